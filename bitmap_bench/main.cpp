@@ -0,0 +1,402 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include "../tools/tools.h"
+#include "../tools/bitmap_ops.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+using lzvk::tools::Bitmap;
+using lzvk::tools::BitmapFormat;
+using lzvk::tools::ResizeFilter;
+
+namespace {
+
+    // Smooth gradient with some high frequency detail, in [0, 1] so every sRGB branch is taken
+    Bitmap makeImage(int size) {
+
+        Bitmap image(size, size, 4, BitmapFormat::Float);
+        float* data = reinterpret_cast<float*>(image.mData.data());
+
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+
+                float* texel = data + 4 * (size_t(y) * size + x);
+                texel[0] = float(x) / size;
+                texel[1] = float(y) / size;
+                texel[2] = float((x ^ y) & 255) / 255.0f;
+                texel[3] = 1.0f;
+            }
+        }
+
+        return image;
+    }
+
+    // Best of a few runs, the first one also pays for faulting in the output
+    double timeRuns(const std::function<void()>& run) {
+
+        double best = 0.0;
+
+        for (int i = 0; i < 3; ++i) {
+
+            auto start = std::chrono::steady_clock::now();
+            run();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            best = i == 0 ? ms : std::min(best, ms);
+        }
+
+        return best;
+    }
+
+    float srgbToLinear(float v) {
+        return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float linearToSrgb(float v) {
+        return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+    }
+
+    uint8_t toByte(float v) {
+        return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+    }
+
+    // The per texel loops the module replaces, clamped to [0, 1] like the module
+
+    void srgbToLinearAccessor(Bitmap& image) {
+
+        for (int y = 0; y < image.mHeight; ++y) {
+            for (int x = 0; x < image.mWidth; ++x) {
+
+                glm::vec4 color = image.getPixelFloat(x, y);
+                glm::vec3 rgb = glm::clamp(glm::vec3(color), 0.0f, 1.0f);
+                image.setPixelFloat(x, y, 0, glm::vec4(srgbToLinear(rgb.r), srgbToLinear(rgb.g), srgbToLinear(rgb.b), color.a));
+            }
+        }
+    }
+
+    Bitmap encodeAccessor(const Bitmap& image) {
+
+        Bitmap result(image.mWidth, image.mHeight, 4, BitmapFormat::UnsignedByte);
+
+        for (int y = 0; y < image.mHeight; ++y) {
+            for (int x = 0; x < image.mWidth; ++x) {
+
+                glm::vec4 color = glm::clamp(image.getPixelFloat(x, y), 0.0f, 1.0f);
+                uint8_t* texel = result.mData.data() + 4 * (size_t(y) * image.mWidth + x);
+                texel[0] = toByte(linearToSrgb(color.r));
+                texel[1] = toByte(linearToSrgb(color.g));
+                texel[2] = toByte(linearToSrgb(color.b));
+                texel[3] = toByte(color.a);
+            }
+        }
+
+        return result;
+    }
+
+    Bitmap decodeAccessor(const Bitmap& image) {
+
+        Bitmap result(image.mWidth, image.mHeight, 4, BitmapFormat::Float);
+
+        for (int y = 0; y < image.mHeight; ++y) {
+            for (int x = 0; x < image.mWidth; ++x) {
+
+                const uint8_t* texel = image.mData.data() + 4 * (size_t(y) * image.mWidth + x);
+                result.setPixelFloat(x, y, 0, glm::vec4(srgbToLinear(texel[0] / 255.0f), srgbToLinear(texel[1] / 255.0f), srgbToLinear(texel[2] / 255.0f), texel[3] / 255.0f));
+            }
+        }
+
+        return result;
+    }
+
+    Bitmap swizzleAccessor(const Bitmap& image) {
+
+        Bitmap result(image.mWidth, image.mHeight, 4, BitmapFormat::Float);
+
+        for (int y = 0; y < image.mHeight; ++y) {
+            for (int x = 0; x < image.mWidth; ++x) {
+
+                glm::vec4 color = image.getPixelFloat(x, y);
+                result.setPixelFloat(x, y, 0, glm::vec4(color.b, color.g, color.r, 1.0f));
+            }
+        }
+
+        return result;
+    }
+
+    Bitmap swizzleBytesAccessor(const Bitmap& image) {
+
+        Bitmap result(image.mWidth, image.mHeight, 4, BitmapFormat::UnsignedByte);
+
+        for (size_t i = 0; i < size_t(image.mWidth) * image.mHeight; ++i) {
+
+            const uint8_t* in = image.mData.data() + 4 * i;
+            uint8_t* out = result.mData.data() + 4 * i;
+            out[0] = in[2];
+            out[1] = in[1];
+            out[2] = in[0];
+            out[3] = 255;
+        }
+
+        return result;
+    }
+
+    // Box taps along one axis, the same weights as downsample: pairs for even sizes, three texels
+    // for odd sizes of 3 or more
+    std::vector<std::pair<int, float>> getBoxTaps(int x, int srcSize, int dstSize) {
+
+        if (srcSize > 1 && srcSize % 2 == 1) {
+            const float n = float(dstSize);
+            return { { 2 * x, (n - x) / srcSize }, { 2 * x + 1, n / srcSize }, { 2 * x + 2, (x + 1.0f) / srcSize } };
+        }
+
+        return { { std::min(2 * x, srcSize - 1), 0.5f }, { std::min(2 * x + 1, srcSize - 1), 0.5f } };
+    }
+
+    Bitmap downsampleAccessor(const Bitmap& image) {
+
+        const int width = std::max(1, image.mWidth / 2);
+        const int height = std::max(1, image.mHeight / 2);
+        Bitmap result(width, height, 4, BitmapFormat::Float);
+
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+
+                glm::vec4 sum(0.0f);
+                for (const auto& [row, rowWeight] : getBoxTaps(y, image.mHeight, height)) {
+                    for (const auto& [column, columnWeight] : getBoxTaps(x, image.mWidth, width)) {
+                        sum += rowWeight * columnWeight * image.getPixelFloat(column, row);
+                    }
+                }
+
+                result.setPixelFloat(x, y, 0, sum);
+            }
+        }
+
+        return result;
+    }
+
+    // Largest difference over every channel, relative to the expected value once that is above 1
+    bool verifyFloat(const std::string& name, const Bitmap& expected, const Bitmap& actual, float tolerance) {
+
+        float maxError = 0.0f;
+        bool sameSize = expected.mWidth == actual.mWidth && expected.mHeight == actual.mHeight && expected.mChannels == actual.mChannels &&
+                        actual.mFormat == BitmapFormat::Float;
+
+        for (int y = 0; sameSize && y < expected.mHeight; ++y) {
+            for (int x = 0; x < expected.mWidth; ++x) {
+
+                glm::vec4 e = expected.getPixelFloat(x, y);
+                glm::vec4 a = actual.getPixelFloat(x, y);
+
+                for (int c = 0; c < 4; ++c) {
+                    float error = std::abs(a[c] - e[c]) / std::max(1.0f, std::abs(e[c]));
+                    maxError = std::isnan(error) ? INFINITY : std::max(maxError, error);
+                }
+            }
+        }
+
+        bool ok = sameSize && maxError <= tolerance;
+        std::cout << "[BitmapBench] verify " << name << ": ";
+
+        if (sameSize) {
+            std::cout << "max error " << maxError;
+        }
+        else {
+            std::cout << "size differs";
+        }
+
+        std::cout << (ok ? ", ok" : ", MISMATCH") << std::endl;
+
+        return ok;
+    }
+
+    bool verifyBytes(const std::string& name, const Bitmap& expected, const Bitmap& actual, int tolerance) {
+
+        int maxError = 0;
+        bool sameSize = expected.mData.size() == actual.mData.size() && actual.mFormat == BitmapFormat::UnsignedByte;
+
+        for (size_t i = 0; sameSize && i < expected.mData.size(); ++i) {
+            maxError = std::max(maxError, std::abs(int(expected.mData[i]) - int(actual.mData[i])));
+        }
+
+        bool ok = sameSize && maxError <= tolerance;
+        std::cout << "[BitmapBench] verify " << name << ": ";
+
+        if (sameSize) {
+            std::cout << "max error " << maxError;
+        }
+        else {
+            std::cout << "size differs";
+        }
+
+        std::cout << (ok ? ", ok" : ", MISMATCH") << std::endl;
+
+        return ok;
+    }
+
+    // The bulk operations against the accessor loops, on every thread so the row interleaving is
+    // checked too. The AVX2 sRGB curves are polynomials, so they get a small tolerance
+    bool verify(const Bitmap& image) {
+
+        const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const std::vector<int> bgrx = { 2, 1, 0, lzvk::tools::SWIZZLE_ONE };
+        bool ok = true;
+
+        std::cout << "[BitmapBench] verifying " << image.mWidth << "x" << image.mHeight << " RGBA" << std::endl;
+
+        // 1 Point operations
+        const Bitmap bytes = encodeAccessor(image);
+
+        ok = verifyFloat("RGBA8 sRGB to float", decodeAccessor(bytes), lzvk::tools::convertFormat(bytes, BitmapFormat::Float, true, threadCount), 1e-6f) && ok;
+        ok = verifyBytes("float to RGBA8 sRGB", bytes, lzvk::tools::convertFormat(image, BitmapFormat::UnsignedByte, true, threadCount), 1) && ok;
+
+        Bitmap expected = image;
+        Bitmap actual = image;
+        srgbToLinearAccessor(expected);
+        lzvk::tools::srgbToLinear(actual, threadCount);
+        ok = verifyFloat("sRGB to linear in place", expected, actual, 1e-5f) && ok;
+
+        ok = verifyFloat("swizzle BGR1", swizzleAccessor(image), lzvk::tools::swizzleChannels(image, bgrx, threadCount), 0.0f) && ok;
+        ok = verifyBytes("RGBA8 swizzle BGR1", swizzleBytesAccessor(bytes), lzvk::tools::swizzleChannels(bytes, bgrx, threadCount), 0) && ok;
+
+        // 2 Filtering
+        ok = verifyFloat("box downsample", downsampleAccessor(image), lzvk::tools::downsample(image, ResizeFilter::Box, threadCount), 1e-6f) && ok;
+
+        // 3 Every box level, e.g. 1021 goes through odd and even sizes
+        const std::vector<Bitmap> levels = lzvk::tools::generateMipLevels(image, ResizeFilter::Box, threadCount);
+        for (size_t level = 1; level < levels.size(); ++level) {
+            ok = verifyFloat("box mip " + std::to_string(level), downsampleAccessor(levels[level - 1]), levels[level], 1e-6f) && ok;
+        }
+
+        return ok;
+    }
+
+    void report(const std::string& name, double texels, double accessorMs, double singleMs, double parallelMs, uint32_t threadCount) {
+
+        std::cout << "[BitmapBench] " << name << ": ";
+
+        if (accessorMs > 0.0) {
+            std::cout << "accessors " << accessorMs << " ms, ";
+        }
+
+        std::cout << "1 thread " << singleMs << " ms (" << texels / (singleMs * 1000.0) << " Mtexel/s), "
+                  << threadCount << " threads " << parallelMs << " ms (" << texels / (parallelMs * 1000.0) << " Mtexel/s)";
+
+        if (accessorMs > 0.0) {
+            std::cout << ", " << accessorMs / parallelMs << "x";
+        }
+
+        std::cout << std::endl;
+    }
+
+    void benchmark(const Bitmap& image) {
+
+        const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const double texels = double(image.mWidth) * image.mHeight;
+
+        std::cout << "[BitmapBench] " << image.mWidth << "x" << image.mHeight << " RGBA" << std::endl;
+
+        // 1 Point operations
+        const Bitmap bytes = lzvk::tools::convertFormat(image, BitmapFormat::UnsignedByte, true);
+
+        report("RGBA8 sRGB to float", texels,
+            timeRuns([&] { decodeAccessor(bytes); }),
+            timeRuns([&] { lzvk::tools::convertFormat(bytes, BitmapFormat::Float, true, 1); }),
+            timeRuns([&] { lzvk::tools::convertFormat(bytes, BitmapFormat::Float, true, threadCount); }), threadCount);
+
+        report("float to RGBA8 sRGB", texels, 0.0,
+            timeRuns([&] { lzvk::tools::convertFormat(image, BitmapFormat::UnsignedByte, true, 1); }),
+            timeRuns([&] { lzvk::tools::convertFormat(image, BitmapFormat::UnsignedByte, true, threadCount); }), threadCount);
+
+        Bitmap scratch = image;
+        report("sRGB to linear in place", texels,
+            timeRuns([&] { scratch = image; srgbToLinearAccessor(scratch); }),
+            timeRuns([&] { scratch = image; lzvk::tools::srgbToLinear(scratch, 1); }),
+            timeRuns([&] { scratch = image; lzvk::tools::srgbToLinear(scratch, threadCount); }), threadCount);
+
+        const std::vector<int> bgrx = { 2, 1, 0, lzvk::tools::SWIZZLE_ONE };
+        report("swizzle BGR1", texels,
+            timeRuns([&] { swizzleAccessor(image); }),
+            timeRuns([&] { lzvk::tools::swizzleChannels(image, bgrx, 1); }),
+            timeRuns([&] { lzvk::tools::swizzleChannels(image, bgrx, threadCount); }), threadCount);
+
+        // 2 Filtering
+        report("box downsample", texels,
+            timeRuns([&] { downsampleAccessor(image); }),
+            timeRuns([&] { lzvk::tools::downsample(image, ResizeFilter::Box, 1); }),
+            timeRuns([&] { lzvk::tools::downsample(image, ResizeFilter::Box, threadCount); }), threadCount);
+
+        report("Kaiser downsample", texels, 0.0,
+            timeRuns([&] { lzvk::tools::downsample(image, ResizeFilter::Kaiser, 1); }),
+            timeRuns([&] { lzvk::tools::downsample(image, ResizeFilter::Kaiser, threadCount); }), threadCount);
+
+        report("triangle resize to 3/4", texels, 0.0,
+            timeRuns([&] { lzvk::tools::resize(image, image.mWidth * 3 / 4, image.mHeight * 3 / 4, ResizeFilter::Triangle, 1); }),
+            timeRuns([&] { lzvk::tools::resize(image, image.mWidth * 3 / 4, image.mHeight * 3 / 4, ResizeFilter::Triangle, threadCount); }), threadCount);
+
+        report("Kaiser mip chain", texels, 0.0,
+            timeRuns([&] { lzvk::tools::generateMipLevels(image, ResizeFilter::Kaiser, 1); }),
+            timeRuns([&] { lzvk::tools::generateMipLevels(image, ResizeFilter::Kaiser, threadCount); }), threadCount);
+    }
+}
+
+// BitmapBench [--verify] [image] [...]
+// Without images runs a generated 2K image, otherwise each given image read as float RGBA.
+// --verify compares the results against the accessor loops instead of timing them, adds an odd
+// sized image for the remainders and edges and exits with 1 on a mismatch
+int main(int argc, char** argv) {
+
+    const bool verifyOnly = argc > 1 && std::string(argv[1]) == "--verify";
+    const int firstImage = verifyOnly ? 2 : 1;
+    bool ok = true;
+
+    std::cout << "[BitmapBench] " << (lzvk::tools::Tools::isSimdEnabled() ? "AVX2" : "SSE2") << " kernels" << std::endl;
+
+    try {
+
+        if (argc <= firstImage) {
+
+            if (verifyOnly) {
+                ok = verify(makeImage(2048)) && ok;
+                ok = verify(makeImage(1021)) && ok;
+            }
+            else {
+                benchmark(makeImage(2048));
+            }
+
+            return ok ? 0 : 1;
+        }
+
+        for (int i = firstImage; i < argc; ++i) {
+
+            int width = 0, height = 0, channels = 0;
+            float* pixels = stbi_loadf(argv[i], &width, &height, &channels, 4);
+
+            if (!pixels) {
+                std::cout << "[BitmapBench] failed to read " << argv[i] << ", skipped" << std::endl;
+                continue;
+            }
+
+            Bitmap image(width, height, 4, BitmapFormat::Float, pixels);
+            stbi_image_free(pixels);
+
+            if (verifyOnly) {
+                ok = verify(image) && ok;
+            }
+            else {
+                benchmark(image);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return ok ? 0 : 1;
+}
@@ -3,6 +3,8 @@
 #include "../imgui/imgui.h"                     
 #include "../imgui/imgui_impl_vulkan.h"
 #include "../imgui/imgui_impl_glfw.h"
+#include <future>
+#include <chrono>
 
 namespace lzvk::core {
 
@@ -47,7 +49,9 @@ namespace lzvk::core {
 
 	void Application::initVulkan() {
 
-		// 1 Set up environment
+		// 1 Set up environment, shaders come from the packed archive when the build produced one
+		lzvk::wrapper::Shader::setArchive(lzvk::wrapper::ShaderArchive::open("shaders.pak"));
+
 		mInstance = lzvk::wrapper::Instance::create(true);
 		mSurface = lzvk::wrapper::Surface::create(mInstance, mWindow);
 		mDevice = lzvk::wrapper::Device::create(mInstance, mSurface);
@@ -56,12 +60,9 @@ namespace lzvk::core {
 		mWidth = mSwapChain->getExtent().width;
 		mHeight = mSwapChain->getExtent().height;
 
-		// 2 create resources and frame buffer
-		// 2.1 pass 01 geometry
-		createShadowMap();
-		createGeometryFramebuffer();
+		// 2 create the frame graph, it owns the per-frame images and framebuffers
+		createFrameGraph();
 		createSSAOResources();
-		createBlurImages();
 
 		// 3 create scene buffer
 		createSceneBuffers();
@@ -76,12 +77,7 @@ namespace lzvk::core {
 		createEnvironmentMap();
 
 		// 5 create pipeline
-		createShadowPipeline();
-		createSkyboxPipeline();
-		createSceneGraphPipeline();
-		createSSAOPipeline();
-		createBlurPipelines();
-		createCombinePipeline();
+		createPipelines();
 
 		// 6 create command buffers
 		createCommandBuffers();
@@ -89,142 +85,221 @@ namespace lzvk::core {
 		// 7 create sync
 		createSyncObjects();
 
+		// 8 submit pending uploads, the first frame is ordered after them on the graphic queue
+		auto uploadManager = mDevice->getUploadManager();
+		uploadManager->flush();
+
+		printf("[Application] uploaded %.1f MB in %u batches\n", uploadManager->getUploadedBytes() / (1024.0 * 1024.0), uploadManager->getSubmitCount());
+		printf("[Application] %u live samplers shared by %u requests\n", lzvk::wrapper::Sampler::getLiveCount(), lzvk::wrapper::Sampler::getRequestCount());
 	}
 
 	void Application::createEnvironmentMap() {
 
-		// 1 Cube map
-		mSkyboxCube = lzvk::renderer::CubeMapTexture::create(mDevice, mCommandPool, "assets/skybox/immenstadter_horn_2k_prefilter.ktx");
-		mIrradianceCube = lzvk::renderer::CubeMapTexture::create(mDevice, mCommandPool, "assets/skybox/immenstadter_horn_2k_irradiance.ktx");
+		// 1 Bake the environment from its equirectangular HDR, another .hdr only needs another path.
+		// The bake is cached, a warm start only reads it back
+		auto start = std::chrono::steady_clock::now();
 
-		auto cmd2 = lzvk::wrapper::CommandBuffer::create(mDevice, mCommandPool);
-		cmd2->begin();
-		cmd2->transitionImageLayout(
-			mSkyboxCube->getImage()->getImage(),
-			mSkyboxCube->getImage()->getFormat(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			0, 6
-		);
+		const uint64_t bakeKey = lzvk::tools::getBakedEnvironmentKey(ENVIRONMENT_PATH);
 
-		cmd2->transitionImageLayout(
-			mIrradianceCube->getImage()->getImage(),
-			mIrradianceCube->getImage()->getFormat(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			0, 6
-		);
+		lzvk::tools::BakedEnvironment environment{};
+		bool cached = lzvk::tools::loadBakedEnvironment(ENVIRONMENT_CACHE_PATH, bakeKey, environment);
+
+		if (!cached) {
+
+			lzvk::tools::Bitmap equirect = lzvk::renderer::CubeMapTexture::loadHdr(ENVIRONMENT_PATH);
+			environment = lzvk::tools::bakeEnvironment(equirect);
+			lzvk::tools::saveBakedEnvironment(ENVIRONMENT_CACHE_PATH, bakeKey, environment);
+		}
+
+		// 2 The skybox shows level 0 of the specular chain, the scene reads the chain by roughness, the diffuse part is SH irradiance
+		mSkyboxCube = lzvk::renderer::CubeMapTexture::create(mDevice, environment.specularLevels);
 
-		cmd2->end();
-		cmd2->submitSync(mDevice->getGraphicQueue());
-		
-		// 5. generate irradiance texture
 		mSkyboxUniformManager->updateCubeMap(mDescriptorSet_Skybox, mSkyboxCube, 0);
-		mSkyboxUniformManager->updateIrradianceMap(mDescriptorSet_Skybox, mIrradianceCube, 0);
+		mSkyboxUniformManager->updateIrradianceSH(environment.irradiance);
+
+		// 3 The ImGui panel can time the GPU conversion only where it runs
+		mEnvironmentComputeSupported = lzvk::renderer::CubeMapTexture::isComputeConversionSupported(mDevice);
+		if (!mEnvironmentComputeSupported) {
+			mEnvironmentConversion = lzvk::renderer::CubeMapConversion::Cpu;
+		}
+
+		double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		if (cached) {
+			printf("[Application] loaded the bake of %s from %s in %.1f ms\n", ENVIRONMENT_PATH, ENVIRONMENT_CACHE_PATH, totalMs);
+		}
+		else {
+			printf("[Application] baked %s in %.1f ms: faces %.1f ms, SH irradiance %.1f ms, %zu specular levels %.1f ms\n", ENVIRONMENT_PATH, totalMs,
+				   environment.cubeMs, environment.irradianceMs, environment.specularLevels.size(), environment.specularMs);
+		}
 	}
 
-	void Application::createShadowMap() {
+	void Application::timeEnvironmentConversion() {
 
-		mImage_Shadow = lzvk::wrapper::Image::create(
-			mDevice,
-			mShadowMapRes, mShadowMapRes,
-			lzvk::wrapper::Image::findDepthFormat(mDevice),
-			VK_IMAGE_TYPE_2D,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_SAMPLE_COUNT_1_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_IMAGE_ASPECT_DEPTH_BIT
-		);
+		// 1 Convert the HDR again without the bake, the skybox keeps the baked chain
+		auto cube = lzvk::renderer::CubeMapTexture::create(mDevice, mCommandPool, ENVIRONMENT_PATH, mEnvironmentConversion);
 
-		mFramebuffer_Shadow = lzvk::wrapper::Framebuffer::create(mDevice, mShadowMapRes, mShadowMapRes, true);
-		mFramebuffer_Shadow->addDepthAttachment(mImage_Shadow);
+		// 2 The CPU path only recorded its upload, wait for it so both times end with the cube on the GPU
+		auto start = std::chrono::steady_clock::now();
+
+		auto uploadManager = mDevice->getUploadManager();
+		uploadManager->wait(uploadManager->flush());
+
+		const int index = static_cast<int>(cube->getConversion());
+		mEnvironmentConversionMs[index] = cube->getConversionMs();
+		mEnvironmentUploadMs[index] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		printf("[Application] %s to a cube map on the %s: %.1f ms, upload wait %.1f ms\n", ENVIRONMENT_PATH,
+			   cube->getConversion() == lzvk::renderer::CubeMapConversion::Compute ? "GPU" : "CPU", mEnvironmentConversionMs[index], mEnvironmentUploadMs[index]);
 	}
 
-	void Application::createGeometryFramebuffer() {
-		
-		// 1 color image
-		mColorImage_Geometry = lzvk::wrapper::Image::create(
-			mDevice,
-			mWidth, mHeight,
-			VK_FORMAT_R16G16B16A16_SFLOAT,
-			VK_IMAGE_TYPE_2D,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_SAMPLE_COUNT_1_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT
-		);
+	void Application::createFrameGraph() {
 
+		// 1 Drop everything that still refers to the images of the previous graph
+		mTexture_Shadow.reset();
+		mDepthTexture_SSAO.reset();
+		mDepthTexture_Blur.reset();
+		mAOTexture_SSAO.reset();
+		mAOTexture_BlurPing.reset();
+		mAOTexture_BlurPong.reset();
+		mColorTexture_Combine.reset();
+		mAOTexture_Combine.reset();
 
+		mFramebuffer_Shadow.reset();
+		mFramebuffer_Geometry.reset();
+		mFramebuffer_Visibility.reset();
 
-		// 2 depth image
-		mDepthImage_Geometry = lzvk::wrapper::Image::create(
-			mDevice,
-			mWidth, mHeight,
-			lzvk::wrapper::Image::findDepthFormat(mDevice),
-			VK_IMAGE_TYPE_2D,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT,
-			VK_SAMPLE_COUNT_1_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_IMAGE_ASPECT_DEPTH_BIT
-		);
+		mImage_Shadow.reset();
+		mColorImage_Geometry.reset();
+		mDepthImage_Geometry.reset();
+		mVisibilityImage_Geometry.reset();
+		mAOImage_SSAO.reset();
+		mAOImage_BlurPing.reset();
+		mAOImage_BlurPong.reset();
+		mFinalAOImage.reset();
 
+		// the views are recreated, cached descriptors could match a reused handle
+		std::vector<lzvk::wrapper::DescriptorSet::Ptr> graphSets{ mDescriptorSet_Shadow, mDescriptorSet_SSAO, mDescriptorSet_Combine, mDescriptorSet_Visibility };
+		graphSets.insert(graphSets.end(), mDescriptorSet_BlurH.begin(), mDescriptorSet_BlurH.end());
+		graphSets.insert(graphSets.end(), mDescriptorSet_BlurV.begin(), mDescriptorSet_BlurV.end());
+
+		for (const auto& descriptorSet : graphSets) {
+			if (descriptorSet) {
+				descriptorSet->invalidate();
+			}
+		}
+
+		mFrameGraph.reset();
+		mFrameGraph = lzvk::renderer::FrameGraph::create(mDevice);
+
+		using lzvk::wrapper::ImageAccess;
+
+		// 2 Images, all of them only live within a frame
+		VkFormat depthFormat = lzvk::wrapper::Image::findDepthFormat(mDevice);
+		VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		VkImageUsageFlags aoUsage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+		auto shadow = mFrameGraph->createImage("shadow map", { mShadowMapRes, mShadowMapRes, depthFormat, depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT });
+		auto color = mFrameGraph->createImage("scene color", { mWidth, mHeight, COLOR_FORMAT,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT });
+		auto depth = mFrameGraph->createImage("scene depth", { mWidth, mHeight, depthFormat, depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT });
+		auto visibility = mFrameGraph->createImage("visibility", { mWidth, mHeight, VISIBILITY_FORMAT,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT });
+		auto ao = mFrameGraph->createImage("ssao", { mWidth, mHeight, VK_FORMAT_R8G8B8A8_UNORM, aoUsage, VK_IMAGE_ASPECT_COLOR_BIT });
+		auto ping = mFrameGraph->createImage("blur ping", { mWidth, mHeight, VK_FORMAT_R8G8B8A8_UNORM, aoUsage, VK_IMAGE_ASPECT_COLOR_BIT });
+		auto pong = mFrameGraph->createImage("blur pong", { mWidth, mHeight, VK_FORMAT_R8G8B8A8_UNORM, aoUsage, VK_IMAGE_ASPECT_COLOR_BIT });
+
+		// 3 Passes in recording order
+		auto shadowPass = mFrameGraph->addPass("shadow", [this](const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
+			recordShadowPass(cmd);
+			writeTimestamp(cmd, 1);
+		});
+		mFrameGraph->write(shadowPass, shadow, ImageAccess::DepthAttachment);
+
+		// 3.1 The geometry path decides which passes write the scene color
+		if (mGeometryMode == GeometryMode::VisibilityBuffer && mVisibilityPipeline) {
+
+			auto rasterPass = mFrameGraph->addPass("visibility raster", [this](const lzvk::wrapper::CommandBuffer::Ptr& cmd) { recordVisibilityPass(cmd); });
+			mFrameGraph->write(rasterPass, visibility, ImageAccess::ColorAttachment);
+			mFrameGraph->write(rasterPass, depth, ImageAccess::DepthAttachment);
+
+			auto resolvePass = mFrameGraph->addPass("visibility resolve", [this](const lzvk::wrapper::CommandBuffer::Ptr& cmd) { recordVisibilityResolvePass(cmd); });
+			mFrameGraph->read(resolvePass, visibility, ImageAccess::StorageCompute);
+			mFrameGraph->read(resolvePass, shadow, ImageAccess::SampledCompute);
+			mFrameGraph->write(resolvePass, color, ImageAccess::StorageCompute);
+		}
+		else {
+
+			auto geometryPass = mFrameGraph->addPass("geometry", [this](const lzvk::wrapper::CommandBuffer::Ptr& cmd) { recordGeometryPass(cmd); });
+			mFrameGraph->read(geometryPass, shadow, ImageAccess::SampledFragment);
+			mFrameGraph->write(geometryPass, color, ImageAccess::ColorAttachment);
+			mFrameGraph->write(geometryPass, depth, ImageAccess::DepthAttachment);
+		}
+
+		// 3.2 SSAO and the ping-pong blur, every direction is its own pass
+		auto ssaoPass = mFrameGraph->addPass("ssao", [this](const lzvk::wrapper::CommandBuffer::Ptr& cmd) { recordSSAOPass(cmd); });
+		mFrameGraph->read(ssaoPass, depth, ImageAccess::SampledCompute);
+		mFrameGraph->write(ssaoPass, ao, ImageAccess::StorageCompute);
+
+		lzvk::renderer::FrameGraphResource finalAO = ao;
+
+		for (int i = 0; i < mBlurPassCount; ++i) {
+
+			auto horizontalPass = mFrameGraph->addPass("blur horizontal " + std::to_string(i), [this, i](const lzvk::wrapper::CommandBuffer::Ptr& cmd) { recordBlurPass(cmd, i, false); });
+			mFrameGraph->read(horizontalPass, depth, ImageAccess::SampledCompute);
+			mFrameGraph->read(horizontalPass, finalAO, ImageAccess::SampledCompute);
+			mFrameGraph->write(horizontalPass, ping, ImageAccess::StorageCompute);
+
+			auto verticalPass = mFrameGraph->addPass("blur vertical " + std::to_string(i), [this, i](const lzvk::wrapper::CommandBuffer::Ptr& cmd) { recordBlurPass(cmd, i, true); });
+			mFrameGraph->read(verticalPass, depth, ImageAccess::SampledCompute);
+			mFrameGraph->read(verticalPass, ping, ImageAccess::SampledCompute);
+			mFrameGraph->write(verticalPass, pong, ImageAccess::StorageCompute);
+
+			finalAO = pong;
+		}
+
+		// 3.3 Swapchain passes, the graph doesn't see their output so they are never culled
+		auto combinePass = mFrameGraph->addPass("combine", [this](const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
+			writeTimestamp(cmd, 4);
+			recordCombinePass(cmd, mSwapChainImageIndex);
+			writeTimestamp(cmd, 5);
+		}, true);
+		mFrameGraph->read(combinePass, color, ImageAccess::SampledFragment);
+		mFrameGraph->read(combinePass, finalAO, ImageAccess::SampledFragment);
+
+		mFrameGraph->addPass("imgui", [this](const lzvk::wrapper::CommandBuffer::Ptr& cmd) { recordImGuiPass(cmd, mSwapChainImageIndex); }, true);
+
+		// 4 Compile and pick up the images, unused ones stay null
+		mFrameGraph->compile();
+
+		mImage_Shadow = mFrameGraph->getImage(shadow);
+		mColorImage_Geometry = mFrameGraph->getImage(color);
+		mDepthImage_Geometry = mFrameGraph->getImage(depth);
+		mVisibilityImage_Geometry = mFrameGraph->getImage(visibility);
+		mAOImage_SSAO = mFrameGraph->getImage(ao);
+		mAOImage_BlurPing = mFrameGraph->getImage(ping);
+		mAOImage_BlurPong = mFrameGraph->getImage(pong);
+		mFinalAOImage = mFrameGraph->getImage(finalAO);
+
+		// 5 Framebuffers
+		mFramebuffer_Shadow = lzvk::wrapper::Framebuffer::create(mDevice, mShadowMapRes, mShadowMapRes, true);
+		mFramebuffer_Shadow->addDepthAttachment(mImage_Shadow);
 
-		// 3 create framebuffer
 		mFramebuffer_Geometry = lzvk::wrapper::Framebuffer::create(mDevice, mWidth, mHeight, true);
 		mFramebuffer_Geometry->addColorAttachment(mColorImage_Geometry);
 		mFramebuffer_Geometry->addDepthAttachment(mDepthImage_Geometry);
-	}
-
-	void Application::createSSAOResources() {
 
-		mRotationTexture = lzvk::renderer::Texture::create(mDevice, mCommandPool, "assets/ssao/rot_texture.bmp");
-		mAOImage_SSAO = lzvk::wrapper::Image::create(
-			mDevice,
-			mWidth, mHeight,
-			VK_FORMAT_R8G8B8A8_UNORM,
-			VK_IMAGE_TYPE_2D,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-			VK_SAMPLE_COUNT_1_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT
-		);
+		if (mVisibilityImage_Geometry) {
 
+			mFramebuffer_Visibility = lzvk::wrapper::Framebuffer::create(mDevice, mWidth, mHeight, true);
+			mFramebuffer_Visibility->addColorAttachment(mVisibilityImage_Geometry);
+			mFramebuffer_Visibility->addDepthAttachment(mDepthImage_Geometry);
+		}
 	}
 
-	void Application::createBlurImages() {
-
-		mAOImage_BlurPing = lzvk::wrapper::Image::create(
-			mDevice,
-			mWidth, mHeight,
-			VK_FORMAT_R8G8B8A8_UNORM,
-			VK_IMAGE_TYPE_2D,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_SAMPLE_COUNT_1_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT
-		);
-
-		mAOImage_BlurPong = lzvk::wrapper::Image::create(
-			mDevice,
-			mWidth, mHeight,
-			VK_FORMAT_R8G8B8A8_UNORM,
-			VK_IMAGE_TYPE_2D,
-			VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_SAMPLE_COUNT_1_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT
-		);
+	void Application::createSSAOResources() {
 
+		mRotationTexture = lzvk::renderer::Texture::create(mDevice, "assets/ssao/rot_texture.bmp");
 	}
 
 	void Application::createSceneBuffers() {
@@ -237,13 +312,18 @@ namespace lzvk::core {
 		const std::string sourceModelExterior = "assets/bistro/Exterior/exterior.obj";
 		const std::string sourceModelInterior = "assets/bistro/Interior/interior.obj";
 
+		// caches written with other batch settings or by an older build are rebuilt
+		const uint64_t cacheKey = lzvk::tools::getStaticBatchCacheKey(mStaticBatchSettings);
+
 		// ---------- Load EXTERIOR ----------
 		bool exteriorCacheLoaded =
-			lzvk::loader::loadMeshData(exteriorMeshCache, mMeshDataExterior) &&
-			lzvk::loader::loadScene(exteriorSceneCache, mSceneExterior);
+			lzvk::loader::loadMeshData(exteriorMeshCache, mMeshDataExterior, cacheKey) &&
+			lzvk::loader::loadScene(exteriorSceneCache, mSceneExterior, cacheKey);
 
 		if (!exteriorCacheLoaded) {
-			printf("[Application] Cache not found for EXTERIOR. Loading from OBJ...\n");
+			printf("[Application] No valid cache for EXTERIOR. Loading from OBJ...\n");
+			mMeshDataExterior = {};
+			mSceneExterior = {};
 
 			bool loaded = lzvk::loader::loadMeshFile(sourceModelExterior, mMeshDataExterior, mSceneExterior);
 			if (!loaded) {
@@ -251,14 +331,12 @@ namespace lzvk::core {
 				throw std::runtime_error("Failed to load EXTERIOR mesh file.");
 			}
 
-			// merge foliage
-			lzvk::tools::mergeNodesWithMaterial(mSceneExterior, mMeshDataExterior, "Foliage_Linde_Tree_Large_Orange_Leaves");
-			lzvk::tools::mergeNodesWithMaterial(mSceneExterior, mMeshDataExterior, "Foliage_Linde_Tree_Large_Green_Leaves");
-			lzvk::tools::mergeNodesWithMaterial(mSceneExterior, mMeshDataExterior, "Foliage_Linde_Tree_Large_Trunk");
+			// batch static draws by material and grid cell
+			lzvk::tools::batchStaticDraws(mSceneExterior, mMeshDataExterior, mStaticBatchSettings);
 
 			// save cache
-			lzvk::loader::saveMeshData(exteriorMeshCache, mMeshDataExterior);
-			lzvk::loader::saveScene(exteriorSceneCache, mSceneExterior);
+			lzvk::loader::saveMeshData(exteriorMeshCache, mMeshDataExterior, cacheKey);
+			lzvk::loader::saveScene(exteriorSceneCache, mSceneExterior, cacheKey);
 
 			printf("[Application] EXTERIOR loaded and cached.\n");
 		}
@@ -268,11 +346,13 @@ namespace lzvk::core {
 
 		// ---------- Load INTERIOR ----------
 		bool interiorCacheLoaded =
-			lzvk::loader::loadMeshData(interiorMeshCache, mMeshDataInterior) &&
-			lzvk::loader::loadScene(interiorSceneCache, mSceneInterior);
+			lzvk::loader::loadMeshData(interiorMeshCache, mMeshDataInterior, cacheKey) &&
+			lzvk::loader::loadScene(interiorSceneCache, mSceneInterior, cacheKey);
 
 		if (!interiorCacheLoaded) {
-			printf("[Application] Cache not found for INTERIOR. Loading from OBJ...\n");
+			printf("[Application] No valid cache for INTERIOR. Loading from OBJ...\n");
+			mMeshDataInterior = {};
+			mSceneInterior = {};
 
 			bool loaded = lzvk::loader::loadMeshFile(sourceModelInterior, mMeshDataInterior, mSceneInterior);
 			if (!loaded) {
@@ -280,9 +360,11 @@ namespace lzvk::core {
 				throw std::runtime_error("Failed to load INTERIOR mesh file.");
 			}
 
+			lzvk::tools::batchStaticDraws(mSceneInterior, mMeshDataInterior, mStaticBatchSettings);
+
 			// save cache
-			lzvk::loader::saveMeshData(interiorMeshCache, mMeshDataInterior);
-			lzvk::loader::saveScene(interiorSceneCache, mSceneInterior);
+			lzvk::loader::saveMeshData(interiorMeshCache, mMeshDataInterior, cacheKey);
+			lzvk::loader::saveScene(interiorSceneCache, mSceneInterior, cacheKey);
 
 			printf("[Application] INTERIOR loaded and cached.\n");
 		}
@@ -330,11 +412,30 @@ namespace lzvk::core {
 		lzvk::loader::recalculateGlobalTransforms(mScene);
 
 		mSceneMesh = lzvk::renderer::SceneMeshRenderer::create(mDevice, mCommandPool, mMeshData, mScene, MAX_FRAMES_IN_FLIGHT);
+		mSceneMesh->getTextureStreamer()->setBudget(static_cast<VkDeviceSize>(mTextureBudgetMB) * 1024 * 1024);
 
 	}
 
 	void Application::createDescriptorSets()
 	{
+		// Shaders reading the scene sets 0 - 3, the layouts take their stages from them and
+		// any binding the GLSL and the uniform managers disagree on fails here
+		std::vector<std::string> sceneShaders = {
+			"shaders/shadow/shadow_vs.spv", "shaders/shadow/shadow_fs.spv",
+			"shaders/cubemap/cubemapvs.spv", "shaders/cubemap/cubemapfs.spv",
+			"shaders/scene_graph/scene_graph_vs.spv", "shaders/scene_graph/scene_graph_fs.spv"
+		};
+
+		if (mSceneMesh->isMeshShaderEnabled()) {
+			sceneShaders.insert(sceneShaders.end(), { "shaders/scene_graph/scene_graph_ts.spv", "shaders/scene_graph/scene_graph_ms.spv" });
+		}
+
+		if (mSceneMesh->isVisibilityBufferSupported()) {
+			sceneShaders.insert(sceneShaders.end(), { "shaders/visibility/visibility_vs.spv", "shaders/visibility/visibility_fs.spv", "shaders/visibility/visibility_resolve_comp.spv" });
+		}
+
+		auto sceneReflection = lzvk::wrapper::Shader::reflect(sceneShaders);
+
 		//
 		// ========== Frame Uniform ==========
 		//
@@ -346,7 +447,7 @@ namespace lzvk::core {
 			mFrameUniformManager->getParams();
 
 		mDescriptorSetLayout_Frame = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-		mDescriptorSetLayout_Frame->build(frameParams);
+		mDescriptorSetLayout_Frame->build(frameParams, sceneReflection, 0);
 
 		mDescriptorPool_Frame = lzvk::wrapper::DescriptorPool::create(mDevice);
 		mDescriptorPool_Frame->build(frameParams, MAX_FRAMES_IN_FLIGHT);
@@ -369,7 +470,7 @@ namespace lzvk::core {
 		auto shadowParams = mShadowUniformManager->getParams();
 
 		mDescriptorSetLayout_Shadow = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-		mDescriptorSetLayout_Shadow->build(shadowParams);
+		mDescriptorSetLayout_Shadow->build(shadowParams, sceneReflection, 2);
 
 		mDescriptorPool_Shadow = lzvk::wrapper::DescriptorPool::create(mDevice);
 		mDescriptorPool_Shadow->build(shadowParams, MAX_FRAMES_IN_FLIGHT);
@@ -394,7 +495,7 @@ namespace lzvk::core {
 		auto skyboxParams = mSkyboxUniformManager->getParams();
 
 		mDescriptorSetLayout_Skybox = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-		mDescriptorSetLayout_Skybox->build(skyboxParams);
+		mDescriptorSetLayout_Skybox->build(skyboxParams, sceneReflection, 3);
 
 		mDescriptorPool_Skybox = lzvk::wrapper::DescriptorPool::create(mDevice);
 		mDescriptorPool_Skybox->build(skyboxParams, 1);
@@ -417,7 +518,7 @@ namespace lzvk::core {
 		std::vector<lzvk::wrapper::UniformParameter::Ptr> ssaoParams = mSSAOUniformManager->getParams();
 
 		mDescriptorSetLayout_SSAO = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-		mDescriptorSetLayout_SSAO->build(ssaoParams);
+		mDescriptorSetLayout_SSAO->build(ssaoParams, lzvk::wrapper::Shader::reflect({ "shaders/ssao/ssao_comp.spv" }), 0);
 
 		mDescriptorPool_SSAO = lzvk::wrapper::DescriptorPool::create(mDevice);
 		mDescriptorPool_SSAO->build(ssaoParams, MAX_FRAMES_IN_FLIGHT);
@@ -440,7 +541,7 @@ namespace lzvk::core {
 		std::vector<lzvk::wrapper::UniformParameter::Ptr> blurParams = mBlurUniformManager->getParams();
 
 		mDescriptorSetLayout_Blur = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-		mDescriptorSetLayout_Blur->build(blurParams);
+		mDescriptorSetLayout_Blur->build(blurParams, lzvk::wrapper::Shader::reflect({ "shaders/ssao/blur_comp.spv" }), 0);
 
 		mDescriptorPool_Blur = lzvk::wrapper::DescriptorPool::create(mDevice);
 		mDescriptorPool_Blur->build(blurParams, mBlurPassCount * 2 * MAX_FRAMES_IN_FLIGHT);
@@ -481,7 +582,7 @@ namespace lzvk::core {
 		auto combineParams = mCombineUniformManager->getParams();
 
 		mDescriptorSetLayout_Combine = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-		mDescriptorSetLayout_Combine->build(combineParams);
+		mDescriptorSetLayout_Combine->build(combineParams, lzvk::wrapper::Shader::reflect({ "shaders/ssao/quad_flip_vs.spv", "shaders/ssao/combine_fs.spv" }), 0);
 
 		mDescriptorPool_Combine = lzvk::wrapper::DescriptorPool::create(mDevice);
 		mDescriptorPool_Combine->build(combineParams, MAX_FRAMES_IN_FLIGHT);
@@ -491,6 +592,74 @@ namespace lzvk::core {
 			mDescriptorSetLayout_Combine,
 			mDescriptorPool_Combine,
 			MAX_FRAMES_IN_FLIGHT);
+
+		//
+		// ========== Visibility Resolve Uniform ==========
+		//
+		mVisibilityUniformManager = lzvk::renderer::VisibilityUniformManager::create();
+		mVisibilityUniformManager->init(mDevice, mSceneMesh->getIndexBuffer(), mSceneMesh->getVertexBuffer());
+
+		auto visibilityParams = mVisibilityUniformManager->getParams();
+
+		mDescriptorSetLayout_Visibility = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
+
+		if (mSceneMesh->isVisibilityBufferSupported()) {
+			mDescriptorSetLayout_Visibility->build(visibilityParams, sceneReflection, 4);
+		}
+		else {
+			mDescriptorSetLayout_Visibility->build(visibilityParams);
+		}
+
+		mDescriptorPool_Visibility = lzvk::wrapper::DescriptorPool::create(mDevice);
+		mDescriptorPool_Visibility->build(visibilityParams, MAX_FRAMES_IN_FLIGHT);
+
+		mDescriptorSet_Visibility = lzvk::wrapper::DescriptorSet::create(
+			mDevice, visibilityParams,
+			mDescriptorSetLayout_Visibility,
+			mDescriptorPool_Visibility,
+			MAX_FRAMES_IN_FLIGHT);
+
+		//
+		// ========== Scene Pipeline Layout ==========
+		//
+
+		// the task shader reads the camera position for cone culling
+		if (mSceneMesh->isMeshShaderEnabled()) {
+			mScenePushConstantStages |= VK_SHADER_STAGE_TASK_BIT_EXT;
+		}
+
+		// the visibility resolve binds the most sets, the scene sets plus its own inputs
+		VkPhysicalDeviceProperties props{};
+		vkGetPhysicalDeviceProperties(mDevice->getPhysicalDevice(), &props);
+
+		uint32_t maxSetCount = static_cast<uint32_t>(getSceneSetLayouts().size()) + 1;
+
+		printf("[Application] geometry pipelines bind %zu sets, resolve binds %u, maxBoundDescriptorSets %u\n",
+			getSceneSetLayouts().size(), maxSetCount, props.limits.maxBoundDescriptorSets);
+
+		if (maxSetCount > props.limits.maxBoundDescriptorSets) {
+			throw std::runtime_error("Error: scene pipelines exceed maxBoundDescriptorSets");
+		}
+	}
+
+	std::vector<VkDescriptorSetLayout> Application::getSceneSetLayouts() const {
+
+		return {
+			mDescriptorSetLayout_Frame->getLayout(),
+			mSceneMesh->getDescriptorSetLayout_Static()->getLayout(),
+			mDescriptorSetLayout_Shadow->getLayout(),
+			mDescriptorSetLayout_Skybox->getLayout()
+		};
+	}
+
+	std::vector<VkDescriptorSet> Application::getSceneDescriptorSets() const {
+
+		return {
+			mDescriptorSet_Frame->getDescriptorSet(mCurrentFrame),
+			mSceneMesh->getDescriptorSet_Static()->getDescriptorSet(mCurrentFrame),
+			mDescriptorSet_Shadow->getDescriptorSet(mCurrentFrame),
+			mDescriptorSet_Skybox->getDescriptorSet(0)
+		};
 	}
 
 	void Application::createImGuiDescriptorPool() {
@@ -530,7 +699,7 @@ namespace lzvk::core {
 		init_info.Device = mDevice->getDevice();
 		init_info.QueueFamily = mDevice->getGraphicQueueFamily().value(); 
 		init_info.Queue = mDevice->getGraphicQueue();
-		init_info.PipelineCache = VK_NULL_HANDLE;
+		init_info.PipelineCache = mDevice->getPipelineCache()->getCache();
 		init_info.DescriptorPool = mImGuiDescriptorPool;
 		init_info.MinImageCount = MAX_FRAMES_IN_FLIGHT;
 		init_info.ImageCount = static_cast<uint32_t>(mSwapChain->getImageCount());
@@ -634,30 +803,18 @@ namespace lzvk::core {
 			}
 								 break;
 
-			case PipelineType::Shadow: {
+			case PipelineType::Shadow:
+			case PipelineType::Skybox:
+			case PipelineType::SceneGraph:
+			case PipelineType::SceneGraphMesh:
+			case PipelineType::Visibility: {
 
-				pipeline->mSetLayoutsStorage = {
-				mDescriptorSetLayout_Frame->getLayout(),
-				mSceneMesh->getDescriptorSetLayout_Static()->getLayout(),
-				};
-			}
-								 break;
-			case PipelineType::SceneGraph: {
-
-				pipeline->mSetLayoutsStorage = {
-					mDescriptorSetLayout_Frame->getLayout(),
-					mSceneMesh->getDescriptorSetLayout_Static()->getLayout(),
-					mSceneMesh->getDescriptorSetLayout_Diffuse()->getLayout(),
-					mSceneMesh->getDescriptorSetLayout_Emissive()->getLayout(),
-					mSceneMesh->getDescriptorSetLayout_Normal()->getLayout(),
-					mSceneMesh->getDescriptorSetLayout_Opacity()->getLayout(),
-					mSceneMesh->getDescriptorSetLayout_Specular()->getLayout(),
-					mDescriptorSetLayout_Shadow->getLayout(),
-					mDescriptorSetLayout_Skybox->getLayout()
-				};
+				// identical set layouts and push constant ranges keep the layouts compatible,
+				// each pass binds the scene sets at its start and they survive the pipeline switches within it
+				pipeline->mSetLayoutsStorage = getSceneSetLayouts();
 
 				VkPushConstantRange lightPcRange{
-						VK_SHADER_STAGE_FRAGMENT_BIT,
+						mScenePushConstantStages,
 						0,
 						sizeof(LightPushConstant)
 				};
@@ -665,13 +822,6 @@ namespace lzvk::core {
 
 			}
 									 break;
-			case PipelineType::Skybox: {
-				pipeline->mSetLayoutsStorage = {
-					mDescriptorSetLayout_Frame->getLayout(),
-					mDescriptorSetLayout_Skybox->getLayout()
-				};
-			}
-								 break;
 
 			case PipelineType::Combine: {
 				
@@ -706,6 +856,45 @@ namespace lzvk::core {
 
 	}
 
+	void Application::createPipelines() {
+
+		auto start = std::chrono::high_resolution_clock::now();
+
+		// 1 Every function fills its own pipeline members and only reads shared state, the
+		//   driver compiles them in parallel through the internally synchronized cache
+		std::vector<std::function<void()>> builders = {
+			[this]() { createShadowPipeline(); },
+			[this]() { createSkyboxPipeline(); },
+			[this]() { createSceneGraphPipeline(); },
+			[this]() { createSceneGraphMeshPipeline(); },
+			[this]() { createVisibilityPipelines(); },
+			[this]() { createSSAOPipeline(); },
+			[this]() { createBlurPipelines(); },
+			[this]() { createCombinePipeline(); }
+		};
+
+		std::vector<std::future<void>> tasks{};
+		tasks.reserve(builders.size());
+
+		for (const auto& builder : builders) {
+			tasks.push_back(std::async(std::launch::async, builder));
+		}
+
+		// 2 get() rethrows the first failure on this thread
+		for (auto& task : tasks) {
+			task.get();
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+		auto pipelineCache = mDevice->getPipelineCache();
+		printf("[Application] pipelines created in %.1f ms on %zu threads, %s cache\n", ms, builders.size(), pipelineCache->isWarm() ? "warm" : "cold");
+
+		// 3 Keep the result even if the application doesn't shut down cleanly
+		pipelineCache->save();
+	}
+
 	void Application::createShadowPipeline() {
 
 		mShadowPipeline = lzvk::wrapper::Pipeline::create(mDevice);
@@ -745,7 +934,7 @@ namespace lzvk::core {
 	void Application::createSkyboxPipeline() {
 
 		mSkyboxPipeline = lzvk::wrapper::Pipeline::create(mDevice);
-		mSkyboxPipeline->setColorAttachmentFormats({ mColorImage_Geometry->getFormat() });
+		mSkyboxPipeline->setColorAttachmentFormats({ COLOR_FORMAT });
 
 		VkFormat depthFormat = mDepthImage_Geometry->getFormat();
 		mSkyboxPipeline->setDepthAttachmentFormat(depthFormat);
@@ -781,7 +970,7 @@ namespace lzvk::core {
 	void Application::createSceneGraphPipeline() {
 
 		mSceneGraphPipeline = lzvk::wrapper::Pipeline::create(mDevice);
-		mSceneGraphPipeline->setColorAttachmentFormats({ mColorImage_Geometry->getFormat() });
+		mSceneGraphPipeline->setColorAttachmentFormats({ COLOR_FORMAT });
 		
 		VkFormat depthFormat = mDepthImage_Geometry->getFormat();
 
@@ -812,6 +1001,85 @@ namespace lzvk::core {
 		mSceneGraphPipeline->build();
 	}
 
+	void Application::createSceneGraphMeshPipeline() {
+
+		if (!mSceneMesh->isMeshShaderEnabled()) {
+			printf("[Application] VK_EXT_mesh_shader not available, using the indirect draw path\n");
+			return;
+		}
+
+		mSceneGraphMeshPipeline = lzvk::wrapper::Pipeline::create(mDevice);
+		mSceneGraphMeshPipeline->setColorAttachmentFormats({ COLOR_FORMAT });
+
+		VkFormat depthFormat = mDepthImage_Geometry->getFormat();
+
+		mSceneGraphMeshPipeline->setDepthAttachmentFormat(depthFormat);
+		if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+			mSceneGraphMeshPipeline->setStencilAttachmentFormat(depthFormat);
+		}
+
+		// task and mesh stages replace vertex input, the fragment shader is shared
+		std::vector<lzvk::wrapper::Shader::Ptr> shaderGroup{};
+		shaderGroup.push_back(lzvk::wrapper::Shader::create(mDevice, "shaders/scene_graph/scene_graph_ts.spv", VK_SHADER_STAGE_TASK_BIT_EXT, "main"));
+		shaderGroup.push_back(lzvk::wrapper::Shader::create(mDevice, "shaders/scene_graph/scene_graph_ms.spv", VK_SHADER_STAGE_MESH_BIT_EXT, "main"));
+		shaderGroup.push_back(lzvk::wrapper::Shader::create(mDevice, "shaders/scene_graph/scene_graph_fs.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "main"));
+		mSceneGraphMeshPipeline->setShaderGroup(shaderGroup);
+
+		applyCommonPipelineState(mSceneGraphMeshPipeline, true, VK_CULL_MODE_BACK_BIT, PipelineType::SceneGraphMesh);
+
+		mSceneGraphMeshPipeline->build();
+	}
+
+	void Application::createVisibilityPipelines() {
+
+		if (!mSceneMesh->isVisibilityBufferSupported()) {
+			printf("[Application] Scene does not fit the visibility id, using the forward path\n");
+			return;
+		}
+
+		// 1 raster pass writing triangle ids
+		mVisibilityPipeline = lzvk::wrapper::Pipeline::create(mDevice);
+		mVisibilityPipeline->setColorAttachmentFormats({ VISIBILITY_FORMAT });
+
+		VkFormat depthFormat = mDepthImage_Geometry->getFormat();
+
+		mVisibilityPipeline->setDepthAttachmentFormat(depthFormat);
+		if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
+			mVisibilityPipeline->setStencilAttachmentFormat(depthFormat);
+		}
+
+		std::vector<lzvk::wrapper::Shader::Ptr> shaderGroup{};
+		shaderGroup.push_back(lzvk::wrapper::Shader::create(mDevice, "shaders/visibility/visibility_vs.spv", VK_SHADER_STAGE_VERTEX_BIT, "main"));
+		shaderGroup.push_back(lzvk::wrapper::Shader::create(mDevice, "shaders/visibility/visibility_fs.spv", VK_SHADER_STAGE_FRAGMENT_BIT, "main"));
+		mVisibilityPipeline->setShaderGroup(shaderGroup);
+
+		auto vertexBindingDes = mSceneMesh->getVertexInputBindingDescriptions();
+		auto attributeDes = mSceneMesh->getAttributeDescriptions();
+		mVisibilityPipeline->mVertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexBindingDes.size());
+		mVisibilityPipeline->mVertexInputState.pVertexBindingDescriptions = vertexBindingDes.data();
+		mVisibilityPipeline->mVertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDes.size());
+		mVisibilityPipeline->mVertexInputState.pVertexAttributeDescriptions = attributeDes.data();
+
+		mVisibilityPipeline->mAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		mVisibilityPipeline->mAssemblyState.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		mVisibilityPipeline->mAssemblyState.primitiveRestartEnable = VK_FALSE;
+
+		applyCommonPipelineState(mVisibilityPipeline, true, VK_CULL_MODE_BACK_BIT, PipelineType::Visibility);
+
+		mVisibilityPipeline->build();
+
+		// 2 compute resolve, scene sets 0 - 3 as in the forward pass plus the visibility inputs
+		mVisibilityResolvePipeline = lzvk::wrapper::ComputePipeline::create(mDevice);
+
+		auto resolveShader = lzvk::wrapper::Shader::create(mDevice, "shaders/visibility/visibility_resolve_comp.spv", VK_SHADER_STAGE_COMPUTE_BIT, "main");
+		mVisibilityResolvePipeline->setShader(resolveShader);
+
+		auto resolveLayouts = getSceneSetLayouts();
+		resolveLayouts.push_back(mDescriptorSetLayout_Visibility->getLayout());
+		mVisibilityResolvePipeline->setDescriptorSetLayouts(resolveLayouts);
+		mVisibilityResolvePipeline->build();
+	}
+
 	void Application::createSSAOPipeline() {
 
 		mSSAOPipeline = lzvk::wrapper::ComputePipeline::create(mDevice);
@@ -850,14 +1118,9 @@ namespace lzvk::core {
 		// 1 create pipeline
 		mCombinePipeline = lzvk::wrapper::Pipeline::create(mDevice);
 
+		// a fullscreen triangle straight into the swapchain, no depth attachment
 		mCombinePipeline->setColorAttachmentFormats({ mSwapChain->getFormat() });
 
-		VkFormat depthFormat = mSwapChain->getDepthImageFormat();
-		mCombinePipeline->setDepthAttachmentFormat(depthFormat);
-		if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT) {
-			mCombinePipeline->setStencilAttachmentFormat(depthFormat);
-		}
-
 		// 2.set shader group
 		std::vector<lzvk::wrapper::Shader::Ptr> shaderGroup{};
 		shaderGroup.push_back(lzvk::wrapper::Shader::create(mDevice, "shaders/ssao/quad_flip_vs.spv", VK_SHADER_STAGE_VERTEX_BIT, "main"));
@@ -891,20 +1154,41 @@ namespace lzvk::core {
 			mCommandBuffers[i] = lzvk::wrapper::CommandBuffer::create(mDevice, mCommandPool);
 
 		}
+
+		// gpu pass timings
+		for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+
+			auto pool = lzvk::wrapper::QueryPool::create(mDevice, GPU_TIMESTAMP_COUNT);
+			if (!pool->isTimestampSupported()) {
+				break;
+			}
+
+			mTimestampPools.push_back(pool);
+		}
+
+		mTimestampsWritten.assign(mTimestampPools.size(), false);
+	}
+
+	void Application::writeTimestamp(const lzvk::wrapper::CommandBuffer::Ptr& cmd, uint32_t query) {
+
+		if (mTimestampPools.empty()) {
+			return;
+		}
+
+		cmd->writeTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mTimestampPools[mCurrentFrame]->getQueryPool(), query);
 	}
 
 	void Application::recordShadowPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
 
-		cmd->transitionImageLayout(
-			mImage_Shadow->getImage(),
-			mImage_Shadow->getFormat(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT
-		);
+		mFrameUniformManager->updateLight(mLight.getViewMatrix(), mLight.getProjectionMatrix(-74.45, 37.15, -54.96, 60.30, 41.56, -34.74), mCurrentFrame);
 
-		mFrameUniformManager->updateLight(mLight.getViewMatrix(), mLight.getProjectionMatrix(-74.45, 37.15, -54.96, 60.30, 41.56, -34.74), mDescriptorSet_Frame, mCurrentFrame);
+		// the shadow set is bound with the other scene sets below, write it before recording the bind
+		if (!mTexture_Shadow) {
+
+			mTexture_Shadow = lzvk::renderer::Texture::create(mDevice, mImage_Shadow);
+		}
+
+		mShadowUniformManager->update(mDescriptorSet_Shadow, mTexture_Shadow, mCurrentFrame);
 
 		// --- Begin Render Pass ---
 		cmd->beginRendering(mFramebuffer_Shadow);
@@ -927,8 +1211,7 @@ namespace lzvk::core {
 		// --- large scene ---
 		cmd->bindGraphicPipeline(mShadowPipeline->getPipeline());
 		cmd->setDepthBias(1.1f, 0.0f, 2.0f);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mShadowPipeline->getLayout(), mDescriptorSet_Frame->getDescriptorSet(mCurrentFrame), 0);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mShadowPipeline->getLayout(), mSceneMesh->getDescriptorSet_Static()->getDescriptorSet(0), 1);
+		cmd->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, mShadowPipeline->getLayout(), 0, getSceneDescriptorSets(), mFrameUniformManager->getDynamicOffsets(mCurrentFrame));
 		mSceneMesh->draw(cmd);
 
 		cmd->disableDepthBias();
@@ -936,48 +1219,20 @@ namespace lzvk::core {
 
 	}
 
-	void Application::transitionGeometryImages(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
-
-			cmd->transitionImageLayout(
-				mColorImage_Geometry->getImage(),
-				mColorImage_Geometry->getFormat(),
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-			);
-
-			cmd->transitionImageLayout(
-				mDepthImage_Geometry->getImage(),
-				mDepthImage_Geometry->getFormat(),
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-				VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-				VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
+	void Application::cullScene() {
 
-			);
+		// --- CPU culling into this frame's indirect buffer ---
+		if (mCullingMode == CullingMode::CPU) {
 
+			mCullingSettings.pixelScale = std::abs(mCamera.getProjectMatrix()[1][1]) * static_cast<float>(mHeight) * 0.5f;
+			mSceneMesh->getCpuCuller()->setSettings(mCullingSettings);
+			mSceneMesh->cull(mCamera.getViewProjectionMatrix(), mCurrentFrame);
+		}
 	}
 
 	void Application::recordGeometryPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
 
-		transitionGeometryImages(cmd);
-
-		cmd->transitionImageLayout(
-			mImage_Shadow->getImage(),
-			mImage_Shadow->getFormat(),
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-		);
-
-		if (!mTexture_Shadow) {
-
-			mTexture_Shadow = lzvk::renderer::Texture::create(mDevice, mImage_Shadow);
-		}
-
-		mShadowUniformManager->update(mDescriptorSet_Shadow, mTexture_Shadow, mCurrentFrame);
+		cullScene();
 
 		// --- Begin Render Pass ---
 		cmd->beginRendering(mFramebuffer_Geometry);
@@ -998,45 +1253,104 @@ namespace lzvk::core {
 		cmd->setScissor(0, scissor);
 
 		// --- skybox ---
+		// scene sets are bound here for the skybox and the large scene, their pipeline layouts share them
 		cmd->bindGraphicPipeline(mSkyboxPipeline->getPipeline());
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSkyboxPipeline->getLayout(), mDescriptorSet_Frame->getDescriptorSet(mCurrentFrame), 0);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSkyboxPipeline->getLayout(), mDescriptorSet_Skybox->getDescriptorSet(0), 1);
+		cmd->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, mSkyboxPipeline->getLayout(), 0, getSceneDescriptorSets(), mFrameUniformManager->getDynamicOffsets(mCurrentFrame));
 		cmd->draw(36);
 
 		// --- large scene ---
-		cmd->bindGraphicPipeline(mSceneGraphPipeline->getPipeline());
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mDescriptorSet_Frame->getDescriptorSet(mCurrentFrame), 0);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mSceneMesh->getDescriptorSet_Static()->getDescriptorSet(0), 1);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mSceneMesh->getDescriptorSet_Diffuse()->getDescriptorSet(0), 2);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mSceneMesh->getDescriptorSet_Emissive()->getDescriptorSet(0), 3);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mSceneMesh->getDescriptorSet_Normal()->getDescriptorSet(0), 4);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mSceneMesh->getDescriptorSet_Opacity()->getDescriptorSet(0), 5);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mSceneMesh->getDescriptorSet_Specular()->getDescriptorSet(0), 6);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mDescriptorSet_Shadow->getDescriptorSet(mCurrentFrame), 7);
-		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_GRAPHICS, mSceneGraphPipeline->getLayout(), mDescriptorSet_Skybox->getDescriptorSet(0), 8);
+		bool useMeshShader = mCullingMode == CullingMode::MeshShader && mSceneGraphMeshPipeline != nullptr;
+		auto scenePipeline = useMeshShader ? mSceneGraphMeshPipeline : mSceneGraphPipeline;
+
+		cmd->bindGraphicPipeline(scenePipeline->getPipeline());
 		
 		// push constants
 		LightPushConstant pc{};
 		pc.lightDir = glm::vec4(mLight.getDirection(), 0.0f);
 		pc.cameraPos = glm::vec4(mCamera.getPosition(), 0.0f);
-		cmd->pushConstants(mSceneGraphPipeline->getLayout(), VK_SHADER_STAGE_FRAGMENT_BIT, pc);
-		
-		mSceneMesh->draw(cmd);
+		cmd->pushConstants(scenePipeline->getLayout(), mScenePushConstantStages, pc);
+
+		if (useMeshShader) {
+
+			mSceneMesh->drawMeshTasks(cmd);
+		}
+		else if (mCullingMode == CullingMode::CPU) {
+
+			mSceneMesh->drawCulled(cmd, mCurrentFrame);
+		}
+		else {
+
+			mSceneMesh->draw(cmd);
+		}
+
 		cmd->endRendering();
 
+		// the forward path shades while rasterizing, no separate resolve
+		writeTimestamp(cmd, 2);
+		writeTimestamp(cmd, 3);
+	}
+
+	void Application::recordVisibilityPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
+
+		// rasterize draw slot and triangle ids, the depth image is shared with the forward path
+		cullScene();
+
+		cmd->beginRendering(mFramebuffer_Visibility);
+
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(mWidth);
+		viewport.height = static_cast<float>(mHeight);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		cmd->setViewport(0, viewport);
+
+		VkRect2D scissor{};
+		scissor.offset = { 0, 0 };
+		scissor.extent = { mWidth, mHeight };
+		cmd->setScissor(0, scissor);
+
+		cmd->bindGraphicPipeline(mVisibilityPipeline->getPipeline());
+		cmd->bindDescriptorSets(VK_PIPELINE_BIND_POINT_GRAPHICS, mVisibilityPipeline->getLayout(), 0, getSceneDescriptorSets(), mFrameUniformManager->getDynamicOffsets(mCurrentFrame));
+
+		// the mesh shader mode has no indirect commands to resolve against, it draws the full list here
+		if (mCullingMode == CullingMode::CPU) {
+			mSceneMesh->drawCulled(cmd, mCurrentFrame);
+		}
+		else {
+			mSceneMesh->draw(cmd);
+		}
+
+		cmd->endRendering();
+		writeTimestamp(cmd, 2);
+	}
+
+	void Application::recordVisibilityResolvePass(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
+
+		// shade every pixel once in compute, draw slots index the same indirect commands the raster pass used
+		bool useCulledDraws = mCullingMode == CullingMode::CPU;
+		auto drawCommandBuffer = useCulledDraws ? mSceneMesh->getCpuCuller()->getIndirectBuffer(mCurrentFrame) : mSceneMesh->getIndirectBuffer();
+
+		mVisibilityUniformManager->update(mDescriptorSet_Visibility, mVisibilityImage_Geometry, mColorImage_Geometry, drawCommandBuffer, mCurrentFrame);
+
+		cmd->bindComputePipeline(mVisibilityResolvePipeline->getPipeline());
+		auto resolveSets = getSceneDescriptorSets();
+		resolveSets.push_back(mDescriptorSet_Visibility->getDescriptorSet(mCurrentFrame));
+		cmd->bindDescriptorSets(VK_PIPELINE_BIND_POINT_COMPUTE, mVisibilityResolvePipeline->getLayout(), 0, resolveSets, mFrameUniformManager->getDynamicOffsets(mCurrentFrame));
+
+		LightPushConstant pc{};
+		pc.lightDir = glm::vec4(mLight.getDirection(), 0.0f);
+		pc.cameraPos = glm::vec4(mCamera.getPosition(), 0.0f);
+		cmd->pushConstants(mVisibilityResolvePipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, pc);
+
+		cmd->dispatch((mWidth + 7) / 8, (mHeight + 7) / 8, 1);
+
+		writeTimestamp(cmd, 3);
 	}
 
 	void Application::recordSSAOPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
 		
-		cmd->transitionImageLayout(
-			mDepthImage_Geometry->getImage(),
-			mDepthImage_Geometry->getFormat(),
-			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
 		if (!mDepthTexture_SSAO) {
 
 			mDepthTexture_SSAO = lzvk::renderer::Texture::create(mDevice, mDepthImage_Geometry);
@@ -1044,17 +1358,6 @@ namespace lzvk::core {
 	
 		mSSAOUniformManager->update(mDescriptorSet_SSAO, mDepthTexture_SSAO, mRotationTexture, mAOImage_SSAO, mCurrentFrame);
 
-		// 1. Layout transition for AO output image to GENERAL
-		cmd->transitionImageLayout(
-			mAOImage_SSAO->getImage(),
-			mAOImage_SSAO->getFormat(),
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
-		);
-
-
 		// 2. Bind compute pipeline
 		cmd->bindComputePipeline(mSSAOPipeline->getPipeline());
 		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, mSSAOPipeline->getLayout(), mDescriptorSet_SSAO->getDescriptorSet(mCurrentFrame), 0);
@@ -1074,106 +1377,44 @@ namespace lzvk::core {
 		cmd->dispatch(groupSizeX, groupSizeY, 1);
 	}
 
-	void Application::recordBlurPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
-
-
-		auto pingImg = mAOImage_BlurPing;
-		auto pongImg = mAOImage_BlurPong;
-
+	void Application::recordBlurPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd, int iteration, bool vertical) {
 
 		if (!mDepthTexture_Blur)     mDepthTexture_Blur = lzvk::renderer::Texture::create(mDevice, mDepthImage_Geometry);
 		if (!mAOTexture_SSAO)        mAOTexture_SSAO = lzvk::renderer::Texture::create(mDevice, mAOImage_SSAO);
 		if (!mAOTexture_BlurPing)    mAOTexture_BlurPing = lzvk::renderer::Texture::create(mDevice, mAOImage_BlurPing);
 		if (!mAOTexture_BlurPong)    mAOTexture_BlurPong = lzvk::renderer::Texture::create(mDevice, mAOImage_BlurPong);
 
-		
 		float mBlurDepthThreshold = 30.0f;
 
-		lzvk::renderer::Texture::Ptr inputTex = mAOTexture_SSAO;
-
-		// 1. Ping-pong blur passes
-		for (int i = 0; i < mBlurPassCount; ++i) {
-
-			cmd->transitionImageLayout(
-				inputTex->getImage()->getImage(),
-				inputTex->getImage()->getFormat(),
-				VK_IMAGE_LAYOUT_GENERAL,  // or keep track of last layout
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-
-			// Horizontal pass: inputTex → ping
-			cmd->transitionImageLayout(pingImg->getImage(), pingImg->getFormat(),
-				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-			mBlurUniformManager->update(mDescriptorSet_BlurH[i], mDepthTexture_Blur, inputTex, pingImg, mCurrentFrame);
-
-			cmd->bindComputePipeline(mBlurPipelineH->getPipeline());
-			cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, mBlurPipelineH->getLayout(), mDescriptorSet_BlurH[i]->getDescriptorSet(mCurrentFrame), 0);
-
-			BlurPushConstant pc{};
-			pc.depthThreshold = mBlurDepthThreshold;
-			cmd->pushConstants(mBlurPipelineH->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, pc);
-
-			cmd->dispatch((mWidth + 15) / 16, (mHeight + 15) / 16, 1);
-
-			inputTex = mAOTexture_BlurPing;
-
-			cmd->transitionImageLayout(
-				inputTex->getImage()->getImage(), inputTex->getImage()->getFormat(),
-				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-			// Vertical pass: inputTex → pong
-			cmd->transitionImageLayout(pongImg->getImage(), pongImg->getFormat(),
-				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
-
-			mBlurUniformManager->update(mDescriptorSet_BlurV[i], mDepthTexture_Blur, inputTex, pongImg, mCurrentFrame);
-
-			cmd->bindComputePipeline(mBlurPipelineV->getPipeline());
-			cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, mBlurPipelineV->getLayout(), mDescriptorSet_BlurV[i]->getDescriptorSet(mCurrentFrame), 0);
+		// horizontal: SSAO output or the previous vertical result → ping, vertical: ping → pong
+		auto inputTex = vertical ? mAOTexture_BlurPing : (iteration == 0 ? mAOTexture_SSAO : mAOTexture_BlurPong);
+		auto outputImg = vertical ? mAOImage_BlurPong : mAOImage_BlurPing;
+		const auto& descriptorSet = vertical ? mDescriptorSet_BlurV[iteration] : mDescriptorSet_BlurH[iteration];
+		const auto& pipeline = vertical ? mBlurPipelineV : mBlurPipelineH;
 
-			cmd->pushConstants(mBlurPipelineV->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, pc);
+		mBlurUniformManager->update(descriptorSet, mDepthTexture_Blur, inputTex, outputImg, mCurrentFrame);
 
-			cmd->dispatch((mWidth + 15) / 16, (mHeight + 15) / 16, 1);
+		cmd->bindComputePipeline(pipeline->getPipeline());
+		cmd->bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getLayout(), descriptorSet->getDescriptorSet(mCurrentFrame), 0);
 
-			inputTex = mAOTexture_BlurPong;
-		}
+		BlurPushConstant pc{};
+		pc.depthThreshold = mBlurDepthThreshold;
+		cmd->pushConstants(pipeline->getLayout(), VK_SHADER_STAGE_COMPUTE_BIT, pc);
 
-		mFinalAOImage = inputTex->getImage();
+		cmd->dispatch((mWidth + 15) / 16, (mHeight + 15) / 16, 1);
 	}
 
 	void Application::recordCombinePass(const lzvk::wrapper::CommandBuffer::Ptr& cmd, uint32_t imageIndex) {
 		
-		// 1. Transition render target
+		// 1. Transition render target, swapchain images are not tracked. The acquire semaphore is
+		// waited on at the color output stage, the barrier chains to that wait
 		cmd->transitionImageLayout(
 			mSwapChain->getImage(imageIndex),
 			mSwapChain->getFormat(),
 			VK_IMAGE_LAYOUT_UNDEFINED,
 			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-		);
-
-		cmd->transitionImageLayout(
-			mColorImage_Geometry->getImage(),
-			mColorImage_Geometry->getFormat(),
-			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
 			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
-		);
-
-		cmd->transitionImageLayout(
-			mFinalAOImage->getImage(),
-			mFinalAOImage->getFormat(),
-			VK_IMAGE_LAYOUT_GENERAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
 		);
 
 
@@ -1257,6 +1498,181 @@ namespace lzvk::core {
 		//ImGui::SliderFloat("Phi", &mLightPhi, -89.9f, 89.9f);
 		ImGui::End();
 
+		ImGui::Begin("Renderer");
+
+		if (ImGui::CollapsingHeader("Culling", ImGuiTreeNodeFlags_DefaultOpen)) {
+
+			const char* cullingModes[] = { "None", "CPU", "Mesh shader (GPU)" };
+			int cullingMode = static_cast<int>(mCullingMode);
+
+			// the mesh shader entry is only offered when the device supports it
+			int cullingModeCount = mSceneGraphMeshPipeline ? IM_ARRAYSIZE(cullingModes) : IM_ARRAYSIZE(cullingModes) - 1;
+
+			if (ImGui::Combo("Mode", &cullingMode, cullingModes, cullingModeCount)) {
+				mCullingMode = static_cast<CullingMode>(cullingMode);
+			}
+
+			auto culler = mSceneMesh->getCpuCuller();
+
+			if (mCullingMode == CullingMode::CPU) {
+
+				ImGui::Text("Visible: %u / %u", culler->getVisibleCount(mCurrentFrame), culler->getDrawCount());
+				ImGui::Text("Cull time: %.3f ms (%u threads, %s)", culler->getLastCullTimeMs(), culler->getWorkerCount(), culler->isSimdEnabled() ? "AVX2" : "scalar");
+
+				ImGui::Checkbox("Contribution culling", &mCullingSettings.contributionCulling);
+				ImGui::SliderFloat("Min pixel size", &mCullingSettings.minPixelSize, 0.0f, 32.0f);
+				ImGui::Checkbox("LOD selection", &mCullingSettings.lodSelection);
+				ImGui::SliderFloat("Max LOD error (px)", &mCullingSettings.maxLodErrorPixels, 0.1f, 8.0f);
+				ImGui::Text("Too small: %u, coarser LOD: %u, exempt: %u", culler->getSmallCulledCount(), culler->getLodDrawCount(), culler->getExemptDrawCount());
+
+				ImGui::InputText("Exempt materials", mExemptMaterialFilter, sizeof(mExemptMaterialFilter));
+				if (ImGui::Button("Apply exemptions")) {
+
+					// comma separated material name substrings
+					std::vector<std::string> filters;
+					std::string filter;
+					for (const char* c = mExemptMaterialFilter; ; ++c) {
+
+						if (*c == ',' || *c == '\0') {
+							filters.push_back(filter);
+							filter.clear();
+							if (*c == '\0') break;
+						}
+						else if (*c != ' ') {
+							filter += *c;
+						}
+					}
+
+					mSceneMesh->setContributionExemptions(filters);
+				}
+			}
+			else if (mCullingMode == CullingMode::MeshShader) {
+
+				ImGui::Text("Meshlet instances: %u (task shader frustum + cone culling)", mSceneMesh->getMeshletInstanceCount());
+			}
+			else {
+
+				ImGui::Text("Visible: %u / %u", mSceneMesh->getDrawCount(), mSceneMesh->getDrawCount());
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Geometry", ImGuiTreeNodeFlags_DefaultOpen)) {
+
+			const char* geometryModes[] = { "Forward", "Visibility buffer" };
+			int geometryMode = static_cast<int>(mGeometryMode);
+
+			// the visibility buffer needs every draw slot and triangle id to fit 32 bits
+			ImGui::BeginDisabled(mVisibilityPipeline == nullptr);
+			if (ImGui::Combo("Path", &geometryMode, geometryModes, IM_ARRAYSIZE(geometryModes))) {
+				mGeometryMode = static_cast<GeometryMode>(geometryMode);
+				mFrameGraphDirty = true;
+			}
+			ImGui::EndDisabled();
+
+			if (mGeometryMode == GeometryMode::VisibilityBuffer && mCullingMode == CullingMode::MeshShader) {
+				ImGui::Text("Mesh shader culling is not used by the visibility pass");
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Environment")) {
+
+			// the baked skybox is unchanged, this only times both paths on the same HDR
+			const char* conversions[] = { "CPU", "GPU compute" };
+			int conversion = static_cast<int>(mEnvironmentConversion);
+
+			if (ImGui::Combo("HDR to cube map", &conversion, conversions, mEnvironmentComputeSupported ? IM_ARRAYSIZE(conversions) : 1)) {
+				mEnvironmentConversion = static_cast<lzvk::renderer::CubeMapConversion>(conversion);
+			}
+
+			if (ImGui::Button("Convert")) {
+				mEnvironmentConversionRequested = true;
+			}
+
+			for (int i = 0; i < IM_ARRAYSIZE(conversions); ++i) {
+				if (mEnvironmentConversionMs[i] >= 0.0) {
+					ImGui::Text("%-12s %.1f ms, upload wait %.1f ms", conversions[i], mEnvironmentConversionMs[i], mEnvironmentUploadMs[i]);
+				}
+			}
+
+			if (!mEnvironmentComputeSupported) {
+				ImGui::Text("R32G32B32A32_SFLOAT has no linear filtering, GPU conversion is off");
+			}
+		}
+
+		if (ImGui::CollapsingHeader("GPU timings", ImGuiTreeNodeFlags_DefaultOpen)) {
+
+			if (mGpuTimesMs.size() == GPU_TIMESTAMP_COUNT) {
+
+				const char* passNames[] = { "Shadow", "Geometry raster", "Geometry resolve", "SSAO + blur", "Combine" };
+
+				for (uint32_t i = 1; i < GPU_TIMESTAMP_COUNT; ++i) {
+					ImGui::Text("%-18s %.3f ms", passNames[i - 1], mGpuTimesMs[i] - mGpuTimesMs[i - 1]);
+				}
+
+				ImGui::Text("%-18s %.3f ms", "Total", mGpuTimesMs[GPU_TIMESTAMP_COUNT - 1]);
+			}
+			else {
+				ImGui::Text("Timestamps not available");
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Descriptors")) {
+
+			ImGui::Text("Writes per frame: %u", mDescriptorWritesPerFrame);
+			ImGui::Text("Bind calls per frame: %u (%u sets)", mDescriptorBindsPerFrame, mDescriptorSetsBoundPerFrame);
+			ImGui::Text("Bind CPU time: %.4f ms", mDescriptorBindCpuMs);
+			ImGui::Text("Scene textures: %u in one array", mSceneMesh->getTextureCount());
+			ImGui::Text("Samplers: %u live (%u requests)", lzvk::wrapper::Sampler::getLiveCount(), lzvk::wrapper::Sampler::getRequestCount());
+		}
+
+		if (ImGui::CollapsingHeader("Texture streaming")) {
+
+			auto streamer = mSceneMesh->getTextureStreamer();
+			const auto& stats = streamer->getStats();
+			const float mb = 1.0f / (1024.0f * 1024.0f);
+
+			if (ImGui::SliderInt("Budget (MB)", &mTextureBudgetMB, 64, 8192)) {
+				streamer->setBudget(static_cast<VkDeviceSize>(mTextureBudgetMB) * 1024 * 1024);
+			}
+
+			ImGui::Text("Resident: %.1f / %.1f MB%s", stats.residentBytes * mb, stats.budgetBytes * mb, mDevice->isMemoryBudgetSupported() ? "" : " (no memory budget extension)");
+			ImGui::Text("Streamed: %u textures, %u loading, %u evicted", stats.streamedCount, stats.loadingCount, stats.evictedCount);
+			ImGui::Text("Sampled last frame: %u, uploaded %.2f MB", stats.requestedCount, stats.uploadedBytes * mb);
+		}
+
+		if (ImGui::CollapsingHeader("Barriers")) {
+
+			ImGui::Text("Transitions requested: %u (%u redundant)", mBarrierStats.requests, mBarrierStats.redundant);
+			ImGui::Text("Image barriers: %u in %u barrier calls", mBarrierStats.imageBarriers, mBarrierStats.barrierCalls);
+
+			bool barrierDebug = lzvk::wrapper::CommandBuffer::isBarrierDebug();
+			if (ImGui::Checkbox("Report redundant transitions", &barrierDebug)) {
+				lzvk::wrapper::CommandBuffer::setBarrierDebug(barrierDebug);
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Memory")) {
+
+			auto stats = mDevice->getAllocator()->getStats();
+			const float mb = 1.0f / (1024.0f * 1024.0f);
+
+			ImGui::Text("Blocks: %u (%.1f / %.1f MB used)", stats.blockCount, stats.usedBytes * mb, stats.blockBytes * mb);
+			ImGui::Text("Dedicated: %u (%.1f MB)", stats.dedicatedCount, stats.dedicatedBytes * mb);
+			ImGui::Text("Allocations: %u", stats.allocationCount);
+			ImGui::Text("Free regions: %u, largest %.2f MB", stats.freeRegionCount, stats.largestFreeRegion * mb);
+			ImGui::Text("Fragmentation: %.2f", stats.fragmentation);
+			ImGui::Text("Frame graph: %u/%u passes, %.1f MB of images in %.1f MB", mFrameGraph->getLivePassCount(), mFrameGraph->getPassCount(),
+						mFrameGraph->getUnaliasedBytes() * mb, mFrameGraph->getHeapBytes() * mb);
+
+			ImGui::Separator();
+
+			for (const auto& [tag, bytes] : stats.bytesPerTag) {
+				ImGui::Text("%-14s %.2f MB", tag.c_str(), bytes * mb);
+			}
+		}
+
+		ImGui::End();
+
 		mLightTheta += 0.05f;
 		if (mLightTheta > 360.0f)
 			mLightTheta -= 360.0f;
@@ -1277,17 +1693,18 @@ namespace lzvk::core {
 
 		mCommandBuffers[mCurrentFrame]->begin();
 
-		recordShadowPass(mCommandBuffers[mCurrentFrame]);
+		if (!mTimestampPools.empty()) {
 
-		recordGeometryPass(mCommandBuffers[mCurrentFrame]);
-
-		recordSSAOPass(mCommandBuffers[mCurrentFrame]);
-
-		recordBlurPass(mCommandBuffers[mCurrentFrame]);
+			mCommandBuffers[mCurrentFrame]->resetQueryPool(mTimestampPools[mCurrentFrame]->getQueryPool(), 0, GPU_TIMESTAMP_COUNT);
+			mTimestampsWritten[mCurrentFrame] = true;
+		}
 
-		recordCombinePass(mCommandBuffers[mCurrentFrame], imageIndex);
+		writeTimestamp(mCommandBuffers[mCurrentFrame], 0);
 
-		recordImGuiPass(mCommandBuffers[mCurrentFrame], imageIndex);
+		// shadow, geometry, SSAO, blur, combine and ImGui, with the barriers between them
+		mSwapChainImageIndex = imageIndex;
+		mFrameGraph->execute(mCommandBuffers[mCurrentFrame]);
+		mSceneMesh->recordTextureFeedbackBarrier(mCommandBuffers[mCurrentFrame]);
 
 		mCommandBuffers[mCurrentFrame]->transitionImageLayout(
 			mSwapChain->getImage(imageIndex),
@@ -1343,6 +1760,8 @@ namespace lzvk::core {
 		mWidth = mSwapChain->getExtent().width;
 		mHeight = mSwapChain->getExtent().height;
 
+		// 4 Per-frame images follow the new resolution
+		createFrameGraph();
 	}
 
 	void Application::cleanupSwapChain() {
@@ -1368,6 +1787,40 @@ namespace lzvk::core {
 
 		mInFlightFences[mCurrentFrame]->block();
 
+		// the pass list changed, the other frame in flight may still use the old images
+		if (mFrameGraphDirty) {
+
+			vkDeviceWaitIdle(mDevice->getDevice());
+			createFrameGraph();
+			mFrameGraphDirty = false;
+		}
+
+		if (mEnvironmentConversionRequested) {
+
+			timeEnvironmentConversion();
+			mEnvironmentConversionRequested = false;
+		}
+
+		// 0 Feedback of the last submission of this frame is readable, streamed textures go into its set
+		mSceneMesh->updateTextureStreaming(mCurrentFrame);
+
+		// 0.1 Timestamps of the last submission of this frame are complete now
+		if (!mTimestampPools.empty() && mTimestampsWritten[mCurrentFrame]) {
+
+			mTimestampPools[mCurrentFrame]->getTimestampsMs(mGpuTimesMs);
+		}
+
+		mDescriptorWritesPerFrame = lzvk::wrapper::DescriptorSet::getWriteCount();
+		lzvk::wrapper::DescriptorSet::resetWriteCount();
+
+		mDescriptorBindsPerFrame = lzvk::wrapper::CommandBuffer::getBindCallCount();
+		mDescriptorSetsBoundPerFrame = lzvk::wrapper::CommandBuffer::getBoundSetCount();
+		mDescriptorBindCpuMs = lzvk::wrapper::CommandBuffer::getBindCpuTimeMs();
+		lzvk::wrapper::CommandBuffer::resetBindStats();
+
+		mBarrierStats = lzvk::wrapper::CommandBuffer::getBarrierStats();
+		lzvk::wrapper::CommandBuffer::resetBarrierStats();
+
 		// 1 Get next frame
 		uint32_t imageIndex{ 0 };
 		VkResult result = vkAcquireNextImageKHR(mDevice->getDevice(), mSwapChain->getSwapChain(), UINT64_MAX, mImageAvailableSemaphores[mCurrentFrame]->getSemaphore(), VK_NULL_HANDLE, &imageIndex);
@@ -1385,7 +1838,7 @@ namespace lzvk::core {
 		}
 
 		// 1.2 Update 
-		mFrameUniformManager->update(mCamera.getViewMatrix(), mCamera.getProjectMatrix(), mDescriptorSet_Frame, mCurrentFrame);
+		mFrameUniformManager->update(mCamera.getViewMatrix(), mCamera.getProjectMatrix(), mCurrentFrame);
 		mInFlightFences[mCurrentFrame]->resetFence();
 
 		// 1.3 Record commands
@@ -1487,6 +1940,16 @@ namespace lzvk::core {
 		mDescriptorSetLayout_SSAO.reset();
 		mSSAOUniformManager.reset();
 
+		// === Visibility ===
+		mVisibilityPipeline.reset();
+		mVisibilityResolvePipeline.reset();
+		mDescriptorSet_Visibility.reset();
+		mDescriptorPool_Visibility.reset();
+		mDescriptorSetLayout_Visibility.reset();
+		mVisibilityUniformManager.reset();
+		mFramebuffer_Visibility.reset();
+		mVisibilityImage_Geometry.reset();
+
 		// === Geometry ===
 		mFramebuffer_Geometry.reset();
 		mColorImage_Geometry.reset();
@@ -1495,6 +1958,7 @@ namespace lzvk::core {
 		// === Scene ===
 		mSceneMesh.reset();
 		mSceneGraphPipeline.reset();
+		mSceneGraphMeshPipeline.reset();
 		mShadowUniformManager.reset();
 
 		// === Skybox ===
@@ -1513,6 +1977,9 @@ namespace lzvk::core {
 		mImage_Shadow.reset();
 		mFramebuffer_Shadow.reset();
 
+		// === Frame graph, owns the images above ===
+		mFrameGraph.reset();
+
 		// === Frame ===
 		mDescriptorSet_Frame.reset();
 		mDescriptorPool_Frame.reset();
@@ -1520,6 +1987,7 @@ namespace lzvk::core {
 		mFrameUniformManager.reset();
 
 		// === Command / Sync ===
+		mTimestampPools.clear();
 		mCommandBuffers.clear();
 		mImageAvailableSemaphores.clear();
 		mRenderFinishedSemaphores.clear();
@@ -1528,6 +1996,7 @@ namespace lzvk::core {
 		cleanUpImGui();
 		// === Core Vulkan handles ===
 		mCommandPool.reset();
+		lzvk::wrapper::Shader::setArchive(nullptr);
 		mDevice.reset();
 		mSurface.reset();
 		mInstance.reset();
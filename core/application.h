@@ -24,9 +24,11 @@
 #include "../wrapper/image.h"
 #include "../wrapper/compute_pipeline.h"
 #include "../wrapper/compute_pass_instancing.h"
+#include "../wrapper/query_pool.h"
 
 #include "../loader/scene.h"
 #include "../loader/mesh.h"
+#include "../tools/scene_tools.h"
 
 #include "../renderer/scene/scene_mesh_renderer.h"
 #include "../renderer/uniform/frame_uniform_manager.h"
@@ -39,6 +41,8 @@
 #include "../renderer/uniform/ssao_uniform_manager.h"
 #include "../renderer/uniform/blur_uniform_manager.h"
 #include "../renderer/uniform/combine_uniform_manager.h"
+#include "../renderer/uniform/visibility_uniform_manager.h"
+#include "../renderer/graph/frame_graph.h"
 
 #include "../renderer/texture/texture.h"
 #include "../renderer/texture/cube_map_texture.h"
@@ -73,10 +77,9 @@ namespace lzvk::core{
 
 		// framebuffer
 		void createEnvironmentMap();
-		void createShadowMap();
-		void createGeometryFramebuffer();
+		void timeEnvironmentConversion();
+		void createFrameGraph();
 		void createSSAOResources();
-		void createBlurImages();
 
 		// scene buffer
 		void createSceneBuffers();
@@ -91,20 +94,28 @@ namespace lzvk::core{
 
 		// pipelines
 		void applyCommonPipelineState(const lzvk::wrapper::Pipeline::Ptr& pipeline, bool enableDepthWrite, VkCullModeFlagBits cullMode, PipelineType type);
+		void createPipelines();
 		void createShadowPipeline();
 		void createSkyboxPipeline();
 		void createSceneGraphPipeline();
+		void createSceneGraphMeshPipeline();
+		void createVisibilityPipelines();
 		void createSSAOPipeline();
 		void createBlurPipelines();
 		void createCombinePipeline();
+		std::vector<VkDescriptorSetLayout> getSceneSetLayouts() const;
 
 		// command buffers
 		void createCommandBuffers();
 		void recordShadowPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
-		void transitionGeometryImages(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
+		void cullScene();
 		void recordGeometryPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
+		void recordVisibilityPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
+		void recordVisibilityResolvePass(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
+		std::vector<VkDescriptorSet> getSceneDescriptorSets() const;
+		void writeTimestamp(const lzvk::wrapper::CommandBuffer::Ptr& cmd, uint32_t query);
 		void recordSSAOPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
-		void recordBlurPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
+		void recordBlurPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd, int iteration, bool vertical);
 		void recordCombinePass(const lzvk::wrapper::CommandBuffer::Ptr& cmd, uint32_t imageIndex);
 		void recordImGuiPass(const lzvk::wrapper::CommandBuffer::Ptr& cmd, uint32_t imageIndex);
 		void recordCommandBuffer(uint32_t imageIndex);
@@ -118,12 +129,27 @@ namespace lzvk::core{
 		unsigned int mHeight{ 400 };
 
 		unsigned int mShadowMapRes{ 4096 };
-		unsigned int mIrradianceMapRes{ 128 };
 
 		int mCurrentFrame{ 0 };
 		const int MAX_FRAMES_IN_FLIGHT{ 2 };
+		const uint32_t GPU_TIMESTAMP_COUNT{ 6 };
 		int mBlurPassCount{ 2 };
 
+		// formats of the frame graph targets, the pipelines are created before the images
+		static constexpr VkFormat COLOR_FORMAT{ VK_FORMAT_R16G16B16A16_SFLOAT };
+		static constexpr VkFormat VISIBILITY_FORMAT{ VK_FORMAT_R32_UINT };
+
+		// equirectangular HDR the skybox and image based lighting are baked from at startup
+		static constexpr const char* ENVIRONMENT_PATH{ "assets/skybox/immenstadter_horn_2k.hdr" };
+
+		// the bake of it, redone when the HDR or the bake settings change
+		static constexpr const char* ENVIRONMENT_CACHE_PATH{ "assets/.cache/environment.ibl" };
+
+		// per-frame passes and their images, rebuilt on resize or when the geometry path changes
+		lzvk::renderer::FrameGraph::Ptr mFrameGraph{ nullptr };
+		bool mFrameGraphDirty{ false };
+		uint32_t mSwapChainImageIndex{ 0 };
+
 		lzvk::core::Window::Ptr mWindow{ nullptr };
 		lzvk::wrapper::Instance::Ptr mInstance{ nullptr };
 		lzvk::wrapper::Device::Ptr mDevice{ nullptr };
@@ -133,8 +159,13 @@ namespace lzvk::core{
 
 		// pre compute
 		lzvk::renderer::CubeMapTexture::Ptr mSkyboxCube{ nullptr };
-		lzvk::wrapper::Image::Ptr mImage_IrradianceCube{ nullptr };
-		lzvk::renderer::CubeMapTexture::Ptr mIrradianceCube{ nullptr };
+
+		// HDR to cube map conversion the ImGui panel times on ENVIRONMENT_PATH, run before the next frame
+		lzvk::renderer::CubeMapConversion mEnvironmentConversion{ lzvk::renderer::CubeMapConversion::Compute };
+		bool mEnvironmentComputeSupported{ false };
+		bool mEnvironmentConversionRequested{ false };
+		double mEnvironmentConversionMs[2]{ -1.0, -1.0 };
+		double mEnvironmentUploadMs[2]{ -1.0, -1.0 };
 
 		// pass 00 shadow
 		lzvk::wrapper::Framebuffer::Ptr mFramebuffer_Shadow{ nullptr };
@@ -150,6 +181,14 @@ namespace lzvk::core{
 
 		lzvk::wrapper::Pipeline::Ptr mSkyboxPipeline{ nullptr };
 		lzvk::wrapper::Pipeline::Ptr mSceneGraphPipeline{ nullptr };
+		lzvk::wrapper::Pipeline::Ptr mSceneGraphMeshPipeline{ nullptr };
+
+		// pass 01 geometry, visibility buffer variant
+		lzvk::wrapper::Framebuffer::Ptr mFramebuffer_Visibility{ nullptr };
+		lzvk::wrapper::Image::Ptr mVisibilityImage_Geometry{ nullptr };
+		lzvk::wrapper::Pipeline::Ptr mVisibilityPipeline{ nullptr };
+		lzvk::wrapper::ComputePipeline::Ptr mVisibilityResolvePipeline{ nullptr };
+		lzvk::renderer::VisibilityUniformManager::Ptr mVisibilityUniformManager{ nullptr };
 
 		lzvk::renderer::SceneMeshRenderer::Ptr mSceneMesh{ nullptr };
 		lzvk::renderer::FrameUniformManager::Ptr mFrameUniformManager{ nullptr };
@@ -209,6 +248,11 @@ namespace lzvk::core{
 		std::vector<lzvk::wrapper::DescriptorSet::Ptr>       mDescriptorSet_BlurH{};
 		std::vector<lzvk::wrapper::DescriptorSet::Ptr>       mDescriptorSet_BlurV{};
 
+		// visibility resolve uniform
+		lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Visibility{ nullptr };
+		lzvk::wrapper::DescriptorPool::Ptr      mDescriptorPool_Visibility{ nullptr };
+		lzvk::wrapper::DescriptorSet::Ptr       mDescriptorSet_Visibility{ nullptr };
+
 		// combine uniform
 		lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Combine{ nullptr };
 		lzvk::wrapper::DescriptorPool::Ptr      mDescriptorPool_Combine{ nullptr };
@@ -227,6 +271,9 @@ namespace lzvk::core{
 		lzvk::loader::Scene    mScene;
 		lzvk::loader::MeshData mMeshData;
 
+		// applied when a scene is loaded from source, not to cached scenes
+		lzvk::tools::StaticBatchSettings mStaticBatchSettings{};
+
 		lzvk::renderer::Camera mCamera;
 		VPMatrices mVPMatrices;
 
@@ -235,6 +282,35 @@ namespace lzvk::core{
 		float mLightTheta{ 90.0f };
 		float mLightPhi{ -26.0f };
 
+		// culling
+		CullingMode mCullingMode{ CullingMode::CPU };
+		lzvk::renderer::CullingSettings mCullingSettings{};
+		char mExemptMaterialFilter[256]{};
+
+		GeometryMode mGeometryMode{ GeometryMode::Forward };
+
+		// budget of the streamed scene texture levels, clamped further by VK_EXT_memory_budget
+		int mTextureBudgetMB{ 512 };
+
+		// gpu timestamps, one pool per frame in flight, read back after its fence
+		std::vector<lzvk::wrapper::QueryPool::Ptr> mTimestampPools{};
+		std::vector<bool> mTimestampsWritten{};
+		std::vector<double> mGpuTimesMs{};
+
+		// descriptors written while recording the previous frame, 0 in steady state
+		uint32_t mDescriptorWritesPerFrame{ 0 };
+
+		// descriptor set binds recorded for the previous frame
+		uint32_t mDescriptorBindsPerFrame{ 0 };
+		uint32_t mDescriptorSetsBoundPerFrame{ 0 };
+		double mDescriptorBindCpuMs{ 0.0 };
+
+		// barriers recorded for the previous frame
+		lzvk::wrapper::BarrierStats mBarrierStats{};
+
+		// shared by every geometry pass pipeline so the scene sets stay bound across them
+		VkShaderStageFlags mScenePushConstantStages{ VK_SHADER_STAGE_FRAGMENT_BIT };
+
 
 		std::vector<lzvk::wrapper::CommandBuffer::Ptr> mCommandBuffers{};
 		std::vector<lzvk::wrapper::Semaphore::Ptr> mImageAvailableSemaphores{};
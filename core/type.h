@@ -51,11 +51,24 @@ namespace lzvk::core {
 
 	enum class PipelineType {
 		SceneGraph,
+		SceneGraphMesh,
+		Visibility,
 		Skybox,
 		Combine,
 		Blur
 	};
 
+	enum class CullingMode {
+		None,
+		CPU,
+		MeshShader
+	};
+
+	enum class GeometryMode {
+		Forward,
+		VisibilityBuffer
+	};
+
 	enum class CAMERA_MOVE
 	{
 		MOVE_LEFT,
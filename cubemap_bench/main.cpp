@@ -0,0 +1,187 @@
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "../tools/tools.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+namespace {
+
+    // Smooth gradient with some high frequency detail, so the taps don't all hit the same cache lines
+    lzvk::tools::Bitmap makeEquirect(int width) {
+
+        lzvk::tools::Bitmap equirect(width, width / 2, 4, lzvk::tools::BitmapFormat::Float);
+        float* data = reinterpret_cast<float*>(equirect.mData.data());
+
+        for (int y = 0; y < equirect.mHeight; ++y) {
+            for (int x = 0; x < equirect.mWidth; ++x) {
+
+                float* texel = data + 4 * (size_t(y) * equirect.mWidth + x);
+                texel[0] = float(x) / equirect.mWidth;
+                texel[1] = float(y) / equirect.mHeight;
+                texel[2] = float((x ^ y) & 255) / 255.0f;
+                texel[3] = 1.0f;
+            }
+        }
+
+        return equirect;
+    }
+
+    // Best of a few runs, the first one also pays for faulting in the output
+    double timeConversion(const lzvk::tools::Bitmap& equirect, uint32_t threadCount) {
+
+        double best = 0.0;
+
+        for (int run = 0; run < 3; ++run) {
+
+            auto start = std::chrono::steady_clock::now();
+            auto cubemap = lzvk::tools::Tools::convertEquirectangularToCubemapFaces(equirect, threadCount);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            best = run == 0 ? ms : std::min(best, ms);
+        }
+
+        return best;
+    }
+
+    // Bilinear tap at (Uf, Vf) through the accessors, taps outside the image are clamped to the
+    // border. range is the largest tap value, errors are measured against it
+    glm::vec4 sampleAccessor(const lzvk::tools::Bitmap& equirect, float Uf, float Vf, float& range) {
+
+        int U1 = std::clamp(int(std::floor(Uf)), 0, equirect.mWidth - 1);
+        int V1 = std::clamp(int(std::floor(Vf)), 0, equirect.mHeight - 1);
+        int U2 = std::min(U1 + 1, equirect.mWidth - 1);
+        int V2 = std::min(V1 + 1, equirect.mHeight - 1);
+
+        float s = Uf - U1;
+        float t = Vf - V1;
+
+        glm::vec4 A = equirect.getPixelFloat(U1, V1);
+        glm::vec4 B = equirect.getPixelFloat(U2, V1);
+        glm::vec4 C = equirect.getPixelFloat(U1, V2);
+        glm::vec4 D = equirect.getPixelFloat(U2, V2);
+
+        glm::vec4 largest = glm::max(glm::max(glm::abs(A), glm::abs(B)), glm::max(glm::abs(C), glm::abs(D)));
+        range = std::max(std::max(largest.x, largest.y), std::max(largest.z, largest.w));
+
+        return A * (1 - s) * (1 - t) + B * s * (1 - t) + C * (1 - s) * t + D * s * t;
+    }
+
+    // The conversion on every thread against faceCoordsToXYZ and the accessors. The AVX2 atan2 is a
+    // polynomial, which moves the taps by a few thousandths of a texel on 8K inputs
+    bool verify(const std::string& name, const lzvk::tools::Bitmap& equirect) {
+
+        const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const lzvk::tools::Bitmap cubemap = lzvk::tools::Tools::convertEquirectangularToCubemapFaces(equirect, threadCount);
+
+        const int faceSize = cubemap.mWidth;
+        const float scale = 2.0f * faceSize / glm::pi<float>();
+        float maxError = 0.0f;
+
+        for (int face = 0; face < 6; ++face) {
+            for (int j = 0; j < faceSize; ++j) {
+                for (int i = 0; i < faceSize; ++i) {
+
+                    glm::vec3 dir = lzvk::tools::Tools::faceCoordsToXYZ(i, j, face, faceSize);
+                    float R = std::hypot(dir.x, dir.y);
+
+                    // straight up or down has no longitude, the pole texel of an odd face size is skipped
+                    if (R < 1e-6f) {
+                        continue;
+                    }
+
+                    float Uf = scale * (std::atan2(dir.y, dir.x) + glm::pi<float>());
+                    float Vf = scale * (glm::half_pi<float>() - std::atan2(dir.z, R));
+
+                    float range = 0.0f;
+                    glm::vec4 expected = sampleAccessor(equirect, Uf, Vf, range);
+                    glm::vec4 actual = cubemap.getPixelFloat(i, j, face);
+
+                    for (int c = 0; c < 4; ++c) {
+                        float error = std::abs(actual[c] - expected[c]) / std::max(1.0f, range);
+                        maxError = std::isnan(error) ? INFINITY : std::max(maxError, error);
+                    }
+                }
+            }
+        }
+
+        bool ok = maxError <= 5e-3f;
+        std::cout << "[CubemapBench] verify " << name << " " << equirect.mWidth << "x" << equirect.mHeight
+                  << ": max error " << maxError << (ok ? ", ok" : ", MISMATCH") << std::endl;
+
+        return ok;
+    }
+
+    void benchmark(const std::string& name, const lzvk::tools::Bitmap& equirect) {
+
+        const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        const double texels = 6.0 * (equirect.mWidth / 4) * (equirect.mWidth / 4);
+
+        double singleMs = timeConversion(equirect, 1);
+        double parallelMs = timeConversion(equirect, threadCount);
+
+        std::cout << "[CubemapBench] " << name << " " << equirect.mWidth << "x" << equirect.mHeight
+                  << ": 1 thread " << singleMs << " ms (" << texels / (singleMs * 1000.0) << " Mtexel/s), "
+                  << threadCount << " threads " << parallelMs << " ms (" << texels / (parallelMs * 1000.0) << " Mtexel/s)" << std::endl;
+    }
+}
+
+// CubemapBench [--verify] [equirect.hdr] [...]
+// Without inputs converts generated 2K and 8K inputs, otherwise each given .hdr.
+// --verify compares the faces against faceCoordsToXYZ and bilinear accessor taps instead of timing
+// them, a generated 2000 texel wide input covers the row remainders, and exits with 1 on a mismatch
+int main(int argc, char** argv) {
+
+    const bool verifyOnly = argc > 1 && std::string(argv[1]) == "--verify";
+    const int firstInput = verifyOnly ? 2 : 1;
+    bool ok = true;
+
+    std::cout << "[CubemapBench] " << (lzvk::tools::Tools::isSimdEnabled() ? "AVX2" : "scalar") << " kernels" << std::endl;
+
+    try {
+
+        if (argc <= firstInput) {
+
+            if (verifyOnly) {
+                ok = verify("2K", makeEquirect(2048)) && ok;
+                ok = verify("2K", makeEquirect(2000)) && ok;
+            }
+            else {
+                benchmark("2K", makeEquirect(2048));
+                benchmark("8K", makeEquirect(8192));
+            }
+
+            return ok ? 0 : 1;
+        }
+
+        for (int i = firstInput; i < argc; ++i) {
+
+            int width = 0, height = 0, channels = 0;
+            float* pixels = stbi_loadf(argv[i], &width, &height, &channels, 4);
+
+            if (!pixels) {
+                std::cout << "[CubemapBench] failed to read " << argv[i] << ", skipped" << std::endl;
+                continue;
+            }
+
+            lzvk::tools::Bitmap equirect(width, height, 4, lzvk::tools::BitmapFormat::Float, pixels);
+            stbi_image_free(pixels);
+
+            if (verifyOnly) {
+                ok = verify(argv[i], equirect) && ok;
+            }
+            else {
+                benchmark(argv[i], equirect);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return ok ? 0 : 1;
+}
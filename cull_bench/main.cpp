@@ -0,0 +1,75 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include "../renderer/scene/cpu_culler.h"
+
+namespace {
+
+    // Draws scattered over a square around the camera, so every plane test and the contribution test cull some of them
+    std::vector<lzvk::renderer::CullDraw> makeDraws(uint32_t drawCount) {
+
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+        std::uniform_real_distribution<float> height(0.0f, 40.0f);
+        std::uniform_real_distribution<float> radius(0.05f, 4.0f);
+
+        std::vector<lzvk::renderer::CullDraw> draws(drawCount);
+
+        for (uint32_t i = 0; i < drawCount; ++i) {
+
+            auto& draw = draws[i];
+            draw.sphere = glm::vec4(position(random), height(random), position(random), radius(random));
+            draw.materialId = i % 64;
+
+            // 1 Three levels, each one a quarter of the indices of the previous
+            draw.command.indexCount = 3 * 1024;
+            draw.command.instanceCount = 1;
+            draw.command.firstInstance = i;
+            draw.lodCount = 3;
+
+            for (uint32_t l = 0; l < draw.lodCount; ++l) {
+
+                draw.lods[l].indexCount = draw.command.indexCount >> (2 * l);
+                draw.lods[l].error = l == 0 ? 0.0f : 0.01f * float(1u << (2 * l)) * draw.sphere.w;
+            }
+        }
+
+        return draws;
+    }
+}
+
+// CullBench [drawCount] [iterations]
+// Defaults to 100000 draws culled 1000 times per variant
+int main(int argc, char** argv) {
+
+    const uint32_t drawCount = argc > 1 ? static_cast<uint32_t>(std::stoul(argv[1])) : 100000;
+    const uint32_t iterations = argc > 2 ? static_cast<uint32_t>(std::stoul(argv[2])) : 1000;
+
+    std::cout << "[CullBench] " << (lzvk::renderer::CpuCuller::isSimdEnabled() ? "AVX2" : "scalar") << " kernels" << std::endl;
+
+    try {
+
+        // 1 Same camera setup as the application, at 1080p
+        const float height = 1080.0f;
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+        projection[1][1] *= -1.0f;
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 20.0f, 0.0f), glm::vec3(100.0f, 0.0f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        lzvk::renderer::CullingSettings settings{};
+        settings.pixelScale = std::abs(projection[1][1]) * height * 0.5f;
+
+        // 2 No device, the culler only runs the benchmark
+        auto culler = lzvk::renderer::CpuCuller::create(nullptr, 0);
+        culler->setDraws(makeDraws(drawCount));
+        culler->setSettings(settings);
+
+        culler->benchmark(projection * view, iterations);
+    }
+    catch (const std::exception& e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
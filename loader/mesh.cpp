@@ -462,13 +462,21 @@ namespace lzvk::loader {
         return true;
     }
 
-    void saveMeshData(const std::string& path, const MeshData& meshData) {
+    namespace {
+
+        constexpr uint32_t MESH_CACHE_MAGIC = 0x484d5a4c; // "LZMH"
+        constexpr uint32_t MESH_CACHE_VERSION = 1;
+    }
+
+    void saveMeshData(const std::string& path, const MeshData& meshData, uint64_t cacheKey) {
         FILE* f = fopen(path.c_str(), "wb");
         if (!f) {
             printf("Failed to open file %s for writing\n", path.c_str());
             return;
         }
 
+        writeCacheHeader(f, MESH_CACHE_MAGIC, MESH_CACHE_VERSION, cacheKey);
+
         auto saveString = [](FILE* f, const std::string& s) {
             uint64_t len = s.length();
             fwrite(&len, sizeof(len), 1, f);
@@ -532,10 +540,15 @@ namespace lzvk::loader {
         printf("MeshData saved to %s\n", path.c_str());
     }
 
-    bool loadMeshData(const std::string& path, MeshData& meshData) {
+    bool loadMeshData(const std::string& path, MeshData& meshData, uint64_t cacheKey) {
         FILE* f = fopen(path.c_str(), "rb");
         if (!f) return false;
 
+        if (!readCacheHeader(f, path, MESH_CACHE_MAGIC, MESH_CACHE_VERSION, cacheKey)) {
+            fclose(f);
+            return false;
+        }
+
         auto loadString = [](FILE* f) -> std::string {
             uint64_t len = 0;
             fread(&len, sizeof(len), 1, f);
@@ -54,7 +54,7 @@ namespace lzvk::loader {
     };
 
     bool loadMeshFile(const std::string& path, MeshData& meshData, Scene& scene);
-    bool loadMeshData(const std::string& path, MeshData& meshData);
-    void saveMeshData(const std::string& path, const MeshData& meshData);
+    bool loadMeshData(const std::string& path, MeshData& meshData, uint64_t cacheKey = 0);
+    void saveMeshData(const std::string& path, const MeshData& meshData, uint64_t cacheKey = 0);
 }
 
@@ -86,13 +86,47 @@ namespace lzvk::loader {
 		return std::string();
 	}
 
-    void saveScene(const std::string& path, const Scene& scene) {
+    namespace {
+
+        constexpr uint32_t SCENE_CACHE_MAGIC = 0x43535a4c; // "LZSC"
+        constexpr uint32_t SCENE_CACHE_VERSION = 1;
+    }
+
+    void writeCacheHeader(FILE* f, uint32_t magic, uint32_t fileVersion, uint64_t key) {
+
+        CacheHeader header{};
+        header.magic = magic;
+        header.fileVersion = fileVersion;
+        header.key = key;
+        fwrite(&header, sizeof(header), 1, f);
+    }
+
+    bool readCacheHeader(FILE* f, const std::string& path, uint32_t magic, uint32_t fileVersion, uint64_t key) {
+
+        CacheHeader header{};
+
+        if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != magic || header.fileVersion != fileVersion) {
+            printf("[Cache] %s has an old format, rebuilding it\n", path.c_str());
+            return false;
+        }
+
+        if (header.key != key) {
+            printf("[Cache] %s was built with other settings, rebuilding it\n", path.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    void saveScene(const std::string& path, const Scene& scene, uint64_t cacheKey) {
         FILE* f = fopen(path.c_str(), "wb");
         if (!f) {
             printf("Failed to open file %s for writing\n", path.c_str());
             return;
         }
 
+        writeCacheHeader(f, SCENE_CACHE_MAGIC, SCENE_CACHE_VERSION, cacheKey);
+
         uint64_t numNodes = scene.hierarchy.size();
         fwrite(&numNodes, sizeof(numNodes), 1, f);
         if (numNodes > 0) {
@@ -137,10 +171,15 @@ namespace lzvk::loader {
         printf("Scene saved to %s\n", path.c_str());
     }
 
-    bool loadScene(const std::string& path, Scene& scene) {
+    bool loadScene(const std::string& path, Scene& scene, uint64_t cacheKey) {
         FILE* f = fopen(path.c_str(), "rb");
         if (!f) return false;
 
+        if (!readCacheHeader(f, path, SCENE_CACHE_MAGIC, SCENE_CACHE_VERSION, cacheKey)) {
+            fclose(f);
+            return false;
+        }
+
         uint64_t numNodes;
         fread(&numNodes, sizeof(numNodes), 1, f);
         scene.hierarchy.resize(numNodes);
@@ -40,8 +40,20 @@ namespace lzvk::loader {
 	void markAsChanged(Scene& scene, int node);
 	std::string getNodeName(const Scene& scene, int node);
 
-	void saveScene(const std::string& path, const Scene& scene);
-	bool loadScene(const std::string& path, Scene& scene);
+	// The .meshes and .scene caches start with this header. A file of another format version, or
+	// written with another key, loads as missing and the caller rebuilds it. The key is a hash of
+	// the settings the cached data was built with.
+	struct CacheHeader {
+		uint32_t magic{ 0 };
+		uint32_t fileVersion{ 0 };
+		uint64_t key{ 0 };
+	};
+
+	void writeCacheHeader(FILE* f, uint32_t magic, uint32_t fileVersion, uint64_t key);
+	bool readCacheHeader(FILE* f, const std::string& path, uint32_t magic, uint32_t fileVersion, uint64_t key);
+
+	void saveScene(const std::string& path, const Scene& scene, uint64_t cacheKey = 0);
+	bool loadScene(const std::string& path, Scene& scene, uint64_t cacheKey = 0);
 }
 
 
@@ -0,0 +1,370 @@
+#include "frame_graph.h"
+
+namespace lzvk::renderer {
+
+	FrameGraph::FrameGraph(const lzvk::wrapper::Device::Ptr& device) {
+
+		mDevice = device;
+	}
+
+	FrameGraph::~FrameGraph() {
+
+		// images go first, the heaps they are bound to are freed after them
+		for (auto& resource : mResources) {
+			resource.image.reset();
+		}
+
+		for (auto& heap : mHeaps) {
+
+			if (heap.allocation.memory != VK_NULL_HANDLE) {
+				mDevice->getAllocator()->free(heap.allocation);
+			}
+		}
+	}
+
+	FrameGraphResource FrameGraph::createImage(const std::string& name, const FrameGraphImageDesc& desc) {
+
+		if (mCompiled) {
+			throw std::runtime_error("Error: frame graph is already compiled");
+		}
+
+		Resource resource{};
+		resource.name = name;
+		resource.desc = desc;
+		mResources.push_back(resource);
+
+		return static_cast<FrameGraphResource>(mResources.size() - 1);
+	}
+
+	uint32_t FrameGraph::addPass(const std::string& name, ExecuteFunction execute, bool sideEffects) {
+
+		if (mCompiled) {
+			throw std::runtime_error("Error: frame graph is already compiled");
+		}
+
+		Pass pass{};
+		pass.name = name;
+		pass.execute = std::move(execute);
+		pass.sideEffects = sideEffects;
+		mPasses.push_back(std::move(pass));
+
+		return static_cast<uint32_t>(mPasses.size() - 1);
+	}
+
+	void FrameGraph::read(uint32_t pass, FrameGraphResource resource, lzvk::wrapper::ImageAccess access) {
+
+		if (pass >= mPasses.size() || resource >= mResources.size()) {
+			throw std::runtime_error("Error: frame graph read of an unknown pass or resource");
+		}
+
+		mPasses[pass].accesses.push_back({ resource, access, false });
+	}
+
+	void FrameGraph::write(uint32_t pass, FrameGraphResource resource, lzvk::wrapper::ImageAccess access) {
+
+		if (pass >= mPasses.size() || resource >= mResources.size()) {
+			throw std::runtime_error("Error: frame graph write of an unknown pass or resource");
+		}
+
+		mPasses[pass].accesses.push_back({ resource, access, true });
+	}
+
+	void FrameGraph::compile() {
+
+		if (mCompiled) {
+			throw std::runtime_error("Error: frame graph is already compiled");
+		}
+
+		// 1 Passes and lifetimes
+		cullPasses();
+		computeLifetimes();
+
+		// 2 Images without memory, their requirements drive the placement
+		for (auto& resource : mResources) {
+
+			if (resource.firstPass == NONE) {
+				continue;
+			}
+
+			resource.image = lzvk::wrapper::Image::createTransient(mDevice, resource.desc.width, resource.desc.height,
+																	resource.desc.format, resource.desc.usage, resource.desc.aspect);
+			resource.requirements = resource.image->getMemoryRequirements();
+			mUnaliasedBytes += resource.requirements.size;
+		}
+
+		placeResources();
+
+		// 3 One allocation per heap, every image is bound at its offset
+		for (auto& heap : mHeaps) {
+
+			VkMemoryRequirements requirements{};
+			requirements.size = heap.size;
+			requirements.alignment = heap.alignment;
+			requirements.memoryTypeBits = heap.memoryTypeBits;
+
+			heap.allocation = mDevice->getAllocator()->allocateForRequirements(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "transient heap");
+			mHeapBytes += heap.size;
+		}
+
+		for (auto& resource : mResources) {
+
+			if (resource.image) {
+
+				const auto& heap = mHeaps[resource.heap];
+				resource.image->bindMemory(heap.allocation.memory, heap.allocation.offset + resource.offset);
+			}
+		}
+
+		mCompiled = true;
+		printStats();
+	}
+
+	void FrameGraph::cullPasses() {
+
+		// walk backwards, a pass is live when it has side effects or writes an image a later live pass reads
+		std::vector<bool> needed(mResources.size(), false);
+		mLivePassCount = 0;
+
+		for (uint32_t i = static_cast<uint32_t>(mPasses.size()); i-- > 0;) {
+
+			auto& pass = mPasses[i];
+			pass.live = pass.sideEffects;
+
+			for (const auto& access : pass.accesses) {
+
+				if (access.write && needed[access.resource]) {
+					pass.live = true;
+				}
+			}
+
+			if (!pass.live) {
+				continue;
+			}
+
+			++mLivePassCount;
+
+			for (const auto& access : pass.accesses) {
+
+				if (access.write) {
+					needed[access.resource] = false;
+				}
+			}
+
+			for (const auto& access : pass.accesses) {
+
+				if (!access.write) {
+					needed[access.resource] = true;
+				}
+			}
+		}
+	}
+
+	void FrameGraph::computeLifetimes() {
+
+		for (uint32_t i = 0; i < mPasses.size(); ++i) {
+
+			if (!mPasses[i].live) {
+				continue;
+			}
+
+			for (const auto& access : mPasses[i].accesses) {
+
+				auto& resource = mResources[access.resource];
+
+				if (resource.firstPass == NONE) {
+					resource.firstPass = i;
+				}
+
+				resource.lastPass = i;
+			}
+		}
+	}
+
+	void FrameGraph::placeResources() {
+
+		// 1 Largest first, smaller images fill the space of the ones that are dead by then
+		std::vector<FrameGraphResource> order{};
+
+		for (FrameGraphResource i = 0; i < mResources.size(); ++i) {
+
+			if (mResources[i].image) {
+				order.push_back(i);
+			}
+		}
+
+		std::sort(order.begin(), order.end(), [this](FrameGraphResource a, FrameGraphResource b) {
+			return mResources[a].requirements.size > mResources[b].requirements.size;
+		});
+
+		std::vector<FrameGraphResource> placed{};
+
+		for (auto index : order) {
+
+			auto& resource = mResources[index];
+			const auto& requirements = resource.requirements;
+
+			// 1.1 A heap whose memory types the image can live in
+			uint32_t heapIndex = NONE;
+
+			for (uint32_t h = 0; h < mHeaps.size(); ++h) {
+
+				if (mHeaps[h].memoryTypeBits & requirements.memoryTypeBits) {
+					heapIndex = h;
+					break;
+				}
+			}
+
+			if (heapIndex == NONE) {
+
+				Heap heap{};
+				heap.memoryTypeBits = requirements.memoryTypeBits;
+				mHeaps.push_back(heap);
+				heapIndex = static_cast<uint32_t>(mHeaps.size() - 1);
+			}
+
+			auto& heap = mHeaps[heapIndex];
+			heap.memoryTypeBits &= requirements.memoryTypeBits;
+			heap.alignment = std::max(heap.alignment, requirements.alignment);
+
+			// 1.2 Lowest offset not overlapping an image that is alive at the same time
+			std::vector<std::pair<VkDeviceSize, VkDeviceSize>> taken{};
+
+			for (auto other : placed) {
+
+				const auto& placedResource = mResources[other];
+				bool overlapping = !(placedResource.lastPass < resource.firstPass || resource.lastPass < placedResource.firstPass);
+
+				if (placedResource.heap == heapIndex && overlapping) {
+					taken.push_back({ placedResource.offset, placedResource.offset + placedResource.requirements.size });
+				}
+			}
+
+			std::sort(taken.begin(), taken.end());
+
+			auto alignUp = [&](VkDeviceSize value) {
+				return (value + requirements.alignment - 1) / requirements.alignment * requirements.alignment;
+			};
+
+			VkDeviceSize offset = 0;
+
+			for (const auto& [begin, end] : taken) {
+
+				if (alignUp(offset) + requirements.size <= begin) {
+					break;
+				}
+
+				offset = std::max(offset, end);
+			}
+
+			resource.heap = heapIndex;
+			resource.offset = alignUp(offset);
+			heap.size = std::max(heap.size, resource.offset + requirements.size);
+
+			placed.push_back(index);
+		}
+
+		// 2 Images sharing bytes, their lifetimes are disjoint by construction
+		for (auto a : placed) {
+			for (auto b : placed) {
+
+				const auto& resourceA = mResources[a];
+				const auto& resourceB = mResources[b];
+
+				if (a == b || resourceA.heap != resourceB.heap) {
+					continue;
+				}
+
+				bool sharesMemory = resourceA.offset < resourceB.offset + resourceB.requirements.size &&
+									resourceB.offset < resourceA.offset + resourceA.requirements.size;
+
+				if (sharesMemory) {
+					mResources[a].aliases.push_back(b);
+				}
+			}
+		}
+	}
+
+	void FrameGraph::execute(const lzvk::wrapper::CommandBuffer::Ptr& commandBuffer) {
+
+		if (!mCompiled) {
+			throw std::runtime_error("Error: frame graph must be compiled before it is executed");
+		}
+
+		std::vector<bool> started(mResources.size(), false);
+
+		for (auto& pass : mPasses) {
+
+			if (!pass.live) {
+				continue;
+			}
+
+			// 1 Barriers, queued here and recorded as one batch by the first command of the pass
+			for (const auto& access : pass.accesses) {
+
+				auto& resource = mResources[access.resource];
+				bool discard = false;
+
+				if (!started[access.resource]) {
+
+					started[access.resource] = true;
+
+					if (access.write) {
+
+						beginLifetime(resource);
+						discard = true;
+					}
+				}
+
+				commandBuffer->requireImage(resource.image, access.access, discard);
+			}
+
+			// 2 Commands
+			pass.execute(commandBuffer);
+		}
+	}
+
+	void FrameGraph::beginLifetime(Resource& resource) {
+
+		// the contents are undefined, the first write still has to wait for the last use of every
+		// image placed on the same bytes and for this image's own use in the previous frame
+		lzvk::wrapper::ImageSubresourceState state = resource.image->getSubresourceState(0, 0);
+		state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		for (auto alias : resource.aliases) {
+
+			const auto& aliasState = mResources[alias].image->getSubresourceState(0, 0);
+			state.stages |= aliasState.stages;
+			state.access |= aliasState.access;
+		}
+
+		resource.image->setSubresourceState(0, 0, state);
+	}
+
+	void FrameGraph::printStats() const {
+
+		const double mb = 1.0 / (1024.0 * 1024.0);
+
+		printf("[FrameGraph] %u of %u passes live\n", mLivePassCount, getPassCount());
+
+		for (const auto& pass : mPasses) {
+
+			if (!pass.live) {
+				printf("[FrameGraph]   culled %s\n", pass.name.c_str());
+			}
+		}
+
+		for (const auto& resource : mResources) {
+
+			if (!resource.image) {
+				continue;
+			}
+
+			printf("[FrameGraph]   %-16s passes %u-%u, heap %u at %7.2f MB, %6.2f MB, %zu aliases\n",
+				   resource.name.c_str(), resource.firstPass, resource.lastPass, resource.heap,
+				   resource.offset * mb, resource.requirements.size * mb, resource.aliases.size());
+		}
+
+		printf("[FrameGraph] %.1f MB of transient images in %.1f MB of heaps, aliasing saves %.1f MB\n",
+			   mUnaliasedBytes * mb, mHeapBytes * mb, (mUnaliasedBytes - mHeapBytes) * mb);
+	}
+}
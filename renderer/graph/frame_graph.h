@@ -0,0 +1,118 @@
+#pragma once
+
+#include "../../common.h"
+#include "../../wrapper/device.h"
+#include "../../wrapper/image.h"
+#include "../../wrapper/command_buffer.h"
+#include "../../wrapper/memory_allocator.h"
+
+namespace lzvk::renderer {
+
+	using FrameGraphResource = uint32_t;
+
+	struct FrameGraphImageDesc {
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+		VkImageUsageFlags usage{ 0 };
+		VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+	};
+
+	// Passes declare the images they read and write. compile culls passes whose results are
+	// never used, places images whose lifetimes don't overlap at the same memory and creates
+	// them. execute records the live passes in declaration order and derives every barrier
+	// from the declared accesses. The graph is rebuilt when the pass list or resolution changes.
+	class FrameGraph {
+	public:
+
+		using Ptr = std::shared_ptr<FrameGraph>;
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device) { return std::make_shared<FrameGraph>(device); }
+
+		using ExecuteFunction = std::function<void(const lzvk::wrapper::CommandBuffer::Ptr&)>;
+
+		explicit FrameGraph(const lzvk::wrapper::Device::Ptr& device);
+		~FrameGraph();
+
+		// 1 Declaration, passes with side effects (e.g. drawing to the swapchain) are never culled
+		FrameGraphResource createImage(const std::string& name, const FrameGraphImageDesc& desc);
+		uint32_t addPass(const std::string& name, ExecuteFunction execute, bool sideEffects = false);
+		void read(uint32_t pass, FrameGraphResource resource, lzvk::wrapper::ImageAccess access);
+		void write(uint32_t pass, FrameGraphResource resource, lzvk::wrapper::ImageAccess access);
+
+		// 2 Cull, compute lifetimes, alias and create the images
+		void compile();
+
+		// 3 Record
+		void execute(const lzvk::wrapper::CommandBuffer::Ptr& commandBuffer);
+
+		// null for images only used by culled passes
+		[[nodiscard]] lzvk::wrapper::Image::Ptr getImage(FrameGraphResource resource) const { return mResources[resource].image; }
+
+		[[nodiscard]] auto getPassCount() const { return static_cast<uint32_t>(mPasses.size()); }
+		[[nodiscard]] auto getLivePassCount() const { return mLivePassCount; }
+		[[nodiscard]] auto getUnaliasedBytes() const { return mUnaliasedBytes; }
+		[[nodiscard]] auto getHeapBytes() const { return mHeapBytes; }
+
+		void printStats() const;
+
+	private:
+
+		static constexpr uint32_t NONE = ~0u;
+
+		struct Access {
+			FrameGraphResource resource{ 0 };
+			lzvk::wrapper::ImageAccess access{ lzvk::wrapper::ImageAccess::SampledFragment };
+			bool write{ false };
+		};
+
+		struct Pass {
+			std::string name{};
+			ExecuteFunction execute{};
+			bool sideEffects{ false };
+			bool live{ false };
+			std::vector<Access> accesses{};
+		};
+
+		struct Resource {
+			std::string name{};
+			FrameGraphImageDesc desc{};
+			lzvk::wrapper::Image::Ptr image{ nullptr };
+			VkMemoryRequirements requirements{};
+
+			// first and last live pass, NONE when no live pass uses the image
+			uint32_t firstPass{ NONE };
+			uint32_t lastPass{ NONE };
+
+			uint32_t heap{ NONE };
+			VkDeviceSize offset{ 0 };
+
+			// images placed over the same bytes, the first use waits for their last use
+			std::vector<FrameGraphResource> aliases{};
+		};
+
+		struct Heap {
+			uint32_t memoryTypeBits{ 0 };
+			VkDeviceSize alignment{ 1 };
+			VkDeviceSize size{ 0 };
+			lzvk::wrapper::MemoryAllocation allocation{};
+		};
+
+		void cullPasses();
+		void computeLifetimes();
+		void placeResources();
+		void beginLifetime(Resource& resource);
+
+	private:
+
+		lzvk::wrapper::Device::Ptr mDevice{ nullptr };
+
+		std::vector<Pass> mPasses{};
+		std::vector<Resource> mResources{};
+		std::vector<Heap> mHeaps{};
+
+		bool mCompiled{ false };
+		uint32_t mLivePassCount{ 0 };
+		VkDeviceSize mUnaliasedBytes{ 0 };
+		VkDeviceSize mHeapBytes{ 0 };
+	};
+}
@@ -0,0 +1,414 @@
+#include "cpu_culler.h"
+#include <chrono>
+#include <cfloat>
+#include <cstring>
+#include "../../tools/simd.h"
+
+namespace lzvk::renderer {
+
+    CpuCuller::CpuCuller(const lzvk::wrapper::Device::Ptr& device, uint32_t frameCount, uint32_t workerCount) {
+
+        mDevice = device;
+        mIndirectBuffers.resize(frameCount);
+        mVisibleCounts.resize(frameCount, 0);
+
+        // 1 Pick worker count, keep one core for the render thread
+        if (workerCount == 0) {
+
+            uint32_t hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        mWorkerCount = std::max(1u, workerCount);
+        mSliceCommands.resize(mWorkerCount);
+        mSliceStats.resize(mWorkerCount);
+
+        // 2 Spawn persistent workers, slice 0 is handled by the caller
+        for (uint32_t i = 1; i < mWorkerCount; ++i) {
+
+            mWorkers.emplace_back(&CpuCuller::workerLoop, this, i);
+        }
+    }
+
+    CpuCuller::~CpuCuller() {
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStop = true;
+        }
+
+        mWakeCondition.notify_all();
+
+        for (auto& worker : mWorkers) {
+            worker.join();
+        }
+    }
+
+    bool CpuCuller::isSimdEnabled() {
+        return lzvk::tools::hasAvx2();
+    }
+
+    void CpuCuller::setDraws(const std::vector<CullDraw>& draws) {
+
+        mDraws = draws;
+        mDrawCount = static_cast<uint32_t>(draws.size());
+        mGroupCount = (mDrawCount + 7) / 8;
+
+        // 1 Pad with spheres that fail every plane test
+        size_t paddedCount = static_cast<size_t>(mGroupCount) * 8;
+        mCenterX.assign(paddedCount, 0.0f);
+        mCenterY.assign(paddedCount, 0.0f);
+        mCenterZ.assign(paddedCount, 0.0f);
+        mRadius.assign(paddedCount, -FLT_MAX);
+        mSizeRadius.assign(paddedCount, -FLT_MAX);
+
+        for (uint32_t i = 0; i < mDrawCount; ++i) {
+
+            mCenterX[i] = draws[i].sphere.x;
+            mCenterY[i] = draws[i].sphere.y;
+            mCenterZ[i] = draws[i].sphere.z;
+            mRadius[i] = draws[i].sphere.w;
+            mSizeRadius[i] = draws[i].sphere.w;
+        }
+
+        mExemptDrawCount = 0;
+
+        // 2 One mapped indirect buffer per frame in flight, none without a device
+        VkDeviceSize bufferSize = std::max<VkDeviceSize>(1, mDrawCount) * sizeof(VkDrawIndexedIndirectCommand);
+
+        for (size_t i = 0; i < mIndirectBuffers.size() && mDevice; ++i) {
+
+            mIndirectBuffers[i] = lzvk::wrapper::Buffer::createHostIndirectBuffer(mDevice, bufferSize);
+            mVisibleCounts[i] = 0;
+        }
+
+        for (auto& slice : mSliceCommands) {
+            slice.reserve(mDrawCount / mWorkerCount + 8);
+        }
+    }
+
+    void CpuCuller::setExemptMaterials(const std::unordered_set<uint32_t>& materialIds) {
+
+        // Exempt draws always pass the contribution test
+        mExemptDrawCount = 0;
+
+        for (uint32_t i = 0; i < mDrawCount; ++i) {
+
+            bool exempt = materialIds.count(mDraws[i].materialId) > 0;
+            mSizeRadius[i] = exempt ? FLT_MAX : mRadius[i];
+            mExemptDrawCount += exempt ? 1 : 0;
+        }
+    }
+
+    uint32_t CpuCuller::cull(const glm::mat4& viewProj, uint32_t frameIndex) {
+
+        auto start = std::chrono::high_resolution_clock::now();
+
+        run(viewProj, isSimdEnabled(), mWorkerCount);
+
+        // Compact the per slice results into this frame's buffer
+        auto* dst = static_cast<VkDrawIndexedIndirectCommand*>(mIndirectBuffers[frameIndex]->getMappedData());
+        uint32_t visibleCount = 0;
+
+        for (uint32_t i = 0; i < mJobWorkerCount; ++i) {
+
+            const auto& slice = mSliceCommands[i];
+
+            if (!slice.empty()) {
+
+                memcpy(dst + visibleCount, slice.data(), slice.size() * sizeof(VkDrawIndexedIndirectCommand));
+                visibleCount += static_cast<uint32_t>(slice.size());
+            }
+        }
+
+        mVisibleCounts[frameIndex] = visibleCount;
+        mSmallCulledCount = 0;
+        mLodDrawCount = 0;
+
+        for (uint32_t i = 0; i < mJobWorkerCount; ++i) {
+
+            mSmallCulledCount += mSliceStats[i].smallCulled;
+            mLodDrawCount += mSliceStats[i].lodDraws;
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        mLastCullTimeMs = std::chrono::duration<float, std::milli>(end - start).count();
+
+        return visibleCount;
+    }
+
+    void CpuCuller::benchmark(const glm::mat4& viewProj, uint32_t iterations) {
+
+        struct Variant {
+            const char* name;
+            bool useSimd;
+            uint32_t workerCount;
+        };
+
+        std::vector<Variant> variants = {
+            { "scalar, 1 thread", false, 1 },
+            { "scalar, all threads", false, mWorkerCount },
+        };
+
+        if (isSimdEnabled()) {
+
+            variants.push_back({ "avx2, 1 thread", true, 1 });
+            variants.push_back({ "avx2, all threads", true, mWorkerCount });
+        }
+
+        printf("[CpuCuller] benchmark: %u draws, %u iterations, %u workers\n", mDrawCount, iterations, mWorkerCount);
+
+        for (const auto& variant : variants) {
+
+            uint32_t visibleCount = 0;
+            auto start = std::chrono::high_resolution_clock::now();
+
+            for (uint32_t i = 0; i < iterations; ++i) {
+
+                visibleCount = run(viewProj, variant.useSimd, variant.workerCount);
+            }
+
+            auto end = std::chrono::high_resolution_clock::now();
+            double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+            printf("[CpuCuller]   %-20s %8.4f ms/frame, %u visible\n", variant.name, totalMs / std::max(1u, iterations), visibleCount);
+        }
+    }
+
+    uint32_t CpuCuller::run(const glm::mat4& viewProj, bool useSimd, uint32_t workerCount) {
+
+        // 1 Extract normalized frustum planes, depth range is [0, 1]
+        glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+        glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+        glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+        glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+
+        mPlanes[0] = row3 + row0;
+        mPlanes[1] = row3 - row0;
+        mPlanes[2] = row3 + row1;
+        mPlanes[3] = row3 - row1;
+        mPlanes[4] = row2;
+        mPlanes[5] = row3 - row2;
+
+        for (auto& plane : mPlanes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+
+        // 2 Clip space w is the view depth, a draw is kept while
+        //   2 * radius * pixelScale / depth >= minPixelSize
+        mDepthRow = row3;
+        mMinSizeDepthScale = mSettings.contributionCulling ? mSettings.minPixelSize / (2.0f * mSettings.pixelScale) : 0.0f;
+
+        mUseSimd = useSimd;
+        mJobWorkerCount = std::min(std::max(1u, workerCount), mWorkerCount);
+
+        // 3 Wake the workers and cull slice 0 on this thread
+        if (mJobWorkerCount > 1) {
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mPendingWorkers = static_cast<uint32_t>(mWorkers.size());
+                ++mGeneration;
+            }
+
+            mWakeCondition.notify_all();
+        }
+
+        cullSlice(0);
+
+        if (mJobWorkerCount > 1) {
+
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDoneCondition.wait(lock, [this] { return mPendingWorkers == 0; });
+        }
+
+        uint32_t visibleCount = 0;
+        for (uint32_t i = 0; i < mJobWorkerCount; ++i) {
+            visibleCount += static_cast<uint32_t>(mSliceCommands[i].size());
+        }
+
+        return visibleCount;
+    }
+
+    void CpuCuller::workerLoop(uint32_t workerIndex) {
+
+        uint64_t seenGeneration = 0;
+
+        while (true) {
+
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mWakeCondition.wait(lock, [&] { return mStop || mGeneration != seenGeneration; });
+
+                if (mStop) {
+                    return;
+                }
+
+                seenGeneration = mGeneration;
+            }
+
+            if (workerIndex < mJobWorkerCount) {
+                cullSlice(workerIndex);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+
+                if (--mPendingWorkers == 0) {
+                    mDoneCondition.notify_one();
+                }
+            }
+        }
+    }
+
+    void CpuCuller::cullSlice(uint32_t slice) {
+
+        auto& out = mSliceCommands[slice];
+        auto& stats = mSliceStats[slice];
+        out.clear();
+        stats = SliceStats{};
+
+        // Slices are made of whole groups of 8 draws
+        uint32_t firstGroup = static_cast<uint32_t>(uint64_t(mGroupCount) * slice / mJobWorkerCount);
+        uint32_t lastGroup = static_cast<uint32_t>(uint64_t(mGroupCount) * (slice + 1) / mJobWorkerCount);
+
+        if (mUseSimd) {
+            cullGroupsSimd(firstGroup, lastGroup, out, stats);
+        }
+        else {
+            cullGroupsScalar(firstGroup, lastGroup, out, stats);
+        }
+    }
+
+    void CpuCuller::cullGroupsScalar(uint32_t firstGroup, uint32_t lastGroup, std::vector<VkDrawIndexedIndirectCommand>& out, SliceStats& stats) const {
+
+        uint32_t end = std::min(lastGroup * 8, mDrawCount);
+
+        for (uint32_t i = firstGroup * 8; i < end; ++i) {
+
+            bool visible = true;
+
+            for (const auto& plane : mPlanes) {
+
+                float distance = plane.x * mCenterX[i] + plane.y * mCenterY[i] + plane.z * mCenterZ[i] + plane.w;
+
+                if (distance < -mRadius[i]) {
+                    visible = false;
+                    break;
+                }
+            }
+
+            if (!visible) {
+                continue;
+            }
+
+            float depth = mDepthRow.x * mCenterX[i] + mDepthRow.y * mCenterY[i] + mDepthRow.z * mCenterZ[i] + mDepthRow.w;
+
+            if (mSizeRadius[i] < depth * mMinSizeDepthScale) {
+                ++stats.smallCulled;
+                continue;
+            }
+
+            emitDraw(i, out, stats);
+        }
+    }
+
+    LZVK_TARGET_AVX2 void CpuCuller::cullGroupsSimd(uint32_t firstGroup, uint32_t lastGroup, std::vector<VkDrawIndexedIndirectCommand>& out, SliceStats& stats) const {
+
+#if LZVK_X86_SIMD
+        __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+
+        for (int p = 0; p < 6; ++p) {
+
+            planeX[p] = _mm256_set1_ps(mPlanes[p].x);
+            planeY[p] = _mm256_set1_ps(mPlanes[p].y);
+            planeZ[p] = _mm256_set1_ps(mPlanes[p].z);
+            planeW[p] = _mm256_set1_ps(mPlanes[p].w);
+        }
+
+        __m256 depthX = _mm256_set1_ps(mDepthRow.x);
+        __m256 depthY = _mm256_set1_ps(mDepthRow.y);
+        __m256 depthZ = _mm256_set1_ps(mDepthRow.z);
+        __m256 depthW = _mm256_set1_ps(mDepthRow.w);
+        __m256 minSizeDepthScale = _mm256_set1_ps(mMinSizeDepthScale);
+
+        for (uint32_t group = firstGroup; group < lastGroup; ++group) {
+
+            uint32_t base = group * 8;
+
+            __m256 x = _mm256_loadu_ps(&mCenterX[base]);
+            __m256 y = _mm256_loadu_ps(&mCenterY[base]);
+            __m256 z = _mm256_loadu_ps(&mCenterZ[base]);
+            __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&mRadius[base]));
+
+            // 8 spheres against one plane per iteration, visible while distance >= -radius
+            __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+            for (int p = 0; p < 6; ++p) {
+
+                __m256 distance = _mm256_fmadd_ps(planeX[p], x,
+                                  _mm256_fmadd_ps(planeY[p], y,
+                                  _mm256_fmadd_ps(planeZ[p], z, planeW[p])));
+
+                visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+            }
+
+            // Contribution test on the same 8 draws
+            __m256 depth = _mm256_fmadd_ps(depthX, x, _mm256_fmadd_ps(depthY, y, _mm256_fmadd_ps(depthZ, z, depthW)));
+            __m256 largeEnough = _mm256_cmp_ps(_mm256_loadu_ps(&mSizeRadius[base]), _mm256_mul_ps(depth, minSizeDepthScale), _CMP_GE_OQ);
+
+            uint32_t frustumMask = static_cast<uint32_t>(_mm256_movemask_ps(visible));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_and_ps(visible, largeEnough)));
+
+            for (uint32_t small = frustumMask & ~mask; small != 0; small &= small - 1) {
+                ++stats.smallCulled;
+            }
+
+            while (mask != 0) {
+
+                uint32_t lane = 0;
+                while ((mask & (1u << lane)) == 0) {
+                    ++lane;
+                }
+
+                mask &= mask - 1;
+                emitDraw(base + lane, out, stats);
+            }
+        }
+#else
+        cullGroupsScalar(firstGroup, lastGroup, out, stats);
+#endif
+    }
+
+    void CpuCuller::emitDraw(uint32_t drawIndex, std::vector<VkDrawIndexedIndirectCommand>& out, SliceStats& stats) const {
+
+        const CullDraw& draw = mDraws[drawIndex];
+        VkDrawIndexedIndirectCommand cmd = draw.command;
+
+        // Coarsest level whose projected error stays under the pixel threshold
+        if (mSettings.lodSelection && draw.lodCount > 1) {
+
+            float depth = mDepthRow.x * mCenterX[drawIndex] + mDepthRow.y * mCenterY[drawIndex] + mDepthRow.z * mCenterZ[drawIndex] + mDepthRow.w;
+
+            if (depth > 0.0f) {
+
+                float maxError = mSettings.maxLodErrorPixels * depth / mSettings.pixelScale;
+                uint32_t level = 0;
+
+                while (level + 1 < draw.lodCount && draw.lods[level + 1].error <= maxError) {
+                    ++level;
+                }
+
+                if (level > 0) {
+
+                    cmd.firstIndex = draw.lods[level].firstIndex;
+                    cmd.indexCount = draw.lods[level].indexCount;
+                    ++stats.lodDraws;
+                }
+            }
+        }
+
+        out.push_back(cmd);
+    }
+
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "../../common.h"
+#include "../../wrapper/device.h"
+#include "../../wrapper/buffer.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+
+namespace lzvk::renderer {
+
+	constexpr uint32_t MAX_DRAW_LODS = 4;
+
+	struct DrawLod {
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+
+		// world space error of this level
+		float error = 0.0f;
+	};
+
+	struct CullDraw {
+		VkDrawIndexedIndirectCommand command{};
+
+		// xyz = world space center, w = radius
+		glm::vec4 sphere{ 0.0f };
+		uint32_t materialId = 0;
+
+		uint32_t lodCount = 1;
+		DrawLod lods[MAX_DRAW_LODS]{};
+	};
+
+	struct CullingSettings {
+		bool contributionCulling = true;
+		float minPixelSize = 2.0f;
+
+		bool lodSelection = true;
+		float maxLodErrorPixels = 1.0f;
+
+		// pixels covered by one world unit at view depth 1
+		float pixelScale = 1.0f;
+	};
+
+	// Frustum and contribution culls the scene draw list on the CPU, picks a LOD
+	// per surviving draw and writes the commands into a persistently mapped
+	// indirect buffer per frame in flight. Created without a device it has no
+	// indirect buffers and only benchmark() can run, as in CullBench.
+	class CpuCuller {
+	public:
+
+		using Ptr = std::shared_ptr<CpuCuller>;
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, uint32_t frameCount, uint32_t workerCount = 0) {
+
+			return std::make_shared<CpuCuller>(device, frameCount, workerCount);
+		}
+
+		CpuCuller(const lzvk::wrapper::Device::Ptr& device, uint32_t frameCount, uint32_t workerCount);
+		~CpuCuller();
+
+		void setDraws(const std::vector<CullDraw>& draws);
+		void setExemptMaterials(const std::unordered_set<uint32_t>& materialIds);
+		void setSettings(const CullingSettings& settings) { mSettings = settings; }
+
+		uint32_t cull(const glm::mat4& viewProj, uint32_t frameIndex);
+
+		void benchmark(const glm::mat4& viewProj, uint32_t iterations);
+
+		[[nodiscard]] auto getIndirectBuffer(uint32_t frameIndex) const { return mIndirectBuffers[frameIndex]; }
+		[[nodiscard]] auto getVisibleCount(uint32_t frameIndex) const { return mVisibleCounts[frameIndex]; }
+		[[nodiscard]] auto getDrawCount() const { return mDrawCount; }
+		[[nodiscard]] auto getWorkerCount() const { return mWorkerCount; }
+		[[nodiscard]] auto getLastCullTimeMs() const { return mLastCullTimeMs; }
+		[[nodiscard]] auto getSmallCulledCount() const { return mSmallCulledCount; }
+		[[nodiscard]] auto getLodDrawCount() const { return mLodDrawCount; }
+		[[nodiscard]] auto getExemptDrawCount() const { return mExemptDrawCount; }
+		[[nodiscard]] auto& getSettings() { return mSettings; }
+		// true when the AVX2 kernel runs, the CPU is checked once at runtime
+		[[nodiscard]] static bool isSimdEnabled();
+
+	private:
+
+		uint32_t run(const glm::mat4& viewProj, bool useSimd, uint32_t workerCount);
+		void workerLoop(uint32_t workerIndex);
+		void cullSlice(uint32_t slice);
+		struct SliceStats {
+			uint32_t smallCulled = 0;
+			uint32_t lodDraws = 0;
+		};
+
+		void cullGroupsScalar(uint32_t firstGroup, uint32_t lastGroup, std::vector<VkDrawIndexedIndirectCommand>& out, SliceStats& stats) const;
+		void cullGroupsSimd(uint32_t firstGroup, uint32_t lastGroup, std::vector<VkDrawIndexedIndirectCommand>& out, SliceStats& stats) const;
+		void emitDraw(uint32_t drawIndex, std::vector<VkDrawIndexedIndirectCommand>& out, SliceStats& stats) const;
+
+	private:
+
+		lzvk::wrapper::Device::Ptr mDevice{ nullptr };
+		std::vector<lzvk::wrapper::Buffer::Ptr> mIndirectBuffers{};
+		std::vector<uint32_t> mVisibleCounts{};
+
+		// bounding spheres in SoA layout, padded to a multiple of 8
+		std::vector<float> mCenterX{};
+		std::vector<float> mCenterY{};
+		std::vector<float> mCenterZ{};
+		std::vector<float> mRadius{};
+
+		// radius used by the contribution test, FLT_MAX for exempt draws
+		std::vector<float> mSizeRadius{};
+		std::vector<CullDraw> mDraws{};
+		uint32_t mDrawCount{ 0 };
+		uint32_t mGroupCount{ 0 };
+
+		// per job state, read by the workers
+		glm::vec4 mPlanes[6]{};
+		glm::vec4 mDepthRow{ 0.0f };
+		CullingSettings mSettings{};
+		float mMinSizeDepthScale{ 0.0f };
+		bool mUseSimd{ true };
+		uint32_t mJobWorkerCount{ 1 };
+		std::vector<std::vector<VkDrawIndexedIndirectCommand>> mSliceCommands{};
+		std::vector<SliceStats> mSliceStats{};
+
+		// worker pool, slice 0 runs on the calling thread
+		uint32_t mWorkerCount{ 1 };
+		std::vector<std::thread> mWorkers{};
+		std::mutex mMutex;
+		std::condition_variable mWakeCondition;
+		std::condition_variable mDoneCondition;
+		uint64_t mGeneration{ 0 };
+		uint32_t mPendingWorkers{ 0 };
+		bool mStop{ false };
+
+		float mLastCullTimeMs{ 0.0f };
+		uint32_t mSmallCulledCount{ 0 };
+		uint32_t mLodDrawCount{ 0 };
+		uint32_t mExemptDrawCount{ 0 };
+	};
+}
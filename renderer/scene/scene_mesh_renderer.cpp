@@ -2,6 +2,9 @@
 #include <cstring>
 #include <stdexcept>
 #include <filesystem>
+#include <cfloat>
+#include "../../tools/mesh_lod.h"
+#include "../../tools/meshlet.h"
 
 
 namespace lzvk::renderer {
@@ -22,11 +25,14 @@ namespace lzvk::renderer {
             meshData.vertexData.data()
         );
 
-        // Create index buffer
+        // Create index buffer, coarser LODs are appended after the source indices
+        std::vector<uint32_t> indexData = meshData.indexData;
+        auto meshLods = lzvk::tools::generateMeshLods(meshData, indexData, MAX_DRAW_LODS);
+
         mIndexBuffer = lzvk::wrapper::Buffer::createIndexBuffer(
             mDevice,
-            meshData.indexData.size() * sizeof(uint32_t),
-            meshData.indexData.data()
+            indexData.size() * sizeof(uint32_t),
+            indexData.data()
         );
 
 
@@ -44,12 +50,26 @@ namespace lzvk::renderer {
         );
 
 
+        // Load all scene textures into one array, materials index into it
+        mSceneTextureManager = lzvk::renderer::SceneTextureManager::create();
+        mSceneTextureManager->init(
+            mDevice,
+            mCommandPool,
+            meshData,
+            frameCount
+        );
+
+        std::vector<lzvk::loader::Material> materials = meshData.materials;
+        for (auto& material : materials) {
+            mSceneTextureManager->remapMaterial(material);
+        }
+
         // Create MaterialUniformManager
         mMaterialUniformManager = lzvk::renderer::MaterialUniformManager::create();
         mMaterialUniformManager->init(
             mDevice,
-            meshData.materials.size(),
-            meshData.materials.data(),
+            materials.size(),
+            materials.data(),
             frameCount
         );
 
@@ -62,7 +82,7 @@ namespace lzvk::renderer {
             frameCount
         );
 
-        // Create Static DescriptorSet (set = 1)
+        // Create the scene set (set = 1), buffers and the bindless texture array in one set
         std::vector<lzvk::wrapper::UniformParameter::Ptr> staticParams;
 
         auto append = [&](const std::vector<lzvk::wrapper::UniformParameter::Ptr>& params) {
@@ -73,138 +93,94 @@ namespace lzvk::renderer {
         append(mMaterialUniformManager->getParams());
         append(mDrawDataUniformManager->getParams());
 
-        mDescriptorSetLayout_Static = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-        mDescriptorSetLayout_Static->build(staticParams);
-
-        mDescriptorPool_Static = lzvk::wrapper::DescriptorPool::create(mDevice);
-        mDescriptorPool_Static->build(staticParams, 1);
-
-        mDescriptorSet_Static = lzvk::wrapper::DescriptorSet::create(
-            mDevice,
-            staticParams,
-            mDescriptorSetLayout_Static,
-            mDescriptorPool_Static,
-            1
-        );
-
-        //
-        // ========== DIFFUSE TEXTURE SET ==========
-        //
-
-        mSceneTextureManager = lzvk::renderer::SceneTextureManager::create();
-        mSceneTextureManager->init(
-            mDevice,
-            mCommandPool,
-            meshData,
-            frameCount
-        );
-
-        //
-        // Diffuse descriptor set (set = 2)
-        //
-        auto diffuseParams = mSceneTextureManager->getDiffuseParams();
+        // Meshlet tables (set = 1, bindings 5 - 9), only when the device runs task and mesh shaders
+        if (mDevice->isMeshShaderSupported()) {
 
-        mDescriptorSetLayout_Diffuse = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-        mDescriptorSetLayout_Diffuse->build(diffuseParams);
+            auto meshletData = lzvk::tools::buildMeshlets(meshData);
+            std::vector<lzvk::renderer::MeshletInstance> instances;
 
-        mDescriptorPool_Diffuse = lzvk::wrapper::DescriptorPool::create(mDevice);
-        mDescriptorPool_Diffuse->build(diffuseParams, 1);
+            for (size_t i = 0; i < scene.drawDataArray.size(); ++i) {
 
-        mDescriptorSet_Diffuse = lzvk::wrapper::DescriptorSet::create(
-            mDevice,
-            diffuseParams,
-            mDescriptorSetLayout_Diffuse,
-            mDescriptorPool_Diffuse,
-            1
-        );
+                auto it = scene.meshForNode.find(scene.drawDataArray[i].transformId);
 
-        //
-        // ========== EMISSIVE TEXTURE SET ==========
-        //
+                if (it == scene.meshForNode.end()) {
+                    continue;
+                }
 
-        auto emissiveParams = mSceneTextureManager->getEmissiveParams();
+                uint32_t firstMeshlet = meshletData.firstMeshlet[it->second];
+                uint32_t meshletCount = meshletData.meshletCount[it->second];
 
-        mDescriptorSetLayout_Emissive = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-        mDescriptorSetLayout_Emissive->build(emissiveParams);
+                for (uint32_t m = 0; m < meshletCount; ++m) {
+                    instances.push_back({ static_cast<uint32_t>(i), firstMeshlet + m });
+                }
+            }
 
-        mDescriptorPool_Emissive = lzvk::wrapper::DescriptorPool::create(mDevice);
-        mDescriptorPool_Emissive->build(emissiveParams, 1);
+            mMeshletInstanceCount = static_cast<uint32_t>(instances.size());
 
-        mDescriptorSet_Emissive = lzvk::wrapper::DescriptorSet::create(
-            mDevice,
-            emissiveParams,
-            mDescriptorSetLayout_Emissive,
-            mDescriptorPool_Emissive,
-            1
-        );
+            mMeshletUniformManager = lzvk::renderer::MeshletUniformManager::create();
+            mMeshletUniformManager->init(
+                mDevice,
+                mVertexBuffer,
+                meshData.vertexData.size(),
+                meshletData,
+                instances
+            );
 
-        //
-        // ========== NORMAL TEXTURE SET ==========
-        //
+            append(mMeshletUniformManager->getParams());
+        }
 
-        auto normalParams = mSceneTextureManager->getNormalParams();
+        // Texture feedback (set = 1, binding 3) and the texture array (binding 10), last because its descriptor count is variable
+        append(mSceneTextureManager->getParams());
+        checkDescriptorLimits(mSceneTextureManager->getTextureCount());
 
-        mDescriptorSetLayout_Normal = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-        mDescriptorSetLayout_Normal->build(normalParams);
+        mDescriptorSetLayout_Static = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
+        mDescriptorSetLayout_Static->build(staticParams);
 
-        mDescriptorPool_Normal = lzvk::wrapper::DescriptorPool::create(mDevice);
-        mDescriptorPool_Normal->build(normalParams, 1);
+        // One set per frame in flight, streamed textures are swapped into a set once its frame completed
+        mDescriptorPool_Static = lzvk::wrapper::DescriptorPool::create(mDevice);
+        mDescriptorPool_Static->build(staticParams, frameCount);
 
-        mDescriptorSet_Normal = lzvk::wrapper::DescriptorSet::create(
+        mDescriptorSet_Static = lzvk::wrapper::DescriptorSet::create(
             mDevice,
-            normalParams,
-            mDescriptorSetLayout_Normal,
-            mDescriptorPool_Normal,
-            1
+            staticParams,
+            mDescriptorSetLayout_Static,
+            mDescriptorPool_Static,
+            frameCount
         );
 
-        //
-        // ========== OPACITY TEXTURE SET ==========
-        //
-
-        auto opacityParams = mSceneTextureManager->getOpacityParams();
-
-        mDescriptorSetLayout_Opacity = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-        mDescriptorSetLayout_Opacity->build(opacityParams);
-
-        mDescriptorPool_Opacity = lzvk::wrapper::DescriptorPool::create(mDevice);
-        mDescriptorPool_Opacity->build(opacityParams, 1);
-
-        mDescriptorSet_Opacity = lzvk::wrapper::DescriptorSet::create(
-            mDevice,
-            opacityParams,
-            mDescriptorSetLayout_Opacity,
-            mDescriptorPool_Opacity,
-            1
-        );
+        mSceneTextureManager->getStreamer()->bindFeedback(mDescriptorSet_Static);
 
         //
-        // ========== SPECULAR TEXTURE SET ==========
+        // ========== INDIRECT BUFFER ==========
         //
 
-        auto specularParams = mSceneTextureManager->getSpecularParams();
+        std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+        std::vector<lzvk::renderer::CullDraw> cullDraws;
+        std::vector<std::pair<glm::vec3, glm::vec3>> meshBounds(meshData.meshes.size());
 
-        mDescriptorSetLayout_Specular = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
-        mDescriptorSetLayout_Specular->build(specularParams);
+        // Local space AABB of every mesh, computed from the referenced vertices
+        const float* vertices = reinterpret_cast<const float*>(meshData.vertexData.data());
+        const size_t vertexStride = 11;
 
-        mDescriptorPool_Specular = lzvk::wrapper::DescriptorPool::create(mDevice);
-        mDescriptorPool_Specular->build(specularParams, 1);
+        for (size_t m = 0; m < meshData.meshes.size(); ++m) {
 
-        mDescriptorSet_Specular = lzvk::wrapper::DescriptorSet::create(
-            mDevice,
-            specularParams,
-            mDescriptorSetLayout_Specular,
-            mDescriptorPool_Specular,
-            1
-        );
+            const lzvk::loader::Mesh& mesh = meshData.meshes[m];
+            glm::vec3 minPos(FLT_MAX);
+            glm::vec3 maxPos(-FLT_MAX);
 
+            for (uint32_t j = 0; j < mesh.indexCount; ++j) {
 
+                const float* pos = vertices + (size_t(mesh.vertexOffset) + meshData.indexData[mesh.indexOffset + j]) * vertexStride;
+                minPos = glm::min(minPos, glm::vec3(pos[0], pos[1], pos[2]));
+                maxPos = glm::max(maxPos, glm::vec3(pos[0], pos[1], pos[2]));
+            }
 
-        //
-        // ========== INDIRECT BUFFER ==========
-        //
+            if (mesh.indexCount == 0) {
+                minPos = maxPos = glm::vec3(0.0f);
+            }
 
-        std::vector<VkDrawIndexedIndirectCommand> drawCommands;
+            meshBounds[m] = { minPos, maxPos };
+        }
 
         for (size_t i = 0; i < scene.drawDataArray.size(); ++i) {
 
@@ -225,11 +201,52 @@ namespace lzvk::renderer {
                 cmd.firstInstance = static_cast<uint32_t>(i);
 
                 drawCommands.push_back(cmd);
+
+                // World space bounding sphere around the transformed AABB corners
+                const glm::mat4& model = scene.globalTransform[dd.transformId];
+                glm::vec3 minPos(FLT_MAX);
+                glm::vec3 maxPos(-FLT_MAX);
+
+                for (int c = 0; c < 8; ++c) {
+
+                    glm::vec3 corner(
+                        (c & 1) ? meshBounds[meshIdx].second.x : meshBounds[meshIdx].first.x,
+                        (c & 2) ? meshBounds[meshIdx].second.y : meshBounds[meshIdx].first.y,
+                        (c & 4) ? meshBounds[meshIdx].second.z : meshBounds[meshIdx].first.z
+                    );
+
+                    glm::vec3 world = glm::vec3(model * glm::vec4(corner, 1.0f));
+                    minPos = glm::min(minPos, world);
+                    maxPos = glm::max(maxPos, world);
+                }
+
+                lzvk::renderer::CullDraw cullDraw{};
+                cullDraw.command = cmd;
+                cullDraw.sphere = glm::vec4((minPos + maxPos) * 0.5f, glm::length(maxPos - minPos) * 0.5f);
+                cullDraw.materialId = dd.materialId;
+
+                // LOD errors are scaled by the largest axis of the node transform
+                float maxScale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+                const auto& lods = meshLods[meshIdx];
+
+                cullDraw.lodCount = static_cast<uint32_t>(std::min<size_t>(lods.size(), MAX_DRAW_LODS));
+                for (uint32_t l = 0; l < cullDraw.lodCount; ++l) {
+
+                    cullDraw.lods[l].firstIndex = lods[l].indexOffset;
+                    cullDraw.lods[l].indexCount = lods[l].indexCount;
+                    cullDraw.lods[l].error = lods[l].error * maxScale;
+                }
+
+                cullDraws.push_back(cullDraw);
             }
         }
 
         mDrawCount = static_cast<uint32_t>(drawCommands.size());
 
+        for (const auto& command : drawCommands) {
+            mMaxDrawTriangles = std::max(mMaxDrawTriangles, command.indexCount / 3);
+        }
+
 
         mIndirectBuffer = lzvk::wrapper::Buffer::createStorageBuffer(
             device,
@@ -237,6 +254,25 @@ namespace lzvk::renderer {
             drawCommands.data(),
             false
         );
+
+        mCpuCuller = lzvk::renderer::CpuCuller::create(mDevice, frameCount);
+        mCpuCuller->setDraws(cullDraws);
+
+        // Emissive surfaces stay visible however small they get
+        mMaterialNames = scene.materialNames;
+        std::unordered_set<uint32_t> exemptMaterials;
+
+        for (size_t i = 0; i < meshData.materials.size(); ++i) {
+
+            const auto& material = meshData.materials[i];
+
+            if (glm::length(glm::vec3(material.emissiveFactor)) > 0.0f || !material.emissiveTexturePath.empty()) {
+                exemptMaterials.insert(static_cast<uint32_t>(i));
+            }
+        }
+
+        mDefaultExemptMaterials = exemptMaterials;
+        mCpuCuller->setExemptMaterials(exemptMaterials);
     }
 
 
@@ -249,6 +285,88 @@ namespace lzvk::renderer {
         cmd->drawIndexedIndirect(mIndirectBuffer->getBuffer(), 0, mDrawCount, sizeof(VkDrawIndexedIndirectCommand));
     }
 
-}
+    void SceneMeshRenderer::checkDescriptorLimits(uint32_t textureCount) const {
+
+        VkPhysicalDeviceDescriptorIndexingProperties indexingProps{};
+        indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 props2{};
+        props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        props2.pNext = &indexingProps;
+        vkGetPhysicalDeviceProperties2(mDevice->getPhysicalDevice(), &props2);
+
+        // Combined image samplers count against both the sampled image and the sampler limits
+        uint32_t perStageLimit = std::min(indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages, indexingProps.maxPerStageDescriptorUpdateAfterBindSamplers);
+        uint32_t perSetLimit = std::min(indexingProps.maxDescriptorSetUpdateAfterBindSampledImages, indexingProps.maxDescriptorSetUpdateAfterBindSamplers);
+
+        printf("[SceneMeshRenderer] bindless textures: %u (per stage limit %u, per set limit %u), bound sets limit %u\n",
+            textureCount, perStageLimit, perSetLimit, props2.properties.limits.maxBoundDescriptorSets);
+
+        if (textureCount > perStageLimit || textureCount > perSetLimit) {
+            throw std::runtime_error("Error: scene textures exceed the update after bind descriptor limits");
+        }
+    }
 
+    bool SceneMeshRenderer::isVisibilityBufferSupported() const {
+
+        // Draw slot and primitive id have to fit the 32 bit visibility id
+        const uint32_t drawSlotBits = 32 - VISIBILITY_TRIANGLE_BITS;
+
+        return mDrawCount < (1u << drawSlotBits) - 1 && mMaxDrawTriangles <= (1u << VISIBILITY_TRIANGLE_BITS);
+    }
+
+    void SceneMeshRenderer::drawMeshTasks(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
+
+        if (mMeshletInstanceCount == 0) {
+            return;
+        }
+
+        // One task workgroup per 32 meshlet instances, spilling into y past the x limit
+        uint32_t groupCount = (mMeshletInstanceCount + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE;
+        uint32_t groupCountX = std::min<uint32_t>(groupCount, 65535);
+        uint32_t groupCountY = (groupCount + groupCountX - 1) / groupCountX;
+
+        cmd->drawMeshTasks(groupCountX, groupCountY, 1);
+    }
+
+    void SceneMeshRenderer::updateTextureStreaming(int frameIndex) {
+
+        mSceneTextureManager->getStreamer()->update(mDescriptorSet_Static, SCENE_TEXTURE_BINDING, frameIndex);
+    }
+
+    void SceneMeshRenderer::recordTextureFeedbackBarrier(const lzvk::wrapper::CommandBuffer::Ptr& cmd) {
+
+        mSceneTextureManager->getStreamer()->recordFeedbackBarrier(cmd->getCommandBuffer());
+    }
+
+    void SceneMeshRenderer::cull(const glm::mat4& viewProj, uint32_t frameIndex) {
+
+        mCpuCuller->cull(viewProj, frameIndex);
+    }
+
+    void SceneMeshRenderer::setContributionExemptions(const std::vector<std::string>& materialNameFilters) {
+
+        std::unordered_set<uint32_t> exemptMaterials = mDefaultExemptMaterials;
+
+        for (size_t i = 0; i < mMaterialNames.size(); ++i) {
+
+            for (const auto& filter : materialNameFilters) {
+
+                if (!filter.empty() && mMaterialNames[i].find(filter) != std::string::npos) {
+                    exemptMaterials.insert(static_cast<uint32_t>(i));
+                    break;
+                }
+            }
+        }
+
+        mCpuCuller->setExemptMaterials(exemptMaterials);
+    }
+
+    void SceneMeshRenderer::drawCulled(const lzvk::wrapper::CommandBuffer::Ptr& cmd, uint32_t frameIndex) {
+
+        cmd->bindVertexBuffer({ mVertexBuffer->getBuffer() });
+        cmd->bindIndexBuffer(mIndexBuffer->getBuffer());
+        cmd->drawIndexedIndirect(mCpuCuller->getIndirectBuffer(frameIndex)->getBuffer(), 0, mCpuCuller->getVisibleCount(frameIndex), sizeof(VkDrawIndexedIndirectCommand));
+    }
 
+}
\ No newline at end of file
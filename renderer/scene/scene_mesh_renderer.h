@@ -17,9 +17,17 @@
 #include "../uniform/material_uniform_manager.h"
 #include "../uniform/draw_data_uniform_manager.h"
 #include "../uniform/scene_texture_manager.h"
+#include "../uniform/meshlet_uniform_manager.h"
+#include "cpu_culler.h"
 
 namespace lzvk::renderer {
 
+    // Must match local_size_x of scene_graph.task
+    constexpr uint32_t MESHLET_TASK_GROUP_SIZE = 32;
+
+    // Visibility ids pack (drawSlot + 1) above the primitive id, must match the visibility shaders
+    constexpr uint32_t VISIBILITY_TRIANGLE_BITS = 18;
+
     class SceneMeshRenderer {
     public:
         using Ptr = std::shared_ptr<SceneMeshRenderer>;
@@ -41,6 +49,14 @@ namespace lzvk::renderer {
         ~SceneMeshRenderer();
 
         void draw(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
+        void cull(const glm::mat4& viewProj, uint32_t frameIndex);
+        void setContributionExemptions(const std::vector<std::string>& materialNameFilters);
+        void drawCulled(const lzvk::wrapper::CommandBuffer::Ptr& cmd, uint32_t frameIndex);
+        void drawMeshTasks(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
+
+        // Texture streaming, update runs after the fence of the frame and before recording
+        void updateTextureStreaming(int frameIndex);
+        void recordTextureFeedbackBarrier(const lzvk::wrapper::CommandBuffer::Ptr& cmd);
 
         std::vector<VkVertexInputBindingDescription> SceneMeshRenderer::getVertexInputBindingDescriptions() {
             return { VkVertexInputBindingDescription{ 0, sizeof(float) * 11, VK_VERTEX_INPUT_RATE_VERTEX } };
@@ -57,22 +73,26 @@ namespace lzvk::renderer {
         }
 
         [[nodiscard]] auto getDescriptorSetLayout_Static() const { return mDescriptorSetLayout_Static; }
-        [[nodiscard]] auto getDescriptorSetLayout_Diffuse() const { return mDescriptorSetLayout_Diffuse; }
-        [[nodiscard]] auto getDescriptorSetLayout_Emissive() const { return mDescriptorSetLayout_Emissive; }
-        [[nodiscard]] auto getDescriptorSetLayout_Normal() const { return mDescriptorSetLayout_Normal; }
-        [[nodiscard]] auto getDescriptorSetLayout_Opacity() const { return mDescriptorSetLayout_Opacity; }
-        [[nodiscard]] auto getDescriptorSetLayout_Specular() const { return mDescriptorSetLayout_Specular; }
 
         [[nodiscard]] auto getDescriptorSet_Static() const { return mDescriptorSet_Static; }
-        [[nodiscard]] auto getDescriptorSet_Diffuse() const { return mDescriptorSet_Diffuse; }
-        [[nodiscard]] auto getDescriptorSet_Emissive() const { return mDescriptorSet_Emissive; }
-        [[nodiscard]] auto getDescriptorSet_Normal() const { return mDescriptorSet_Normal; }
-        [[nodiscard]] auto getDescriptorSet_Opacity() const { return mDescriptorSet_Opacity; }
-        [[nodiscard]] auto getDescriptorSet_Specular() const { return mDescriptorSet_Specular; }
+
+        [[nodiscard]] auto getCpuCuller() const { return mCpuCuller; }
+        [[nodiscard]] auto getDrawCount() const { return mDrawCount; }
+        [[nodiscard]] auto getMeshletInstanceCount() const { return mMeshletInstanceCount; }
+        [[nodiscard]] bool isMeshShaderEnabled() const { return mMeshletUniformManager != nullptr; }
+        [[nodiscard]] bool isVisibilityBufferSupported() const;
+
+        [[nodiscard]] auto getVertexBuffer() const { return mVertexBuffer; }
+        [[nodiscard]] auto getIndexBuffer() const { return mIndexBuffer; }
+        [[nodiscard]] auto getIndirectBuffer() const { return mIndirectBuffer; }
+        [[nodiscard]] auto getTextureCount() const { return mSceneTextureManager->getTextureCount(); }
+        [[nodiscard]] auto getTextureStreamer() const { return mSceneTextureManager->getStreamer(); }
 
 
     private:
 
+        void checkDescriptorLimits(uint32_t textureCount) const;
+
         lzvk::wrapper::Device::Ptr mDevice{ nullptr };
         lzvk::wrapper::CommandPool::Ptr mCommandPool{ nullptr };
         lzvk::wrapper::Buffer::Ptr mVertexBuffer{ nullptr };
@@ -80,6 +100,16 @@ namespace lzvk::renderer {
         lzvk::wrapper::Buffer::Ptr mIndirectBuffer{ nullptr };
 
         uint32_t mDrawCount{ 0 };
+        uint32_t mMaxDrawTriangles{ 0 };
+
+        // cpu frustum culling
+        lzvk::renderer::CpuCuller::Ptr mCpuCuller{ nullptr };
+        std::vector<std::string> mMaterialNames{};
+        std::unordered_set<uint32_t> mDefaultExemptMaterials{};
+
+        // mesh shader path
+        lzvk::renderer::MeshletUniformManager::Ptr mMeshletUniformManager{ nullptr };
+        uint32_t mMeshletInstanceCount{ 0 };
 
         // Uniform managers
         lzvk::renderer::TransformUniformManager::Ptr mTransformUniformManager{ nullptr };
@@ -87,36 +117,11 @@ namespace lzvk::renderer {
         lzvk::renderer::DrawDataUniformManager::Ptr mDrawDataUniformManager{ nullptr };
         lzvk::renderer::SceneTextureManager::Ptr mSceneTextureManager{ nullptr };
         
-        // descriptors
+        // scene set: transforms, materials, draw data, meshlets, texture feedback and the bindless texture array, one per frame
         lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Static{ nullptr };
         lzvk::wrapper::DescriptorPool::Ptr      mDescriptorPool_Static{ nullptr };
         lzvk::wrapper::DescriptorSet::Ptr       mDescriptorSet_Static{ nullptr };
 
-        // diffuse
-        lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Diffuse{ nullptr };
-        lzvk::wrapper::DescriptorPool::Ptr      mDescriptorPool_Diffuse{ nullptr };
-        lzvk::wrapper::DescriptorSet::Ptr       mDescriptorSet_Diffuse{ nullptr };
-
-        // emissive
-        lzvk::wrapper::DescriptorSet::Ptr mDescriptorSet_Emissive{ nullptr };
-        lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Emissive{ nullptr };
-        lzvk::wrapper::DescriptorPool::Ptr mDescriptorPool_Emissive{ nullptr };
-
-        // normal
-        lzvk::wrapper::DescriptorSet::Ptr mDescriptorSet_Normal{ nullptr };
-        lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Normal{ nullptr };
-        lzvk::wrapper::DescriptorPool::Ptr mDescriptorPool_Normal{ nullptr };
-
-        // opacity
-        lzvk::wrapper::DescriptorSet::Ptr mDescriptorSet_Opacity{ nullptr };
-        lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Opacity{ nullptr };
-        lzvk::wrapper::DescriptorPool::Ptr mDescriptorPool_Opacity{ nullptr };
-
-        // specular
-        lzvk::wrapper::DescriptorSet::Ptr mDescriptorSet_Specular{ nullptr };
-        lzvk::wrapper::DescriptorSetLayout::Ptr mDescriptorSetLayout_Specular{ nullptr };
-        lzvk::wrapper::DescriptorPool::Ptr mDescriptorPool_Specular{ nullptr };
-
     };
 
 }
@@ -2,4 +2,6 @@ D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\g
 
 D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V cubemap.frag -o cubemapfs.spv
 
+D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V equirect_to_cube.comp -o equirect_to_cube_comp.spv
+
 pause
\ No newline at end of file
@@ -3,11 +3,12 @@
 layout(location = 0) in vec3 vDirection;
 layout(location = 0) out vec4 outColor;
 
-layout(set = 1, binding = 3) uniform samplerCube uCubemap;
+layout(set = 3, binding = 3) uniform samplerCube uCubemap;
 
 void main() {
     
-     outColor = texture(uCubemap, normalize(vDirection));
+     // level 0 is the environment itself, the levels below it are prefiltered for roughness
+     outColor = textureLod(uCubemap, normalize(vDirection), 0.0);
 //    outColor = vec4(1.0, 0.0, 1.0, 1.0);
 
 }
\ No newline at end of file
@@ -2,4 +2,8 @@ D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\g
 
 D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V scene_graph.frag -o scene_graph_fs.spv
 
+D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V --target-env vulkan1.3 scene_graph.task -o scene_graph_ts.spv
+
+D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V --target-env vulkan1.3 scene_graph.mesh -o scene_graph_ms.spv
+
 pause
\ No newline at end of file
@@ -35,13 +35,19 @@ struct Material {
 
 
 layout(set = 1, binding = 2) readonly buffer MaterialParams { Material materials[]; };
-layout(set = 2, binding = 0) uniform sampler2D diffuseTextures[];
-layout(set = 3, binding = 0) uniform sampler2D emissiveTextures[];
-layout(set = 4, binding = 0) uniform sampler2D normalTextures[];
-layout(set = 5, binding = 0) uniform sampler2D opacityTextures[];
-layout(set = 6, binding = 0) uniform sampler2D specularTextures[];
-layout(set = 7, binding = 0) uniform sampler2D shadowMap;
-layout(set = 8, binding = 4) uniform samplerCube irradianceMap;
+layout(set = 1, binding = 3) buffer TextureFeedback { uint requestedLevels[]; };
+layout(set = 1, binding = 10) uniform sampler2D sceneTextures[];
+
+// Array images of small textures share the binding, must match scene_texture_manager.h
+layout(set = 1, binding = 10) uniform sampler2DArray sceneTextureArrays[];
+
+const uint TEXTURE_ARRAY_BIT = 0x80000000u;
+const uint TEXTURE_LAYER_SHIFT = 20;
+const uint TEXTURE_SLOT_MASK = (1u << TEXTURE_LAYER_SHIFT) - 1u;
+layout(set = 2, binding = 0) uniform sampler2D shadowMap;
+// Prefiltered environment chain, level i holds roughness i / (levels - 1)
+layout(set = 3, binding = 3) uniform samplerCube environmentMap;
+layout(set = 3, binding = 4) uniform IrradianceSH { vec4 shCoefficients[9]; };
 
 
 layout(push_constant) uniform PushConstants {
@@ -104,6 +110,69 @@ void runAlphaTest(float alpha, float alphaThreshold)
   }
 }
 
+// Must match TEXTURE_FEEDBACK_LEVEL_BIAS in texture_streamer.h
+const float FEEDBACK_LEVEL_BIAS = 16.0;
+
+// Packed indices address a layer of an array image
+vec4 sampleSceneTexture(uint textureIndex, vec2 uv)
+{
+    if ((textureIndex & TEXTURE_ARRAY_BIT) != 0u) {
+        float layer = float((textureIndex & ~TEXTURE_ARRAY_BIT) >> TEXTURE_LAYER_SHIFT);
+        return texture(sceneTextureArrays[nonuniformEXT(textureIndex & TEXTURE_SLOT_MASK)], vec3(uv, layer));
+    }
+
+    return texture(sceneTextures[nonuniformEXT(textureIndex)], uv);
+}
+
+// Finest level the texture is sampled at, relative to the resident image. Anisotropic filtering
+// resolves up to 16 texels along the major axis, the level follows the minor one until then.
+// Array layers are loaded whole and never stream.
+void requestTextureLevel(uint textureIndex, vec2 uvDdx, vec2 uvDdy)
+{
+    if ((textureIndex & TEXTURE_ARRAY_BIT) != 0u) {
+        return;
+    }
+
+    vec2 size = vec2(textureSize(sceneTextures[nonuniformEXT(textureIndex)], 0));
+    float lengthX = length(uvDdx * size);
+    float lengthY = length(uvDdy * size);
+
+    float footprint = max(max(lengthX, lengthY) / 16.0, min(lengthX, lengthY));
+    float level = floor(log2(max(footprint, 1e-6))) + FEEDBACK_LEVEL_BIAS;
+
+    atomicMin(requestedLevels[textureIndex], uint(clamp(level, 0.0, 31.0)));
+}
+
+// Order-2 SH of the environment irradiance divided by pi, basis and order must match tools/ibl_baker.cpp
+vec4 evaluateIrradianceSH(vec3 n) {
+
+    vec3 irradiance =
+        shCoefficients[0].rgb * 0.282095 +
+        shCoefficients[1].rgb * (0.488603 * n.y) +
+        shCoefficients[2].rgb * (0.488603 * n.z) +
+        shCoefficients[3].rgb * (0.488603 * n.x) +
+        shCoefficients[4].rgb * (1.092548 * n.x * n.y) +
+        shCoefficients[5].rgb * (1.092548 * n.y * n.z) +
+        shCoefficients[6].rgb * (0.315392 * (3.0 * n.z * n.z - 1.0)) +
+        shCoefficients[7].rgb * (1.092548 * n.x * n.z) +
+        shCoefficients[8].rgb * (0.546274 * (n.x * n.x - n.y * n.y));
+
+    return vec4(max(irradiance, vec3(0.0)), 1.0);
+}
+
+// Split-sum DFG term of the prefiltered specular as (scale, bias) of F0, Karis' analytic fit,
+// Schlick Fresnel falls off with roughness
+vec2 evaluateEnvironmentBRDF(float roughness, float NdotV) {
+
+    const vec4 c0 = vec4(-1.0, -0.0275, -0.572, 0.022);
+    const vec4 c1 = vec4(1.0, 0.0425, 1.04, -0.04);
+
+    vec4 r = roughness * c0 + c1;
+    float a004 = min(r.x * r.x, exp2(-9.28 * NdotV)) * r.x + r.y;
+
+    return vec2(-1.04, 1.04) * a004 + r.zw;
+}
+
 vec3 rotateForIrradiance(vec3 dir) {
 
     mat3 rot = mat3(
@@ -124,14 +193,28 @@ mat3 rotY180 = mat3(
 
 void main()
 {
+    // one pixel of every 4x4 block reports the levels it samples, derivatives before any discard
+    vec2 uvDdx = dFdx(fragUV);
+    vec2 uvDdy = dFdy(fragUV);
+    bool feedback = ((uint(gl_FragCoord.x) | uint(gl_FragCoord.y)) & 3u) == 0u;
+
+    if (feedback) {
+        uint textures[5] = uint[](materials[matID].baseColorTexture, materials[matID].opacityTexture, materials[matID].normalTexture,
+                                  materials[matID].specularTexture, materials[matID].emissiveTexture);
+        for (int i = 0; i < 5; ++i) {
+            if (textures[i] > 0) {
+                requestTextureLevel(textures[i], uvDdx, uvDdy);
+            }
+        }
+    }
 
     vec4 baseColor = materials[matID].baseColorFactor;
     if(materials[matID].baseColorTexture > 0){
-        baseColor *= texture(diffuseTextures[materials[matID].baseColorTexture], fragUV);
+        baseColor *= sampleSceneTexture(materials[matID].baseColorTexture, fragUV);
     }
 
     if (materials[matID].opacityTexture > 0) {
-        baseColor.a = texture(opacityTextures[materials[matID].opacityTexture], fragUV).r;
+        baseColor.a = sampleSceneTexture(materials[matID].opacityTexture, fragUV).r;
     }
 
 
@@ -139,17 +222,19 @@ void main()
 
     vec3 normal = normalize(fragNormal);
     if (materials[matID].normalTexture > 0) {
-        vec3 sampledNormal = texture(normalTextures[materials[matID].normalTexture], fragUV).xyz;
-        sampledNormal = sampledNormal * 2.0 - 1.0;
+        // z is rebuilt from xy, baked BC5 normal maps only store two channels
+        vec2 sampledXY = sampleSceneTexture(materials[matID].normalTexture, fragUV).xy * 2.0 - 1.0;
+        vec3 sampledNormal = vec3(sampledXY, sqrt(max(1.0 - dot(sampledXY, sampledXY), 0.0)));
         normal = normalize(tbn * sampledNormal);
     }
 
 
+    vec3 viewDir = normalize(pc.cameraPos.xyz - worldPos.xyz);
+
         vec4 specular = vec4(0.0, 0.0, 0.0, 0.0);
     if (materials[matID].specularTexture > 0) {
     
-        specular = texture(specularTextures[materials[matID].specularTexture], fragUV);
-        vec3 viewDir = normalize(pc.cameraPos.xyz - worldPos.xyz);
+        specular = sampleSceneTexture(materials[matID].specularTexture, fragUV);
         vec3 lightDir = -normalize(pc.lightDir.xyz);
         vec3 halfwayDir = normalize(lightDir + viewDir);
 
@@ -163,7 +248,7 @@ void main()
     vec4 emissive = vec4(0.0, 0.0, 0.0, 0.0);
     if (materials[matID].emissiveTexture > 0) {
 
-        emissive = texture(emissiveTextures[materials[matID].emissiveTexture], fragUV);
+        emissive = sampleSceneTexture(materials[matID].emissiveTexture, fragUV);
     }
 
 
@@ -177,10 +262,21 @@ void main()
     direct += specular;
 
     // ambient light
-    // diffuse
+    // diffuse, metals have none
+    float metallic = clamp(materials[matID].metallicFactor, 0.0, 1.0);
+    float roughness = clamp(materials[matID].roughness, 0.0, 1.0);
+    float NdotV = clamp(dot(normal, viewDir), 0.0, 1.0);
+
+    vec3 reflected = rotY180 * reflect(-viewDir, normal);
     normal = rotY180 * normal;
-    vec4 irradiance = texture(irradianceMap, normal);
-    vec4 ambient = baseColor  * irradiance * (1 - f0);
+    vec4 irradiance = evaluateIrradianceSH(normal);
+    vec4 ambient = baseColor  * irradiance * (1 - f0) * (1.0 - metallic);
+
+    // specular, the mip is picked by roughness and weighted by the split-sum DFG term
+    float envLevel = roughness * float(textureQueryLevels(environmentMap) - 1);
+    vec4 prefiltered = textureLod(environmentMap, reflected, envLevel);
+    vec2 environmentBRDF = evaluateEnvironmentBRDF(roughness, NdotV);
+    ambient += prefiltered * (mix(f0, baseColor, metallic) * environmentBRDF.x + environmentBRDF.y);
 
     vec4 diffuse = direct + ambient;
 
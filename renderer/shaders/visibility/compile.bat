@@ -0,0 +1,7 @@
+D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V visibility.vert -o visibility_vs.spv
+
+D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V visibility.frag -o visibility_fs.spv
+
+D:\Career\Knowledge\02_graphics_api\vulkan_intermediate\third_party\vulkan\Bin\glslangValidator.exe -V visibility_resolve.comp -o visibility_resolve_comp.spv
+
+pause
\ No newline at end of file
@@ -0,0 +1,92 @@
+#version 450
+
+#extension GL_EXT_nonuniform_qualifier : enable
+
+precision highp float;
+precision mediump int;
+
+layout(location = 0) in vec2 fragUV;
+layout(location = 1) in flat uint matID;
+layout(location = 2) in flat uint drawSlot;
+
+layout(location = 0) out uint outVisibility;
+
+struct Material {
+
+    vec4 emissiveFactor;
+    vec4 baseColorFactor;
+
+    float roughness;
+    float metallicFactor;
+    float alphaTest;
+    float transparencyFactor;
+
+    uint baseColorTexture;
+    uint specularTexture;
+    uint emissiveTexture;
+    uint normalTexture;
+    uint opacityTexture;
+    uint occlusionTexture;
+};
+
+// Must match VISIBILITY_TRIANGLE_BITS in scene_mesh_renderer.h
+const uint TRIANGLE_BITS = 18;
+
+
+layout(set = 1, binding = 2) readonly buffer MaterialParams { Material materials[]; };
+layout(set = 1, binding = 10) uniform sampler2D sceneTextures[];
+
+// Array images of small textures share the binding, must match scene_texture_manager.h
+layout(set = 1, binding = 10) uniform sampler2DArray sceneTextureArrays[];
+
+const uint TEXTURE_ARRAY_BIT = 0x80000000u;
+const uint TEXTURE_LAYER_SHIFT = 20;
+const uint TEXTURE_SLOT_MASK = (1u << TEXTURE_LAYER_SHIFT) - 1u;
+
+// Packed indices address a layer of an array image
+vec4 sampleSceneTexture(uint textureIndex, vec2 uv)
+{
+    if ((textureIndex & TEXTURE_ARRAY_BIT) != 0u) {
+        float layer = float((textureIndex & ~TEXTURE_ARRAY_BIT) >> TEXTURE_LAYER_SHIFT);
+        return texture(sceneTextureArrays[nonuniformEXT(textureIndex & TEXTURE_SLOT_MASK)], vec3(uv, layer));
+    }
+
+    return texture(sceneTextures[nonuniformEXT(textureIndex)], uv);
+}
+
+void runAlphaTest(float alpha, float alphaThreshold)
+{
+  if (alphaThreshold > 0.0) {
+
+    mat4 thresholdMatrix = mat4(
+      1.0  / 17.0,  9.0 / 17.0,  3.0 / 17.0, 11.0 / 17.0,
+      13.0 / 17.0,  5.0 / 17.0, 15.0 / 17.0,  7.0 / 17.0,
+      4.0  / 17.0, 12.0 / 17.0,  2.0 / 17.0, 10.0 / 17.0,
+      16.0 / 17.0,  8.0 / 17.0, 14.0 / 17.0,  6.0 / 17.0
+    );
+
+    alpha = clamp(alpha - 0.5 * thresholdMatrix[int(mod(gl_FragCoord.x, 4.0))][int(mod(gl_FragCoord.y, 4.0))], 0.0, 1.0);
+
+    if (alpha < alphaThreshold)
+      discard;
+  }
+}
+
+
+void main()
+{
+    // only the alpha test runs here, all shading happens in the resolve pass
+    float alpha = materials[matID].baseColorFactor.a;
+    if (materials[matID].baseColorTexture > 0) {
+        alpha *= sampleSceneTexture(materials[matID].baseColorTexture, fragUV).a;
+    }
+
+    if (materials[matID].opacityTexture > 0) {
+        alpha = sampleSceneTexture(materials[matID].opacityTexture, fragUV).r;
+    }
+
+    runAlphaTest(alpha, materials[matID].alphaTest / max(32.0 * fwidth(fragUV.x), 1.0));
+
+    // 0 is left for pixels without geometry
+    outVisibility = ((drawSlot + 1) << TRIANGLE_BITS) | uint(gl_PrimitiveID);
+}
@@ -0,0 +1,36 @@
+#version 460
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inUV;
+
+layout(location = 0) out vec2 fragUV;
+layout(location = 1) out flat uint matID;
+layout(location = 2) out flat uint drawSlot;
+
+struct DrawData {
+    uint transformId;
+    uint materialId;
+};
+
+
+layout(set = 0, binding = 0) uniform VPMatrices {
+    mat4 mViewMatrix;
+    mat4 mProjectionMatrix;
+} vpUBO;
+
+
+layout(set = 1, binding = 1) readonly buffer Transforms { mat4 worldMatrices[];};
+layout(set = 1, binding = 4) readonly buffer DrawDataBuffer { DrawData dd[]; };
+
+void main() {
+
+    mat4 model = worldMatrices[dd[gl_BaseInstance].transformId];
+
+    fragUV = inUV;
+    matID = dd[gl_BaseInstance].materialId;
+
+    // index of the command inside the indirect buffer, the resolve pass reads it back
+    drawSlot = gl_DrawID;
+
+    gl_Position = vpUBO.mProjectionMatrix * vpUBO.mViewMatrix * model * vec4(inPosition, 1.0);
+}
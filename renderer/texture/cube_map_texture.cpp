@@ -1,6 +1,9 @@
 #include "cube_map_texture.h"
-#include "../../tools/bitmap.h"
 #include "../../tools/tools.h"
+#include "../../wrapper/command_buffer.h"
+#include "../../wrapper/compute_pipeline.h"
+#include "../../wrapper/descriptor_set.h"
+#include <chrono>
 
 #include <stb_image.h>
 #include <ktx.h>
@@ -8,87 +11,248 @@
 
 namespace lzvk::renderer {
 
-	//CubeMapTexture::CubeMapTexture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& imageFilePath) {
+	namespace {
 
-	//	mDevice = device;
+		double getMilliseconds(std::chrono::steady_clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+	}
+
+	CubeMapTexture::CubeMapTexture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& hdrFilePath,
+								   CubeMapConversion conversion) {
+
+		mDevice = device;
+		mCommandPool = commandPool;
+
+		// 1 Load hdr image
+		auto start = std::chrono::steady_clock::now();
+
+		lzvk::tools::Bitmap equirect = loadHdr(hdrFilePath);
+		double loadMs = getMilliseconds(start);
+
+		// 2 Hdr to cube map
+		if (conversion == CubeMapConversion::Compute && !isComputeConversionSupported(device)) {
+
+			printf("[CubeMapTexture] R32G32B32A32_SFLOAT can not be sampled with a linear filter, %s is converted on the CPU\n", hdrFilePath.c_str());
+			conversion = CubeMapConversion::Cpu;
+		}
+
+		start = std::chrono::steady_clock::now();
+
+		if (conversion == CubeMapConversion::Compute) {
+			convertWithCompute(equirect, commandPool);
+		}
+		else {
+			convertOnCpu(equirect);
+		}
+
+		mConversion = conversion;
+		mConversionMs = getMilliseconds(start);
+
+		printf("[CubeMapTexture] %s: %dx%d to 6 faces of %u on the %s in %.1f ms, read in %.1f ms\n", hdrFilePath.c_str(), equirect.mWidth, equirect.mHeight, mWidth,
+			   conversion == CubeMapConversion::Compute ? "GPU" : "CPU", mConversionMs, loadMs);
+
+		// 3 Create sampler and info
+		mSampler = lzvk::wrapper::Sampler::create(mDevice);
+		mImageInfo.imageLayout = mCubeMapImage->getLayout();
+		mImageInfo.imageView = mCubeMapImage->getImageView();
+		mImageInfo.sampler = mSampler->getSampler();
+	}
+
+	CubeMapTexture::CubeMapTexture(const lzvk::wrapper::Device::Ptr& device, const std::vector<lzvk::tools::Bitmap>& levels) {
+
+		mDevice = device;
 
-	//	// 1 Load hdr image
-	//	int width, height, channels;
-	//	float* hdrData = stbi_loadf(imageFilePath.c_str(), &width, &height, &channels, 4);
-	//	if (!hdrData) {
+		if (levels.empty() || levels[0].mDepth != 6 || levels[0].mChannels != 4 || levels[0].mFormat != lzvk::tools::BitmapFormat::Float) {
+			throw std::runtime_error("Error: cube map levels must be float RGBA with 6 faces");
+		}
 
-	//		throw std::runtime_error("Failed to load HDR image");
-	//	}
+		// 1 Every face takes its whole chain in one copy, batched with the other uploads
+		const uint32_t levelCount = static_cast<uint32_t>(levels.size());
+		createCubeImage(levels[0].mWidth, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, levelCount);
 
-	//	lzvk::tools::Bitmap hdrBitmap(width, height, 4, lzvk::tools::BitmapFormat::Float, hdrData);
-	//	stbi_image_free(hdrData);
+		std::vector<lzvk::wrapper::ImageUploadLevel> uploadLevels(levelCount);
 
-	//	// 2 Hdr to cube map
-	//	lzvk::tools::Bitmap cubemapBitmap = lzvk::tools::Tools::convertEquirectangularToCubemapFaces(hdrBitmap);
+		for (uint32_t face = 0; face < 6; ++face) {
 
-	//	mWidth = cubemapBitmap.mWidth;
-	//	mHeight = cubemapBitmap.mHeight;
+			for (uint32_t level = 0; level < levelCount; ++level) {
 
-	//	// 3 Create cube map image
-	//	mCubeMapImage = lzvk::wrapper::Image::create(mDevice,
-	//		cubemapBitmap.mWidth,
-	//		cubemapBitmap.mHeight,
-	//		VK_FORMAT_R32G32B32A32_SFLOAT,
-	//		VK_IMAGE_TYPE_2D,
-	//		VK_IMAGE_TILING_OPTIMAL,
-	//		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-	//		VK_SAMPLE_COUNT_1_BIT,
-	//		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-	//		VK_IMAGE_ASPECT_COLOR_BIT,
-	//		VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
-	//		6,
-	//		VK_IMAGE_VIEW_TYPE_CUBE);
+				const VkDeviceSize faceBytes = levels[level].mData.size() / 6;
+				uploadLevels[level].data = levels[level].mData.data() + face * faceBytes;
+				uploadLevels[level].size = faceBytes;
+			}
 
-	//	VkImageSubresourceRange initRange{};
-	//	initRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	//	initRange.baseMipLevel = 0;
-	//	initRange.levelCount = 1;
-	//	initRange.baseArrayLayer = 0;
-	//	initRange.layerCount = 6;
+			mDevice->getUploadManager()->uploadImage(mCubeMapImage->getImage(), mWidth, mHeight, face, uploadLevels);
+		}
 
+		mCubeMapImage->setImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
-	//	mCubeMapImage->setImageLayout(
-	//		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-	//		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-	//		VK_PIPELINE_STAGE_TRANSFER_BIT,
-	//		initRange,
-	//		commandPool
-	//	);
+		// 2 Levels stand for roughness rather than distance, like the prefiltered KTX maps, the shaders pick them with textureLod
+		mSampler = lzvk::wrapper::Sampler::create(mDevice);
+		mImageInfo.imageLayout = mCubeMapImage->getLayout();
+		mImageInfo.imageView = mCubeMapImage->getImageView();
+		mImageInfo.sampler = mSampler->getSampler();
+	}
 
+	lzvk::tools::Bitmap CubeMapTexture::loadHdr(const std::string& hdrFilePath) {
 
-	//	const int facePixels = cubemapBitmap.mWidth * cubemapBitmap.mHeight;
-	//	const int bytesPerPixel = cubemapBitmap.mChannels * lzvk::tools::Bitmap::getBytesPerChannel(cubemapBitmap.mFormat);
-	//	const int faceBytes = facePixels * bytesPerPixel;
+		int width, height, channels;
+		float* hdrData = stbi_loadf(hdrFilePath.c_str(), &width, &height, &channels, 4);
+		if (!hdrData) {
+			throw std::runtime_error("Error: failed to load HDR image " + hdrFilePath);
+		}
+
+		lzvk::tools::Bitmap equirect(width, height, 4, lzvk::tools::BitmapFormat::Float, hdrData);
+		stbi_image_free(hdrData);
 
-	//	assert(6 * faceBytes <= cubemapBitmap.mData.size());
+		if (width < 4 || height < 1) {
+			throw std::runtime_error("Error: HDR image is too small for a cube map " + hdrFilePath);
+		}
 
-	//	for (int face = 0; face < 6; ++face) {
-	//		void* faceData = cubemapBitmap.mData.data() + face * faceBytes;
-	//		mCubeMapImage->fillImageData(faceBytes, faceData, commandPool, face);
-	//	}
+		return equirect;
+	}
 
-	//	mCubeMapImage->setImageLayout(
-	//		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-	//		VK_PIPELINE_STAGE_TRANSFER_BIT,
-	//		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-	//		initRange,
-	//		commandPool
-	//	);
+	bool CubeMapTexture::isComputeConversionSupported(const lzvk::wrapper::Device::Ptr& device) {
 
+		VkFormatProperties properties{};
+		vkGetPhysicalDeviceFormatProperties(device->getPhysicalDevice(), VK_FORMAT_R32G32B32A32_SFLOAT, &properties);
 
-	//	// Create sampler
-	//	mSampler = lzvk::wrapper::Sampler::create(mDevice);
-	//	mImageInfo.imageLayout = mCubeMapImage->getLayout();
-	//	mImageInfo.imageView = mCubeMapImage->getImageView();
-	//	mImageInfo.sampler = mSampler->getSampler();
+		const VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT;
+		return (properties.optimalTilingFeatures & features) == features;
+	}
 
-	//}
+	void CubeMapTexture::createCubeImage(uint32_t faceSize, VkImageUsageFlags usage, uint32_t mipLevels) {
+
+		mWidth = faceSize;
+		mHeight = faceSize;
+
+		mCubeMapImage = lzvk::wrapper::Image::create(mDevice,
+			faceSize,
+			faceSize,
+			VK_FORMAT_R32G32B32A32_SFLOAT,
+			VK_IMAGE_TYPE_2D,
+			VK_IMAGE_TILING_OPTIMAL,
+			usage,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
+			6,
+			VK_IMAGE_VIEW_TYPE_CUBE,
+			mipLevels);
+	}
 
+	void CubeMapTexture::convertOnCpu(const lzvk::tools::Bitmap& equirect) {
+
+		// 1 Split into faces on every core
+		lzvk::tools::Bitmap cubemapBitmap = lzvk::tools::Tools::convertEquirectangularToCubemapFaces(equirect);
+
+		// 2 One copy per face, batched with the other uploads
+		createCubeImage(cubemapBitmap.mWidth, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+
+		const VkDeviceSize faceBytes = VkDeviceSize(cubemapBitmap.mWidth) * cubemapBitmap.mHeight * cubemapBitmap.mChannels *
+									   lzvk::tools::Bitmap::getBytesPerChannel(cubemapBitmap.mFormat);
+
+		for (uint32_t face = 0; face < 6; ++face) {
+			mDevice->getUploadManager()->uploadImage(mCubeMapImage->getImage(), mWidth, mHeight, face,
+													 cubemapBitmap.mData.data() + face * faceBytes, faceBytes);
+		}
+
+		mCubeMapImage->setImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	void CubeMapTexture::convertWithCompute(const lzvk::tools::Bitmap& equirect, const lzvk::wrapper::CommandPool::Ptr& commandPool) {
+
+		const int width = equirect.mWidth;
+		const int height = equirect.mHeight;
+
+		// 1 Upload the equirectangular image, the dispatch below waits on the CPU for it
+		auto equirectImage = lzvk::wrapper::Image::create(mDevice,
+			width,
+			height,
+			VK_FORMAT_R32G32B32A32_SFLOAT,
+			VK_IMAGE_TYPE_2D,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+			VK_SAMPLE_COUNT_1_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			VK_IMAGE_ASPECT_COLOR_BIT);
+
+		auto uploadManager = mDevice->getUploadManager();
+		uploadManager->uploadImage(equirectImage->getImage(), width, height, 0, equirect.mData.data(), equirect.mData.size());
+		uploadManager->wait(uploadManager->flush());
+
+		equirectImage->setImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		createCubeImage(static_cast<uint32_t>(width / 4), VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+
+		// 2 One shot set, taps clamp at the border like the CPU path
+		auto equirectParam = lzvk::wrapper::UniformParameter::create();
+		equirectParam->mBinding = 0;
+		equirectParam->mDescriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		equirectParam->mStage = VK_SHADER_STAGE_COMPUTE_BIT;
+		equirectParam->mCount = 1;
+
+		auto cubeParam = lzvk::wrapper::UniformParameter::create();
+		cubeParam->mBinding = 1;
+		cubeParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		cubeParam->mStage = VK_SHADER_STAGE_COMPUTE_BIT;
+		cubeParam->mCount = 1;
+
+		std::vector<lzvk::wrapper::UniformParameter::Ptr> params{ equirectParam, cubeParam };
+
+		auto layout = lzvk::wrapper::DescriptorSetLayout::create(mDevice);
+		layout->build(params);
+
+		auto pool = lzvk::wrapper::DescriptorPool::create(mDevice);
+		pool->build(params, 1);
+
+		auto descriptorSet = lzvk::wrapper::DescriptorSet::create(mDevice, params, layout, pool, 1);
+
+		VkSamplerCreateInfo samplerInfo = lzvk::wrapper::Sampler::getDefaultCreateInfo();
+		samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		samplerInfo.anisotropyEnable = VK_FALSE;
+		samplerInfo.maxLod = 0.0f;
+
+		auto equirectSampler = lzvk::wrapper::Sampler::create(mDevice, samplerInfo);
+
+		VkDescriptorImageInfo equirectInfo{};
+		equirectInfo.sampler = equirectSampler->getSampler();
+		equirectInfo.imageView = equirectImage->getImageView();
+		equirectInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkDescriptorImageInfo cubeInfo{};
+		cubeInfo.sampler = VK_NULL_HANDLE;
+		cubeInfo.imageView = mCubeMapImage->getImageView();
+		cubeInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		descriptorSet->updateImage(descriptorSet->getDescriptorSet(0), equirectParam->mBinding, equirectInfo);
+		descriptorSet->updateStorageImage(descriptorSet->getDescriptorSet(0), cubeParam->mBinding, cubeInfo);
+
+		// 3 One invocation per texel of every face
+		auto pipeline = lzvk::wrapper::ComputePipeline::create(mDevice);
+		pipeline->setShader(lzvk::wrapper::Shader::create(mDevice, "shaders/cubemap/equirect_to_cube_comp.spv", VK_SHADER_STAGE_COMPUTE_BIT, "main"));
+		pipeline->setDescriptorSetLayouts({ layout->getLayout() });
+		pipeline->build();
+
+		const uint32_t groupSize = 16;
+		const uint32_t groupCount = (mWidth + groupSize - 1) / groupSize;
+
+		auto commandBuffer = lzvk::wrapper::CommandBuffer::create(mDevice, commandPool);
+
+		commandBuffer->begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+		commandBuffer->requireImage(equirectImage, lzvk::wrapper::ImageAccess::SampledCompute);
+		commandBuffer->requireImage(mCubeMapImage, lzvk::wrapper::ImageAccess::StorageCompute, true);
+		commandBuffer->bindComputePipeline(pipeline->getPipeline());
+		commandBuffer->bindDescriptorSet(VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->getLayout(), descriptorSet->getDescriptorSet(0), 0);
+		commandBuffer->dispatch(groupCount, groupCount, 6);
+		commandBuffer->requireImage(mCubeMapImage, lzvk::wrapper::ImageAccess::SampledFragment);
+		commandBuffer->flushBarriers();
+		commandBuffer->end();
+		commandBuffer->submitSync(mDevice->getGraphicQueue(), VK_NULL_HANDLE);
+	}
 
 	CubeMapTexture::CubeMapTexture(const lzvk::wrapper::Device::Ptr& device,
 		const lzvk::wrapper::CommandPool::Ptr& commandPool,
@@ -153,19 +317,22 @@ namespace lzvk::renderer {
 			throw std::runtime_error("Failed to create cubemap VkImageView");
 		}
 
-		// 5. create image
+		// 5. create image, the upload left every face and level in vkTex.imageLayout
 		mCubeMapImage = lzvk::wrapper::Image::create(
 			device,
 			vkTex.image,
 			cubeView,
-			vkTex.imageFormat
+			vkTex.imageFormat,
+			vkTex.layerCount,
+			vkTex.levelCount,
+			vkTex.imageLayout
 		);
 
 		// 6. set size
 		mWidth = texture->baseWidth;
 		mHeight = texture->baseHeight;
 
-		// 7. create sampler and info
+		// 7. create sampler and info, levels of the prefiltered maps stand for roughness rather than distance and the shaders pick them with textureLod
 		mSampler = lzvk::wrapper::Sampler::create(mDevice);
 		mImageInfo.imageLayout = mCubeMapImage->getLayout();
 		mImageInfo.imageView = mCubeMapImage->getImageView();
@@ -5,9 +5,16 @@
 #include "../../wrapper/sampler.h"
 #include "../../wrapper/device.h"
 #include "../../wrapper/command_pool.h"
+#include "../../tools/bitmap.h"
 
 namespace lzvk::renderer {
 
+	// Where an equirectangular .hdr is split into faces, Compute writes them straight into the cube image
+	enum class CubeMapConversion {
+		Cpu,
+		Compute
+	};
+
 	class CubeMapTexture {
 	public:
 
@@ -17,6 +24,16 @@ namespace lzvk::renderer {
 			return std::make_shared<CubeMapTexture>(device, commandPool, ktxFilePath);
 		};
 
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& hdrFilePath,
+						  CubeMapConversion conversion) {
+
+			return std::make_shared<CubeMapTexture>(device, commandPool, hdrFilePath, conversion);
+		}
+
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const std::vector<lzvk::tools::Bitmap>& levels) {
+			return std::make_shared<CubeMapTexture>(device, levels);
+		}
+
 		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::Image::Ptr& image) {
 			return std::make_shared<CubeMapTexture>(device, image);
 		}
@@ -24,10 +41,25 @@ namespace lzvk::renderer {
 
 
 		CubeMapTexture(const lzvk::wrapper::Device::Ptr& device,const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& ktxFilePath);
-		//CubeMapTexture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& imageFilePath);
+
+		// Faces are width / 4 of the equirectangular image. The CPU path records its upload into the current
+		// UploadManager batch, the compute path has finished writing the cube when this returns. Compute falls
+		// back to the CPU where isComputeConversionSupported is false
+		CubeMapTexture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& hdrFilePath,
+					   CubeMapConversion conversion);
+
+		// Float RGBA levels largest first with 6 faces each, as the IBL baker writes them. The upload
+		// is recorded into the current UploadManager batch
+		CubeMapTexture(const lzvk::wrapper::Device::Ptr& device, const std::vector<lzvk::tools::Bitmap>& levels);
 		CubeMapTexture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::Image::Ptr& image);
 		~CubeMapTexture();
 
+		// Equirectangular .hdr as float RGBA
+		static lzvk::tools::Bitmap loadHdr(const std::string& hdrFilePath);
+
+		// The compute path samples the float RGBA equirect with a linear filter, which Vulkan does not require for 32 bit floats
+		static bool isComputeConversionSupported(const lzvk::wrapper::Device::Ptr& device);
+
 		[[nodiscard]] lzvk::wrapper::Image::Ptr getImage(){ return mCubeMapImage; }
 		[[nodiscard]] VkDescriptorImageInfo& getImageInfo() { return mImageInfo; }
 		[[nodiscard]] VkImageView getImageView() const { return mImageInfo.imageView; }
@@ -35,11 +67,24 @@ namespace lzvk::renderer {
 		[[nodiscard]] auto getWidth() const { return mWidth; }
 		[[nodiscard]] auto getHeight() const { return mHeight; }
 
+		// Conversion the .hdr constructor ran and its time without reading the file
+		[[nodiscard]] auto getConversion() const { return mConversion; }
+		[[nodiscard]] auto getConversionMs() const { return mConversionMs; }
+
+
+	private:
+
+		void createCubeImage(uint32_t faceSize, VkImageUsageFlags usage, uint32_t mipLevels = 1);
+		void convertOnCpu(const lzvk::tools::Bitmap& equirect);
+		void convertWithCompute(const lzvk::tools::Bitmap& equirect, const lzvk::wrapper::CommandPool::Ptr& commandPool);
 
 	private:
 		unsigned int mWidth{};
 		unsigned int mHeight{};
 
+		CubeMapConversion mConversion{ CubeMapConversion::Cpu };
+		double mConversionMs{};
+
 		lzvk::wrapper::Device::Ptr mDevice;
 		lzvk::wrapper::CommandPool::Ptr mCommandPool;
 		lzvk::wrapper::Image::Ptr mCubeMapImage;
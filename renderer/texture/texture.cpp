@@ -1,70 +1,244 @@
 #include "texture.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ktx.h>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 namespace lzvk::renderer {
 
-	Texture::Texture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& imageFilePath, VkFormat format) {
-		
+	Texture::Texture(const lzvk::wrapper::Device::Ptr& device, const std::string& imageFilePath, VkFormat format, int coverageChannel)
+		: Texture(device, decode(imageFilePath, format, coverageChannel)) {
+	}
+
+	Texture::Texture(const lzvk::wrapper::Device::Ptr& device, const TextureData& data) {
+
 		mDevice = device;
+		mFirstLevel = data.firstLevel;
 
-		// 1 load image
-		int texWidth, texHeight, texSize, texChannles;
-		stbi_uc* pixels = stbi_load(imageFilePath.c_str(), &texWidth, &texHeight, &texChannles, STBI_rgb_alpha);
+		createImage(&data, 1, VK_IMAGE_VIEW_TYPE_2D);
 
-		if (!pixels) {
-			throw std::runtime_error("Error: failed to read image data");
+		// create sampler
+		mSampler = lzvk::wrapper::Sampler::create(mDevice);
+
+		mImageInfo.imageLayout = mImage->getLayout();
+		mImageInfo.imageView = mImage->getImageView();
+		mImageInfo.sampler = mSampler->getSampler();
+	}
+
+	Texture::Texture(const lzvk::wrapper::Device::Ptr& device, const std::vector<TextureData>& layers) {
+
+		mDevice = device;
+
+		if (layers.empty()) {
+			throw std::runtime_error("Error: texture array without layers");
 		}
 
-		texSize = texWidth * texHeight * 4;
+		mFirstLevel = layers[0].firstLevel;
+
+		createImage(layers.data(), static_cast<uint32_t>(layers.size()), VK_IMAGE_VIEW_TYPE_2D_ARRAY);
+
+		mSampler = lzvk::wrapper::Sampler::create(mDevice);
+
+		mImageInfo.imageLayout = mImage->getLayout();
+		mImageInfo.imageView = mImage->getImageView();
+		mImageInfo.sampler = mSampler->getSampler();
+	}
+
+	void Texture::createImage(const TextureData* layers, uint32_t layerCount, VkImageViewType viewType) {
+
+		const auto& first = layers[0];
+		const auto& levels = first.mipChain.levels;
+		const uint32_t mipLevels = static_cast<uint32_t>(levels.size());
+
+		for (uint32_t layer = 0; layer < layerCount; ++layer) {
+
+			const auto& layerLevels = layers[layer].mipChain.levels;
+
+			if (layers[layer].format != first.format || layerLevels.size() != levels.size() ||
+				layerLevels[0].width != levels[0].width || layerLevels[0].height != levels[0].height) {
+				throw std::runtime_error("Error: texture array layers differ in format or extent");
+			}
+		}
 
 		mImage = lzvk::wrapper::Image::create(
-			mDevice, texWidth, texHeight,
-			format,
+			mDevice, levels[0].width, levels[0].height,
+			first.format,
 			VK_IMAGE_TYPE_2D,
 			VK_IMAGE_TILING_OPTIMAL,
 			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
 			VK_SAMPLE_COUNT_1_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-			VK_IMAGE_ASPECT_COLOR_BIT
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, layerCount, viewType,
+			mipLevels
 		);
 
-		VkImageSubresourceRange region{};
-		region.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		// Copy and layout transitions are batched with the other uploads, one copy per layer
+		std::vector<lzvk::wrapper::ImageUploadLevel> uploadLevels(mipLevels);
 
-		region.baseArrayLayer = 0;
-		region.layerCount = 1;
+		for (uint32_t layer = 0; layer < layerCount; ++layer) {
 
-		region.baseMipLevel = 0;
-		region.levelCount = 1;
+			const auto& data = layers[layer];
+			const uint8_t* bytes = data.mappedData != nullptr ? data.mappedData : data.mipChain.data.data();
 
-		mImage->setImageLayout(
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			region,
-			commandPool
-		);
+			for (uint32_t level = 0; level < mipLevels; ++level) {
+				uploadLevels[level].data = bytes + data.mipChain.levels[level].offset;
+				uploadLevels[level].size = data.mipChain.levels[level].size;
+			}
 
-		mImage->fillImageData(texSize, (void*)pixels, commandPool, 0);
+			mDevice->getUploadManager()->uploadImage(mImage->getImage(), levels[0].width, levels[0].height, layer, uploadLevels, data.blockExtent);
+		}
 
-		mImage->setImageLayout(
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			region,
-			commandPool
-		);
+		mImage->setImageLayout(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+
+	TextureData Texture::decode(const std::string& imageFilePath, VkFormat format, int coverageChannel) {
+
+		return decode(imageFilePath, readFile(imageFilePath), format, coverageChannel);
+	}
+
+	TextureData Texture::decode(const std::string& imageFilePath, const std::vector<uint8_t>& fileData, VkFormat format, int coverageChannel) {
+
+		if (std::filesystem::path(imageFilePath).extension() == ".ktx2") {
+			return decodeKtx2File(imageFilePath, fileData);
+		}
+
+		return decodeImageFile(imageFilePath, fileData, format, coverageChannel);
+	}
+
+	std::vector<uint8_t> Texture::readFile(const std::string& filePath) {
+
+		std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+		if (!file) {
+			throw std::runtime_error("Error: failed to open " + filePath);
+		}
+
+		std::vector<uint8_t> fileData(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+
+		if (!file.read(reinterpret_cast<char*>(fileData.data()), fileData.size())) {
+			throw std::runtime_error("Error: failed to read " + filePath);
+		}
+
+		return fileData;
+	}
+
+	void Texture::dropLevels(TextureData& data, uint32_t levelCount) {
+
+		auto& chain = data.mipChain;
+		levelCount = std::min<uint32_t>(levelCount, static_cast<uint32_t>(chain.levels.size()) - 1);
+
+		if (levelCount == 0) {
+			return;
+		}
+
+		// levels are stored largest first, the kept ones move to the front. Mapped levels stay where they are
+		const size_t dropped = chain.levels[levelCount].offset;
+
+		if (data.mappedData != nullptr) {
+			data.mappedData += dropped;
+		}
+		else {
+			chain.data.erase(chain.data.begin(), chain.data.begin() + dropped);
+		}
+
+		chain.levels.erase(chain.levels.begin(), chain.levels.begin() + levelCount);
+
+		for (auto& level : chain.levels) {
+			level.offset -= dropped;
+		}
+
+		data.firstLevel += levelCount;
+	}
+
+	size_t Texture::getDataSize(const TextureData& data) {
+
+		const auto& levels = data.mipChain.levels;
+		return levels.empty() ? 0 : levels.back().offset + levels.back().size;
+	}
+
+	TextureData Texture::decodeImageFile(const std::string& imageFilePath, const std::vector<uint8_t>& fileData, VkFormat format, int coverageChannel) {
+
+		// 1 load image
+		int texWidth, texHeight, texChannles;
+		stbi_uc* pixels = stbi_load_from_memory(fileData.data(), static_cast<int>(fileData.size()), &texWidth, &texHeight, &texChannles, STBI_rgb_alpha);
+
+		if (!pixels) {
+			throw std::runtime_error("Error: failed to read image data " + imageFilePath);
+		}
+
+		// 2 A coverage channel without variation, e.g. the alpha of a file without one, needs no scaling
+		if (coverageChannel >= 0) {
+
+			const size_t texelCount = size_t(texWidth) * texHeight;
+			const stbi_uc first = pixels[coverageChannel];
+
+			bool uniform = true;
+			for (size_t i = 1; i < texelCount && uniform; ++i) {
+				uniform = pixels[i * 4 + coverageChannel] == first;
+			}
+
+			coverageChannel = uniform ? -1 : coverageChannel;
+		}
+
+		// 3 Mip chain filtered on the CPU, sRGB data is averaged in linear space
+		lzvk::tools::MipSettings mipSettings{};
+		mipSettings.srgb = format == VK_FORMAT_R8G8B8A8_SRGB;
+		mipSettings.coverageChannel = coverageChannel;
+
+		TextureData data{};
+		data.format = format;
+		data.coverageChannel = coverageChannel;
+		data.mipChain = lzvk::tools::generateMipChain(pixels, texWidth, texHeight, mipSettings);
 
 		stbi_image_free(pixels);
 
-		// create sampler
-		mSampler = lzvk::wrapper::Sampler::create(mDevice);
+		return data;
+	}
 
-		mImageInfo.imageLayout = mImage->getLayout();
-		mImageInfo.imageView = mImage->getImageView();
-		mImageInfo.sampler = mSampler->getSampler();
+	TextureData Texture::decodeKtx2File(const std::string& ktxFilePath, const std::vector<uint8_t>& fileData) {
+
+		// 1 Load the baked chain as stored, no decoding
+		ktxTexture2* texture = nullptr;
+		if (ktxTexture2_CreateFromMemory(fileData.data(), fileData.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture) != KTX_SUCCESS) {
+			throw std::runtime_error("Error: failed to read " + ktxFilePath);
+		}
+
+		TextureData data{};
+		data.format = static_cast<VkFormat>(texture->vkFormat);
+		data.blockExtent = texture->isCompressed ? VkExtent2D{ 4, 4 } : VkExtent2D{ 1, 1 };
+
+		// 2 Levels largest first, in the layout the upload expects
+		auto& chain = data.mipChain;
+		chain.levels.resize(texture->numLevels);
+
+		size_t offset = 0;
+		for (uint32_t level = 0; level < texture->numLevels; ++level) {
+
+			auto& mip = chain.levels[level];
+			mip.width = std::max(1u, texture->baseWidth >> level);
+			mip.height = std::max(1u, texture->baseHeight >> level);
+			mip.offset = offset;
+			mip.size = ktxTexture_GetImageSize(ktxTexture(texture), level);
+			offset += mip.size;
+		}
+
+		chain.data.resize(offset);
+
+		for (uint32_t level = 0; level < texture->numLevels; ++level) {
+
+			ktx_size_t imageOffset = 0;
+			ktxTexture_GetImageOffset(ktxTexture(texture), level, 0, 0, &imageOffset);
+
+			std::memcpy(chain.data.data() + chain.levels[level].offset, ktxTexture_GetData(ktxTexture(texture)) + imageOffset, chain.levels[level].size);
+		}
+
+		ktxTexture_Destroy(ktxTexture(texture));
+
+		return data;
 	}
 
 	Texture::Texture(const lzvk::wrapper::Device::Ptr& device,
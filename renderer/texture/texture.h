@@ -4,38 +4,101 @@
 #include "../../wrapper/image.h"
 #include "../../wrapper/sampler.h"
 #include "../../wrapper/device.h"
-#include "../../wrapper/command_pool.h"
+#include "../../tools/mip_chain.h"
 
 
 namespace lzvk::renderer {
 
+	// A texture file decoded into the levels it is uploaded with. Decoding touches no Vulkan
+	// object, so it runs on any thread.
+	struct TextureData {
+		VkFormat format{ VK_FORMAT_UNDEFINED };
+
+		// 4x4 for block compressed formats, rows are copied in whole blocks
+		VkExtent2D blockExtent{ 1, 1 };
+		lzvk::tools::MipChain mipChain{};
+
+		// Level of the full chain that mipChain starts at, larger levels were dropped
+		uint32_t firstLevel{ 0 };
+
+		// Channel whose alpha test coverage the levels preserve, -1 for none. A channel holding one
+		// value has no coverage to preserve and reads -1, the chain then equals a decode without it
+		int coverageChannel{ -1 };
+
+		// Set when the levels are read from a mapped TextureCache instead of mipChain.data,
+		// the mapping has to outlive the upload
+		const uint8_t* mappedData{ nullptr };
+	};
+
 	class Texture {
 	public:
 		using Ptr = std::shared_ptr<Texture>;
-		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& imageFilePath) {
-			return std::make_shared<Texture>(device, commandPool, imageFilePath);
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const std::string& imageFilePath) {
+			return std::make_shared<Texture>(device, imageFilePath);
 		}
 
 		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::Image::Ptr& image) {
 			return std::make_shared<Texture>(device, image);
 		}
 
-		Texture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::CommandPool::Ptr& commandPool, const std::string& imageFilePath, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB);
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const TextureData& data) {
+			return std::make_shared<Texture>(device, data);
+		}
+
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, const std::vector<TextureData>& layers) {
+			return std::make_shared<Texture>(device, layers);
+		}
+
+		// Reads the file with a full mip chain, coverageChannel is the channel alpha tests read (-1 for none).
+		// Baked .ktx2 files already carry their chain and block format, format and coverageChannel are ignored
+		static TextureData decode(const std::string& imageFilePath, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, int coverageChannel = -1);
+
+		// Same as above on file contents already in memory, imageFilePath only picks the container and names errors
+		static TextureData decode(const std::string& imageFilePath, const std::vector<uint8_t>& fileData,
+								  VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, int coverageChannel = -1);
+
+		static std::vector<uint8_t> readFile(const std::string& filePath);
+
+		// Drops the largest levels of the chain, at least one level is kept
+		static void dropLevels(TextureData& data, uint32_t levelCount);
+
+		// Bytes of every level of the chain
+		static size_t getDataSize(const TextureData& data);
+
+		// decode followed by the upload
+		Texture(const lzvk::wrapper::Device::Ptr& device, const std::string& imageFilePath, VkFormat format = VK_FORMAT_R8G8B8A8_SRGB, int coverageChannel = -1);
 		Texture(const lzvk::wrapper::Device::Ptr& device, const lzvk::wrapper::Image::Ptr& image);
 
+		// Creates the image and records its upload into the current UploadManager batch
+		Texture(const lzvk::wrapper::Device::Ptr& device, const TextureData& data);
+
+		// Same for a 2D array image sampled as sampler2DArray, every layer has the same format and levels
+		Texture(const lzvk::wrapper::Device::Ptr& device, const std::vector<TextureData>& layers);
+
 		~Texture();	
 
 		[[nodiscard]] auto getImage() const { return mImage; }
+		[[nodiscard]] auto getFirstLevel() const { return mFirstLevel; }
+		[[nodiscard]] auto getLayerCount() const { return mImage->getArrayLayers(); }
 		[[nodiscard]] VkDescriptorImageInfo& getImageInfo() { return mImageInfo; }
 		[[nodiscard]] VkImageView getImageView() const { return mImageInfo.imageView; }
 		[[nodiscard]] VkSampler getSampler() const { return mImageInfo.sampler; }
 
+	private:
+
+		static TextureData decodeImageFile(const std::string& imageFilePath, const std::vector<uint8_t>& fileData, VkFormat format, int coverageChannel);
+		static TextureData decodeKtx2File(const std::string& ktxFilePath, const std::vector<uint8_t>& fileData);
+
+		// Image, view and upload of layerCount chains of the same shape
+		void createImage(const TextureData* layers, uint32_t layerCount, VkImageViewType viewType);
+
 	private:
 
 		lzvk::wrapper::Device::Ptr mDevice{ nullptr };
 		lzvk::wrapper::Image::Ptr mImage{ nullptr };
 		lzvk::wrapper::Sampler::Ptr mSampler{ nullptr };
 		VkDescriptorImageInfo mImageInfo{};
+		uint32_t mFirstLevel{ 0 };
 	};
 
 }
\ No newline at end of file
@@ -0,0 +1,447 @@
+#include "texture_cache.h"
+#include <filesystem>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lzvk::renderer {
+
+	TextureCache::Key TextureCache::getKey(const std::string& sourcePath, VkFormat format, int coverageChannel) {
+
+		std::error_code timeError{};
+		std::error_code sizeError{};
+
+		Key key{};
+		key.path = sourcePath;
+		key.modifiedTime = static_cast<int64_t>(std::filesystem::last_write_time(sourcePath, timeError).time_since_epoch().count());
+		key.fileSize = static_cast<uint64_t>(std::filesystem::file_size(sourcePath, sizeError));
+		key.format = format;
+		key.coverageChannel = coverageChannel;
+
+		if (timeError || sizeError) {
+			throw std::runtime_error("Error: failed to open " + sourcePath);
+		}
+
+		return key;
+	}
+
+	TextureCache::TextureCache(const std::string& path) {
+
+		mPath = path;
+
+		std::error_code error{};
+		if (!std::filesystem::exists(path, error)) {
+			printf("[TextureCache] %s not found, textures are decoded and cached\n", path.c_str());
+			return;
+		}
+
+		try {
+			map(path);
+			readTable();
+		}
+		catch (const std::exception& e) {
+
+			printf("[TextureCache] %s, textures are decoded and cached again\n", e.what());
+			unmap();
+			mEntries.clear();
+			return;
+		}
+
+		printf("[TextureCache] mapped %s, %u textures in %.1f MB\n", path.c_str(), getEntryCount(), mSize / (1024.0 * 1024.0));
+	}
+
+	TextureCache::~TextureCache() {
+
+		// an unsaved archive is incomplete
+		if (mPending.is_open()) {
+			mPending.close();
+
+			std::error_code error{};
+			std::filesystem::remove(mPath + ".tmp", error);
+		}
+
+		unmap();
+	}
+
+	bool TextureCache::find(const Key& key, TextureData& data, uint64_t& contentHash) {
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		auto it = mEntries.find(getName(key.path, key.format, key.coverageChannel));
+		if (it == mEntries.end() || it->second.pending) {
+			return false;
+		}
+
+		// a touched source is decoded again
+		auto& entry = it->second;
+		if (entry.file.modifiedTime != key.modifiedTime || entry.file.fileSize != key.fileSize) {
+			return false;
+		}
+
+		data = {};
+		data.format = static_cast<VkFormat>(entry.file.format);
+		data.blockExtent = { entry.file.blockWidth, entry.file.blockHeight };
+		data.coverageChannel = entry.file.chainCoverageChannel;
+		data.mappedData = mData + entry.file.dataOffset;
+
+		data.mipChain.levels.resize(entry.file.levelCount);
+		for (uint32_t level = 0; level < entry.file.levelCount; ++level) {
+
+			const auto& fileLevel = entry.file.levels[level];
+			data.mipChain.levels[level] = { fileLevel.width, fileLevel.height, static_cast<size_t>(fileLevel.offset), static_cast<size_t>(fileLevel.size) };
+		}
+
+		contentHash = entry.file.contentHash;
+		entry.used = true;
+		++mHitCount;
+
+		return true;
+	}
+
+	void TextureCache::store(const Key& key, uint64_t contentHash, const TextureData* data) {
+
+		if (data != nullptr && (data->mipChain.levels.empty() || data->mipChain.levels.size() > MAX_LEVELS)) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Entry entry{};
+		entry.pending = true;
+		entry.used = true;
+		entry.file.modifiedTime = key.modifiedTime;
+		entry.file.fileSize = key.fileSize;
+		entry.file.contentHash = contentHash;
+		entry.file.requestFormat = static_cast<uint32_t>(key.format);
+		entry.file.coverageChannel = key.coverageChannel;
+
+		// 1 Chains with the same contents are written once
+		auto blob = mPendingBlobs.find(getContentKey(entry.file));
+
+		if (blob != mPendingBlobs.end()) {
+			entry.file = blob->second;
+			entry.file.modifiedTime = key.modifiedTime;
+		}
+		else if (data != nullptr) {
+
+			const auto& levels = data->mipChain.levels;
+
+			entry.file.format = static_cast<uint32_t>(data->format);
+			entry.file.blockWidth = data->blockExtent.width;
+			entry.file.blockHeight = data->blockExtent.height;
+			entry.file.levelCount = static_cast<uint32_t>(levels.size());
+			entry.file.chainCoverageChannel = data->coverageChannel;
+			entry.file.dataSize = levels.back().offset + levels.back().size;
+
+			for (size_t level = 0; level < levels.size(); ++level) {
+				entry.file.levels[level] = { levels[level].width, levels[level].height, levels[level].offset, levels[level].size };
+			}
+
+			// 2 Straight into the next archive, nothing is held in memory
+			const uint8_t* bytes = data->mappedData != nullptr ? data->mappedData : data->mipChain.data.data();
+			writeBlob(entry.file, bytes);
+
+			mPendingBlobs.emplace(getContentKey(entry.file), entry.file);
+		}
+		else if (!mPending.is_open()) {
+
+			// no blob yet, the next archive is still started so save() resolves the entry
+			writeBlob(entry.file, nullptr);
+		}
+
+		mEntries[getName(key.path, key.format, key.coverageChannel)] = entry;
+		++mStoredCount;
+	}
+
+	void TextureCache::save() {
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (!mPending.is_open()) {
+			return;
+		}
+
+		// 1 Hits are copied over from the mapped archive, unused entries are dropped
+		for (auto it = mEntries.begin(); it != mEntries.end();) {
+
+			auto& entry = it->second;
+
+			if (!entry.used) {
+				it = mEntries.erase(it);
+				continue;
+			}
+
+			if (!entry.pending) {
+
+				auto blob = mPendingBlobs.find(getContentKey(entry.file));
+
+				if (blob == mPendingBlobs.end()) {
+					const uint8_t* bytes = mData + entry.file.dataOffset;
+					writeBlob(entry.file, bytes);
+					mPendingBlobs.emplace(getContentKey(entry.file), entry.file);
+				}
+				else {
+					entry.file.dataOffset = blob->second.dataOffset;
+				}
+			}
+
+			++it;
+		}
+
+		// 2 Entries that only matched another's contents take its blob, or go when it was never written
+		for (auto it = mEntries.begin(); it != mEntries.end();) {
+
+			auto& entry = it->second;
+
+			if (entry.file.levelCount == 0) {
+
+				auto blob = mPendingBlobs.find(getContentKey(entry.file));
+				if (blob == mPendingBlobs.end()) {
+					it = mEntries.erase(it);
+					continue;
+				}
+
+				auto modifiedTime = entry.file.modifiedTime;
+				entry.file = blob->second;
+				entry.file.modifiedTime = modifiedTime;
+			}
+
+			++it;
+		}
+
+		// 3 Entry table and names behind the blobs
+		FileHeader header{};
+		header.entryCount = static_cast<uint32_t>(mEntries.size());
+		header.tableOffset = (mPendingSize + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+
+		std::vector<FileEntry> entries{};
+		std::string names{};
+		size_t namesOffset = mEntries.size() * sizeof(FileEntry);
+
+		for (const auto& [name, entry] : mEntries) {
+
+			FileEntry file = entry.file;
+			file.nameOffset = static_cast<uint32_t>(namesOffset + names.size());
+			file.nameSize = static_cast<uint32_t>(name.size());
+
+			entries.push_back(file);
+			names += name;
+		}
+
+		const char padding[BLOB_ALIGNMENT] = {};
+
+		mPending.write(padding, header.tableOffset - mPendingSize);
+		mPending.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(FileEntry));
+		mPending.write(names.data(), names.size());
+
+		mPending.seekp(0);
+		mPending.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		mPending.close();
+
+		if (mPending.fail()) {
+			throw std::runtime_error("Error: failed to write texture cache " + mPath);
+		}
+
+		// 4 Swap the archives, pointers into the old mapping are invalid from here
+		unmap();
+
+		std::error_code error{};
+		std::filesystem::rename(mPath + ".tmp", mPath, error);
+
+		if (error) {
+			throw std::runtime_error("Error: failed to replace texture cache " + mPath + ", " + error.message());
+		}
+
+		mPendingBlobs.clear();
+		mPendingSize = 0;
+
+		map(mPath);
+		readTable();
+
+		printf("[TextureCache] wrote %s, %u textures in %.1f MB\n", mPath.c_str(), getEntryCount(), mSize / (1024.0 * 1024.0));
+	}
+
+	std::string TextureCache::getName(const std::string& path, VkFormat format, int coverageChannel) {
+
+		return path + "#" + std::to_string(static_cast<uint32_t>(format)) + "#" + std::to_string(coverageChannel);
+	}
+
+	TextureCache::ContentKey TextureCache::getContentKey(const FileEntry& entry) {
+
+		return { entry.contentHash, entry.fileSize, entry.requestFormat, entry.coverageChannel };
+	}
+
+	void TextureCache::readTable() {
+
+		mEntries.clear();
+
+		// 1 Header and entry table
+		if (mSize < sizeof(FileHeader)) {
+			throw std::runtime_error("Error: texture cache " + mPath + " is truncated");
+		}
+
+		const auto* header = reinterpret_cast<const FileHeader*>(mData);
+
+		if (header->magic != MAGIC || header->fileVersion != FILE_VERSION) {
+			throw std::runtime_error("Error: " + mPath + " is not a texture cache of this version");
+		}
+
+		if (header->tableOffset + uint64_t(header->entryCount) * sizeof(FileEntry) > mSize) {
+			throw std::runtime_error("Error: texture cache " + mPath + " is truncated");
+		}
+
+		const auto* entries = reinterpret_cast<const FileEntry*>(mData + header->tableOffset);
+		const uint64_t tableSize = mSize - header->tableOffset;
+
+		// 2 Every entry and level has to stay inside the file
+		for (uint32_t i = 0; i < header->entryCount; ++i) {
+
+			const auto& file = entries[i];
+
+			bool inside = uint64_t(file.nameOffset) + file.nameSize <= tableSize &&
+						  file.dataOffset + file.dataSize <= header->tableOffset &&
+						  file.levelCount > 0 && file.levelCount <= MAX_LEVELS;
+
+			for (uint32_t level = 0; inside && level < file.levelCount; ++level) {
+				inside = file.levels[level].offset + file.levels[level].size <= file.dataSize;
+			}
+
+			if (!inside) {
+				throw std::runtime_error("Error: texture cache " + mPath + " has an entry outside the file");
+			}
+
+			std::string name(reinterpret_cast<const char*>(mData + header->tableOffset + file.nameOffset), file.nameSize);
+
+			Entry entry{};
+			entry.file = file;
+			mEntries.emplace(std::move(name), entry);
+		}
+	}
+
+	void TextureCache::writeBlob(FileEntry& entry, const uint8_t* data) {
+
+		// 1 The header is written last, once the table offset is known
+		if (!mPending.is_open()) {
+
+			std::error_code error{};
+			std::filesystem::create_directories(std::filesystem::path(mPath).parent_path(), error);
+
+			mPending.open(mPath + ".tmp", std::ios::binary | std::ios::trunc);
+			if (!mPending) {
+				throw std::runtime_error("Error: failed to write texture cache " + mPath + ".tmp");
+			}
+
+			FileHeader header{};
+			mPending.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			mPendingSize = sizeof(header);
+		}
+
+		if (data == nullptr) {
+			return;
+		}
+
+		// 2 Blobs start aligned for the staging copies
+		const char padding[BLOB_ALIGNMENT] = {};
+		const uint64_t offset = (mPendingSize + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+
+		mPending.write(padding, offset - mPendingSize);
+		mPending.write(reinterpret_cast<const char*>(data), entry.dataSize);
+
+		if (!mPending) {
+			throw std::runtime_error("Error: failed to write texture cache " + mPath + ".tmp");
+		}
+
+		entry.dataOffset = offset;
+		mPendingSize = offset + entry.dataSize;
+	}
+
+#if defined(_WIN32)
+
+	void TextureCache::map(const std::string& path) {
+
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("Error: failed to open texture cache " + path);
+		}
+		mFileHandle = file;
+
+		LARGE_INTEGER size{};
+		GetFileSizeEx(file, &size);
+		mSize = static_cast<size_t>(size.QuadPart);
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			unmap();
+			throw std::runtime_error("Error: failed to map texture cache " + path);
+		}
+		mMappingHandle = mapping;
+
+		mData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (mData == nullptr) {
+			unmap();
+			throw std::runtime_error("Error: failed to map texture cache " + path);
+		}
+	}
+
+	void TextureCache::unmap() {
+
+		if (mData != nullptr) UnmapViewOfFile(mData);
+		if (mMappingHandle != nullptr) CloseHandle(static_cast<HANDLE>(mMappingHandle));
+		if (mFileHandle != nullptr) CloseHandle(static_cast<HANDLE>(mFileHandle));
+
+		mData = nullptr;
+		mSize = 0;
+		mMappingHandle = nullptr;
+		mFileHandle = nullptr;
+	}
+
+#else
+
+	void TextureCache::map(const std::string& path) {
+
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			throw std::runtime_error("Error: failed to open texture cache " + path);
+		}
+
+		struct stat info {};
+		fstat(file, &info);
+		mSize = static_cast<size_t>(info.st_size);
+
+		if (mSize == 0) {
+			::close(file);
+			throw std::runtime_error("Error: texture cache " + path + " is truncated");
+		}
+
+		// the mapping keeps the file alive, the descriptor isn't needed after this
+		void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+
+		if (data == MAP_FAILED) {
+			mSize = 0;
+			throw std::runtime_error("Error: failed to map texture cache " + path);
+		}
+
+		mData = static_cast<const uint8_t*>(data);
+	}
+
+	void TextureCache::unmap() {
+
+		if (mData != nullptr) {
+			munmap(const_cast<uint8_t*>(mData), mSize);
+		}
+
+		mData = nullptr;
+		mSize = 0;
+	}
+
+#endif
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "../../common.h"
+#include "texture.h"
+#include <mutex>
+#include <map>
+#include <tuple>
+
+namespace lzvk::renderer {
+
+	// Decoded scene textures kept on disk next to the mesh caches, in the layout they are uploaded
+	// with. The file is memory mapped and hits hand out levels that point into the mapping, so
+	// a warm start copies straight from the file into the staging ring without decoding.
+	//
+	// Entries are keyed by the source path, its modification time and size, and the format and
+	// coverage channel it is sampled with. Each entry also records the content hash of the source,
+	// entries with the same contents share one texel blob.
+	//
+	// Layout: FileHeader, texel blobs 16 byte aligned, then at tableOffset FileEntry[entryCount]
+	// followed by the names. Blob offsets count from the start of the file, name offsets from
+	// tableOffset and level offsets from their blob.
+	class TextureCache {
+	public:
+
+		using Ptr = std::shared_ptr<TextureCache>;
+		static Ptr create(const std::string& path) {
+			return std::make_shared<TextureCache>(path);
+		}
+
+		struct Key {
+			std::string path{};
+			int64_t modifiedTime{ 0 };
+			uint64_t fileSize{ 0 };
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			int coverageChannel{ -1 };
+		};
+
+		// Reads the modification time and size of the source file
+		static Key getKey(const std::string& sourcePath, VkFormat format, int coverageChannel);
+
+		// A missing, stale or foreign file starts an empty cache
+		explicit TextureCache(const std::string& path);
+		~TextureCache();
+
+		// Levels of a hit point into the mapping and stay valid until save() replaces it.
+		// Safe to call from the loader workers
+		bool find(const Key& key, TextureData& data, uint64_t& contentHash);
+
+		// Appends the chain of a miss to the next archive. data may be nullptr when an entry with
+		// the same content hash was stored, the entry then shares its blob
+		void store(const Key& key, uint64_t contentHash, const TextureData* data);
+
+		// Writes the entries found or stored since the last save into a new archive that replaces
+		// the mapped one, entries nobody asked for are dropped. Does nothing when every lookup hit
+		void save();
+
+		[[nodiscard]] auto getPath() const { return mPath; }
+		[[nodiscard]] auto getSize() const { return mSize; }
+		[[nodiscard]] auto getEntryCount() const { return static_cast<uint32_t>(mEntries.size()); }
+		[[nodiscard]] auto getHitCount() const { return mHitCount; }
+		[[nodiscard]] auto getStoredCount() const { return mStoredCount; }
+
+	private:
+
+		static constexpr uint32_t MAGIC = 0x43545a4c; // "LZTC"
+		static constexpr uint32_t FILE_VERSION = 2;
+		static constexpr uint32_t MAX_LEVELS = 16;
+		static constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+		struct FileHeader {
+			uint32_t magic{ MAGIC };
+			uint32_t fileVersion{ FILE_VERSION };
+			uint32_t entryCount{ 0 };
+			uint32_t reserved{ 0 };
+			uint64_t tableOffset{ 0 };
+		};
+
+		struct FileLevel {
+			uint32_t width{ 0 };
+			uint32_t height{ 0 };
+			uint64_t offset{ 0 };
+			uint64_t size{ 0 };
+		};
+
+		struct FileEntry {
+			uint32_t nameOffset{ 0 };
+			uint32_t nameSize{ 0 };
+			int64_t modifiedTime{ 0 };
+			uint64_t fileSize{ 0 };
+			uint64_t contentHash{ 0 };
+
+			// what was requested, and what the blob holds
+			uint32_t requestFormat{ 0 };
+			int32_t coverageChannel{ -1 };
+			uint32_t format{ 0 };
+			uint32_t blockWidth{ 1 };
+			uint32_t blockHeight{ 1 };
+			uint32_t levelCount{ 0 };
+			int32_t chainCoverageChannel{ -1 };
+			uint32_t reserved{ 0 };
+
+			uint64_t dataOffset{ 0 };
+			uint64_t dataSize{ 0 };
+			FileLevel levels[MAX_LEVELS]{};
+		};
+
+		// Blobs are shared by entries with the same contents and sampling
+		using ContentKey = std::tuple<uint64_t, uint64_t, uint32_t, int32_t>;
+
+		struct Entry {
+			FileEntry file{};
+
+			// blob lives in the pending file, or nowhere yet for entries sharing another's blob
+			bool pending{ false };
+			bool used{ false };
+		};
+
+		static std::string getName(const std::string& path, VkFormat format, int coverageChannel);
+		static ContentKey getContentKey(const FileEntry& entry);
+
+		void readTable();
+		void writeBlob(FileEntry& entry, const uint8_t* data);
+		void map(const std::string& path);
+		void unmap();
+
+	private:
+
+		std::string mPath{};
+		std::mutex mMutex;
+
+		// 1 Mapped archive
+		const uint8_t* mData{ nullptr };
+		size_t mSize{ 0 };
+
+		// platform handles of the mapping
+		void* mFileHandle{ nullptr };
+		void* mMappingHandle{ nullptr };
+
+		// 2 Entries of the mapped archive and the ones stored since, by name
+		std::map<std::string, Entry> mEntries{};
+
+		// 3 Next archive, blobs are appended as misses come in
+		std::ofstream mPending;
+		uint64_t mPendingSize{ 0 };
+		std::map<ContentKey, FileEntry> mPendingBlobs{};
+
+		uint32_t mHitCount{ 0 };
+		uint32_t mStoredCount{ 0 };
+	};
+}
@@ -0,0 +1,300 @@
+#include "texture_loader.h"
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+namespace lzvk::renderer {
+
+	namespace {
+
+		double getMilliseconds(std::chrono::steady_clock::time_point start) {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		// FNV-1a over 64 bit words with a final avalanche, the key also carries the size
+		uint64_t hashContent(const std::vector<uint8_t>& bytes) {
+
+			uint64_t hash = 0xcbf29ce484222325ull;
+			size_t i = 0;
+
+			for (; i + 8 <= bytes.size(); i += 8) {
+				uint64_t word = 0;
+				std::memcpy(&word, bytes.data() + i, 8);
+				hash = (hash ^ word) * 0x100000001b3ull;
+			}
+
+			for (; i < bytes.size(); ++i) {
+				hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+			}
+
+			hash ^= hash >> 33;
+			hash *= 0xff51afd7ed558ccdull;
+			hash ^= hash >> 33;
+
+			return hash;
+		}
+	}
+
+	TextureLoader::TextureLoader(const lzvk::wrapper::Device::Ptr& device, uint32_t workerCount, uint32_t queueCapacity) {
+
+		mDevice = device;
+
+		// the calling thread is busy uploading, leave it a core
+		if (workerCount == 0) {
+			workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+		}
+
+		mWorkerCount = workerCount;
+		mQueueCapacity = std::max(1u, queueCapacity);
+	}
+
+	TextureLoader::~TextureLoader() {}
+
+	std::vector<Texture::Ptr> TextureLoader::load(const std::vector<Request>& requests) {
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::vector<Texture::Ptr> textures(requests.size());
+		if (requests.empty()) {
+			return textures;
+		}
+
+		// 1 Start the workers on a fresh queue
+		const uint32_t workerCount = static_cast<uint32_t>(std::min<size_t>(mWorkerCount, requests.size()));
+
+		mQueue.clear();
+		mNextRequest = 0;
+		mRunningWorkers = workerCount;
+		mAborted = false;
+		mError = nullptr;
+		mDecodeMs = 0.0;
+		mContentOwners.clear();
+		mStats = {};
+		mStats.workerCount = workerCount;
+
+		std::vector<std::thread> workers{};
+		for (uint32_t i = 0; i < workerCount; ++i) {
+			workers.emplace_back(&TextureLoader::decodeRequests, this, std::cref(requests));
+		}
+
+		// 2 Upload in the order the decodes finish
+		std::exception_ptr error = nullptr;
+		std::vector<std::pair<size_t, size_t>> aliases{};
+
+		try {
+
+			for (size_t received = 0; received < requests.size(); ++received) {
+
+				Decoded decoded{};
+				{
+					auto waitStart = std::chrono::steady_clock::now();
+
+					std::unique_lock<std::mutex> lock(mMutex);
+					mNotEmpty.wait(lock, [this] { return !mQueue.empty() || mError || mRunningWorkers == 0; });
+
+					mStats.waitMs += getMilliseconds(waitStart);
+
+					if (mError) {
+						std::rethrow_exception(mError);
+					}
+
+					if (mQueue.empty()) {
+						throw std::runtime_error("Error: texture workers stopped before every texture was decoded");
+					}
+
+					decoded = std::move(mQueue.front());
+					mQueue.pop_front();
+				}
+
+				mNotFull.notify_one();
+
+				if (decoded.aliasOf != SIZE_MAX) {
+					aliases.emplace_back(decoded.index, decoded.aliasOf);
+					continue;
+				}
+
+				auto uploadStart = std::chrono::steady_clock::now();
+				textures[decoded.index] = Texture::create(mDevice, decoded.data);
+				mStats.uploadMs += getMilliseconds(uploadStart);
+			}
+		}
+		catch (...) {
+			error = std::current_exception();
+		}
+
+		// 3 Release workers blocked on a full queue when we stopped early
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mAborted = true;
+		}
+
+		mNotFull.notify_all();
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+
+		mQueue.clear();
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		// 4 Every copy is recorded, submit the remainder so descriptors can be written against images in flight
+		auto uploadStart = std::chrono::steady_clock::now();
+		mDevice->getUploadManager()->flush();
+		mStats.uploadMs += getMilliseconds(uploadStart);
+
+		// 5 Duplicates share the texture of the first request with their contents. An owner found to
+		// be a duplicate only after its decode is followed to the texture it shares
+		std::vector<size_t> owners(requests.size(), SIZE_MAX);
+		for (const auto& [index, owner] : aliases) {
+			owners[index] = owner;
+		}
+
+		for (const auto& [index, first] : aliases) {
+
+			size_t owner = first;
+			while (owners[owner] != SIZE_MAX) {
+				owner = owners[owner];
+			}
+
+			textures[index] = textures[owner];
+
+			++mStats.duplicateCount;
+			mStats.duplicateBytes += textures[owner]->getImage()->getMemoryRequirements().size;
+		}
+
+		mStats.decodeMs = mDecodeMs;
+		mStats.totalMs = getMilliseconds(start);
+
+		return textures;
+	}
+
+	void TextureLoader::decodeRequests(const std::vector<Request>& requests) {
+
+		double decodeMs = 0.0;
+
+		while (true) {
+
+			size_t index = 0;
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+
+				if (mAborted || mError || mNextRequest >= requests.size()) {
+					break;
+				}
+
+				index = mNextRequest++;
+			}
+
+			try {
+
+				const auto& request = requests[index];
+
+				auto decodeStart = std::chrono::steady_clock::now();
+
+				// 1 Cached chains come straight from the mapping, the source is only read on a miss
+				TextureCache::Key cacheKey{};
+				TextureData data{};
+				uint64_t contentHash = 0;
+				uint64_t fileSize = 0;
+				bool cached = false;
+				std::vector<uint8_t> fileData{};
+
+				if (mCache) {
+					cacheKey = TextureCache::getKey(request.path, request.format, request.coverageChannel);
+					cached = mCache->find(cacheKey, data, contentHash);
+					fileSize = cacheKey.fileSize;
+				}
+
+				if (!cached) {
+					fileData = Texture::readFile(request.path);
+					contentHash = hashContent(fileData);
+					fileSize = fileData.size();
+				}
+
+				// 2 The first request with these contents decodes them, later ones only reference it
+				ContentKey key{ contentHash, fileSize, request.format, request.coverageChannel, request.maxExtent };
+				size_t aliasOf = SIZE_MAX;
+				{
+					std::lock_guard<std::mutex> lock(mMutex);
+
+					auto [owner, inserted] = mContentOwners.emplace(key, index);
+					if (!inserted) {
+						aliasOf = owner->second;
+					}
+
+					mStats.cachedCount += cached ? 1 : 0;
+				}
+
+				// 3 Decode, misses go into the cache with their full chain before levels are dropped
+				const bool decoded = aliasOf == SIZE_MAX && !cached;
+				if (decoded) {
+					data = Texture::decode(request.path, fileData, request.format, request.coverageChannel);
+				}
+
+				if (mCache && !cached) {
+					mCache->store(cacheKey, contentHash, decoded ? &data : nullptr);
+				}
+
+				// 4 A coverage channel that turned out uniform left the chain as it is without coverage,
+				// it is then shared with the requests for these contents that have none
+				if (aliasOf == SIZE_MAX && request.coverageChannel >= 0 && data.coverageChannel < 0) {
+
+					ContentKey plainKey{ contentHash, fileSize, request.format, -1, request.maxExtent };
+
+					std::lock_guard<std::mutex> lock(mMutex);
+
+					auto [owner, inserted] = mContentOwners.emplace(plainKey, index);
+					if (!inserted) {
+						aliasOf = owner->second;
+						data = {};
+					}
+				}
+
+				if (aliasOf == SIZE_MAX && request.maxExtent > 0) {
+
+					const auto& levels = data.mipChain.levels;
+
+					uint32_t dropCount = 0;
+					while (dropCount + 1 < levels.size() && std::max(levels[dropCount].width, levels[dropCount].height) > request.maxExtent) {
+						++dropCount;
+					}
+
+					Texture::dropLevels(data, dropCount);
+				}
+
+				fileData = {};
+				decodeMs += getMilliseconds(decodeStart);
+
+				std::unique_lock<std::mutex> lock(mMutex);
+				mNotFull.wait(lock, [this] { return mQueue.size() < mQueueCapacity || mAborted; });
+
+				if (mAborted) {
+					break;
+				}
+
+				mQueue.push_back({ index, aliasOf, std::move(data) });
+			}
+			catch (...) {
+
+				std::lock_guard<std::mutex> lock(mMutex);
+				if (!mError) {
+					mError = std::current_exception();
+				}
+				break;
+			}
+
+			mNotEmpty.notify_one();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mDecodeMs += decodeMs;
+			--mRunningWorkers;
+		}
+
+		mNotEmpty.notify_all();
+	}
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../../common.h"
+#include "texture.h"
+#include "texture_cache.h"
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <tuple>
+
+namespace lzvk::renderer {
+
+	// Loads many textures at once. Workers decode files into a bounded queue, the calling thread
+	// creates the images and records their uploads, which the UploadManager packs into large
+	// staging submissions. The queue bound caps how many decoded chains sit in memory.
+	// Requests are keyed by a hash of the file contents and the sampling format, files with the
+	// same contents under different paths are decoded once and share their texture. A request with
+	// a coverage channel that decodes without variation in it is shared with the requests for the
+	// same contents without one, that key is only known once the file is decoded. With a
+	// TextureCache set, cached chains skip reading and decoding the source and misses are stored
+	// in it with their full chain.
+	class TextureLoader {
+	public:
+
+		using Ptr = std::shared_ptr<TextureLoader>;
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, uint32_t workerCount = 0, uint32_t queueCapacity = 8) {
+			return std::make_shared<TextureLoader>(device, workerCount, queueCapacity);
+		}
+
+		struct Request {
+			std::string path{};
+			VkFormat format{ VK_FORMAT_R8G8B8A8_SRGB };
+			int coverageChannel{ -1 };
+
+			// Levels larger than this are dropped after decoding, 0 keeps the full chain
+			uint32_t maxExtent{ 0 };
+		};
+
+		// Timings of the last load in milliseconds. Decode is summed over the workers, wait is
+		// the time the calling thread spent on an empty queue
+		struct Stats {
+			double decodeMs{ 0.0 };
+			double uploadMs{ 0.0 };
+			double waitMs{ 0.0 };
+			double totalMs{ 0.0 };
+			uint32_t workerCount{ 0 };
+
+			// Requests whose contents matched an earlier one, and the image bytes they did not allocate
+			uint32_t duplicateCount{ 0 };
+			VkDeviceSize duplicateBytes{ 0 };
+
+			// Requests served from the TextureCache without decoding
+			uint32_t cachedCount{ 0 };
+		};
+
+		// workerCount 0 uses every hardware thread but one
+		TextureLoader(const lzvk::wrapper::Device::Ptr& device, uint32_t workerCount, uint32_t queueCapacity);
+		~TextureLoader();
+
+		// Textures come back in request order, duplicates point at the same texture.
+		// Their uploads are submitted before returning
+		std::vector<Texture::Ptr> load(const std::vector<Request>& requests);
+
+		// The cache has to outlive the load, the caller saves it once the textures are uploaded
+		void setCache(const TextureCache::Ptr& cache) { mCache = cache; }
+
+		[[nodiscard]] const auto& getStats() const { return mStats; }
+
+	private:
+
+		// Content hash, file size and how the texels are sampled
+		struct ContentKey {
+			uint64_t hash{ 0 };
+			size_t size{ 0 };
+			VkFormat format{ VK_FORMAT_UNDEFINED };
+			int coverageChannel{ -1 };
+			uint32_t maxExtent{ 0 };
+
+			bool operator<(const ContentKey& other) const {
+				return std::tie(hash, size, format, coverageChannel, maxExtent) < std::tie(other.hash, other.size, other.format, other.coverageChannel, other.maxExtent);
+			}
+		};
+
+		// aliasOf is set for duplicates, which carry no data
+		struct Decoded {
+			size_t index{ 0 };
+			size_t aliasOf{ SIZE_MAX };
+			TextureData data{};
+		};
+
+		void decodeRequests(const std::vector<Request>& requests);
+
+	private:
+
+		lzvk::wrapper::Device::Ptr mDevice{ nullptr };
+		uint32_t mWorkerCount{ 1 };
+		uint32_t mQueueCapacity{ 1 };
+		TextureCache::Ptr mCache{ nullptr };
+
+		// 1 Bounded queue between the workers and the uploading thread
+		std::mutex mMutex;
+		std::condition_variable mNotEmpty;
+		std::condition_variable mNotFull;
+		std::deque<Decoded> mQueue{};
+
+		// 2 Shared progress of one load
+		size_t mNextRequest{ 0 };
+		uint32_t mRunningWorkers{ 0 };
+		bool mAborted{ false };
+		std::exception_ptr mError{ nullptr };
+		double mDecodeMs{ 0.0 };
+		std::map<ContentKey, size_t> mContentOwners{};
+
+		Stats mStats{};
+	};
+}
@@ -0,0 +1,425 @@
+#include "texture_streamer.h"
+#include <algorithm>
+
+namespace lzvk::renderer {
+
+	namespace {
+
+		constexpr uint32_t NO_FEEDBACK = 0xFFFFFFFFu;
+	}
+
+	TextureStreamer::TextureStreamer(const lzvk::wrapper::Device::Ptr& device, int frameCount) {
+
+		mDevice = device;
+		mFrameCount = std::max(1, frameCount);
+		mBound.resize(mFrameCount);
+
+		mWorker = std::thread(&TextureStreamer::loadLevels, this);
+	}
+
+	TextureStreamer::~TextureStreamer() {
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStopping = true;
+		}
+
+		mWake.notify_all();
+
+		if (mWorker.joinable()) {
+			mWorker.join();
+		}
+	}
+
+	VkDeviceSize TextureStreamer::getImageBytes(const Texture::Ptr& texture) {
+
+		return texture ? texture->getImage()->getMemoryRequirements().size : 0;
+	}
+
+	void TextureStreamer::init(const std::vector<TextureLoader::Request>& requests, const std::vector<Texture::Ptr>& textures, uint32_t feedbackBinding,
+							   const TextureCache::Ptr& cache) {
+
+		mRequests = requests;
+		mCache = cache;
+		mResidents.assign(textures.size(), {});
+
+		// 1 Full level count of every chain, the tails know which level they start at
+		for (size_t i = 0; i < textures.size(); ++i) {
+
+			auto& resident = mResidents[i];
+			resident.tail = textures[i];
+			resident.texture = textures[i];
+			resident.levelCount = textures[i]->getFirstLevel() + textures[i]->getImage()->getMipLevels();
+			resident.wantedLevel = textures[i]->getFirstLevel();
+		}
+
+		for (auto& bound : mBound) {
+			bound = textures;
+		}
+
+		// 2 One slice per frame, aligned for the descriptor offset
+		VkPhysicalDeviceProperties props{};
+		vkGetPhysicalDeviceProperties(mDevice->getPhysicalDevice(), &props);
+
+		const VkDeviceSize alignment = std::max<VkDeviceSize>(props.limits.minStorageBufferOffsetAlignment, sizeof(uint32_t));
+		const VkDeviceSize sliceBytes = std::max<size_t>(textures.size(), 1) * sizeof(uint32_t);
+		mSliceStride = (sliceBytes + alignment - 1) / alignment * alignment;
+
+		mFeedbackBuffer = lzvk::wrapper::Buffer::create(
+			mDevice, mSliceStride * mFrameCount,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		mFeedback = static_cast<uint32_t*>(mFeedbackBuffer->mapPersistent());
+		std::fill(mFeedback, mFeedback + mSliceStride * mFrameCount / sizeof(uint32_t), NO_FEEDBACK);
+
+		mFeedbackParam = lzvk::wrapper::UniformParameter::create();
+		mFeedbackParam->mBinding = feedbackBinding;
+		mFeedbackParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		mFeedbackParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+		mFeedbackParam->mCount = 1;
+		mFeedbackParam->mSize = sliceBytes;
+		mFeedbackParam->mOffset = 0;
+		mFeedbackParam->mBuffers.push_back(mFeedbackBuffer);
+	}
+
+	void TextureStreamer::bindFeedback(const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet) {
+
+		for (int frame = 0; frame < mFrameCount; ++frame) {
+
+			VkDescriptorBufferInfo bufferInfo{};
+			bufferInfo.buffer = mFeedbackBuffer->getBuffer();
+			bufferInfo.offset = mSliceStride * frame;
+			bufferInfo.range = mFeedbackParam->mSize;
+
+			descriptorSet->setBuffer(frame, mFeedbackParam->mBinding, bufferInfo);
+			descriptorSet->commit(frame);
+		}
+	}
+
+	void TextureStreamer::recordFeedbackBarrier(VkCommandBuffer commandBuffer) const {
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer,
+							 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+							 VK_PIPELINE_STAGE_HOST_BIT,
+							 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void TextureStreamer::update(const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet, uint32_t textureBinding, int frameIndex) {
+
+		++mFrame;
+
+		// 1 Levels the last submission of this frame sampled
+		readFeedback(frameIndex);
+
+		// 2 Decoded levels become images, uploads that completed replace the resident texture
+		createLoaded();
+
+		// 3 Stay within the budget, then ask for what still fits
+		VkDeviceSize residentBytes = 0;
+		mStats.streamedCount = 0;
+
+		for (const auto& resident : mResidents) {
+
+			residentBytes += getImageBytes(resident.tail) + getImageBytes(resident.pending);
+
+			if (resident.texture != resident.tail) {
+				residentBytes += getImageBytes(resident.texture);
+				++mStats.streamedCount;
+			}
+		}
+
+		VkDeviceSize budget = getEffectiveBudget(residentBytes);
+
+		evict(residentBytes, budget);
+		requestLoads(residentBytes, budget);
+
+		mStats.residentBytes = residentBytes;
+		mStats.budgetBytes = budget;
+
+		// 4 Point the set of this frame at the current images, its previous submission is complete
+		auto& bound = mBound[frameIndex];
+
+		for (size_t i = 0; i < mResidents.size(); ++i) {
+
+			if (bound[i] != mResidents[i].texture) {
+
+				bound[i] = mResidents[i].texture;
+				descriptorSet->updateImageArrayElement(frameIndex, textureBinding, static_cast<uint32_t>(i), bound[i]->getImageInfo());
+			}
+		}
+	}
+
+	void TextureStreamer::readFeedback(int frameIndex) {
+
+		uint32_t* slice = mFeedback + mSliceStride / sizeof(uint32_t) * frameIndex;
+		const auto& bound = mBound[frameIndex];
+
+		mStats.requestedCount = 0;
+
+		for (size_t i = 0; i < mResidents.size(); ++i) {
+
+			if (slice[i] == NO_FEEDBACK) {
+				continue;
+			}
+
+			// the shaders measured against the image bound for that frame
+			auto& resident = mResidents[i];
+			int level = static_cast<int>(bound[i]->getFirstLevel()) + static_cast<int>(slice[i]) - static_cast<int>(TEXTURE_FEEDBACK_LEVEL_BIAS);
+			level = std::clamp(level, 0, static_cast<int>(resident.levelCount) - 1);
+
+			resident.wantedLevel = resident.lastUsedFrame == mFrame ? std::min<uint32_t>(resident.wantedLevel, level) : level;
+			resident.lastUsedFrame = mFrame;
+
+			slice[i] = NO_FEEDBACK;
+			++mStats.requestedCount;
+		}
+	}
+
+	void TextureStreamer::createLoaded() {
+
+		// 1 Images for the decoded levels, the copies share one upload batch per frame
+		std::vector<uint32_t> created{};
+		VkDeviceSize uploadedBytes = 0;
+
+		while (uploadedBytes < mUploadBytesPerFrame) {
+
+			Loaded loaded{};
+			{
+				std::lock_guard<std::mutex> lock(mMutex);
+
+				if (mLoaded.empty()) {
+					break;
+				}
+
+				loaded = std::move(mLoaded.front());
+				mLoaded.pop_front();
+			}
+
+			auto& resident = mResidents[loaded.index];
+			resident.loading = false;
+
+			if (loaded.failed) {
+				resident.failed = true;
+				continue;
+			}
+
+			// a finer chain arrived first
+			if (loaded.data.firstLevel >= resident.texture->getFirstLevel()) {
+				continue;
+			}
+
+			resident.pending = Texture::create(mDevice, loaded.data);
+			uploadedBytes += Texture::getDataSize(loaded.data);
+			created.push_back(loaded.index);
+		}
+
+		if (!created.empty()) {
+
+			uint64_t uploadValue = mDevice->getUploadManager()->flush();
+
+			for (auto index : created) {
+				mResidents[index].pendingUpload = uploadValue;
+			}
+		}
+
+		mStats.uploadedBytes = uploadedBytes;
+
+		// 2 Swap in what the transfer queue finished
+		for (auto& resident : mResidents) {
+
+			if (resident.pending && mDevice->getUploadManager()->isComplete(resident.pendingUpload)) {
+
+				resident.texture = resident.pending;
+				resident.pending = nullptr;
+			}
+		}
+	}
+
+	VkDeviceSize TextureStreamer::getEffectiveBudget(VkDeviceSize residentBytes) const {
+
+		VkDeviceSize budget = mBudget;
+
+		// Leave a tenth of the heap budget to everything else, other allocations shrink what we may keep
+		VkDeviceSize heapBudget = 0;
+		VkDeviceSize heapUsage = 0;
+
+		if (mDevice->getDeviceLocalMemoryBudget(heapBudget, heapUsage)) {
+
+			VkDeviceSize limit = heapBudget - heapBudget / 10;
+			VkDeviceSize others = heapUsage > residentBytes ? heapUsage - residentBytes : 0;
+
+			budget = std::min(budget, limit > others ? limit - others : 0);
+		}
+
+		return budget;
+	}
+
+	void TextureStreamer::evict(VkDeviceSize& residentBytes, VkDeviceSize budget) {
+
+		if (residentBytes <= budget) {
+			return;
+		}
+
+		// 1 Streamed textures the last update did not see, least recently sampled first. A pending
+		// image is only dropped once its upload completed, the transfer queue may still be writing it
+		std::vector<uint32_t> candidates{};
+
+		for (size_t i = 0; i < mResidents.size(); ++i) {
+
+			const auto& resident = mResidents[i];
+
+			if (resident.pending && !mDevice->getUploadManager()->isComplete(resident.pendingUpload)) {
+				continue;
+			}
+
+			if ((resident.texture != resident.tail || resident.pending) && resident.lastUsedFrame + mFrameCount < mFrame) {
+				candidates.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+			return mResidents[a].lastUsedFrame < mResidents[b].lastUsedFrame;
+		});
+
+		// 2 Back to the tails, the images go once no frame set references them
+		for (auto index : candidates) {
+
+			if (residentBytes <= budget) {
+				break;
+			}
+
+			auto& resident = mResidents[index];
+
+			if (resident.texture != resident.tail) {
+				residentBytes -= getImageBytes(resident.texture);
+			}
+
+			residentBytes -= getImageBytes(resident.pending);
+
+			resident.texture = resident.tail;
+			resident.pending = nullptr;
+			resident.wantedLevel = resident.tail->getFirstLevel();
+
+			++mStats.evictedCount;
+		}
+	}
+
+	void TextureStreamer::requestLoads(VkDeviceSize residentBytes, VkDeviceSize budget) {
+
+		// 1 Recently sampled textures that want finer levels than they hold
+		uint32_t loadingCount = 0;
+		std::vector<uint32_t> candidates{};
+
+		for (size_t i = 0; i < mResidents.size(); ++i) {
+
+			const auto& resident = mResidents[i];
+			loadingCount += resident.loading ? 1 : 0;
+
+			if (!resident.loading && !resident.failed && !resident.pending &&
+				resident.lastUsedFrame + 2 * mFrameCount >= mFrame &&
+				resident.wantedLevel < resident.texture->getFirstLevel()) {
+
+				candidates.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		mStats.loadingCount = loadingCount;
+
+		// the largest jumps in resolution first
+		std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+			uint32_t gapA = mResidents[a].texture->getFirstLevel() - mResidents[a].wantedLevel;
+			uint32_t gapB = mResidents[b].texture->getFirstLevel() - mResidents[b].wantedLevel;
+			return gapA > gapB;
+		});
+
+		// 2 Each finer level roughly quadruples the image, take the finest that fits the budget
+		bool requested = false;
+
+		for (auto index : candidates) {
+
+			if (loadingCount >= mMaxLoadsInFlight) {
+				break;
+			}
+
+			auto& resident = mResidents[index];
+
+			const uint32_t currentLevel = resident.texture->getFirstLevel();
+			const VkDeviceSize currentBytes = getImageBytes(resident.texture);
+			const VkDeviceSize replacedBytes = resident.texture != resident.tail ? currentBytes : 0;
+
+			for (uint32_t level = resident.wantedLevel; level < currentLevel; ++level) {
+
+				VkDeviceSize estimate = currentBytes << std::min(2 * (currentLevel - level), 40u);
+
+				if (residentBytes + estimate - replacedBytes > budget) {
+					continue;
+				}
+
+				residentBytes += estimate - replacedBytes;
+				resident.loading = true;
+				++loadingCount;
+
+				std::lock_guard<std::mutex> lock(mMutex);
+				mJobs.emplace_back(index, level);
+				requested = true;
+				break;
+			}
+		}
+
+		if (requested) {
+			mWake.notify_one();
+		}
+	}
+
+	void TextureStreamer::loadLevels() {
+
+		while (true) {
+
+			std::pair<uint32_t, uint32_t> job{};
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mWake.wait(lock, [this] { return mStopping || !mJobs.empty(); });
+
+				if (mStopping) {
+					break;
+				}
+
+				job = mJobs.front();
+				mJobs.pop_front();
+			}
+
+			// Cached chains are read from the mapping, otherwise baked chains are copied as stored and
+			// sources are decoded and filtered again
+			Loaded loaded{};
+			loaded.index = job.first;
+
+			try {
+
+				const auto& request = mRequests[job.first];
+				uint64_t contentHash = 0;
+
+				bool cached = mCache && mCache->find(TextureCache::getKey(request.path, request.format, request.coverageChannel), loaded.data, contentHash);
+				if (!cached) {
+					loaded.data = Texture::decode(request.path, request.format, request.coverageChannel);
+				}
+
+				Texture::dropLevels(loaded.data, job.second);
+			}
+			catch (const std::exception& e) {
+
+				printf("[TextureStreamer] %s, keeping the resident levels\n", e.what());
+				loaded.failed = true;
+			}
+
+			std::lock_guard<std::mutex> lock(mMutex);
+			mLoaded.push_back(std::move(loaded));
+		}
+	}
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "../../common.h"
+#include "texture.h"
+#include "texture_loader.h"
+#include "../../wrapper/buffer.h"
+#include "../../wrapper/description.h"
+#include "../../wrapper/descriptor_set.h"
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace lzvk::renderer {
+
+	// Feedback levels are written biased so magnified textures stay positive, must match the scene shaders
+	constexpr uint32_t TEXTURE_FEEDBACK_LEVEL_BIAS = 16;
+
+	// Keeps scene textures resident only at the mip levels the frame samples. Textures start with
+	// their tail levels, the scene shaders write the finest level they need per texture into a
+	// feedback slice of the frame. A background thread reads the missing levels from the
+	// TextureCache, or decodes them on a miss, and the calling thread swaps the larger images into
+	// the descriptor set of each frame once their upload completed. Resident images stay within
+	// the budget, the least recently sampled textures fall back to their tails first.
+	class TextureStreamer {
+	public:
+
+		using Ptr = std::shared_ptr<TextureStreamer>;
+		static Ptr create(const lzvk::wrapper::Device::Ptr& device, int frameCount) {
+			return std::make_shared<TextureStreamer>(device, frameCount);
+		}
+
+		struct Stats {
+			VkDeviceSize residentBytes{ 0 };
+			VkDeviceSize budgetBytes{ 0 };
+			VkDeviceSize uploadedBytes{ 0 };
+			uint32_t streamedCount{ 0 };
+			uint32_t loadingCount{ 0 };
+			uint32_t requestedCount{ 0 };
+			uint32_t evictedCount{ 0 };
+		};
+
+		TextureStreamer(const lzvk::wrapper::Device::Ptr& device, int frameCount);
+		~TextureStreamer();
+
+		// textures hold the tails loaded from requests, both indexed like the texture array.
+		// cache may be nullptr, finer levels are then decoded from the request files
+		void init(const std::vector<TextureLoader::Request>& requests, const std::vector<Texture::Ptr>& textures, uint32_t feedbackBinding,
+				  const TextureCache::Ptr& cache);
+
+		// Each frame of the set writes its own slice of the feedback buffer
+		void bindFeedback(const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet);
+
+		// Called once the fence of frameIndex signalled, before its commands are recorded
+		void update(const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet, uint32_t textureBinding, int frameIndex);
+
+		// Makes the shader writes of the frame visible to the host read after its fence
+		void recordFeedbackBarrier(VkCommandBuffer commandBuffer) const;
+
+		void setBudget(VkDeviceSize budget) { mBudget = budget; }
+
+		[[nodiscard]] auto getBudget() const { return mBudget; }
+		[[nodiscard]] auto getFeedbackParam() const { return mFeedbackParam; }
+		[[nodiscard]] const auto& getStats() const { return mStats; }
+
+	private:
+
+		struct Resident {
+			Texture::Ptr tail{ nullptr };
+			Texture::Ptr texture{ nullptr };
+			Texture::Ptr pending{ nullptr };
+			uint64_t pendingUpload{ 0 };
+
+			uint32_t levelCount{ 1 };
+			uint32_t wantedLevel{ 0 };
+			uint64_t lastUsedFrame{ 0 };
+			bool loading{ false };
+			bool failed{ false };
+		};
+
+		struct Loaded {
+			uint32_t index{ 0 };
+			bool failed{ false };
+			TextureData data{};
+		};
+
+		void readFeedback(int frameIndex);
+		void createLoaded();
+		void evict(VkDeviceSize& residentBytes, VkDeviceSize budget);
+		void requestLoads(VkDeviceSize residentBytes, VkDeviceSize budget);
+		VkDeviceSize getEffectiveBudget(VkDeviceSize residentBytes) const;
+		void loadLevels();
+
+		static VkDeviceSize getImageBytes(const Texture::Ptr& texture);
+
+	private:
+
+		lzvk::wrapper::Device::Ptr mDevice{ nullptr };
+		int mFrameCount{ 1 };
+		uint64_t mFrame{ 0 };
+
+		// 1 Settings
+		VkDeviceSize mBudget{ 512ull * 1024 * 1024 };
+		VkDeviceSize mUploadBytesPerFrame{ 32ull * 1024 * 1024 };
+		uint32_t mMaxLoadsInFlight{ 4 };
+
+		// 2 Textures, requests say where the rest of each chain is read from
+		std::vector<TextureLoader::Request> mRequests{};
+		std::vector<Resident> mResidents{};
+		TextureCache::Ptr mCache{ nullptr };
+
+		// What the set of each frame points at, old images live until no frame references them
+		std::vector<std::vector<Texture::Ptr>> mBound{};
+
+		// 3 Per frame feedback slices, host visible and read after the fence of the frame
+		lzvk::wrapper::Buffer::Ptr mFeedbackBuffer{ nullptr };
+		uint32_t* mFeedback{ nullptr };
+		VkDeviceSize mSliceStride{ 0 };
+		lzvk::wrapper::UniformParameter::Ptr mFeedbackParam{ nullptr };
+
+		// 4 Background decoding
+		std::thread mWorker;
+		std::mutex mMutex;
+		std::condition_variable mWake;
+		std::deque<std::pair<uint32_t, uint32_t>> mJobs{};
+		std::deque<Loaded> mLoaded{};
+		bool mStopping{ false };
+
+		Stats mStats{};
+	};
+}
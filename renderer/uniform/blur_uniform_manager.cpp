@@ -58,9 +58,10 @@ namespace lzvk::renderer {
         mOutputAOParam->mImageInfos[0].imageView = outputAO->getImageView();
         mOutputAOParam->mImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mDepthParam->mBinding, mDepthParam->mImageInfos[0]);
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mInputAOParam->mBinding, mInputAOParam->mImageInfos[0]);
-        descriptorSet->updateStorageImage(descriptorSet->getDescriptorSet(frameCount), mOutputAOParam->mBinding, mOutputAOParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mDepthParam->mBinding, mDepthParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mInputAOParam->mBinding, mInputAOParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mOutputAOParam->mBinding, mOutputAOParam->mImageInfos[0]);
+        descriptorSet->commit(frameCount);
     }
 
 }
@@ -43,8 +43,9 @@ namespace lzvk::renderer {
         mAOParam->mImageInfos[0].imageView = aoTexture->getImageView();
         mAOParam->mImageInfos[0].sampler = aoTexture->getSampler();
 
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mColorParam->mBinding, mColorParam->mImageInfos[0]);
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mAOParam->mBinding, mAOParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mColorParam->mBinding, mColorParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mAOParam->mBinding, mAOParam->mImageInfos[0]);
+        descriptorSet->commit(frameCount);
     }
 
     std::vector<wrapper::UniformParameter::Ptr> CombineUniformManager::getParams() const {
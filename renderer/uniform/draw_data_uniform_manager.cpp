@@ -16,7 +16,7 @@ namespace lzvk::renderer {
         mDrawDataParam = lzvk::wrapper::UniformParameter::create();
         mDrawDataParam->mBinding = 4;
         mDrawDataParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        mDrawDataParam->mStage = VK_SHADER_STAGE_VERTEX_BIT;
+        mDrawDataParam->mStage = device->getGeometryShaderStages() | VK_SHADER_STAGE_COMPUTE_BIT;
         mDrawDataParam->mCount = 1;
         mDrawDataParam->mSize = sizeof(lzvk::loader::DrawData) * drawCount;
 
@@ -5,57 +5,75 @@ namespace lzvk::renderer {
     FrameUniformManager::FrameUniformManager(){}
     FrameUniformManager::~FrameUniformManager(){}
 
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
     void FrameUniformManager::init(const lzvk::wrapper::Device::Ptr& device, int frameCount) {
        
         mDevice = device;
 
+        // 1 Slice layout, every block starts at the dynamic offset alignment
+        VkPhysicalDeviceProperties props{};
+        vkGetPhysicalDeviceProperties(device->getPhysicalDevice(), &props);
+        VkDeviceSize alignment = std::max<VkDeviceSize>(props.limits.minUniformBufferOffsetAlignment, 16);
+
+        VkDeviceSize lightOffset = alignUp(sizeof(lzvk::core::VPMatrices), alignment);
+        mSliceSize = alignUp(lightOffset + sizeof(lzvk::core::VPMatrices), alignment);
+
+        // 2 Host visible ring, mapped once by the allocator
+        mRingBuffer = lzvk::wrapper::Buffer::createUniformBuffer(device, mSliceSize * frameCount, nullptr);
+        mRingData = static_cast<uint8_t*>(mRingBuffer->mapPersistent());
+
+        // 3 Camera and light matrices share the ring
         mVpParam = lzvk::wrapper::UniformParameter::create();
         mVpParam->mBinding = 0;
-        mVpParam->mDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        mVpParam->mStage = VK_SHADER_STAGE_VERTEX_BIT;
+        mVpParam->mDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        mVpParam->mStage = device->getGeometryShaderStages() | VK_SHADER_STAGE_COMPUTE_BIT;
         mVpParam->mCount = 1;
         mVpParam->mSize = sizeof(lzvk::core::VPMatrices);
+        mVpParam->mOffset = 0;
+        mVpParam->mBuffers.push_back(mRingBuffer);
+
+        mLightVpParam = lzvk::wrapper::UniformParameter::create();
+        mLightVpParam->mBinding = 1;
+        mLightVpParam->mDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        mLightVpParam->mStage = device->getGeometryShaderStages() | VK_SHADER_STAGE_COMPUTE_BIT;
+        mLightVpParam->mCount = 1;
+        mLightVpParam->mSize = sizeof(lzvk::core::VPMatrices);
+        mLightVpParam->mOffset = lightOffset;
+        mLightVpParam->mBuffers.push_back(mRingBuffer);
 
         for (int i = 0; i < frameCount; ++i) {
 
-            auto buffer = lzvk::wrapper::Buffer::createUniformBuffer(device, mVpParam->mSize, nullptr);
-            mVpParam->mBuffers.push_back(buffer);
+            uint32_t sliceOffset = static_cast<uint32_t>(mSliceSize * i);
+            mDynamicOffsets.push_back({ sliceOffset, sliceOffset });
         }
     }
 
-    void FrameUniformManager::update(const glm::mat4& view, const glm::mat4& projection, const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet, int frameIndex) {
-        
+    void FrameUniformManager::write(VkDeviceSize offset, const glm::mat4& view, const glm::mat4& projection, int frameIndex) {
+
         lzvk::core::VPMatrices vp{};
         vp.mViewMatrix = view;
         vp.mProjectionMatrix = projection;
 
-        mVpParam->mBuffers[frameIndex]->updateBufferByMap(&vp, sizeof(lzvk::core::VPMatrices));
-
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = mVpParam->mBuffers[frameIndex]->getBuffer();
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(lzvk::core::VPMatrices);
-
-        VkWriteDescriptorSet write{};
-        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write.dstSet = descriptorSet->getDescriptorSet(frameIndex);
-        write.dstBinding = mVpParam->mBinding;
-        write.dstArrayElement = 0;
-        write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        write.descriptorCount = 1;
-        write.pBufferInfo = &bufferInfo;
-
-        vkUpdateDescriptorSets(
-            mDevice->getDevice(),
-            1,
-            &write,
-            0,
-            nullptr);
+        memcpy(mRingData + mSliceSize * frameIndex + offset, &vp, sizeof(lzvk::core::VPMatrices));
+    }
+
+    void FrameUniformManager::update(const glm::mat4& view, const glm::mat4& projection, int frameIndex) {
+        
+        write(mVpParam->mOffset, view, projection, frameIndex);
+    }
+
+    void FrameUniformManager::updateLight(const glm::mat4& view, const glm::mat4& projection, int frameIndex) {
+
+        write(mLightVpParam->mOffset, view, projection, frameIndex);
     }
 
     std::vector<lzvk::wrapper::UniformParameter::Ptr> FrameUniformManager::getParams() const {
        
-        return { mVpParam };
+        return { mVpParam, mLightVpParam };
     }
 
 }
@@ -9,6 +9,8 @@
 
 namespace lzvk::renderer {
 
+    // Per frame data lives in one persistently mapped ring, one slice per frame in flight.
+    // The frame set is written once and bound with a dynamic offset selecting the slice.
     class FrameUniformManager {
     public:
         using Ptr = std::shared_ptr<FrameUniformManager>;
@@ -18,14 +20,29 @@ namespace lzvk::renderer {
         ~FrameUniformManager();
 
         void init(const lzvk::wrapper::Device::Ptr& device, int frameCount);
-        void update(const glm::mat4& view, const glm::mat4& projection, const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet, int frameIndex);
+        void update(const glm::mat4& view, const glm::mat4& projection, int frameIndex);
+        void updateLight(const glm::mat4& view, const glm::mat4& projection, int frameIndex);
 
         std::vector<lzvk::wrapper::UniformParameter::Ptr> getParams() const;
 
+        // one offset per dynamic binding of the frame set
+        [[nodiscard]] const std::vector<uint32_t>& getDynamicOffsets(int frameIndex) const { return mDynamicOffsets[frameIndex]; }
+
+    private:
+
+        void write(VkDeviceSize offset, const glm::mat4& view, const glm::mat4& projection, int frameIndex);
+
     private:
 
         lzvk::wrapper::Device::Ptr mDevice{ nullptr };
+        lzvk::wrapper::Buffer::Ptr mRingBuffer{ nullptr };
+        uint8_t* mRingData{ nullptr };
+        VkDeviceSize mSliceSize{ 0 };
+
         lzvk::wrapper::UniformParameter::Ptr mVpParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mLightVpParam{ nullptr };
+
+        std::vector<std::vector<uint32_t>> mDynamicOffsets{};
     };
 
-}
\ No newline at end of file
+}
@@ -46,7 +46,7 @@ namespace lzvk::renderer {
         mMaterialParam = lzvk::wrapper::UniformParameter::create();
         mMaterialParam->mBinding = 2;
         mMaterialParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        mMaterialParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        mMaterialParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
         mMaterialParam->mCount = 1;
         mMaterialParam->mSize = sizeof(GpuMaterial) * materialCount;
 
@@ -0,0 +1,55 @@
+#include "meshlet_uniform_manager.h"
+
+namespace lzvk::renderer {
+
+    MeshletUniformManager::MeshletUniformManager() {}
+    MeshletUniformManager::~MeshletUniformManager() {}
+
+    void MeshletUniformManager::init(const lzvk::wrapper::Device::Ptr& device,
+        const lzvk::wrapper::Buffer::Ptr& vertexBuffer,
+        size_t vertexBufferSize,
+        const lzvk::tools::MeshletData& meshletData,
+        const std::vector<MeshletInstance>& instances) {
+
+        mDevice = device;
+
+        // 1 the vertex buffer is shared with the indirect path
+        mVertexParam = lzvk::wrapper::UniformParameter::create();
+        mVertexParam->mBinding = 5;
+        mVertexParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        mVertexParam->mStage = VK_SHADER_STAGE_MESH_BIT_EXT;
+        mVertexParam->mCount = 1;
+        mVertexParam->mSize = vertexBufferSize;
+        mVertexParam->mBuffers.push_back(vertexBuffer);
+
+        // 2 meshlet tables
+        mMeshletParam = createParam(6, sizeof(lzvk::tools::Meshlet) * meshletData.meshlets.size(), meshletData.meshlets.data());
+        mMeshletVertexParam = createParam(7, sizeof(uint32_t) * meshletData.meshletVertices.size(), meshletData.meshletVertices.data());
+        mMeshletTriangleParam = createParam(8, sizeof(uint32_t) * meshletData.meshletTriangles.size(), meshletData.meshletTriangles.data());
+        mInstanceParam = createParam(9, sizeof(MeshletInstance) * instances.size(), instances.data());
+    }
+
+    lzvk::wrapper::UniformParameter::Ptr MeshletUniformManager::createParam(uint32_t binding, size_t size, const void* data) {
+
+        auto param = lzvk::wrapper::UniformParameter::create();
+        param->mBinding = binding;
+        param->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        param->mStage = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+        param->mCount = 1;
+        param->mSize = std::max<size_t>(size, sizeof(uint32_t));
+
+        auto buffer = lzvk::wrapper::Buffer::createStorageBuffer(
+            mDevice,
+            param->mSize,
+            size > 0 ? data : nullptr,
+            false
+        );
+        param->mBuffers.push_back(buffer);
+
+        return param;
+    }
+
+    std::vector<lzvk::wrapper::UniformParameter::Ptr> MeshletUniformManager::getParams() const {
+        return { mVertexParam, mMeshletParam, mMeshletVertexParam, mMeshletTriangleParam, mInstanceParam };
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../../common.h"
+#include "../../wrapper/device.h"
+#include "../../wrapper/buffer.h"
+#include "../../wrapper/description.h"
+#include "../../wrapper/descriptor_set.h"
+#include "../../tools/meshlet.h"
+
+namespace lzvk::renderer {
+
+    // One task shader invocation per instance, x = draw data index, y = meshlet index
+    struct MeshletInstance {
+        uint32_t drawIndex = 0;
+        uint32_t meshletIndex = 0;
+    };
+
+    class MeshletUniformManager {
+    public:
+
+        using Ptr = std::shared_ptr<MeshletUniformManager>;
+        static Ptr create() { return std::make_shared<MeshletUniformManager>(); }
+
+        MeshletUniformManager();
+        ~MeshletUniformManager();
+
+        void init(const lzvk::wrapper::Device::Ptr& device,
+            const lzvk::wrapper::Buffer::Ptr& vertexBuffer,
+            size_t vertexBufferSize,
+            const lzvk::tools::MeshletData& meshletData,
+            const std::vector<MeshletInstance>& instances);
+
+        std::vector<lzvk::wrapper::UniformParameter::Ptr> getParams() const;
+
+    private:
+
+        lzvk::wrapper::UniformParameter::Ptr createParam(uint32_t binding, size_t size, const void* data);
+
+    private:
+
+        lzvk::wrapper::Device::Ptr mDevice{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mVertexParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mMeshletParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mMeshletVertexParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mMeshletTriangleParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mInstanceParam{ nullptr };
+    };
+}
@@ -14,99 +14,281 @@ namespace lzvk::renderer{
         mDevice = device;
         mCommandPool = commandPool;
 
-        //
-        // Load diffuse textures
-        //
-        std::vector<Texture::Ptr> diffuseTextures;
-        for (const auto& texPath : meshData.diffuseTextureFiles) {
-          /*  std::cout << "[SceneTextureManager] Loading diffuse texture: " << texPath << std::endl;*/
-            auto tex = std::make_shared<Texture>(
-                mDevice,
-                mCommandPool,
-                texPath
-            );
-            diffuseTextures.push_back(tex);
-        }
-
-        mSceneDiffuseTexturesParam = loadTextureParam(
-            diffuseTextures,
-            0,
-            static_cast<uint32_t>(diffuseTextures.size())
-        );
+        // 1 Per slot file lists, normal maps hold vectors and are sampled without sRGB decode
+        const std::vector<std::string>* slotFiles[] = {
+            &meshData.diffuseTextureFiles,
+            &meshData.emissiveTextureFiles,
+            &meshData.normalTextureFiles,
+            &meshData.opacityTextureFiles,
+            &meshData.specularTextureFiles
+        };
+
+        const VkFormat slotFormats[] = {
+            VK_FORMAT_R8G8B8A8_SRGB,
+            VK_FORMAT_R8G8B8A8_SRGB,
+            VK_FORMAT_R8G8B8A8_UNORM,
+            VK_FORMAT_R8G8B8A8_SRGB,
+            VK_FORMAT_R8G8B8A8_SRGB
+        };
+
+        // Channels the alpha test reads, their mips keep the coverage of level 0
+        const int slotCoverageChannels[] = { 3, -1, -1, 0, -1 };
 
+        // Block format family of the baked copies, specular holds colors and is baked like one
+        const lzvk::tools::TextureKind slotKinds[] = {
+            lzvk::tools::TextureKind::Color,
+            lzvk::tools::TextureKind::Color,
+            lzvk::tools::TextureKind::Normal,
+            lzvk::tools::TextureKind::Mask,
+            lzvk::tools::TextureKind::Color
+        };
 
-        // Load emissive textures
-        std::vector<Texture::Ptr> emissiveTextures;
-        for (const auto& texPath : meshData.emissiveTextureFiles) {
-       /*     std::cout << "[SceneTextureManager] Loading emissive texture: " << texPath << std::endl;*/
-            auto tex = std::make_shared<Texture>(
-                mDevice,
-                mCommandPool,
-                texPath
-            );
-            emissiveTextures.push_back(tex);
+        // 2 Global index 0 is the dummy texture, shared by every slot
+        if (!meshData.diffuseTextureFiles.empty()) {
+            addTexture(meshData.diffuseTextureFiles[0], slotFormats[0], slotCoverageChannels[0], slotKinds[0]);
         }
 
-        mSceneEmissiveTexturesParam = loadTextureParam(
-            emissiveTextures,
-            0,
-            static_cast<uint32_t>(emissiveTextures.size())
-        );
+        // 3 Files used by several slots with the same format and coverage channel are requested once
+        for (size_t slot = 0; slot < mGlobalIndices.size(); ++slot) {
 
+            const auto& files = *slotFiles[slot];
+            auto& indices = mGlobalIndices[slot];
+            indices.resize(files.size(), 0);
 
-        // Load normal textures
-        std::vector<Texture::Ptr> normalTextures;
-        for (const auto& texPath : meshData.normalTextureFiles) {
-       /*     std::cout << "[SceneTextureManager] Loading normal texture: " << texPath << std::endl;*/
-            auto tex = std::make_shared<Texture>(
-                mDevice,
-                mCommandPool,
-                texPath,
-                VK_FORMAT_R8G8B8A8_UNORM);
-            normalTextures.push_back(tex);
+            for (size_t i = 1; i < files.size(); ++i) {
+                indices[i] = addTexture(files[i], slotFormats[slot], slotCoverageChannels[slot], slotKinds[slot]);
+            }
         }
 
-        mSceneNormalTexturesParam = loadTextureParam(
-            normalTextures,
-            0,
-            static_cast<uint32_t>(normalTextures.size())
-        );
+        // 4 Decode on the workers and upload, the descriptor array is written once every upload is submitted.
+        // Chains in the texture cache skip the decode, the cache is rewritten when anything was missing
+        mCache = TextureCache::create(SCENE_TEXTURE_CACHE_PATH);
 
-        // Load opacity textures
-        std::vector<Texture::Ptr> opacityTextures;
-        for (const auto& texPath : meshData.opacityTextureFiles) {
-            /*     std::cout << "[SceneTextureManager] Loading normal texture: " << texPath << std::endl;*/
-            auto tex = std::make_shared<Texture>(
-                mDevice,
-                mCommandPool,
-                texPath
-            );
-            opacityTextures.push_back(tex);
-        }
-
-        mSceneOpacityTexturesParam = loadTextureParam(
-            opacityTextures,
-            0,
-            static_cast<uint32_t>(opacityTextures.size())
-        );
+        auto loader = TextureLoader::create(mDevice);
+        loader->setCache(mCache);
+
+        auto loaded = loader->load(mRequests);
+        mCache->save();
+
+        // 5 Requests with the same contents came back as one texture, keep it once in the array.
+        // Walking in request order keeps the dummy at index 0
+        std::unordered_map<Texture*, uint32_t> uniqueIndices{};
+        std::vector<uint32_t> requestToUnique(loaded.size(), 0);
+        std::vector<TextureLoader::Request> uniqueRequests{};
+        mTextures.clear();
 
-        // load specular textures
-        std::vector<Texture::Ptr> specularTextures;
-        for (const auto& texPath : meshData.specularTextureFiles) {
+        for (size_t i = 0; i < loaded.size(); ++i) {
+
+            auto [it, inserted] = uniqueIndices.emplace(loaded[i].get(), static_cast<uint32_t>(mTextures.size()));
+            if (inserted) {
+                mTextures.push_back(loaded[i]);
+                uniqueRequests.push_back(mRequests[i]);
+            }
 
-            auto tex = std::make_shared<Texture>(
-                mDevice,
-                mCommandPool,
-                texPath
-            );
-            specularTextures.push_back(tex);
+            requestToUnique[i] = it->second;
         }
 
-        mSceneSpecularTexturesParam = loadTextureParam(
-            specularTextures,
-            0,
-            static_cast<uint32_t>(specularTextures.size())
+        for (auto& indices : mGlobalIndices) {
+            for (auto& index : indices) {
+                index = index < requestToUnique.size() ? requestToUnique[index] : 0;
+            }
+        }
+
+        mRequests.clear();
+
+        // What one image per slot reference would have allocated
+        VkDeviceSize uniqueBytes = 0;
+        for (const auto& texture : mTextures) {
+            uniqueBytes += texture->getImage()->getMemoryRequirements().size;
+        }
+
+        VkDeviceSize referencedBytes = 0;
+        for (const auto& indices : mGlobalIndices) {
+            for (auto index : indices) {
+                if (index < mTextures.size()) {
+                    referencedBytes += mTextures[index]->getImage()->getMemoryRequirements().size;
+                }
+            }
+        }
+
+        mDuplicateBytes = referencedBytes > uniqueBytes ? referencedBytes - uniqueBytes : 0;
+
+        // 6 Small textures become layers of array images
+        const size_t unpackedCount = mTextures.size();
+        packTextureArrays(uniqueRequests);
+
+        // 7 Finer levels are streamed in from the same files
+        mStreamer = TextureStreamer::create(mDevice, frameCount);
+        mStreamer->init(uniqueRequests, mTextures, SCENE_TEXTURE_FEEDBACK_BINDING, mCache);
+
+        mSceneTexturesParam = loadTextureParam(
+            mTextures,
+            SCENE_TEXTURE_BINDING,
+            static_cast<uint32_t>(mTextures.size())
         );
+
+        size_t requested = 0;
+        for (const auto* files : slotFiles) {
+            requested += files->size();
+        }
+
+        VkDeviceSize imageBytes = 0;
+        for (const auto& texture : mTextures) {
+            imageBytes += texture->getImage()->getMemoryRequirements().size;
+        }
+
+        const auto& stats = loader->getStats();
+
+        printf("[SceneTextureManager] %zu textures in one array (%zu slot references)\n", mTextures.size(), requested);
+        printf("[SceneTextureManager] %u small textures packed into %u array images, %zu images before packing, %zu after\n",
+               mPackedCount, mArrayCount, unpackedCount, mTextures.size());
+        printf("[SceneTextureManager] %u files matched by contents, %.1f MB of duplicate images eliminated\n",
+               stats.duplicateCount, mDuplicateBytes / (1024.0 * 1024.0));
+        printf("[SceneTextureManager] %u baked, %.1f MB of mip tails up to %u texels, loaded in %.0f ms\n", mBakedCount, imageBytes / (1024.0 * 1024.0), SCENE_TEXTURE_TAIL_EXTENT, stats.totalMs);
+        printf("[SceneTextureManager] decode %.0f ms over %u workers, upload %.0f ms, waiting on decodes %.0f ms\n",
+               stats.decodeMs, stats.workerCount, stats.uploadMs, stats.waitMs);
+        printf("[SceneTextureManager] %u of %zu requests read from the texture cache (%s start)\n",
+               stats.cachedCount, loaded.size(), stats.cachedCount == loaded.size() ? "warm" : "cold");
+    }
+
+    uint32_t SceneTextureManager::addTexture(const std::string& sourcePath, VkFormat format, int coverageChannel, lzvk::tools::TextureKind kind) {
+
+        // 1 Prefer the block compressed copy written by TextureBaker
+        bool baked = mDevice->isTextureCompressionBCSupported() && lzvk::tools::isBakedTextureCurrent(sourcePath, kind);
+        const std::string path = baked ? lzvk::tools::getBakedTexturePath(sourcePath, kind) : sourcePath;
+
+        // Same path and sampling, contents are compared by the loader
+        std::string key = path + "#" + std::to_string(static_cast<uint32_t>(format)) + "#" + std::to_string(coverageChannel);
+
+        auto it = mTextureIndices.find(key);
+        if (it != mTextureIndices.end()) {
+            return it->second;
+        }
+
+        uint32_t index = static_cast<uint32_t>(mRequests.size());
+        mRequests.push_back({ path, format, coverageChannel, SCENE_TEXTURE_TAIL_EXTENT });
+        mTextureIndices[key] = index;
+        mBakedCount += baked ? 1 : 0;
+
+        return index;
+    }
+
+    void SceneTextureManager::packTextureArrays(std::vector<TextureLoader::Request>& requests) {
+
+        // 1 Textures holding their whole chain are candidates, the dummy at 0 keeps its own image
+        std::vector<lzvk::tools::TextureShape> shapes(mTextures.size());
+
+        for (size_t i = 1; i < mTextures.size(); ++i) {
+
+            const auto& image = mTextures[i]->getImage();
+
+            if (mTextures[i]->getFirstLevel() == 0) {
+                shapes[i] = { image->getFormat(), static_cast<uint32_t>(image->getWidth()), static_cast<uint32_t>(image->getHeight()), image->getMipLevels() };
+            }
+        }
+
+        auto plans = lzvk::tools::planTextureArrays(shapes, SCENE_TEXTURE_ARRAY_MAX_LAYERS);
+
+        // 2 Layers are uploaded again from the texture cache, textures it can't serve keep their image
+        std::vector<uint32_t> arrayOf(mTextures.size(), UINT32_MAX);
+        std::vector<uint32_t> layerOf(mTextures.size(), 0);
+        std::vector<Texture::Ptr> arrays{};
+        std::vector<TextureLoader::Request> arrayRequests{};
+
+        for (const auto& plan : plans) {
+
+            std::vector<TextureData> layers{};
+            std::vector<uint32_t> members{};
+
+            for (uint32_t index : plan.layers) {
+
+                const auto& request = requests[index];
+
+                TextureData data{};
+                uint64_t contentHash = 0;
+
+                if (mCache->find(TextureCache::getKey(request.path, request.format, request.coverageChannel), data, contentHash) &&
+                    data.mipChain.levels.size() == plan.shape.levelCount) {
+                    layers.push_back(std::move(data));
+                    members.push_back(index);
+                }
+            }
+
+            if (layers.size() < 2) {
+                continue;
+            }
+
+            for (uint32_t layer = 0; layer < members.size(); ++layer) {
+                arrayOf[members[layer]] = static_cast<uint32_t>(arrays.size());
+                layerOf[members[layer]] = layer;
+            }
+
+            arrays.push_back(Texture::create(mDevice, layers));
+            arrayRequests.push_back(requests[members[0]]);
+        }
+
+        if (arrays.empty()) {
+            return;
+        }
+
+        // 3 The separate images may still be read by their uploads
+        mDevice->getUploadManager()->flush();
+        mDevice->getUploadManager()->waitIdle();
+
+        // 4 Unpacked textures keep their order, the arrays follow them
+        std::vector<Texture::Ptr> textures{};
+        std::vector<TextureLoader::Request> keptRequests{};
+        std::vector<uint32_t> remap(mTextures.size(), 0);
+
+        for (size_t i = 0; i < mTextures.size(); ++i) {
+            if (arrayOf[i] == UINT32_MAX) {
+                remap[i] = static_cast<uint32_t>(textures.size());
+                textures.push_back(mTextures[i]);
+                keptRequests.push_back(requests[i]);
+            }
+        }
+
+        const uint32_t firstArray = static_cast<uint32_t>(textures.size());
+        textures.insert(textures.end(), arrays.begin(), arrays.end());
+        keptRequests.insert(keptRequests.end(), arrayRequests.begin(), arrayRequests.end());
+
+        for (size_t i = 0; i < mTextures.size(); ++i) {
+            if (arrayOf[i] != UINT32_MAX) {
+                remap[i] = SCENE_TEXTURE_ARRAY_BIT | (layerOf[i] << SCENE_TEXTURE_LAYER_SHIFT) | (firstArray + arrayOf[i]);
+                ++mPackedCount;
+            }
+        }
+
+        for (auto& indices : mGlobalIndices) {
+            for (auto& index : indices) {
+                index = index < remap.size() ? remap[index] : 0;
+            }
+        }
+
+        mTextures = std::move(textures);
+        requests = std::move(keptRequests);
+        mArrayCount = static_cast<uint32_t>(arrays.size());
+    }
+
+    uint32_t SceneTextureManager::getGlobalIndex(SceneTextureSlot slot, uint32_t localIndex) const {
+
+        const auto& indices = mGlobalIndices[static_cast<size_t>(slot)];
+
+        // missing textures, including the -1 marker, fall back to the dummy
+        if (localIndex >= indices.size()) {
+            return 0;
+        }
+
+        return indices[localIndex];
+    }
+
+    void SceneTextureManager::remapMaterial(lzvk::loader::Material& material) const {
+
+        material.baseColorTexture = getGlobalIndex(SceneTextureSlot::Diffuse, material.baseColorTexture);
+        material.emissiveTexture = getGlobalIndex(SceneTextureSlot::Emissive, material.emissiveTexture);
+        material.normalTexture = getGlobalIndex(SceneTextureSlot::Normal, material.normalTexture);
+        material.opacityTexture = getGlobalIndex(SceneTextureSlot::Opacity, material.opacityTexture);
+        material.specularTexture = getGlobalIndex(SceneTextureSlot::Specular, material.specularTexture);
     }
 
     lzvk::wrapper::UniformParameter::Ptr SceneTextureManager::loadTextureParam(
@@ -117,7 +299,7 @@ namespace lzvk::renderer{
         auto param = lzvk::wrapper::UniformParameter::create();
         param->mBinding = binding;
         param->mDescriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        param->mStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        param->mStage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
         param->mCount = fixedSize;
 
         param->mTextures.resize(fixedSize, nullptr);
@@ -3,12 +3,56 @@
 #include "../../common.h"
 #include "../../loader/mesh.h"
 #include "../texture/texture.h"
+#include "../texture/texture_cache.h"
+#include "../texture/texture_loader.h"
+#include "../texture/texture_streamer.h"
+#include "../../tools/texture_baker.h"
+#include "../../tools/texture_packer.h"
 #include "../../wrapper/device.h"
 #include "../../wrapper/buffer.h"
 #include "../../wrapper/description.h"
 
 namespace lzvk::renderer {
 
+    // Binding of the bindless texture array in the scene set, must stay the highest binding
+    // of the set because its descriptor count is variable. Must match the scene shaders.
+    constexpr uint32_t SCENE_TEXTURE_BINDING = 10;
+
+    // Per frame texture feedback slice in the scene set. Must match the scene shaders.
+    constexpr uint32_t SCENE_TEXTURE_FEEDBACK_BINDING = 3;
+
+    // Largest level a scene texture is loaded with, the streamer brings in the rest on demand
+    constexpr uint32_t SCENE_TEXTURE_TAIL_EXTENT = 64;
+
+    // Decoded full chains of every scene texture, next to the mesh caches. Delete it for a cold start
+    constexpr const char* SCENE_TEXTURE_CACHE_PATH = "assets/.cache/scene.textures";
+
+    // Textures loaded with their whole chain are packed into array images by format and extent,
+    // the array images sit in the same texture array and the shaders alias them as sampler2DArray.
+    // Materials address a layer as SCENE_TEXTURE_ARRAY_BIT | layer << SCENE_TEXTURE_LAYER_SHIFT | array
+    // index. Must match the scene shaders
+    constexpr uint32_t SCENE_TEXTURE_ARRAY_BIT = 0x80000000u;
+    constexpr uint32_t SCENE_TEXTURE_LAYER_SHIFT = 20;
+
+    // Every device supports 256 layers
+    constexpr uint32_t SCENE_TEXTURE_ARRAY_MAX_LAYERS = 256;
+
+    enum class SceneTextureSlot : uint32_t {
+        Diffuse = 0,
+        Emissive,
+        Normal,
+        Opacity,
+        Specular,
+        Count
+    };
+
+    // Loads every scene texture into one array. Index 0 of each per slot file list is the
+    // dummy texture and maps to global index 0, which the shaders treat as "no texture".
+    // Every slot indexes the same array, a file is stored once per sampling format no matter
+    // how many slots or paths reference its contents. Only the mip tails are loaded up front,
+    // the TextureStreamer brings in finer levels the frames sample. Both read decoded chains from
+    // the TextureCache, sources are only decoded when they changed. Small textures that are loaded
+    // whole share array images instead of holding an image, allocation and descriptor each.
     class SceneTextureManager {
     public:
         using Ptr = std::shared_ptr<SceneTextureManager>;
@@ -27,21 +71,45 @@ namespace lzvk::renderer {
             uint32_t binding,
             uint32_t fixedSize);
 
-        [[nodiscard]] auto getDiffuseParams() const { return std::vector{ mSceneDiffuseTexturesParam }; }
-        [[nodiscard]] auto getEmissiveParams() const { return std::vector{ mSceneEmissiveTexturesParam }; }
-        [[nodiscard]] auto getNormalParams() const { return std::vector{ mSceneNormalTexturesParam }; }
-        [[nodiscard]] auto getOpacityParams() const { return std::vector{ mSceneOpacityTexturesParam }; }
-        [[nodiscard]] auto getSpecularParams() const { return std::vector{ mSceneSpecularTexturesParam }; }
+        // Translate a per slot texture index into the unified array
+        [[nodiscard]] uint32_t getGlobalIndex(SceneTextureSlot slot, uint32_t localIndex) const;
+        void remapMaterial(lzvk::loader::Material& material) const;
+
+        [[nodiscard]] auto getParams() const { return std::vector{ mStreamer->getFeedbackParam(), mSceneTexturesParam }; }
+        [[nodiscard]] auto getStreamer() const { return mStreamer; }
+        [[nodiscard]] auto getCache() const { return mCache; }
+        [[nodiscard]] auto getTextureCount() const { return static_cast<uint32_t>(mTextures.size()); }
+        [[nodiscard]] auto getBakedCount() const { return mBakedCount; }
+        [[nodiscard]] auto getPackedCount() const { return mPackedCount; }
+        [[nodiscard]] auto getArrayCount() const { return mArrayCount; }
+
+        // Image bytes saved by sharing textures between slot references
+        [[nodiscard]] auto getDuplicateBytes() const { return mDuplicateBytes; }
+
+    private:
+
+        // Index the file gets in the array, every requested file is loaded together at the end of init
+        uint32_t addTexture(const std::string& sourcePath, VkFormat format, int coverageChannel, lzvk::tools::TextureKind kind);
+
+        // Replaces small textures of the same shape by array images, requests follows mTextures
+        void packTextureArrays(std::vector<TextureLoader::Request>& requests);
 
     private:
 
         lzvk::wrapper::Device::Ptr mDevice;
         lzvk::wrapper::CommandPool::Ptr mCommandPool;
 
-        lzvk::wrapper::UniformParameter::Ptr mSceneDiffuseTexturesParam;
-        lzvk::wrapper::UniformParameter::Ptr mSceneEmissiveTexturesParam;
-        lzvk::wrapper::UniformParameter::Ptr mSceneNormalTexturesParam;
-        lzvk::wrapper::UniformParameter::Ptr mSceneOpacityTexturesParam;
-        lzvk::wrapper::UniformParameter::Ptr mSceneSpecularTexturesParam;
+        std::vector<lzvk::renderer::Texture::Ptr> mTextures{};
+        std::vector<TextureLoader::Request> mRequests{};
+        std::unordered_map<std::string, uint32_t> mTextureIndices{};
+        std::array<std::vector<uint32_t>, static_cast<size_t>(SceneTextureSlot::Count)> mGlobalIndices{};
+        uint32_t mBakedCount{ 0 };
+        uint32_t mPackedCount{ 0 };
+        uint32_t mArrayCount{ 0 };
+        VkDeviceSize mDuplicateBytes{ 0 };
+
+        lzvk::wrapper::UniformParameter::Ptr mSceneTexturesParam;
+        lzvk::renderer::TextureStreamer::Ptr mStreamer{ nullptr };
+        lzvk::renderer::TextureCache::Ptr mCache{ nullptr };
     };
-}
\ No newline at end of file
+}
@@ -13,7 +13,7 @@ namespace lzvk::renderer {
         mShadowParam = wrapper::UniformParameter::create();
         mShadowParam->mBinding = 0;
         mShadowParam->mDescriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        mShadowParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        mShadowParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
         mShadowParam->mCount = 1;
 
     }
@@ -31,7 +31,8 @@ namespace lzvk::renderer {
         mShadowParam->mImageInfos[0].imageView = shadowTexture->getImageView();
         mShadowParam->mImageInfos[0].sampler = shadowTexture->getSampler();
 
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mShadowParam->mBinding, mShadowParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mShadowParam->mBinding, mShadowParam->mImageInfos[0]);
+        descriptorSet->commit(frameCount);
     }
 
     std::vector<wrapper::UniformParameter::Ptr> ShadowUniformManager::getParams() const {
@@ -13,14 +13,19 @@ namespace lzvk::renderer {
         mSkyboxParam = lzvk::wrapper::UniformParameter::create();
         mSkyboxParam->mBinding = 3;
         mSkyboxParam->mDescriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        mSkyboxParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        mSkyboxParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
         mSkyboxParam->mCount = 1;
 
+        // SH irradiance of the environment, host visible and rewritten when the environment changes
+        mIrradianceBuffer = lzvk::wrapper::Buffer::createUniformBuffer(mDevice, sizeof(lzvk::tools::IrradianceSH), nullptr);
+
         mIrradianceParam = lzvk::wrapper::UniformParameter::create();
         mIrradianceParam->mBinding = 4;
-        mIrradianceParam->mDescriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        mIrradianceParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        mIrradianceParam->mDescriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        mIrradianceParam->mStage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
         mIrradianceParam->mCount = 1;
+        mIrradianceParam->mSize = sizeof(lzvk::tools::IrradianceSH);
+        mIrradianceParam->mBuffers.push_back(mIrradianceBuffer);
     }
 
     void SkyboxUniformManager::updateCubeMap(
@@ -38,17 +43,9 @@ namespace lzvk::renderer {
     }
 
 
-    void SkyboxUniformManager::updateIrradianceMap(
-        const wrapper::DescriptorSet::Ptr& descriptorSet,
-        const renderer::CubeMapTexture::Ptr& irradianceMap,
-        int frameCount
-    ) {
-        mIrradianceParam->mImageInfos.resize(1);
-        mIrradianceParam->mImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        mIrradianceParam->mImageInfos[0].imageView = irradianceMap->getImageView();
-        mIrradianceParam->mImageInfos[0].sampler = irradianceMap->getSampler();
+    void SkyboxUniformManager::updateIrradianceSH(const lzvk::tools::IrradianceSH& irradiance) {
 
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mIrradianceParam->mBinding, mIrradianceParam->mImageInfos[0]);
+        mIrradianceBuffer->updateBufferByMap(&irradiance, sizeof(irradiance));
     }
 
     std::vector<lzvk::wrapper::UniformParameter::Ptr> SkyboxUniformManager::getParams() const {
@@ -6,6 +6,7 @@
 #include "../../wrapper/description.h"
 #include "../../wrapper/descriptor_set.h"
 #include "../texture/cube_map_texture.h"
+#include "../../tools/ibl_baker.h"
 
 namespace lzvk::renderer {
 
@@ -26,11 +27,8 @@ namespace lzvk::renderer {
         );
 
 
-        void updateIrradianceMap(
-            const wrapper::DescriptorSet::Ptr& descriptorSet,
-            const renderer::CubeMapTexture::Ptr& irradianceMap,
-            int frameCount
-        );
+        // The scene shaders evaluate the diffuse environment from these coefficients, no frame may be in flight
+        void updateIrradianceSH(const lzvk::tools::IrradianceSH& irradiance);
 
         std::vector<lzvk::wrapper::UniformParameter::Ptr> getParams() const;
 
@@ -41,6 +39,7 @@ namespace lzvk::renderer {
         lzvk::wrapper::CommandPool::Ptr mCommandPool{ nullptr };
         lzvk::wrapper::UniformParameter::Ptr mSkyboxParam{ nullptr };
         lzvk::wrapper::UniformParameter::Ptr mIrradianceParam{ nullptr };
+        lzvk::wrapper::Buffer::Ptr mIrradianceBuffer{ nullptr };
     };
 
 }
\ No newline at end of file
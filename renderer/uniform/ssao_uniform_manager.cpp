@@ -59,9 +59,10 @@ namespace lzvk::renderer {
         mOutputParam->mImageInfos[0].imageView = outputImage->getImageView();
         mOutputParam->mImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
 
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mDepthParam->mBinding, mDepthParam->mImageInfos[0]);
-        descriptorSet->updateImage(descriptorSet->getDescriptorSet(frameCount), mRotationParam->mBinding, mRotationParam->mImageInfos[0]);
-        descriptorSet->updateStorageImage(descriptorSet->getDescriptorSet(frameCount), mOutputParam->mBinding, mOutputParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mDepthParam->mBinding, mDepthParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mRotationParam->mBinding, mRotationParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mOutputParam->mBinding, mOutputParam->mImageInfos[0]);
+        descriptorSet->commit(frameCount);
     }
 }
 
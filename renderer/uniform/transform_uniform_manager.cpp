@@ -12,7 +12,7 @@ namespace lzvk::renderer {
         mTransformParam = lzvk::wrapper::UniformParameter::create();
         mTransformParam->mBinding = 1;
         mTransformParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-        mTransformParam->mStage = VK_SHADER_STAGE_VERTEX_BIT;
+        mTransformParam->mStage = device->getGeometryShaderStages() | VK_SHADER_STAGE_COMPUTE_BIT;
         mTransformParam->mCount = 1;
         mTransformParam->mSize = sizeof(glm::mat4) * transformCount;
 
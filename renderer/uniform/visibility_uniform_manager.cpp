@@ -0,0 +1,82 @@
+#include "visibility_uniform_manager.h"
+
+namespace lzvk::renderer {
+
+    VisibilityUniformManager::VisibilityUniformManager() {}
+    VisibilityUniformManager::~VisibilityUniformManager() {}
+
+    void VisibilityUniformManager::init(const lzvk::wrapper::Device::Ptr& device,
+        const lzvk::wrapper::Buffer::Ptr& indexBuffer,
+        const lzvk::wrapper::Buffer::Ptr& vertexBuffer) {
+
+        mDevice = device;
+
+        // 1 visibility ids in, shaded color out
+        mVisibilityParam = lzvk::wrapper::UniformParameter::create();
+        mVisibilityParam->mBinding = 0;
+        mVisibilityParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        mVisibilityParam->mStage = VK_SHADER_STAGE_COMPUTE_BIT;
+        mVisibilityParam->mCount = 1;
+
+        mOutputParam = lzvk::wrapper::UniformParameter::create();
+        mOutputParam->mBinding = 1;
+        mOutputParam->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        mOutputParam->mStage = VK_SHADER_STAGE_COMPUTE_BIT;
+        mOutputParam->mCount = 1;
+
+        // 2 geometry to fetch the triangle of every pixel
+        mIndexParam = createBufferParam(2, indexBuffer);
+        mVertexParam = createBufferParam(3, vertexBuffer);
+
+        // 3 the indirect commands that were rasterized, written per frame
+        mDrawCommandParam = createBufferParam(4, nullptr);
+    }
+
+    lzvk::wrapper::UniformParameter::Ptr VisibilityUniformManager::createBufferParam(uint32_t binding, const lzvk::wrapper::Buffer::Ptr& buffer) {
+
+        auto param = lzvk::wrapper::UniformParameter::create();
+        param->mBinding = binding;
+        param->mDescriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        param->mStage = VK_SHADER_STAGE_COMPUTE_BIT;
+        param->mCount = 1;
+
+        if (buffer) {
+            param->mSize = buffer->getBufferInfo().range;
+            param->mBuffers.push_back(buffer);
+        }
+
+        return param;
+    }
+
+    std::vector<lzvk::wrapper::UniformParameter::Ptr> VisibilityUniformManager::getParams() const {
+        return { mVisibilityParam, mOutputParam, mIndexParam, mVertexParam, mDrawCommandParam };
+    }
+
+    void VisibilityUniformManager::update(
+        const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet,
+        const lzvk::wrapper::Image::Ptr& visibilityImage,
+        const lzvk::wrapper::Image::Ptr& outputImage,
+        const lzvk::wrapper::Buffer::Ptr& drawCommandBuffer,
+        int frameCount)
+    {
+        mVisibilityParam->mImageInfos.resize(1);
+        mVisibilityParam->mImageInfos[0].sampler = VK_NULL_HANDLE;
+        mVisibilityParam->mImageInfos[0].imageView = visibilityImage->getImageView();
+        mVisibilityParam->mImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        mOutputParam->mImageInfos.resize(1);
+        mOutputParam->mImageInfos[0].sampler = VK_NULL_HANDLE;
+        mOutputParam->mImageInfos[0].imageView = outputImage->getImageView();
+        mOutputParam->mImageInfos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorBufferInfo drawCommandInfo{};
+        drawCommandInfo.buffer = drawCommandBuffer->getBuffer();
+        drawCommandInfo.offset = 0;
+        drawCommandInfo.range = VK_WHOLE_SIZE;
+
+        descriptorSet->setImage(frameCount, mVisibilityParam->mBinding, mVisibilityParam->mImageInfos[0]);
+        descriptorSet->setImage(frameCount, mOutputParam->mBinding, mOutputParam->mImageInfos[0]);
+        descriptorSet->setBuffer(frameCount, mDrawCommandParam->mBinding, drawCommandInfo);
+        descriptorSet->commit(frameCount);
+    }
+}
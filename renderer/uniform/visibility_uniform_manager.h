@@ -0,0 +1,48 @@
+#pragma once
+
+#include "../../common.h"
+#include "../../wrapper/device.h"
+#include "../../wrapper/buffer.h"
+#include "../../wrapper/image.h"
+#include "../../wrapper/description.h"
+#include "../../wrapper/descriptor_set.h"
+
+namespace lzvk::renderer {
+
+    // Inputs of the visibility resolve pass, the material sets are shared with the geometry pass
+    class VisibilityUniformManager {
+    public:
+
+        using Ptr = std::shared_ptr<VisibilityUniformManager>;
+        static Ptr create() { return std::make_shared<VisibilityUniformManager>(); }
+
+        VisibilityUniformManager();
+        ~VisibilityUniformManager();
+
+        void init(const lzvk::wrapper::Device::Ptr& device,
+            const lzvk::wrapper::Buffer::Ptr& indexBuffer,
+            const lzvk::wrapper::Buffer::Ptr& vertexBuffer);
+
+        std::vector<lzvk::wrapper::UniformParameter::Ptr> getParams() const;
+
+        void update(
+            const lzvk::wrapper::DescriptorSet::Ptr& descriptorSet,
+            const lzvk::wrapper::Image::Ptr& visibilityImage,
+            const lzvk::wrapper::Image::Ptr& outputImage,
+            const lzvk::wrapper::Buffer::Ptr& drawCommandBuffer,
+            int frameCount);
+
+    private:
+
+        lzvk::wrapper::UniformParameter::Ptr createBufferParam(uint32_t binding, const lzvk::wrapper::Buffer::Ptr& buffer);
+
+    private:
+
+        lzvk::wrapper::Device::Ptr mDevice{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mVisibilityParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mOutputParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mIndexParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mVertexParam{ nullptr };
+        lzvk::wrapper::UniformParameter::Ptr mDrawCommandParam{ nullptr };
+    };
+}
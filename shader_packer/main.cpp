@@ -0,0 +1,69 @@
+#include <iostream>
+#include <filesystem>
+#include "../wrapper/shader_archive.h"
+
+// ShaderPacker <archive> <shader directory> <name prefix>
+// Modules are stored under "<name prefix>/<path relative to the shader directory>", which is
+// the path the renderer passes to Shader::create.
+int main(int argc, char** argv) {
+
+    if (argc != 4) {
+
+        std::cout << "usage: ShaderPacker <archive> <shader directory> <name prefix>" << std::endl;
+        return 1;
+    }
+
+    namespace fs = std::filesystem;
+
+    const fs::path archivePath = argv[1];
+    const fs::path shaderDirectory = argv[2];
+    const std::string prefix = argv[3];
+
+    try {
+
+        // 1 Collect the modules in a stable order
+        std::vector<fs::path> files{};
+
+        for (const auto& entry : fs::recursive_directory_iterator(shaderDirectory)) {
+
+            if (entry.is_regular_file() && entry.path().extension() == ".spv") {
+                files.push_back(entry.path());
+            }
+        }
+
+        std::sort(files.begin(), files.end());
+
+        // 2 Read them, reflection runs while writing and rejects anything that isn't SPIR-V
+        std::vector<std::pair<std::string, std::vector<uint32_t>>> modules{};
+        size_t codeBytes = 0;
+
+        for (const auto& file : files) {
+
+            std::ifstream stream(file, std::ios::binary | std::ios::ate);
+            size_t size = static_cast<size_t>(stream.tellg());
+
+            if (!stream || size == 0 || size % sizeof(uint32_t) != 0) {
+                throw std::runtime_error("Error: " + file.string() + " is not a SPIR-V module");
+            }
+
+            std::vector<uint32_t> code(size / sizeof(uint32_t));
+            stream.seekg(0);
+            stream.read(reinterpret_cast<char*>(code.data()), size);
+
+            std::string name = prefix + "/" + fs::relative(file, shaderDirectory).generic_string();
+            modules.emplace_back(name, std::move(code));
+            codeBytes += size;
+        }
+
+        lzvk::wrapper::ShaderArchive::write(archivePath.string(), modules);
+
+        std::cout << "[ShaderPacker] " << modules.size() << " modules, " << codeBytes / 1024 << " KB of SPIR-V -> " << archivePath.string() << std::endl;
+    }
+    catch (const std::exception& e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
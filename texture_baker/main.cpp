@@ -0,0 +1,105 @@
+#include <iostream>
+#include <filesystem>
+#include <chrono>
+#include "../loader/mesh.h"
+#include "../loader/scene.h"
+#include "../tools/texture_baker.h"
+#include "../tools/scene_tools.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// TextureBaker <mesh cache or model> [...]
+// Bakes every texture the meshes reference, run from the directory the renderer starts in.
+// Files whose baked copy is newer than the source are skipped.
+int main(int argc, char** argv) {
+
+    if (argc < 2) {
+
+        std::cout << "usage: TextureBaker <mesh cache or model> [...]" << std::endl;
+        return 1;
+    }
+
+    using lzvk::tools::TextureKind;
+
+    try {
+
+        // 1 Collect the files per kind, the dummy texture at index 0 of each list included
+        std::set<std::pair<std::string, TextureKind>> jobs{};
+
+        for (int i = 1; i < argc; ++i) {
+
+            const std::string path = argv[i];
+
+            lzvk::loader::MeshData meshData{};
+            lzvk::loader::Scene scene{};
+
+            // Mesh caches are keyed by the batch settings, the renderer writes them with the defaults
+            bool loaded = std::filesystem::path(path).extension() == ".meshes" ?
+                          lzvk::loader::loadMeshData(path, meshData, lzvk::tools::getStaticBatchCacheKey({})) :
+                          lzvk::loader::loadMeshFile(path, meshData, scene);
+
+            if (!loaded) {
+                throw std::runtime_error("Error: failed to load " + path);
+            }
+
+            auto add = [&](const std::vector<std::string>& files, TextureKind kind) {
+                for (const auto& file : files) {
+                    jobs.emplace(file, kind);
+                }
+            };
+
+            add(meshData.diffuseTextureFiles, TextureKind::Color);
+            add(meshData.emissiveTextureFiles, TextureKind::Color);
+            add(meshData.specularTextureFiles, TextureKind::Color);
+            add(meshData.normalTextureFiles, TextureKind::Normal);
+            add(meshData.opacityTextureFiles, TextureKind::Mask);
+        }
+
+        // 2 Bake, the encoder spreads each level over every core
+        size_t uncompressedBytes = 0;
+        size_t bakedBytes = 0;
+        uint32_t bakedCount = 0;
+        uint32_t skippedCount = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (const auto& [file, kind] : jobs) {
+
+            if (lzvk::tools::isBakedTextureCurrent(file, kind)) {
+                ++skippedCount;
+                continue;
+            }
+
+            int width = 0, height = 0, channels = 0;
+            stbi_uc* pixels = stbi_load(file.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+            if (!pixels) {
+                std::cout << "[TextureBaker] failed to read " << file << ", skipped" << std::endl;
+                continue;
+            }
+
+            auto baked = lzvk::tools::bakeTexture(pixels, width, height, kind, lzvk::tools::getBakedTexturePath(file, kind));
+            stbi_image_free(pixels);
+
+            uncompressedBytes += baked.uncompressedBytes;
+            bakedBytes += baked.bakedBytes;
+            ++bakedCount;
+        }
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        std::cout << "[TextureBaker] baked " << bakedCount << " textures in " << seconds << " s, " << skippedCount << " up to date" << std::endl;
+
+        if (bakedCount > 0) {
+            std::cout << "[TextureBaker] " << uncompressedBytes / (1024 * 1024) << " MB as RGBA8 -> " << bakedBytes / (1024 * 1024) << " MB block compressed" << std::endl;
+        }
+    }
+    catch (const std::exception& e) {
+
+        std::cout << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
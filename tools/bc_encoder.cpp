@@ -0,0 +1,331 @@
+#include "bc_encoder.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace lzvk::tools {
+
+    namespace {
+
+        // Endpoints of the segment through the block along its principal axis, channels 0..N-1
+        template <int N>
+        void fitEndpoints(const uint8_t texels[64], const int channels[N], float low[N], float high[N])
+        {
+            float mean[N] = {};
+            for (int i = 0; i < 16; ++i) {
+                for (int c = 0; c < N; ++c) {
+                    mean[c] += texels[i * 4 + channels[c]] / 16.0f;
+                }
+            }
+
+            float covariance[N][N] = {};
+            for (int i = 0; i < 16; ++i) {
+                for (int a = 0; a < N; ++a) {
+                    for (int b = 0; b < N; ++b) {
+                        covariance[a][b] += (texels[i * 4 + channels[a]] - mean[a]) * (texels[i * 4 + channels[b]] - mean[b]);
+                    }
+                }
+            }
+
+            // power iteration, a handful of steps is plenty for 16 points
+            float axis[N];
+            for (int c = 0; c < N; ++c) {
+                axis[c] = 1.0f;
+            }
+
+            for (int iteration = 0; iteration < 8; ++iteration) {
+
+                float next[N] = {};
+                float length = 0.0f;
+
+                for (int a = 0; a < N; ++a) {
+                    for (int b = 0; b < N; ++b) {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                    length += next[a] * next[a];
+                }
+
+                if (length < 1e-12f) {
+                    break;
+                }
+
+                length = 1.0f / std::sqrt(length);
+                for (int c = 0; c < N; ++c) {
+                    axis[c] = next[c] * length;
+                }
+            }
+
+            float minT = 0.0f;
+            float maxT = 0.0f;
+
+            for (int i = 0; i < 16; ++i) {
+
+                float t = 0.0f;
+                for (int c = 0; c < N; ++c) {
+                    t += (texels[i * 4 + channels[c]] - mean[c]) * axis[c];
+                }
+
+                minT = std::min(minT, t);
+                maxT = std::max(maxT, t);
+            }
+
+            for (int c = 0; c < N; ++c) {
+                low[c] = std::clamp(mean[c] + minT * axis[c], 0.0f, 255.0f);
+                high[c] = std::clamp(mean[c] + maxT * axis[c], 0.0f, 255.0f);
+            }
+        }
+
+        template <int N>
+        int findNearest(const uint8_t* texel, const int channels[N], const int (*palette)[4], int paletteSize)
+        {
+            int best = 0;
+            int bestError = INT32_MAX;
+
+            for (int p = 0; p < paletteSize; ++p) {
+
+                int error = 0;
+                for (int c = 0; c < N; ++c) {
+                    int d = texel[channels[c]] - palette[p][c];
+                    error += d * d;
+                }
+
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+
+            return best;
+        }
+
+        void encodeBC1(const uint8_t texels[64], uint8_t* block)
+        {
+            static const int channels[3] = { 0, 1, 2 };
+
+            float low[3], high[3];
+            fitEndpoints<3>(texels, channels, low, high);
+
+            auto pack = [](const float color[3]) {
+                uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+                uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+                uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+                return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+            };
+
+            auto unpack = [](uint16_t color, int out[4]) {
+                int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+                out[0] = (r << 3) | (r >> 2);
+                out[1] = (g << 2) | (g >> 4);
+                out[2] = (b << 3) | (b >> 2);
+                out[3] = 255;
+            };
+
+            // four color mode needs color0 > color1
+            uint16_t color0 = pack(high);
+            uint16_t color1 = pack(low);
+            if (color0 < color1) {
+                std::swap(color0, color1);
+            }
+
+            uint32_t indices = 0;
+
+            if (color0 != color1) {
+
+                int palette[4][4];
+                unpack(color0, palette[0]);
+                unpack(color1, palette[1]);
+                for (int c = 0; c < 3; ++c) {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+
+                for (int i = 0; i < 16; ++i) {
+                    indices |= static_cast<uint32_t>(findNearest<3>(texels + i * 4, channels, palette, 4)) << (2 * i);
+                }
+            }
+
+            std::memcpy(block + 0, &color0, 2);
+            std::memcpy(block + 2, &color1, 2);
+            std::memcpy(block + 4, &indices, 4);
+        }
+
+        void encodeBC4(const uint8_t texels[64], int channel, uint8_t* block)
+        {
+            const int channels[1] = { channel };
+
+            // eight value mode, red0 > red1
+            int red0 = 0;
+            int red1 = 255;
+            for (int i = 0; i < 16; ++i) {
+                red0 = std::max(red0, int(texels[i * 4 + channel]));
+                red1 = std::min(red1, int(texels[i * 4 + channel]));
+            }
+
+            uint64_t indices = 0;
+
+            if (red0 != red1) {
+
+                int palette[8][4] = {};
+                palette[0][0] = red0;
+                palette[1][0] = red1;
+                for (int p = 2; p < 8; ++p) {
+                    palette[p][0] = ((8 - p) * red0 + (p - 1) * red1) / 7;
+                }
+
+                for (int i = 0; i < 16; ++i) {
+                    indices |= static_cast<uint64_t>(findNearest<1>(texels + i * 4, channels, palette, 8)) << (3 * i);
+                }
+            }
+
+            block[0] = static_cast<uint8_t>(red0);
+            block[1] = static_cast<uint8_t>(red1);
+            for (int b = 0; b < 6; ++b) {
+                block[2 + b] = static_cast<uint8_t>(indices >> (8 * b));
+            }
+        }
+
+        // Mode 6: one subset, 7 bit rgba endpoints with a p-bit each and 4 bit indices
+        void encodeBC7(const uint8_t texels[64], uint8_t* block)
+        {
+            static const int channels[4] = { 0, 1, 2, 3 };
+            static const int weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+            float endpoints[2][4];
+            fitEndpoints<4>(texels, channels, endpoints[0], endpoints[1]);
+
+            // 1 Quantize, the p-bit is shared by the channels of an endpoint
+            int quantized[2][4];
+            int pbits[2];
+
+            for (int e = 0; e < 2; ++e) {
+
+                float bestError = FLT_MAX;
+
+                for (int p = 0; p < 2; ++p) {
+
+                    int candidate[4];
+                    float error = 0.0f;
+
+                    for (int c = 0; c < 4; ++c) {
+                        candidate[c] = std::clamp(static_cast<int>(std::lround((endpoints[e][c] - p) * 0.5f)), 0, 127);
+                        float d = static_cast<float>((candidate[c] << 1) | p) - endpoints[e][c];
+                        error += d * d;
+                    }
+
+                    if (error < bestError) {
+                        bestError = error;
+                        pbits[e] = p;
+                        std::memcpy(quantized[e], candidate, sizeof(candidate));
+                    }
+                }
+            }
+
+            // 2 Palette and indices
+            int palette[16][4];
+            for (int i = 0; i < 16; ++i) {
+                for (int c = 0; c < 4; ++c) {
+                    int e0 = (quantized[0][c] << 1) | pbits[0];
+                    int e1 = (quantized[1][c] << 1) | pbits[1];
+                    palette[i][c] = ((64 - weights[i]) * e0 + weights[i] * e1 + 32) >> 6;
+                }
+            }
+
+            int indices[16];
+            for (int i = 0; i < 16; ++i) {
+                indices[i] = findNearest<4>(texels + i * 4, channels, palette, 16);
+            }
+
+            // the anchor index is stored without its top bit, swap the endpoints when it is set
+            if (indices[0] & 8) {
+                std::swap(quantized[0], quantized[1]);
+                std::swap(pbits[0], pbits[1]);
+                for (int& index : indices) {
+                    index = 15 - index;
+                }
+            }
+
+            // 3 Pack, least significant bit first
+            std::memset(block, 0, 16);
+            uint32_t position = 0;
+
+            auto write = [&](uint32_t value, uint32_t bits) {
+                for (uint32_t b = 0; b < bits; ++b, ++position) {
+                    block[position >> 3] |= static_cast<uint8_t>(((value >> b) & 1) << (position & 7));
+                }
+            };
+
+            write(1 << 6, 7);
+            for (int c = 0; c < 4; ++c) {
+                write(quantized[0][c], 7);
+                write(quantized[1][c], 7);
+            }
+            write(pbits[0], 1);
+            write(pbits[1], 1);
+            for (int i = 0; i < 16; ++i) {
+                write(indices[i], i == 0 ? 3 : 4);
+            }
+        }
+    }
+
+    uint32_t getBlockBytes(BlockFormat format)
+    {
+        return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+    }
+
+    void encodeBlock(BlockFormat format, const uint8_t texels[64], uint8_t* block)
+    {
+        switch (format) {
+        case BlockFormat::BC1: encodeBC1(texels, block); break;
+        case BlockFormat::BC4: encodeBC4(texels, 0, block); break;
+        case BlockFormat::BC5: encodeBC4(texels, 0, block); encodeBC4(texels, 1, block + 8); break;
+        case BlockFormat::BC7: encodeBC7(texels, block); break;
+        }
+    }
+
+    std::vector<uint8_t> encodeImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t threadCount)
+    {
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        const uint32_t blockBytes = getBlockBytes(format);
+
+        std::vector<uint8_t> blocks(size_t(blocksX) * blocksY * blockBytes);
+
+        auto encodeRows = [&](uint32_t firstRow, uint32_t step) {
+
+            uint8_t texels[64];
+
+            for (uint32_t by = firstRow; by < blocksY; by += step) {
+                for (uint32_t bx = 0; bx < blocksX; ++bx) {
+
+                    for (uint32_t i = 0; i < 16; ++i) {
+                        uint32_t x = std::min(bx * 4 + (i & 3), width - 1);
+                        uint32_t y = std::min(by * 4 + (i >> 2), height - 1);
+                        std::memcpy(texels + i * 4, rgba + (size_t(y) * width + x) * 4, 4);
+                    }
+
+                    encodeBlock(format, texels, blocks.data() + (size_t(by) * blocksX + bx) * blockBytes);
+                }
+            }
+        };
+
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threadCount = std::min(threadCount, blocksY);
+
+        // rows are interleaved so every thread gets a similar mix of detailed and flat regions
+        std::vector<std::thread> threads;
+        for (uint32_t t = 1; t < threadCount; ++t) {
+            threads.emplace_back(encodeRows, t, threadCount);
+        }
+
+        encodeRows(0, threadCount);
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        return blocks;
+    }
+}
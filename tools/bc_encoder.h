@@ -0,0 +1,23 @@
+#pragma once
+
+#include "../common.h"
+
+namespace lzvk::tools {
+
+    enum class BlockFormat {
+        BC1,    // rgb, 8 bytes per block
+        BC4,    // r, 8 bytes per block
+        BC5,    // rg, 16 bytes per block
+        BC7     // rgba, 16 bytes per block, encoded in mode 6
+    };
+
+    uint32_t getBlockBytes(BlockFormat format);
+
+    // Encodes one 4x4 block of RGBA8 texels, row major. Endpoints are fit along the principal
+    // axis of the block and every texel picks its nearest palette entry.
+    void encodeBlock(BlockFormat format, const uint8_t texels[64], uint8_t* block);
+
+    // Encodes a whole RGBA8 image, edge blocks repeat the last row and column. Rows of blocks
+    // are spread over threadCount threads, 0 uses every hardware thread.
+    std::vector<uint8_t> encodeImage(BlockFormat format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t threadCount = 0);
+}
@@ -0,0 +1,1082 @@
+#include "bitmap_ops.h"
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include "simd.h"
+
+namespace lzvk::tools {
+
+    namespace {
+
+        const float KAISER_RADIUS = 3.0f;
+        const float KAISER_BETA = 4.0f;
+
+        // Rows of all depth slices, they are stored back to back
+        uint32_t getRowCount(const Bitmap& bitmap) {
+            return uint32_t(bitmap.mHeight) * uint32_t(bitmap.mDepth);
+        }
+
+        size_t getRowLength(const Bitmap& bitmap) {
+            return size_t(bitmap.mWidth) * bitmap.mChannels;
+        }
+
+        void checkFloat(const Bitmap& bitmap, const char* operation) {
+
+            if (bitmap.mFormat != BitmapFormat::Float) {
+                throw std::runtime_error(std::string("Error: ") + operation + " expects a float bitmap");
+            }
+        }
+
+        // Only RGBA carries alpha, one to three channels are all color
+        inline bool isAlpha(size_t index, int channels) {
+            return channels == 4 && (index & 3) == 3;
+        }
+
+        const std::array<float, 256>& getSrgbToLinearTable() {
+
+            static const std::array<float, 256> table = [] {
+                std::array<float, 256> result{};
+                for (int i = 0; i < 256; ++i) {
+                    float v = i / 255.0f;
+                    result[i] = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+                }
+                return result;
+            }();
+
+            return table;
+        }
+
+        float srgbToLinearValue(float v) {
+            v = std::clamp(v, 0.0f, 1.0f);
+            return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+        }
+
+        float linearToSrgbValue(float v) {
+            v = std::clamp(v, 0.0f, 1.0f);
+            return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+        }
+
+        uint8_t toByte(float v) {
+            return static_cast<uint8_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+
+#if LZVK_X86_SIMD
+
+        // SSE2 versions of the AVX2 math below, used on CPUs without AVX2. SSE2 has no blendv,
+        // round or FMA, lanes are selected with masks and products added separately
+
+        // Lanes of a where mask is set, b elsewhere
+        inline __m128 selectSse(__m128 mask, __m128 a, __m128 b) {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        // Lane 3 of an RGBA pixel
+        inline __m128 getAlphaMaskSse() {
+            return _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+        }
+
+        inline __m128 log2Sse(__m128 x) {
+
+            __m128i bits = _mm_castps_si128(_mm_max_ps(x, _mm_set1_ps(FLT_MIN)));
+            __m128i exponent = _mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127));
+            __m128 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+
+            __m128 high = _mm_cmpgt_ps(m, _mm_set1_ps(1.41421356f));
+            m = selectSse(high, _mm_mul_ps(m, _mm_set1_ps(0.5f)), m);
+            __m128 e = _mm_add_ps(_mm_cvtepi32_ps(exponent), _mm_and_ps(high, _mm_set1_ps(1.0f)));
+
+            __m128 t = _mm_div_ps(_mm_sub_ps(m, _mm_set1_ps(1.0f)), _mm_add_ps(m, _mm_set1_ps(1.0f)));
+            __m128 s = _mm_mul_ps(t, t);
+
+            __m128 p = _mm_set1_ps(1.0f / 7.0f);
+            p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(1.0f / 5.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(1.0f / 3.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, s), _mm_set1_ps(1.0f));
+            p = _mm_mul_ps(p, _mm_mul_ps(t, _mm_set1_ps(2.0f / glm::ln_two<float>())));
+
+            return _mm_add_ps(e, p);
+        }
+
+        // The conversion rounds to nearest under the default MXCSR mode, like _mm256_round_ps
+        inline __m128 exp2Sse(__m128 y) {
+
+            y = _mm_min_ps(_mm_max_ps(y, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+
+            __m128i integer = _mm_cvtps_epi32(y);
+            __m128 f = _mm_mul_ps(_mm_sub_ps(y, _mm_cvtepi32_ps(integer)), _mm_set1_ps(glm::ln_two<float>()));
+
+            __m128 p = _mm_set1_ps(1.0f / 720.0f);
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f / 120.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f / 24.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f / 6.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(0.5f));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+            p = _mm_add_ps(_mm_mul_ps(p, f), _mm_set1_ps(1.0f));
+
+            __m128i scale = _mm_slli_epi32(_mm_add_epi32(integer, _mm_set1_epi32(127)), 23);
+            return _mm_mul_ps(p, _mm_castsi128_ps(scale));
+        }
+
+        inline __m128 clamp01Sse(__m128 v) {
+            return _mm_min_ps(_mm_max_ps(v, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+        }
+
+        inline __m128 srgbToLinearSse(__m128 v) {
+
+            v = clamp01Sse(v);
+
+            __m128 base = _mm_mul_ps(_mm_add_ps(v, _mm_set1_ps(0.055f)), _mm_set1_ps(1.0f / 1.055f));
+            __m128 curve = exp2Sse(_mm_mul_ps(log2Sse(base), _mm_set1_ps(2.4f)));
+            __m128 linear = _mm_mul_ps(v, _mm_set1_ps(1.0f / 12.92f));
+
+            return selectSse(_mm_cmple_ps(v, _mm_set1_ps(0.04045f)), linear, curve);
+        }
+
+        inline __m128 linearToSrgbSse(__m128 v) {
+
+            v = clamp01Sse(v);
+
+            __m128 curve = exp2Sse(_mm_mul_ps(log2Sse(v), _mm_set1_ps(1.0f / 2.4f)));
+            curve = _mm_sub_ps(_mm_mul_ps(curve, _mm_set1_ps(1.055f)), _mm_set1_ps(0.055f));
+            __m128 linear = _mm_mul_ps(v, _mm_set1_ps(12.92f));
+
+            return selectSse(_mm_cmple_ps(v, _mm_set1_ps(0.0031308f)), linear, curve);
+        }
+
+        // log2 of positive x. The mantissa is moved to [sqrt(0.5), sqrt(2)) and expanded with the
+        // atanh series of (m - 1) / (m + 1), about 5e-8 off
+        LZVK_TARGET_AVX2 inline __m256 log2Avx(__m256 x) {
+
+            __m256i bits = _mm256_castps_si256(_mm256_max_ps(x, _mm256_set1_ps(FLT_MIN)));
+            __m256i exponent = _mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(127));
+            __m256 m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007FFFFF)), _mm256_set1_epi32(0x3F800000)));
+
+            __m256 high = _mm256_cmp_ps(m, _mm256_set1_ps(1.41421356f), _CMP_GT_OQ);
+            m = _mm256_blendv_ps(m, _mm256_mul_ps(m, _mm256_set1_ps(0.5f)), high);
+            __m256 e = _mm256_add_ps(_mm256_cvtepi32_ps(exponent), _mm256_and_ps(high, _mm256_set1_ps(1.0f)));
+
+            __m256 t = _mm256_div_ps(_mm256_sub_ps(m, _mm256_set1_ps(1.0f)), _mm256_add_ps(m, _mm256_set1_ps(1.0f)));
+            __m256 s = _mm256_mul_ps(t, t);
+
+            __m256 p = _mm256_set1_ps(1.0f / 7.0f);
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(1.0f / 5.0f));
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(1.0f / 3.0f));
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(1.0f));
+            p = _mm256_mul_ps(p, _mm256_mul_ps(t, _mm256_set1_ps(2.0f / glm::ln_two<float>())));
+
+            return _mm256_add_ps(e, p);
+        }
+
+        // 2^y, the fraction around the nearest integer goes through a degree 6 Taylor polynomial
+        LZVK_TARGET_AVX2 inline __m256 exp2Avx(__m256 y) {
+
+            y = _mm256_min_ps(_mm256_max_ps(y, _mm256_set1_ps(-126.0f)), _mm256_set1_ps(126.0f));
+
+            __m256 n = _mm256_round_ps(y, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+            __m256 f = _mm256_mul_ps(_mm256_sub_ps(y, n), _mm256_set1_ps(glm::ln_two<float>()));
+
+            __m256 p = _mm256_set1_ps(1.0f / 720.0f);
+            p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f / 120.0f));
+            p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f / 24.0f));
+            p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f / 6.0f));
+            p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(0.5f));
+            p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+            p = _mm256_fmadd_ps(p, f, _mm256_set1_ps(1.0f));
+
+            __m256i scale = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+            return _mm256_mul_ps(p, _mm256_castsi256_ps(scale));
+        }
+
+        LZVK_TARGET_AVX2 inline __m256 clamp01Avx(__m256 v) {
+            return _mm256_min_ps(_mm256_max_ps(v, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+        }
+
+        LZVK_TARGET_AVX2 inline __m256 srgbToLinearAvx(__m256 v) {
+
+            v = clamp01Avx(v);
+
+            __m256 base = _mm256_mul_ps(_mm256_add_ps(v, _mm256_set1_ps(0.055f)), _mm256_set1_ps(1.0f / 1.055f));
+            __m256 curve = exp2Avx(_mm256_mul_ps(log2Avx(base), _mm256_set1_ps(2.4f)));
+            __m256 linear = _mm256_mul_ps(v, _mm256_set1_ps(1.0f / 12.92f));
+
+            return _mm256_blendv_ps(curve, linear, _mm256_cmp_ps(v, _mm256_set1_ps(0.04045f), _CMP_LE_OQ));
+        }
+
+        LZVK_TARGET_AVX2 inline __m256 linearToSrgbAvx(__m256 v) {
+
+            v = clamp01Avx(v);
+
+            __m256 curve = exp2Avx(_mm256_mul_ps(log2Avx(v), _mm256_set1_ps(1.0f / 2.4f)));
+            curve = _mm256_fmadd_ps(curve, _mm256_set1_ps(1.055f), _mm256_set1_ps(-0.055f));
+            __m256 linear = _mm256_mul_ps(v, _mm256_set1_ps(12.92f));
+
+            return _mm256_blendv_ps(curve, linear, _mm256_cmp_ps(v, _mm256_set1_ps(0.0031308f), _CMP_LE_OQ));
+        }
+
+        // Point operations on one row, count values starting at a pixel boundary. The SSE2 and
+        // AVX2 kernels return how many values they wrote, the scalar loops finish the row
+
+        // 4 values are one RGBA pixel
+        size_t srgbToLinearRowSse(float* data, size_t count, int channels) {
+
+            size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+                __m128 v = _mm_loadu_ps(data + i);
+                __m128 result = srgbToLinearSse(v);
+                _mm_storeu_ps(data + i, channels == 4 ? selectSse(getAlphaMaskSse(), v, result) : result);
+            }
+
+            return i;
+        }
+
+        size_t linearToSrgbRowSse(float* data, size_t count, int channels) {
+
+            size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+                __m128 v = _mm_loadu_ps(data + i);
+                __m128 result = linearToSrgbSse(v);
+                _mm_storeu_ps(data + i, channels == 4 ? selectSse(getAlphaMaskSse(), v, result) : result);
+            }
+
+            return i;
+        }
+
+        // Widen 4 bytes with zero unpacks, there is no gather so sRGB values are read one by one
+        size_t byteToFloatRowSse(const uint8_t* src, float* dst, size_t count, int channels, bool srgb, const float* table) {
+
+            const __m128i zero = _mm_setzero_si128();
+            size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+
+                int32_t word = 0;
+                std::memcpy(&word, src + i, sizeof(word));
+
+                __m128i index = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(word), zero), zero);
+                __m128 linear = _mm_mul_ps(_mm_cvtepi32_ps(index), _mm_set1_ps(1.0f / 255.0f));
+
+                if (srgb) {
+                    __m128 decoded = _mm_setr_ps(table[src[i]], table[src[i + 1]], table[src[i + 2]], table[src[i + 3]]);
+                    linear = channels == 4 ? selectSse(getAlphaMaskSse(), linear, decoded) : decoded;
+                }
+
+                _mm_storeu_ps(dst + i, linear);
+            }
+
+            return i;
+        }
+
+        // The values are at most 255 after rounding, so the signed pack to 16 bits is exact
+        size_t floatToByteRowSse(const float* src, uint8_t* dst, size_t count, int channels, bool srgb) {
+
+            size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+
+                __m128 v = _mm_loadu_ps(src + i);
+
+                if (srgb) {
+                    __m128 encoded = linearToSrgbSse(v);
+                    v = channels == 4 ? selectSse(getAlphaMaskSse(), v, encoded) : encoded;
+                }
+
+                __m128i value = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(clamp01Sse(v), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+                __m128i words = _mm_packs_epi32(value, value);
+                __m128i bytes = _mm_packus_epi16(words, words);
+
+                int32_t word = _mm_cvtsi128_si32(bytes);
+                std::memcpy(dst + i, &word, sizeof(word));
+            }
+
+            return i;
+        }
+
+        // 8 values are two RGBA pixels, their alphas sit in lanes 3 and 7
+        LZVK_TARGET_AVX2 size_t srgbToLinearRowAvx2(float* data, size_t count, int channels) {
+
+            size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                __m256 v = _mm256_loadu_ps(data + i);
+                __m256 result = srgbToLinearAvx(v);
+                _mm256_storeu_ps(data + i, channels == 4 ? _mm256_blend_ps(result, v, 0x88) : result);
+            }
+
+            return i;
+        }
+
+        LZVK_TARGET_AVX2 size_t linearToSrgbRowAvx2(float* data, size_t count, int channels) {
+
+            size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+                __m256 v = _mm256_loadu_ps(data + i);
+                __m256 result = linearToSrgbAvx(v);
+                _mm256_storeu_ps(data + i, channels == 4 ? _mm256_blend_ps(result, v, 0x88) : result);
+            }
+
+            return i;
+        }
+
+        // Widen 8 bytes, sRGB values are gathered from the table
+        LZVK_TARGET_AVX2 size_t byteToFloatRowAvx2(const uint8_t* src, float* dst, size_t count, int channels, bool srgb, const float* table) {
+
+            size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+
+                __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i)));
+                __m256 linear = _mm256_mul_ps(_mm256_cvtepi32_ps(index), _mm256_set1_ps(1.0f / 255.0f));
+
+                if (srgb) {
+                    __m256 decoded = _mm256_i32gather_ps(table, index, 4);
+                    linear = channels == 4 ? _mm256_blend_ps(decoded, linear, 0x88) : decoded;
+                }
+
+                _mm256_storeu_ps(dst + i, linear);
+            }
+
+            return i;
+        }
+
+        // Encode, round like toByte, then narrow 8 lanes to 8 bytes. The packs work per 128 bit
+        // lane, so the low 4 bytes of each lane are joined at the end
+        LZVK_TARGET_AVX2 size_t floatToByteRowAvx2(const float* src, uint8_t* dst, size_t count, int channels, bool srgb) {
+
+            size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+
+                __m256 v = _mm256_loadu_ps(src + i);
+
+                if (srgb) {
+                    __m256 encoded = linearToSrgbAvx(v);
+                    v = channels == 4 ? _mm256_blend_ps(encoded, v, 0x88) : encoded;
+                }
+
+                __m256i value = _mm256_cvttps_epi32(_mm256_fmadd_ps(clamp01Avx(v), _mm256_set1_ps(255.0f), _mm256_set1_ps(0.5f)));
+                __m256i words = _mm256_packus_epi32(value, value);
+                __m256i bytes = _mm256_packus_epi16(words, words);
+
+                __m128i packed = _mm_unpacklo_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), packed);
+            }
+
+            return i;
+        }
+
+#endif
+
+        void srgbToLinearRow(float* data, size_t count, int channels) {
+
+            size_t i = 0;
+
+#if LZVK_X86_SIMD
+            i = hasAvx2() ? srgbToLinearRowAvx2(data, count, channels) : srgbToLinearRowSse(data, count, channels);
+#endif
+
+            for (; i < count; ++i) {
+                if (!isAlpha(i, channels)) {
+                    data[i] = srgbToLinearValue(data[i]);
+                }
+            }
+        }
+
+        void linearToSrgbRow(float* data, size_t count, int channels) {
+
+            size_t i = 0;
+
+#if LZVK_X86_SIMD
+            i = hasAvx2() ? linearToSrgbRowAvx2(data, count, channels) : linearToSrgbRowSse(data, count, channels);
+#endif
+
+            for (; i < count; ++i) {
+                if (!isAlpha(i, channels)) {
+                    data[i] = linearToSrgbValue(data[i]);
+                }
+            }
+        }
+
+        void byteToFloatRow(const uint8_t* src, float* dst, size_t count, int channels, bool srgb) {
+
+            const float* table = getSrgbToLinearTable().data();
+            size_t i = 0;
+
+#if LZVK_X86_SIMD
+            // 1 Vector kernels, AVX2 when the CPU has it
+            i = hasAvx2() ? byteToFloatRowAvx2(src, dst, count, channels, srgb, table) : byteToFloatRowSse(src, dst, count, channels, srgb, table);
+#endif
+
+            // 2 Remainder, or every value on other CPU architectures
+            for (; i < count; ++i) {
+                dst[i] = srgb && !isAlpha(i, channels) ? table[src[i]] : src[i] / 255.0f;
+            }
+        }
+
+        void floatToByteRow(const float* src, uint8_t* dst, size_t count, int channels, bool srgb) {
+
+            size_t i = 0;
+
+#if LZVK_X86_SIMD
+            // 1 Vector kernels, AVX2 when the CPU has it
+            i = hasAvx2() ? floatToByteRowAvx2(src, dst, count, channels, srgb) : floatToByteRowSse(src, dst, count, channels, srgb);
+#endif
+
+            // 2 Remainder, or every value on other CPU architectures
+            for (; i < count; ++i) {
+                dst[i] = toByte(srgb && !isAlpha(i, channels) ? linearToSrgbValue(src[i]) : src[i]);
+            }
+        }
+
+        template <typename T>
+        void swizzleRowScalar(const T* src, T* dst, int first, int width, int srcChannels, const std::vector<int>& swizzle, T one) {
+
+            const int dstChannels = int(swizzle.size());
+
+            for (int x = first; x < width; ++x) {
+
+                const T* in = src + size_t(x) * srcChannels;
+                T* out = dst + size_t(x) * dstChannels;
+
+                for (int c = 0; c < dstChannels; ++c) {
+                    int channel = swizzle[c];
+                    out[c] = channel >= 0 ? in[channel] : (channel == SWIZZLE_ONE ? one : T(0));
+                }
+            }
+        }
+
+#if LZVK_X86_SIMD
+
+        // Eight RGBA8 pixels per shuffle, constant channels are zeroed by the shuffle and ones are
+        // ORed back in. Returns the pixels done
+        LZVK_TARGET_AVX2 int swizzleRowBytesAvx2(const uint8_t* in, uint8_t* out, int width, const std::vector<int>& swizzle) {
+
+            alignas(32) int8_t shuffle[32];
+            alignas(32) int8_t ones[32];
+
+            for (int i = 0; i < 32; ++i) {
+                int channel = swizzle[i & 3];
+                shuffle[i] = channel >= 0 ? int8_t((i & ~3 & 15) + channel) : int8_t(-128);
+                ones[i] = channel == SWIZZLE_ONE ? int8_t(-1) : int8_t(0);
+            }
+
+            const __m256i shuffleMask = _mm256_load_si256(reinterpret_cast<const __m256i*>(shuffle));
+            const __m256i onesMask = _mm256_load_si256(reinterpret_cast<const __m256i*>(ones));
+
+            int x = 0;
+            for (; x + 8 <= width; x += 8) {
+                __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + 4 * size_t(x)));
+                pixels = _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffleMask), onesMask);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4 * size_t(x)), pixels);
+            }
+
+            return x;
+        }
+
+        // Two float RGBA pixels per permute, one in each 128 bit lane
+        LZVK_TARGET_AVX2 int swizzleRowFloatAvx2(const float* in, float* out, int width, const std::vector<int>& swizzle) {
+
+            alignas(32) int32_t permute[8];
+            alignas(32) float keep[8];
+            alignas(32) float constants[8];
+
+            for (int i = 0; i < 8; ++i) {
+                int channel = swizzle[i & 3];
+                permute[i] = std::max(channel, 0);
+                keep[i] = channel >= 0 ? 0.0f : 1.0f;
+                constants[i] = channel == SWIZZLE_ONE ? 1.0f : 0.0f;
+            }
+
+            const __m256i permuteIndex = _mm256_load_si256(reinterpret_cast<const __m256i*>(permute));
+            const __m256 constantMask = _mm256_cmp_ps(_mm256_load_ps(keep), _mm256_set1_ps(0.5f), _CMP_GT_OQ);
+            const __m256 constantValue = _mm256_load_ps(constants);
+
+            int x = 0;
+            for (; x + 2 <= width; x += 2) {
+                __m256 pixels = _mm256_permutevar_ps(_mm256_loadu_ps(in + 4 * size_t(x)), permuteIndex);
+                _mm256_storeu_ps(out + 4 * size_t(x), _mm256_blendv_ps(pixels, constantValue, constantMask));
+            }
+
+            return x;
+        }
+
+#endif
+
+        void swizzleRow(const Bitmap& src, Bitmap& dst, uint32_t row, const std::vector<int>& swizzle) {
+
+            const int width = src.mWidth;
+#if LZVK_X86_SIMD
+            const bool rgbaToRgba = src.mChannels == 4 && swizzle.size() == 4;
+#endif
+            int x = 0;
+
+            if (src.mFormat == BitmapFormat::UnsignedByte) {
+
+                const uint8_t* in = src.mData.data() + row * getRowLength(src);
+                uint8_t* out = dst.mData.data() + row * getRowLength(dst);
+
+#if LZVK_X86_SIMD
+                // 1 RGBA8 to RGBA8 kernel
+                if (rgbaToRgba && hasAvx2()) {
+                    x = swizzleRowBytesAvx2(in, out, width, swizzle);
+                }
+#endif
+
+                swizzleRowScalar<uint8_t>(in, out, x, width, src.mChannels, swizzle, 255);
+                return;
+            }
+
+            const float* in = reinterpret_cast<const float*>(src.mData.data()) + row * getRowLength(src);
+            float* out = reinterpret_cast<float*>(dst.mData.data()) + row * getRowLength(dst);
+
+#if LZVK_X86_SIMD
+            // 2 Float RGBA to RGBA kernel
+            if (rgbaToRgba && hasAvx2()) {
+                x = swizzleRowFloatAvx2(in, out, width, swizzle);
+            }
+#endif
+
+            swizzleRowScalar<float>(in, out, x, width, src.mChannels, swizzle, 1.0f);
+        }
+
+#if LZVK_X86_SIMD
+
+        // One RGBA output per step from two source pixels of each row
+        int downsampleBoxRowSse(const float* row0, const float* row1, float* dst, int srcWidth, int dstWidth) {
+
+            const int pairs = std::min(dstWidth, srcWidth / 2);
+            const __m128 quarter = _mm_set1_ps(0.25f);
+
+            int x = 0;
+            for (; x < pairs; ++x) {
+
+                __m128 left = _mm_add_ps(_mm_loadu_ps(row0 + 8 * size_t(x)), _mm_loadu_ps(row1 + 8 * size_t(x)));
+                __m128 right = _mm_add_ps(_mm_loadu_ps(row0 + 8 * size_t(x) + 4), _mm_loadu_ps(row1 + 8 * size_t(x) + 4));
+
+                _mm_storeu_ps(dst + 4 * size_t(x), _mm_mul_ps(_mm_add_ps(left, right), quarter));
+            }
+
+            return x;
+        }
+
+        // Two RGBA outputs per step from four source pixels of each row. The row sum holds pixels
+        // [0 | 1] and [2 | 3] per register, the lane permutes line up [0 | 2] with [1 | 3]
+        LZVK_TARGET_AVX2 int downsampleBoxRowAvx2(const float* row0, const float* row1, float* dst, int srcWidth, int dstWidth) {
+
+            const int pairs = std::min(dstWidth, srcWidth / 2);
+            const __m256 quarter = _mm256_set1_ps(0.25f);
+
+            int x = 0;
+            for (; x + 2 <= pairs; x += 2) {
+
+                __m256 s0 = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * size_t(x)), _mm256_loadu_ps(row1 + 8 * size_t(x)));
+                __m256 s1 = _mm256_add_ps(_mm256_loadu_ps(row0 + 8 * size_t(x) + 8), _mm256_loadu_ps(row1 + 8 * size_t(x) + 8));
+
+                __m256 even = _mm256_permute2f128_ps(s0, s1, 0x20);
+                __m256 odd = _mm256_permute2f128_ps(s0, s1, 0x31);
+
+                _mm256_storeu_ps(dst + 4 * size_t(x), _mm256_mul_ps(_mm256_add_ps(even, odd), quarter));
+            }
+
+            return x;
+        }
+
+#endif
+
+        // 2x2 box filter of one output row, for even sizes. A size of 1 repeats its only texel
+        void downsampleBoxRow(const float* row0, const float* row1, float* dst, int srcWidth, int dstWidth, int channels) {
+
+            int x = 0;
+
+#if LZVK_X86_SIMD
+            // 1 RGBA kernels, the SSE2 one also takes the pair the AVX2 one leaves over
+            if (channels == 4) {
+                x = hasAvx2() ? downsampleBoxRowAvx2(row0, row1, dst, srcWidth, dstWidth) : 0;
+                x += downsampleBoxRowSse(row0 + 8 * size_t(x), row1 + 8 * size_t(x), dst + 4 * size_t(x), srcWidth - 2 * x, dstWidth - x);
+            }
+#endif
+
+            // 2 Remainder, or every output without the kernels
+            const int last = srcWidth - 1;
+
+            for (; x < dstWidth; ++x) {
+
+                const size_t x0 = size_t(std::min(2 * x, last)) * channels;
+                const size_t x1 = size_t(std::min(2 * x + 1, last)) * channels;
+
+                for (int c = 0; c < channels; ++c) {
+                    dst[size_t(x) * channels + c] = 0.25f * (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]);
+                }
+            }
+        }
+
+        // Modified Bessel function of the first kind, order 0
+        float besselI0(float x) {
+
+            float sum = 1.0f;
+            float term = 1.0f;
+            const float quarterSquare = 0.25f * x * x;
+
+            for (int k = 1; k < 32 && term > 1e-7f * sum; ++k) {
+                term *= quarterSquare / float(k * k);
+                sum += term;
+            }
+
+            return sum;
+        }
+
+        float getFilterRadius(ResizeFilter filter) {
+
+            switch (filter) {
+            case ResizeFilter::Box: return 0.5f;
+            case ResizeFilter::Triangle: return 1.0f;
+            case ResizeFilter::Kaiser: return KAISER_RADIUS;
+            default: return 0.5f;
+            }
+        }
+
+        float evaluateFilter(ResizeFilter filter, float x) {
+
+            switch (filter) {
+            case ResizeFilter::Box:
+                return x >= -0.5f && x < 0.5f ? 1.0f : 0.0f;
+
+            case ResizeFilter::Triangle:
+                return std::max(0.0f, 1.0f - std::abs(x));
+
+            case ResizeFilter::Kaiser: {
+                if (std::abs(x) >= KAISER_RADIUS) {
+                    return 0.0f;
+                }
+
+                const float ratio = x / KAISER_RADIUS;
+                const float window = besselI0(KAISER_BETA * std::sqrt(1.0f - ratio * ratio)) / besselI0(KAISER_BETA);
+                const float sinc = std::abs(x) < 1e-5f ? 1.0f : std::sin(glm::pi<float>() * x) / (glm::pi<float>() * x);
+                return sinc * window;
+            }
+
+            default:
+                return 0.0f;
+            }
+        }
+
+        // Taps of every output texel along one axis, all padded to tapCount with zero weights
+        struct Contributions {
+            int tapCount = 0;
+            std::vector<int> indices;
+            std::vector<float> weights;
+        };
+
+        Contributions getContributions(int srcSize, int dstSize, ResizeFilter filter) {
+
+            // 1 Minifying widens the filter so that every source texel contributes
+            const float scale = float(dstSize) / float(srcSize);
+            const float filterScale = std::max(1.0f, 1.0f / scale);
+            const float support = getFilterRadius(filter) * filterScale;
+
+            std::vector<std::vector<std::pair<int, float>>> taps(dstSize);
+            int tapCount = 1;
+
+            for (int i = 0; i < dstSize; ++i) {
+
+                const float center = (i + 0.5f) / scale;
+                const int first = int(std::floor(center - support - 0.5f));
+                const int last = int(std::ceil(center + support - 0.5f));
+
+                float total = 0.0f;
+                for (int j = first; j <= last; ++j) {
+
+                    float weight = evaluateFilter(filter, (j + 0.5f - center) / filterScale);
+                    if (weight != 0.0f) {
+                        taps[i].emplace_back(std::clamp(j, 0, srcSize - 1), weight);
+                        total += weight;
+                    }
+                }
+
+                // 2 Normalized so flat areas stay flat, a degenerate footprint takes the nearest texel
+                if (taps[i].empty() || std::abs(total) < 1e-6f) {
+                    taps[i].assign(1, { std::clamp(int(center), 0, srcSize - 1), 1.0f });
+                    total = 1.0f;
+                }
+
+                for (auto& tap : taps[i]) {
+                    tap.second /= total;
+                }
+
+                tapCount = std::max(tapCount, int(taps[i].size()));
+            }
+
+            Contributions contributions{};
+            contributions.tapCount = tapCount;
+            contributions.indices.resize(size_t(dstSize) * tapCount);
+            contributions.weights.resize(size_t(dstSize) * tapCount, 0.0f);
+
+            for (int i = 0; i < dstSize; ++i) {
+                for (int k = 0; k < tapCount; ++k) {
+                    const bool used = k < int(taps[i].size());
+                    contributions.indices[size_t(i) * tapCount + k] = used ? taps[i][k].first : taps[i].back().first;
+                    contributions.weights[size_t(i) * tapCount + k] = used ? taps[i][k].second : 0.0f;
+                }
+            }
+
+            return contributions;
+        }
+
+#if LZVK_X86_SIMD
+
+        // RGBA rows, one pixel per register
+        void resizeRowHorizontalSse(const float* src, float* dst, int dstWidth, const Contributions& contributions) {
+
+            const int tapCount = contributions.tapCount;
+
+            for (int x = 0; x < dstWidth; ++x) {
+
+                const int* indices = &contributions.indices[size_t(x) * tapCount];
+                const float* weights = &contributions.weights[size_t(x) * tapCount];
+
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < tapCount; ++k) {
+                    sum = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + 4 * size_t(indices[k])), _mm_set1_ps(weights[k])), sum);
+                }
+
+                _mm_storeu_ps(dst + 4 * size_t(x), sum);
+            }
+        }
+
+        size_t resizeRowVerticalSse(const float* const* rows, const float* weights, int tapCount, float* dst, size_t count) {
+
+            size_t i = 0;
+
+            for (; i + 4 <= count; i += 4) {
+
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < tapCount; ++k) {
+                    sum = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(rows[k] + i), _mm_set1_ps(weights[k])), sum);
+                }
+
+                _mm_storeu_ps(dst + i, sum);
+            }
+
+            return i;
+        }
+
+        // Same with FMA
+        LZVK_TARGET_AVX2 void resizeRowHorizontalAvx2(const float* src, float* dst, int dstWidth, const Contributions& contributions) {
+
+            const int tapCount = contributions.tapCount;
+
+            for (int x = 0; x < dstWidth; ++x) {
+
+                const int* indices = &contributions.indices[size_t(x) * tapCount];
+                const float* weights = &contributions.weights[size_t(x) * tapCount];
+
+                __m128 sum = _mm_setzero_ps();
+                for (int k = 0; k < tapCount; ++k) {
+                    sum = _mm_fmadd_ps(_mm_loadu_ps(src + 4 * size_t(indices[k])), _mm_set1_ps(weights[k]), sum);
+                }
+
+                _mm_storeu_ps(dst + 4 * size_t(x), sum);
+            }
+        }
+
+        LZVK_TARGET_AVX2 size_t resizeRowVerticalAvx2(const float* const* rows, const float* weights, int tapCount, float* dst, size_t count) {
+
+            size_t i = 0;
+
+            for (; i + 8 <= count; i += 8) {
+
+                __m256 sum = _mm256_setzero_ps();
+                for (int k = 0; k < tapCount; ++k) {
+                    sum = _mm256_fmadd_ps(_mm256_loadu_ps(rows[k] + i), _mm256_set1_ps(weights[k]), sum);
+                }
+
+                _mm256_storeu_ps(dst + i, sum);
+            }
+
+            return i;
+        }
+
+#endif
+
+        void resizeRowHorizontal(const float* src, float* dst, int dstWidth, int channels, const Contributions& contributions) {
+
+#if LZVK_X86_SIMD
+            if (channels == 4) {
+
+                if (hasAvx2()) {
+                    resizeRowHorizontalAvx2(src, dst, dstWidth, contributions);
+                }
+                else {
+                    resizeRowHorizontalSse(src, dst, dstWidth, contributions);
+                }
+
+                return;
+            }
+#endif
+
+            const int tapCount = contributions.tapCount;
+
+            for (int x = 0; x < dstWidth; ++x) {
+
+                const int* indices = &contributions.indices[size_t(x) * tapCount];
+                const float* weights = &contributions.weights[size_t(x) * tapCount];
+                float* out = dst + size_t(x) * channels;
+
+                for (int c = 0; c < channels; ++c) {
+
+                    float sum = 0.0f;
+                    for (int k = 0; k < tapCount; ++k) {
+                        sum += src[size_t(indices[k]) * channels + c] * weights[k];
+                    }
+
+                    out[c] = sum;
+                }
+            }
+        }
+
+        // rows[k] is the source row of tap k, the whole output row is one weighted sum
+        void resizeRowVertical(const float* const* rows, const float* weights, int tapCount, float* dst, size_t count) {
+
+            size_t i = 0;
+
+#if LZVK_X86_SIMD
+            i = hasAvx2() ? resizeRowVerticalAvx2(rows, weights, tapCount, dst, count) : resizeRowVerticalSse(rows, weights, tapCount, dst, count);
+#endif
+
+            for (; i < count; ++i) {
+
+                float sum = 0.0f;
+                for (int k = 0; k < tapCount; ++k) {
+                    sum += rows[k][i] * weights[k];
+                }
+
+                dst[i] = sum;
+            }
+        }
+
+        // Box taps of one axis. Even sizes average texel pairs, a size of 1 keeps its texel. An
+        // odd size 2n + 1 maps onto n outputs that each cover (2n + 1) / n texels, so output x
+        // weighs texels 2x, 2x + 1 and 2x + 2 by (n - x), n and (x + 1) over 2n + 1 and the
+        // last row or column still counts
+        Contributions getBoxContributions(int srcSize, int dstSize) {
+
+            const bool odd = srcSize > 1 && srcSize % 2 == 1;
+
+            Contributions contributions{};
+            contributions.tapCount = odd ? 3 : 2;
+            contributions.indices.resize(size_t(dstSize) * contributions.tapCount);
+            contributions.weights.resize(size_t(dstSize) * contributions.tapCount);
+
+            for (int x = 0; x < dstSize; ++x) {
+
+                int* indices = &contributions.indices[size_t(x) * contributions.tapCount];
+                float* weights = &contributions.weights[size_t(x) * contributions.tapCount];
+
+                if (odd) {
+                    const float n = float(dstSize);
+                    indices[0] = 2 * x;
+                    indices[1] = 2 * x + 1;
+                    indices[2] = 2 * x + 2;
+                    weights[0] = (n - x) / srcSize;
+                    weights[1] = n / srcSize;
+                    weights[2] = (x + 1.0f) / srcSize;
+                }
+                else {
+                    indices[0] = std::min(2 * x, srcSize - 1);
+                    indices[1] = std::min(2 * x + 1, srcSize - 1);
+                    weights[0] = 0.5f;
+                    weights[1] = 0.5f;
+                }
+            }
+
+            return contributions;
+        }
+
+        // Both passes of resize with the taps of each axis given, also used by the odd box sizes
+        Bitmap resizeSeparable(const Bitmap& src, int width, int height, const Contributions& horizontal, const Contributions& vertical, uint32_t threadCount) {
+
+            const int channels = src.mChannels;
+
+            // 1 Horizontal pass into every source row at the new width
+            Bitmap temp(width, src.mHeight, src.mDepth, channels, BitmapFormat::Float);
+
+            const float* in = reinterpret_cast<const float*>(src.mData.data());
+            float* between = reinterpret_cast<float*>(temp.mData.data());
+            const size_t srcRowLength = getRowLength(src);
+            const size_t rowLength = getRowLength(temp);
+
+            const uint32_t tempRowCount = getRowCount(temp);
+            forEachRow(tempRowCount, getThreadCount(threadCount, tempRowCount), [&](uint32_t row, uint32_t) {
+                resizeRowHorizontal(in + row * srcRowLength, between + row * rowLength, width, channels, horizontal);
+            });
+
+            // 2 Vertical pass, each output row is a weighted sum of whole rows within its slice
+            Bitmap result(width, height, src.mDepth, channels, BitmapFormat::Float);
+            float* out = reinterpret_cast<float*>(result.mData.data());
+
+            const int tapCount = vertical.tapCount;
+            const uint32_t rowCount = getRowCount(result);
+
+            forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+
+                const size_t z = row / uint32_t(height);
+                const size_t y = row % uint32_t(height);
+
+                std::vector<const float*> rows(tapCount);
+                for (int k = 0; k < tapCount; ++k) {
+                    rows[k] = between + (z * src.mHeight + vertical.indices[y * tapCount + k]) * rowLength;
+                }
+
+                resizeRowVertical(rows.data(), &vertical.weights[y * tapCount], tapCount, out + row * rowLength, rowLength);
+            });
+
+            return result;
+        }
+
+        Bitmap downsampleBox(const Bitmap& src, uint32_t threadCount) {
+
+            const int width = std::max(1, src.mWidth / 2);
+            const int height = std::max(1, src.mHeight / 2);
+
+            // 1 Odd sizes of 3 or more take three weighted taps on that axis
+            const bool oddWidth = src.mWidth > 1 && src.mWidth % 2 == 1;
+            const bool oddHeight = src.mHeight > 1 && src.mHeight % 2 == 1;
+
+            if (oddWidth || oddHeight) {
+                return resizeSeparable(src, width, height, getBoxContributions(src.mWidth, width), getBoxContributions(src.mHeight, height), threadCount);
+            }
+
+            // 2 Even sizes average 2x2 texels in one pass
+            const int last = src.mHeight - 1;
+
+            Bitmap result(width, height, src.mDepth, src.mChannels, BitmapFormat::Float);
+
+            const float* in = reinterpret_cast<const float*>(src.mData.data());
+            float* out = reinterpret_cast<float*>(result.mData.data());
+            const size_t srcRowLength = getRowLength(src);
+
+            const uint32_t rowCount = getRowCount(result);
+            forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+
+                const size_t z = row / uint32_t(height);
+                const int y = int(row % uint32_t(height));
+
+                const float* row0 = in + (z * src.mHeight + std::min(2 * y, last)) * srcRowLength;
+                const float* row1 = in + (z * src.mHeight + std::min(2 * y + 1, last)) * srcRowLength;
+
+                downsampleBoxRow(row0, row1, out + row * getRowLength(result), src.mWidth, width, src.mChannels);
+            });
+
+            return result;
+        }
+    }
+
+    Bitmap convertFormat(const Bitmap& src, BitmapFormat format, bool srgb, uint32_t threadCount) {
+
+        if (src.mFormat == format) {
+            return src;
+        }
+
+        Bitmap result(src.mWidth, src.mHeight, src.mDepth, src.mChannels, format);
+
+        const size_t rowLength = getRowLength(src);
+        const uint32_t rowCount = getRowCount(src);
+
+        forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+
+            if (format == BitmapFormat::Float) {
+                byteToFloatRow(src.mData.data() + row * rowLength, reinterpret_cast<float*>(result.mData.data()) + row * rowLength, rowLength, src.mChannels, srgb);
+            }
+            else {
+                floatToByteRow(reinterpret_cast<const float*>(src.mData.data()) + row * rowLength, result.mData.data() + row * rowLength, rowLength, src.mChannels, srgb);
+            }
+        });
+
+        return result;
+    }
+
+    void srgbToLinear(Bitmap& bitmap, uint32_t threadCount) {
+
+        checkFloat(bitmap, "srgbToLinear");
+
+        const size_t rowLength = getRowLength(bitmap);
+        const uint32_t rowCount = getRowCount(bitmap);
+        float* data = reinterpret_cast<float*>(bitmap.mData.data());
+
+        forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+            srgbToLinearRow(data + row * rowLength, rowLength, bitmap.mChannels);
+        });
+    }
+
+    void linearToSrgb(Bitmap& bitmap, uint32_t threadCount) {
+
+        checkFloat(bitmap, "linearToSrgb");
+
+        const size_t rowLength = getRowLength(bitmap);
+        const uint32_t rowCount = getRowCount(bitmap);
+        float* data = reinterpret_cast<float*>(bitmap.mData.data());
+
+        forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+            linearToSrgbRow(data + row * rowLength, rowLength, bitmap.mChannels);
+        });
+    }
+
+    Bitmap swizzleChannels(const Bitmap& src, const std::vector<int>& swizzle, uint32_t threadCount) {
+
+        if (swizzle.empty() || swizzle.size() > 4) {
+            throw std::runtime_error("Error: a swizzle needs one to four output channels");
+        }
+
+        for (int channel : swizzle) {
+            if (channel >= src.mChannels || (channel < 0 && channel != SWIZZLE_ZERO && channel != SWIZZLE_ONE)) {
+                throw std::runtime_error("Error: swizzle reads a channel the bitmap does not have");
+            }
+        }
+
+        Bitmap result(src.mWidth, src.mHeight, src.mDepth, int(swizzle.size()), src.mFormat);
+
+        const uint32_t rowCount = getRowCount(src);
+        forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+            swizzleRow(src, result, row, swizzle);
+        });
+
+        return result;
+    }
+
+    Bitmap resize(const Bitmap& src, int width, int height, ResizeFilter filter, uint32_t threadCount) {
+
+        checkFloat(src, "resize");
+
+        if (width <= 0 || height <= 0 || src.mWidth <= 0 || src.mHeight <= 0) {
+            throw std::runtime_error("Error: resize needs a non empty source and target size");
+        }
+
+        return resizeSeparable(src, width, height, getContributions(src.mWidth, width, filter), getContributions(src.mHeight, height, filter), threadCount);
+    }
+
+    Bitmap downsample(const Bitmap& src, ResizeFilter filter, uint32_t threadCount) {
+
+        checkFloat(src, "downsample");
+
+        if (filter == ResizeFilter::Box) {
+            return downsampleBox(src, threadCount);
+        }
+
+        return resize(src, std::max(1, src.mWidth / 2), std::max(1, src.mHeight / 2), filter, threadCount);
+    }
+
+    std::vector<Bitmap> generateMipLevels(const Bitmap& src, ResizeFilter filter, uint32_t threadCount) {
+
+        checkFloat(src, "generateMipLevels");
+
+        std::vector<Bitmap> levels{ src };
+        while (levels.back().mWidth > 1 || levels.back().mHeight > 1) {
+            levels.push_back(downsample(levels.back(), filter, threadCount));
+        }
+
+        return levels;
+    }
+}
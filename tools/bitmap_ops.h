@@ -0,0 +1,78 @@
+#pragma once
+
+#include "bitmap.h"
+#include <thread>
+
+namespace lzvk::tools {
+
+    // Bulk operations over whole Bitmaps, without the per texel glm::vec4 of getPixelFloat and
+    // setPixelFloat. Rows of every depth slice are interleaved across threadCount threads, 0 uses
+    // every hardware thread, and each row runs an AVX2 kernel when the CPU has it, an SSE2 one on
+    // other x86-64 CPUs or a scalar loop elsewhere. Filtering runs on Float bitmaps, decode RGBA8
+    // with convertFormat first so that sRGB data is filtered in linear space.
+
+    enum class ResizeFilter {
+        Box,        // average of the covered texels
+        Triangle,   // bilinear, widened when minifying
+        Kaiser      // Kaiser windowed sinc, sharper mips with little ringing
+    };
+
+    // Swizzle entries besides the source channel indices
+    constexpr int SWIZZLE_ZERO = -1;
+    constexpr int SWIZZLE_ONE = -2;
+
+    inline uint32_t getThreadCount(uint32_t threadCount, uint32_t rowCount) {
+
+        if (threadCount == 0) {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        return std::max(1u, std::min(threadCount, rowCount));
+    }
+
+    // Calls function(row, slice) for every row below rowCount, threadCount as returned by
+    // getThreadCount. Rows are interleaved over the threads, the calling thread runs slice 0
+    template <typename RowFunction>
+    void forEachRow(uint32_t rowCount, uint32_t threadCount, const RowFunction& function) {
+
+        auto runSlice = [&](uint32_t slice) {
+            for (uint32_t row = slice; row < rowCount; row += threadCount) {
+                function(row, slice);
+            }
+        };
+
+        std::vector<std::thread> threads{};
+        for (uint32_t t = 1; t < threadCount; ++t) {
+            threads.emplace_back(runSlice, t);
+        }
+
+        runSlice(0);
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    // UnsignedByte to Float or back, channels unchanged. srgb decodes or encodes the first three
+    // channels, a fourth stays linear
+    Bitmap convertFormat(const Bitmap& src, BitmapFormat format, bool srgb = false, uint32_t threadCount = 0);
+
+    // In place on Float bitmaps, values are clamped to [0, 1] and a fourth channel is left alone
+    void srgbToLinear(Bitmap& bitmap, uint32_t threadCount = 0);
+    void linearToSrgb(Bitmap& bitmap, uint32_t threadCount = 0);
+
+    // Output channel i reads source channel swizzle[i], or SWIZZLE_ZERO / SWIZZLE_ONE. Packs or
+    // widens when the counts differ, e.g. { 0, 1, 2, SWIZZLE_ONE } turns RGB into opaque RGBA
+    Bitmap swizzleChannels(const Bitmap& src, const std::vector<int>& swizzle, uint32_t threadCount = 0);
+
+    // Separable resize of a Float bitmap, every depth slice on its own, taps clamp at the edges
+    Bitmap resize(const Bitmap& src, int width, int height, ResizeFilter filter, uint32_t threadCount = 0);
+
+    // Next mip level of a Float bitmap, half the size rounded down and at least 1. Box averages
+    // 2x2 texels, an odd axis of 3 or more weighs 3 texels per output so its last row or column
+    // is not dropped. The other filters go through resize
+    Bitmap downsample(const Bitmap& src, ResizeFilter filter = ResizeFilter::Box, uint32_t threadCount = 0);
+
+    // A copy of src followed by every downsampled level down to 1x1
+    std::vector<Bitmap> generateMipLevels(const Bitmap& src, ResizeFilter filter = ResizeFilter::Box, uint32_t threadCount = 0);
+}
@@ -0,0 +1,455 @@
+#include "ibl_baker.h"
+#include "tools.h"
+#include "bitmap_ops.h"
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+namespace lzvk::tools {
+
+    namespace {
+
+        // Bump when the baking changes its results, cached bakes are then redone
+        constexpr uint32_t IBL_BAKE_VERSION = 1;
+
+        constexpr uint32_t BAKE_CACHE_MAGIC = 0x42495a4c; // "LZIB"
+        constexpr uint32_t BAKE_CACHE_VERSION = 1;
+
+        struct BakeCacheHeader {
+            uint32_t magic{ BAKE_CACHE_MAGIC };
+            uint32_t fileVersion{ BAKE_CACHE_VERSION };
+            uint64_t key{ 0 };
+            uint32_t levelCount{ 0 };
+            uint32_t reserved{ 0 };
+        };
+
+        struct BakeCacheLevel {
+            int32_t width{ 0 };
+            int32_t height{ 0 };
+            int32_t depth{ 0 };
+            int32_t channels{ 0 };
+        };
+
+        double getMilliseconds(std::chrono::steady_clock::time_point start) {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        void checkCubemap(const Bitmap& cubemap) {
+
+            if (cubemap.mFormat != BitmapFormat::Float || cubemap.mChannels != 4 || cubemap.mDepth != 6 || cubemap.mWidth != cubemap.mHeight || cubemap.mWidth == 0) {
+                throw std::runtime_error("Error: IBL baking expects a float RGBA cube map with square faces");
+            }
+        }
+
+        const float* getTexel(const Bitmap& cubemap, int face, int x, int y) {
+            return reinterpret_cast<const float*>(cubemap.mData.data()) + 4 * ((size_t(face) * cubemap.mHeight + y) * cubemap.mWidth + x);
+        }
+
+        float* getTexel(Bitmap& cubemap, int face, int x, int y) {
+            return reinterpret_cast<float*>(cubemap.mData.data()) + 4 * ((size_t(face) * cubemap.mHeight + y) * cubemap.mWidth + x);
+        }
+
+        // Solid angle of the face area between the corner and (x, y), x and y in [-1, 1]
+        double getAreaElement(double x, double y) {
+            return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0));
+        }
+
+        // Solid angle of every texel of a face, the same for all six. Texels share their corners,
+        // so the area elements are evaluated once per corner
+        std::vector<double> getTexelSolidAngles(int faceSize) {
+
+            const int cornerCount = faceSize + 1;
+
+            std::vector<double> corners(size_t(cornerCount) * cornerCount);
+            for (int y = 0; y < cornerCount; ++y) {
+                for (int x = 0; x < cornerCount; ++x) {
+                    corners[size_t(y) * cornerCount + x] = getAreaElement(2.0 * x / faceSize - 1.0, 2.0 * y / faceSize - 1.0);
+                }
+            }
+
+            std::vector<double> solidAngles(size_t(faceSize) * faceSize);
+            for (int j = 0; j < faceSize; ++j) {
+                for (int i = 0; i < faceSize; ++i) {
+
+                    const double* row0 = corners.data() + size_t(j) * cornerCount;
+                    const double* row1 = row0 + cornerCount;
+                    solidAngles[size_t(j) * faceSize + i] = row0[i] - row1[i] - row0[i + 1] + row1[i + 1];
+                }
+            }
+
+            return solidAngles;
+        }
+
+        // Real SH basis up to band 2, must match evaluateIrradianceSH in the scene shaders
+        std::array<float, 9> getSHBasis(const glm::vec3& d) {
+            return {
+                0.282095f,
+                0.488603f * d.y,
+                0.488603f * d.z,
+                0.488603f * d.x,
+                1.092548f * d.x * d.y,
+                1.092548f * d.y * d.z,
+                0.315392f * (3.0f * d.z * d.z - 1.0f),
+                1.092548f * d.x * d.z,
+                0.546274f * (d.x * d.x - d.y * d.y)
+            };
+        }
+
+        // Bilinear tap of a face, texel centers at whole coordinates, clamped to the face
+        glm::vec4 sampleFace(const Bitmap& cubemap, int face, float x, float y) {
+
+            const int last = cubemap.mWidth - 1;
+
+            float fx = std::floor(x);
+            float fy = std::floor(y);
+            float s = x - fx;
+            float t = y - fy;
+
+            int x0 = std::clamp(int(fx), 0, last);
+            int y0 = std::clamp(int(fy), 0, last);
+            int x1 = std::clamp(int(fx) + 1, 0, last);
+            int y1 = std::clamp(int(fy) + 1, 0, last);
+
+            const float* A = getTexel(cubemap, face, x0, y0);
+            const float* B = getTexel(cubemap, face, x1, y0);
+            const float* C = getTexel(cubemap, face, x0, y1);
+            const float* D = getTexel(cubemap, face, x1, y1);
+
+            glm::vec4 color{};
+            for (int c = 0; c < 4; ++c) {
+                color[c] = (A[c] * (1 - s) + B[c] * s) * (1 - t) + (C[c] * (1 - s) + D[c] * s) * t;
+            }
+
+            return color;
+        }
+
+        // Face selection of Vulkan cube sampling, the inverse of Tools::faceCoordsToXYZ
+        glm::vec4 sampleCube(const Bitmap& cubemap, const glm::vec3& dir) {
+
+            glm::vec3 a = glm::abs(dir);
+            int face = 0;
+            float ma = 0.0f, sc = 0.0f, tc = 0.0f;
+
+            if (a.x >= a.y && a.x >= a.z) {
+                face = dir.x > 0.0f ? 0 : 1;
+                ma = a.x;
+                sc = dir.x > 0.0f ? -dir.z : dir.z;
+                tc = -dir.y;
+            }
+            else if (a.y >= a.z) {
+                face = dir.y > 0.0f ? 2 : 3;
+                ma = a.y;
+                sc = dir.x;
+                tc = dir.y > 0.0f ? dir.z : -dir.z;
+            }
+            else {
+                face = dir.z > 0.0f ? 4 : 5;
+                ma = a.z;
+                sc = dir.z > 0.0f ? dir.x : -dir.x;
+                tc = -dir.y;
+            }
+
+            const float size = float(cubemap.mWidth);
+            return sampleFace(cubemap, face, 0.5f * (sc / ma + 1.0f) * size - 0.5f, 0.5f * (tc / ma + 1.0f) * size - 0.5f);
+        }
+
+        glm::vec2 getHammersley(uint32_t i, uint32_t count) {
+
+            uint32_t bits = i;
+            bits = (bits << 16u) | (bits >> 16u);
+            bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+            bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+            bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+            bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+
+            return { float(i) / float(count), float(bits) * 2.3283064365386963e-10f };
+        }
+
+        // Light direction in the tangent frame of the normal, its weight and the source level it reads
+        struct SpecularSample {
+            glm::vec3 direction;
+            float weight;
+            float level;
+        };
+
+        // The view is taken along the normal, so every texel of a level shares the same samples
+        std::vector<SpecularSample> getSpecularSamples(float roughness, uint32_t sampleCount, int faceSize) {
+
+            const float alpha = roughness * roughness;
+            const float alpha2 = alpha * alpha;
+            const float texelSolidAngle = 4.0f * glm::pi<float>() / (6.0f * faceSize * faceSize);
+
+            std::vector<SpecularSample> samples{};
+
+            for (uint32_t i = 0; i < sampleCount; ++i) {
+
+                // 1 Half vector from the GGX distribution
+                glm::vec2 xi = getHammersley(i, sampleCount);
+
+                float phi = 2.0f * glm::pi<float>() * xi.x;
+                float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (alpha2 - 1.0f) * xi.y));
+                float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+                glm::vec3 H{ sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta };
+                glm::vec3 L = 2.0f * H.z * H - glm::vec3(0.0f, 0.0f, 1.0f);
+
+                if (L.z <= 0.0f) {
+                    continue;
+                }
+
+                // 2 Filtered importance sampling, pdf of L is D / 4 with the view along the normal
+                float d = cosTheta * cosTheta * (alpha2 - 1.0f) + 1.0f;
+                float pdf = alpha2 / (glm::pi<float>() * d * d) / 4.0f;
+                float sampleSolidAngle = 1.0f / (float(sampleCount) * pdf + 1e-6f);
+
+                float level = std::max(0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f, 0.0f);
+
+                samples.push_back({ L, L.z, level });
+            }
+
+            return samples;
+        }
+    }
+
+    IrradianceSH projectIrradianceSH(const Bitmap& cubemap, uint32_t threadCount) {
+
+        checkCubemap(cubemap);
+
+        const int faceSize = cubemap.mWidth;
+        const uint32_t rowCount = 6 * uint32_t(faceSize);
+        threadCount = getThreadCount(threadCount, rowCount);
+
+        const auto solidAngles = getTexelSolidAngles(faceSize);
+
+        // 1 Every thread sums its rows, in double so the small texels of large faces still count
+        std::vector<std::array<glm::dvec3, 9>> sums(threadCount);
+
+        forEachRow(rowCount, threadCount, [&](uint32_t row, uint32_t slice) {
+
+            const int face = int(row) / faceSize;
+            const int j = int(row) % faceSize;
+            auto& sum = sums[slice];
+
+            for (int i = 0; i < faceSize; ++i) {
+
+                const float* texel = getTexel(cubemap, face, i, j);
+                glm::dvec3 radiance = glm::dvec3(texel[0], texel[1], texel[2]) * solidAngles[size_t(j) * faceSize + i];
+                auto basis = getSHBasis(Tools::faceCoordsToXYZ(i, j, face, faceSize));
+
+                for (int k = 0; k < 9; ++k) {
+                    sum[k] += radiance * double(basis[k]);
+                }
+            }
+        });
+
+        // 2 Clamped cosine convolution per band, pi, 2 pi / 3 and pi / 4, then divided by pi
+        const double bandFactors[9] = { 1.0, 2.0 / 3.0, 2.0 / 3.0, 2.0 / 3.0, 0.25, 0.25, 0.25, 0.25, 0.25 };
+
+        IrradianceSH irradiance{};
+        for (int k = 0; k < 9; ++k) {
+
+            glm::dvec3 total{ 0.0 };
+            for (const auto& sum : sums) {
+                total += sum[k];
+            }
+
+            irradiance.coefficients[k] = glm::vec4(glm::vec3(total * bandFactors[k]), 0.0f);
+        }
+
+        return irradiance;
+    }
+
+    std::vector<Bitmap> prefilterSpecular(const Bitmap& cubemap, uint32_t levelCount, uint32_t sampleCount, uint32_t threadCount) {
+
+        checkCubemap(cubemap);
+
+        // 1 Box filtered source chain down to 1x1, the samples of rough levels read the small ones
+        std::vector<Bitmap> source{};
+        for (int size = cubemap.mWidth / 2; size >= 1; size /= 2) {
+            source.push_back(downsample(source.empty() ? cubemap : source.back(), ResizeFilter::Box, threadCount));
+        }
+
+        auto getSource = [&](int level) -> const Bitmap& {
+            return level == 0 ? cubemap : source[level - 1];
+        };
+
+        const int maxSourceLevel = int(source.size());
+
+        auto sampleSource = [&](const glm::vec3& dir, float level) {
+
+            level = std::min(level, float(maxSourceLevel));
+
+            int level0 = int(level);
+            int level1 = std::min(level0 + 1, maxSourceLevel);
+            float t = level - level0;
+
+            glm::vec4 color = sampleCube(getSource(level0), dir);
+            return t > 0.0f ? glm::mix(color, sampleCube(getSource(level1), dir), t) : color;
+        };
+
+        // 2 Level 0 is the mirror reflection, every later one halves the faces
+        levelCount = std::clamp(levelCount, 1u, uint32_t(maxSourceLevel) + 1);
+        sampleCount = std::max(1u, sampleCount);
+
+        std::vector<Bitmap> levels{};
+        levels.push_back(cubemap);
+
+        for (uint32_t level = 1; level < levelCount; ++level) {
+
+            const int size = std::max(1, cubemap.mWidth >> level);
+            const float roughness = levelCount > 1 ? float(level) / float(levelCount - 1) : 0.0f;
+            const auto samples = getSpecularSamples(roughness, sampleCount, cubemap.mWidth);
+
+            Bitmap result(size, size, 6, 4, BitmapFormat::Float);
+
+            const uint32_t rowCount = 6 * uint32_t(size);
+            forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+
+                const int face = int(row) / size;
+                const int j = int(row) % size;
+
+                for (int i = 0; i < size; ++i) {
+
+                    // 3 Tangent frame of the texel direction, the samples are rotated into it
+                    glm::vec3 N = Tools::faceCoordsToXYZ(i, j, face, size);
+                    glm::vec3 up = std::abs(N.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                    glm::vec3 T = glm::normalize(glm::cross(up, N));
+                    glm::vec3 B = glm::cross(N, T);
+
+                    glm::vec4 color{ 0.0f };
+                    float totalWeight = 0.0f;
+
+                    for (const auto& sample : samples) {
+
+                        glm::vec3 L = T * sample.direction.x + B * sample.direction.y + N * sample.direction.z;
+                        color += sampleSource(L, sample.level) * sample.weight;
+                        totalWeight += sample.weight;
+                    }
+
+                    color /= std::max(totalWeight, 1e-6f);
+
+                    float* dst = getTexel(result, face, i, j);
+                    dst[0] = color.r;
+                    dst[1] = color.g;
+                    dst[2] = color.b;
+                    dst[3] = 1.0f;
+                }
+            });
+
+            levels.push_back(std::move(result));
+        }
+
+        return levels;
+    }
+
+    BakedEnvironment bakeEnvironment(const Bitmap& equirect, const IblSettings& settings) {
+
+        if (equirect.mFormat != BitmapFormat::Float || equirect.mChannels != 4) {
+            throw std::runtime_error("Error: IBL baking expects a float RGBA equirectangular image");
+        }
+
+        BakedEnvironment baked{};
+
+        // 1 Faces of a quarter of the width
+        auto start = std::chrono::steady_clock::now();
+        Bitmap cubemap = Tools::convertEquirectangularToCubemapFaces(equirect, settings.threadCount);
+        baked.cubeMs = getMilliseconds(start);
+
+        // 2 Diffuse
+        start = std::chrono::steady_clock::now();
+        baked.irradiance = projectIrradianceSH(cubemap, settings.threadCount);
+        baked.irradianceMs = getMilliseconds(start);
+
+        // 3 Specular
+        start = std::chrono::steady_clock::now();
+        baked.specularLevels = prefilterSpecular(cubemap, settings.specularLevelCount, settings.specularSampleCount, settings.threadCount);
+        baked.specularMs = getMilliseconds(start);
+
+        return baked;
+    }
+
+    uint64_t getBakedEnvironmentKey(const std::string& sourcePath, const IblSettings& settings) {
+
+        std::error_code error{};
+        const uint64_t modifiedTime = static_cast<uint64_t>(std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count());
+        const uint64_t fileSize = static_cast<uint64_t>(std::filesystem::file_size(sourcePath, error));
+
+        // FNV-1a over the fields, the thread count does not change the result
+        uint64_t key = 0xcbf29ce484222325ull;
+        for (uint64_t word : { uint64_t(IBL_BAKE_VERSION), modifiedTime, fileSize, uint64_t(settings.specularLevelCount), uint64_t(settings.specularSampleCount) }) {
+            key = (key ^ word) * 0x100000001b3ull;
+        }
+
+        return key;
+    }
+
+    bool loadBakedEnvironment(const std::string& path, uint64_t key, BakedEnvironment& baked) {
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+
+        // 1 Header, another format or key is a miss
+        BakeCacheHeader header{};
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+            header.magic != BAKE_CACHE_MAGIC || header.fileVersion != BAKE_CACHE_VERSION || header.key != key || header.levelCount == 0) {
+            return false;
+        }
+
+        // 2 SH block and the levels, largest first
+        BakedEnvironment loaded{};
+        if (!file.read(reinterpret_cast<char*>(&loaded.irradiance), sizeof(loaded.irradiance))) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < header.levelCount; ++i) {
+
+            BakeCacheLevel level{};
+            if (!file.read(reinterpret_cast<char*>(&level), sizeof(level)) || level.width <= 0 || level.height <= 0 || level.depth != 6 || level.channels != 4) {
+                return false;
+            }
+
+            Bitmap bitmap(level.width, level.height, level.depth, level.channels, BitmapFormat::Float);
+            if (!file.read(reinterpret_cast<char*>(bitmap.mData.data()), bitmap.mData.size())) {
+                return false;
+            }
+
+            loaded.specularLevels.push_back(std::move(bitmap));
+        }
+
+        baked = std::move(loaded);
+        return true;
+    }
+
+    void saveBakedEnvironment(const std::string& path, uint64_t key, const BakedEnvironment& baked) {
+
+        std::error_code error{};
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            printf("[IblBaker] failed to open %s for writing\n", path.c_str());
+            return;
+        }
+
+        BakeCacheHeader header{};
+        header.key = key;
+        header.levelCount = static_cast<uint32_t>(baked.specularLevels.size());
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&baked.irradiance), sizeof(baked.irradiance));
+
+        for (const auto& bitmap : baked.specularLevels) {
+
+            BakeCacheLevel level{ bitmap.mWidth, bitmap.mHeight, bitmap.mDepth, bitmap.mChannels };
+            file.write(reinterpret_cast<const char*>(&level), sizeof(level));
+            file.write(reinterpret_cast<const char*>(bitmap.mData.data()), bitmap.mData.size());
+        }
+
+        if (!file) {
+            printf("[IblBaker] failed to write %s\n", path.c_str());
+        }
+    }
+}
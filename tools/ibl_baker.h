@@ -0,0 +1,57 @@
+#pragma once
+
+#include "bitmap.h"
+
+namespace lzvk::tools {
+
+    // Order-2 spherical harmonics of the diffuse irradiance, already convolved with the clamped
+    // cosine and divided by pi so that a white environment gives 1. Coefficients follow the usual
+    // real basis order L00, L1-1, L10, L11, L2-2, L2-1, L20, L21, L22, w is unused.
+    // Laid out like the std140 block the scene shaders read
+    struct IrradianceSH {
+        glm::vec4 coefficients[9]{};
+    };
+
+    struct IblSettings {
+
+        // levels of the specular chain, level i is prefiltered for roughness i / (levels - 1)
+        uint32_t specularLevelCount = 6;
+
+        // GGX samples per texel, each one reads the source level its solid angle covers
+        uint32_t specularSampleCount = 32;
+
+        // 0 uses every hardware thread
+        uint32_t threadCount = 0;
+    };
+
+    struct BakedEnvironment {
+
+        // Cube map chain largest first, each level a Bitmap with depth 6 in the face order of
+        // Tools::convertEquirectangularToCubemapFaces. Level 0 is the environment itself
+        std::vector<Bitmap> specularLevels;
+        IrradianceSH irradiance{};
+
+        double cubeMs = 0.0;
+        double irradianceMs = 0.0;
+        double specularMs = 0.0;
+    };
+
+    // Projects a float RGBA cube map onto the SH basis, every texel weighted by its solid angle
+    IrradianceSH projectIrradianceSH(const Bitmap& cubemap, uint32_t threadCount = 0);
+
+    // GGX prefiltered chain of a float RGBA cube map, importance sampled with the view along the normal.
+    // Samples read a box filtered chain of the source at the level matching their solid angle
+    std::vector<Bitmap> prefilterSpecular(const Bitmap& cubemap, uint32_t levelCount, uint32_t sampleCount, uint32_t threadCount = 0);
+
+    // Equirectangular float RGBA image to the cube map, its specular chain and its irradiance
+    BakedEnvironment bakeEnvironment(const Bitmap& equirect, const IblSettings& settings = {});
+
+    // Key of a cached bake, changes with the source file's modification time and size, the settings
+    // that shape the result and IBL_BAKE_VERSION
+    uint64_t getBakedEnvironmentKey(const std::string& sourcePath, const IblSettings& settings = {});
+
+    // The bake on disk: a header with the key, the SH block, then every level as its extent and floats.
+    // A missing file, another format version or another key loads as a miss, timings are not stored
+    bool loadBakedEnvironment(const std::string& path, uint64_t key, BakedEnvironment& baked);
+    void saveBakedEnvironment(const std::string& path, uint64_t key, const BakedEnvironment& baked);
+}
@@ -0,0 +1,104 @@
+#include "mesh_lod.h"
+#include <cfloat>
+
+namespace lzvk::tools {
+
+    std::vector<std::vector<MeshLod>> generateMeshLods(
+        const lzvk::loader::MeshData& meshData,
+        std::vector<uint32_t>& indexData,
+        uint32_t maxLodCount)
+    {
+        using namespace lzvk::loader;
+
+        const size_t vertexStride = 11;
+        const float* vertices = reinterpret_cast<const float*>(meshData.vertexData.data());
+
+        std::vector<std::vector<MeshLod>> lodChains(meshData.meshes.size());
+        size_t lodIndexCount = 0;
+
+        for (size_t m = 0; m < meshData.meshes.size(); ++m)
+        {
+            const Mesh& mesh = meshData.meshes[m];
+            auto& chain = lodChains[m];
+
+            chain.push_back({ mesh.indexOffset, mesh.indexCount, 0.0f });
+
+            if (mesh.indexCount < 3)
+                continue;
+
+            auto position = [&](uint32_t index) {
+                const float* p = vertices + (size_t(mesh.vertexOffset) + index) * vertexStride;
+                return glm::vec3(p[0], p[1], p[2]);
+            };
+
+            // 1 local bounds
+            glm::vec3 minPos(FLT_MAX);
+            glm::vec3 maxPos(-FLT_MAX);
+
+            for (uint32_t i = 0; i < mesh.indexCount; ++i)
+            {
+                glm::vec3 p = position(indexData[mesh.indexOffset + i]);
+                minPos = glm::min(minPos, p);
+                maxPos = glm::max(maxPos, p);
+            }
+
+            float extent = glm::max(maxPos.x - minPos.x, glm::max(maxPos.y - minPos.y, maxPos.z - minPos.z));
+            if (extent <= 0.0f)
+                continue;
+
+            // 2 cluster on a grid that halves in resolution every level
+            uint32_t gridResolution = 64;
+
+            for (uint32_t level = 1; level < maxLodCount && gridResolution >= 2; ++level, gridResolution /= 2)
+            {
+                float cellSize = extent / float(gridResolution);
+                const MeshLod& previous = chain.back();
+
+                // 2.1 every vertex snaps to the first vertex seen in its cell
+                std::unordered_map<uint64_t, uint32_t> cellVertex;
+                cellVertex.reserve(previous.indexCount / 2);
+
+                auto remap = [&](uint32_t index) {
+                    glm::vec3 cell = glm::floor((position(index) - minPos) / cellSize);
+                    uint64_t key = (uint64_t(cell.x) << 42) | (uint64_t(cell.y) << 21) | uint64_t(cell.z);
+                    return cellVertex.emplace(key, index).first->second;
+                };
+
+                // 2.2 keep triangles that do not collapse
+                std::vector<uint32_t> lodIndices;
+                lodIndices.reserve(previous.indexCount);
+
+                for (uint32_t i = 0; i + 2 < previous.indexCount; i += 3)
+                {
+                    uint32_t a = remap(indexData[previous.indexOffset + i + 0]);
+                    uint32_t b = remap(indexData[previous.indexOffset + i + 1]);
+                    uint32_t c = remap(indexData[previous.indexOffset + i + 2]);
+
+                    if (a == b || b == c || a == c)
+                        continue;
+
+                    lodIndices.push_back(a);
+                    lodIndices.push_back(b);
+                    lodIndices.push_back(c);
+                }
+
+                // 2.3 stop when a level removes too little or everything
+                if (lodIndices.empty() || lodIndices.size() > size_t(previous.indexCount) * 8 / 10)
+                    break;
+
+                MeshLod lod;
+                lod.indexOffset = static_cast<uint32_t>(indexData.size());
+                lod.indexCount = static_cast<uint32_t>(lodIndices.size());
+                lod.error = cellSize * 1.7320508f;
+
+                indexData.insert(indexData.end(), lodIndices.begin(), lodIndices.end());
+                chain.push_back(lod);
+                lodIndexCount += lodIndices.size();
+            }
+        }
+
+        printf("[generateMeshLods] %zu meshes, %zu extra LOD indices\n", meshData.meshes.size(), lodIndexCount);
+
+        return lodChains;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../loader/mesh.h"
+
+namespace lzvk::tools {
+
+    struct MeshLod {
+
+        uint32_t indexOffset = 0;
+        uint32_t indexCount = 0;
+
+        // max vertex displacement in mesh local space
+        float error = 0.0f;
+    };
+
+    // Builds coarser index lists for every mesh by vertex clustering and appends
+    // them to indexData. Level 0 of each chain is the original mesh.
+    std::vector<std::vector<MeshLod>> generateMeshLods(
+        const lzvk::loader::MeshData& meshData,
+        std::vector<uint32_t>& indexData,
+        uint32_t maxLodCount);
+}
@@ -0,0 +1,161 @@
+#include "meshlet.h"
+#include <cfloat>
+
+namespace lzvk::tools {
+
+    static void computeMeshletBounds(const float* vertices, MeshletData& data, Meshlet& meshlet)
+    {
+        const size_t vertexStride = 11;
+
+        auto position = [&](uint32_t localIndex) {
+            const float* p = vertices + size_t(data.meshletVertices[meshlet.vertexOffset + localIndex]) * vertexStride;
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+
+        // 1 bounding sphere around the AABB center
+        glm::vec3 minPos(FLT_MAX);
+        glm::vec3 maxPos(-FLT_MAX);
+
+        for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+        {
+            minPos = glm::min(minPos, position(i));
+            maxPos = glm::max(maxPos, position(i));
+        }
+
+        glm::vec3 center = (minPos + maxPos) * 0.5f;
+        float radius = 0.0f;
+
+        for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+            radius = glm::max(radius, glm::length(position(i) - center));
+
+        meshlet.sphere = glm::vec4(center, radius);
+
+        // 2 normal cone from the face normals
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.triangleCount);
+        glm::vec3 axis(0.0f);
+
+        for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+        {
+            uint32_t packed = data.meshletTriangles[meshlet.triangleOffset + t];
+            glm::vec3 a = position(packed & 0xFF);
+            glm::vec3 b = position((packed >> 8) & 0xFF);
+            glm::vec3 c = position((packed >> 16) & 0xFF);
+
+            glm::vec3 n = glm::cross(b - a, c - a);
+            float length = glm::length(n);
+
+            if (length <= 0.0f)
+                continue;
+
+            normals.push_back(n / length);
+            axis += n / length;
+        }
+
+        float axisLength = glm::length(axis);
+
+        if (normals.empty() || axisLength <= 0.0f)
+            return;
+
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (const auto& n : normals)
+            minDot = glm::min(minDot, glm::dot(axis, n));
+
+        // Wide cones never cull, keep the test disabled
+        float cutoff = minDot <= 0.1f ? 1.0f : glm::sqrt(1.0f - minDot * minDot);
+        meshlet.cone = glm::vec4(axis, cutoff);
+    }
+
+    MeshletData buildMeshlets(const lzvk::loader::MeshData& meshData, uint32_t maxVertices, uint32_t maxTriangles)
+    {
+        using namespace lzvk::loader;
+
+        const float* vertices = reinterpret_cast<const float*>(meshData.vertexData.data());
+
+        MeshletData data;
+        data.firstMeshlet.resize(meshData.meshes.size(), 0);
+        data.meshletCount.resize(meshData.meshes.size(), 0);
+
+        for (size_t m = 0; m < meshData.meshes.size(); ++m)
+        {
+            const Mesh& mesh = meshData.meshes[m];
+            data.firstMeshlet[m] = static_cast<uint32_t>(data.meshlets.size());
+
+            Meshlet current;
+            current.vertexOffset = static_cast<uint32_t>(data.meshletVertices.size());
+            current.triangleOffset = static_cast<uint32_t>(data.meshletTriangles.size());
+
+            auto flush = [&]() {
+                if (current.triangleCount == 0)
+                    return;
+
+                computeMeshletBounds(vertices, data, current);
+                data.meshlets.push_back(current);
+
+                current = Meshlet{};
+                current.vertexOffset = static_cast<uint32_t>(data.meshletVertices.size());
+                current.triangleOffset = static_cast<uint32_t>(data.meshletTriangles.size());
+            };
+
+            // 1 greedily fill meshlets in index order
+            for (uint32_t i = 0; i + 2 < mesh.indexCount; i += 3)
+            {
+                uint32_t corners[3];
+                uint32_t newVertices = 0;
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    corners[c] = mesh.vertexOffset + meshData.indexData[mesh.indexOffset + i + c];
+
+                    bool found = false;
+                    for (uint32_t v = 0; v < current.vertexCount && !found; ++v)
+                        found = data.meshletVertices[current.vertexOffset + v] == corners[c];
+
+                    bool repeated = (c > 0 && corners[c] == corners[0]) || (c > 1 && corners[c] == corners[1]);
+                    newVertices += (found || repeated) ? 0 : 1;
+                }
+
+                if (current.vertexCount + newVertices > maxVertices || current.triangleCount + 1 > maxTriangles)
+                    flush();
+
+                // 2 append the triangle with meshlet local corners
+                uint32_t packed = 0;
+
+                for (int c = 0; c < 3; ++c)
+                {
+                    uint32_t local = current.vertexCount;
+
+                    for (uint32_t v = 0; v < current.vertexCount; ++v)
+                    {
+                        if (data.meshletVertices[current.vertexOffset + v] == corners[c])
+                        {
+                            local = v;
+                            break;
+                        }
+                    }
+
+                    if (local == current.vertexCount)
+                    {
+                        data.meshletVertices.push_back(corners[c]);
+                        ++current.vertexCount;
+                    }
+
+                    packed |= local << (8 * c);
+                }
+
+                data.meshletTriangles.push_back(packed);
+                ++current.triangleCount;
+            }
+
+            flush();
+            data.meshletCount[m] = static_cast<uint32_t>(data.meshlets.size()) - data.firstMeshlet[m];
+        }
+
+        printf("[buildMeshlets] %zu meshes, %zu meshlets, %zu meshlet vertices, %zu triangles\n",
+            meshData.meshes.size(), data.meshlets.size(), data.meshletVertices.size(), data.meshletTriangles.size());
+
+        return data;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "../loader/mesh.h"
+
+namespace lzvk::tools {
+
+    // Matches the std430 layout used by the task and mesh shaders
+    struct Meshlet {
+
+        uint32_t vertexOffset = 0;
+        uint32_t triangleOffset = 0;
+        uint32_t vertexCount = 0;
+        uint32_t triangleCount = 0;
+
+        // xyz = local space center, w = radius
+        glm::vec4 sphere = glm::vec4(0.0f);
+
+        // xyz = average normal, w = cone cutoff, 1 disables the cone test
+        glm::vec4 cone = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    };
+
+    struct MeshletData {
+
+        std::vector<Meshlet> meshlets;
+
+        // global vertex indices, meshlet local triangles packed as 8 bits per corner
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint32_t> meshletTriangles;
+
+        // meshlet range of every mesh
+        std::vector<uint32_t> firstMeshlet;
+        std::vector<uint32_t> meshletCount;
+    };
+
+    MeshletData buildMeshlets(const lzvk::loader::MeshData& meshData, uint32_t maxVertices = 64, uint32_t maxTriangles = 124);
+}
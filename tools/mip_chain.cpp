@@ -0,0 +1,124 @@
+#include "mip_chain.h"
+#include "bitmap_ops.h"
+#include <cmath>
+#include <cstring>
+
+namespace lzvk::tools {
+
+    namespace {
+
+        float getCoverage(const float* texels, size_t texelCount, int channel, float cutoff, float scale)
+        {
+            size_t passed = 0;
+            for (size_t i = 0; i < texelCount; ++i) {
+                if (texels[i * 4 + channel] * scale > cutoff) {
+                    ++passed;
+                }
+            }
+
+            return static_cast<float>(passed) / static_cast<float>(texelCount);
+        }
+
+        // Scale for the coverage channel that brings the level back to the target coverage
+        float findCoverageScale(const float* texels, size_t texelCount, int channel, float cutoff, float target)
+        {
+            // already within one texel of the target, e.g. a fully opaque map
+            if (std::abs(getCoverage(texels, texelCount, channel, cutoff, 1.0f) - target) * texelCount <= 1.0f) {
+                return 1.0f;
+            }
+
+            float low = 0.0f;
+            float high = 4.0f;
+
+            for (int i = 0; i < 16; ++i) {
+
+                float mid = 0.5f * (low + high);
+                if (getCoverage(texels, texelCount, channel, cutoff, mid) < target) {
+                    low = mid;
+                }
+                else {
+                    high = mid;
+                }
+            }
+
+            return high;
+        }
+    }
+
+    uint32_t getMipLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levels = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+            ++levels;
+        }
+
+        return levels;
+    }
+
+    MipChain generateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, const MipSettings& settings)
+    {
+        const int channel = settings.coverageChannel;
+
+        // 1 Lay out every level
+        MipChain chain;
+        chain.levels.resize(getMipLevelCount(width, height));
+
+        size_t offset = 0;
+        for (uint32_t level = 0; level < chain.levels.size(); ++level) {
+
+            auto& mip = chain.levels[level];
+            mip.width = std::max(1u, width >> level);
+            mip.height = std::max(1u, height >> level);
+            mip.offset = offset;
+            mip.size = size_t(mip.width) * mip.height * 4;
+            offset += mip.size;
+        }
+
+        chain.data.resize(offset);
+
+        // 2 Level 0 as loaded, decoded to linear floats, and the coverage every smaller level is held to
+        std::memcpy(chain.data.data(), rgba, chain.levels[0].size);
+
+        Bitmap current = convertFormat(Bitmap(int(width), int(height), 4, BitmapFormat::UnsignedByte, rgba), BitmapFormat::Float, settings.srgb, settings.threadCount);
+
+        float targetCoverage = 0.0f;
+        if (channel >= 0) {
+            targetCoverage = getCoverage(reinterpret_cast<const float*>(current.mData.data()), size_t(width) * height, channel, settings.coverageCutoff, 1.0f);
+        }
+
+        // 3 Filter in linear space, each level from the unscaled level above it
+        for (uint32_t level = 1; level < chain.levels.size(); ++level) {
+
+            const auto& dst = chain.levels[level];
+            current = downsample(current, ResizeFilter::Box, settings.threadCount);
+
+            const size_t texelCount = size_t(dst.width) * dst.height;
+            const float* texels = reinterpret_cast<const float*>(current.mData.data());
+
+            float scale = 1.0f;
+            if (channel >= 0 && targetCoverage > 0.0f) {
+                scale = findCoverageScale(texels, texelCount, channel, settings.coverageCutoff, targetCoverage);
+            }
+
+            // 4 The scale only goes into the stored level
+            const Bitmap* source = &current;
+            Bitmap scaled{};
+
+            if (scale != 1.0f) {
+
+                scaled = current;
+                float* values = reinterpret_cast<float*>(scaled.mData.data());
+                for (size_t i = 0; i < texelCount; ++i) {
+                    values[i * 4 + channel] *= scale;
+                }
+
+                source = &scaled;
+            }
+
+            const Bitmap encoded = convertFormat(*source, BitmapFormat::UnsignedByte, settings.srgb, settings.threadCount);
+            std::memcpy(chain.data.data() + dst.offset, encoded.mData.data(), dst.size);
+        }
+
+        return chain;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "../common.h"
+
+namespace lzvk::tools {
+
+    struct MipLevel {
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        // byte range of the level in MipChain::data
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    // RGBA8 levels packed back to back, largest first, in the order the upload copies them
+    struct MipChain {
+        std::vector<uint8_t> data;
+        std::vector<MipLevel> levels;
+    };
+
+    struct MipSettings {
+
+        // rgb is sRGB encoded, it is filtered in linear space and encoded again. Alpha is always linear
+        bool srgb = true;
+
+        // channel an alpha test reads, -1 for none. Every level is rescaled so that the share
+        // of texels above coverageCutoff matches level 0, cutouts don't fade out in the distance
+        int coverageChannel = -1;
+        float coverageCutoff = 0.5f;
+
+        // threads each level is filtered on, 0 for every hardware thread. Texture loads already
+        // run on the loader workers and keep it at 1
+        uint32_t threadCount = 1;
+    };
+
+    uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+    // Full chain down to 1x1 with the box filter of downsample, level 0 is a copy of rgba
+    MipChain generateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, const MipSettings& settings);
+}
@@ -1,7 +1,180 @@
 #include "scene_tools.h"
+#include <cfloat>
+#include <cstring>
+#include <tuple>
 
 namespace lzvk::tools {
 
+    // Appends one mesh holding the geometry of the given draws, with their node
+    // transforms baked into the vertices, and a node plus draw data rendering it.
+    static void appendBakedBatch(
+        lzvk::loader::Scene& scene,
+        lzvk::loader::MeshData& meshData,
+        const std::vector<uint32_t>& drawIndices,
+        uint32_t materialId,
+        const std::string& name)
+    {
+        using namespace lzvk::loader;
+
+        const size_t vertexStride = 11;
+        const glm::mat4 rootInverse = glm::inverse(scene.globalTransform[0]);
+
+        Mesh batchMesh;
+        batchMesh.materialID = materialId;
+        batchMesh.vertexOffset = static_cast<uint32_t>(meshData.vertexData.size() / (sizeof(float) * vertexStride));
+        batchMesh.indexOffset = static_cast<uint32_t>(meshData.indexData.size());
+        batchMesh.indexCount = 0;
+
+        std::vector<float> batchVertices;
+        std::vector<uint32_t> batchIndices;
+        std::vector<uint32_t> remap;
+
+        for (uint32_t drawIndex : drawIndices)
+        {
+            uint32_t node = scene.drawDataArray[drawIndex].transformId;
+            const Mesh& mesh = meshData.meshes[scene.meshForNode.at(node)];
+
+            // 1 the batch node sits under the root, so bake the transform relative to it
+            glm::mat4 model = rootInverse * scene.globalTransform[node];
+            glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+            bool flipWinding = glm::determinant(glm::mat3(model)) < 0.0f;
+
+            // 2 copy every referenced vertex once, indices are local to the mesh
+            uint32_t localVertexCount = 0;
+            for (uint32_t i = 0; i < mesh.indexCount; ++i)
+                localVertexCount = std::max(localVertexCount, meshData.indexData[mesh.indexOffset + i] + 1);
+
+            remap.assign(localVertexCount, uint32_t(-1));
+
+            auto bakeVertex = [&](uint32_t localIndex) {
+                if (remap[localIndex] != uint32_t(-1))
+                    return remap[localIndex];
+
+                const float* v = reinterpret_cast<const float*>(meshData.vertexData.data()) + (size_t(mesh.vertexOffset) + localIndex) * vertexStride;
+
+                glm::vec3 position = glm::vec3(model * glm::vec4(v[0], v[1], v[2], 1.0f));
+                glm::vec3 normal = normalMatrix * glm::vec3(v[5], v[6], v[7]);
+                glm::vec3 tangent = glm::mat3(model) * glm::vec3(v[8], v[9], v[10]);
+
+                normal = glm::length(normal) > 0.0f ? glm::normalize(normal) : normal;
+                tangent = glm::length(tangent) > 0.0f ? glm::normalize(tangent) : tangent;
+
+                float baked[11] = {
+                    position.x, position.y, position.z,
+                    v[3], v[4],
+                    normal.x, normal.y, normal.z,
+                    tangent.x, tangent.y, tangent.z
+                };
+
+                remap[localIndex] = static_cast<uint32_t>(batchVertices.size() / vertexStride);
+                batchVertices.insert(batchVertices.end(), baked, baked + vertexStride);
+
+                return remap[localIndex];
+            };
+
+            // 3 mirrored transforms flip the winding, swap two corners to keep it
+            for (uint32_t i = 0; i + 2 < mesh.indexCount; i += 3)
+            {
+                uint32_t a = bakeVertex(meshData.indexData[mesh.indexOffset + i + 0]);
+                uint32_t b = bakeVertex(meshData.indexData[mesh.indexOffset + i + 1]);
+                uint32_t c = bakeVertex(meshData.indexData[mesh.indexOffset + i + 2]);
+
+                batchIndices.push_back(a);
+                batchIndices.push_back(flipWinding ? c : b);
+                batchIndices.push_back(flipWinding ? b : c);
+            }
+        }
+
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(batchVertices.data());
+        meshData.vertexData.insert(meshData.vertexData.end(), bytes, bytes + batchVertices.size() * sizeof(float));
+        meshData.indexData.insert(meshData.indexData.end(), batchIndices.begin(), batchIndices.end());
+
+        batchMesh.indexCount = static_cast<uint32_t>(batchIndices.size());
+        meshData.meshes.push_back(batchMesh);
+
+        // 4 node and draw data for the batch
+        int batchNode = addNode(scene, 0, 1);
+        scene.globalTransform[batchNode] = scene.globalTransform[0];
+        scene.nodeNames.push_back(name);
+        scene.nameForNode[batchNode] = static_cast<uint32_t>(scene.nodeNames.size() - 1);
+        scene.meshForNode[batchNode] = static_cast<uint32_t>(meshData.meshes.size() - 1);
+        scene.materialForNode[batchNode] = materialId;
+
+        DrawData batchDraw;
+        batchDraw.transformId = batchNode;
+        batchDraw.materialId = materialId;
+        scene.drawDataArray.push_back(batchDraw);
+    }
+
+    // Drops the given draws and every mesh no draw references any more,
+    // then repacks vertex and index data so the scene keeps no dead geometry.
+    static void removeDrawsAndCompact(
+        lzvk::loader::Scene& scene,
+        lzvk::loader::MeshData& meshData,
+        const std::vector<bool>& removeDraw)
+    {
+        using namespace lzvk::loader;
+
+        const size_t vertexSize = sizeof(float) * 11;
+
+        // 1 remove draw data and the mesh link of its node
+        std::vector<DrawData> keptDraws;
+        keptDraws.reserve(scene.drawDataArray.size());
+
+        for (size_t i = 0; i < scene.drawDataArray.size(); ++i)
+        {
+            if (i < removeDraw.size() && removeDraw[i])
+                scene.meshForNode.erase(scene.drawDataArray[i].transformId);
+            else
+                keptDraws.push_back(scene.drawDataArray[i]);
+        }
+
+        scene.drawDataArray = std::move(keptDraws);
+
+        // 2 repack referenced meshes in their original order
+        std::vector<uint32_t> meshRemap(meshData.meshes.size(), uint32_t(-1));
+        for (const auto& [node, mesh] : scene.meshForNode)
+            meshRemap[mesh] = 0;
+
+        MeshData packed;
+        packed.materials = std::move(meshData.materials);
+        packed.diffuseTextureFiles = std::move(meshData.diffuseTextureFiles);
+        packed.emissiveTextureFiles = std::move(meshData.emissiveTextureFiles);
+        packed.normalTextureFiles = std::move(meshData.normalTextureFiles);
+        packed.opacityTextureFiles = std::move(meshData.opacityTextureFiles);
+        packed.specularTextureFiles = std::move(meshData.specularTextureFiles);
+
+        for (size_t m = 0; m < meshData.meshes.size(); ++m)
+        {
+            if (meshRemap[m] == uint32_t(-1))
+                continue;
+
+            const Mesh& mesh = meshData.meshes[m];
+
+            uint32_t vertexCount = 0;
+            for (uint32_t i = 0; i < mesh.indexCount; ++i)
+                vertexCount = std::max(vertexCount, meshData.indexData[mesh.indexOffset + i] + 1);
+
+            Mesh packedMesh = mesh;
+            packedMesh.vertexOffset = static_cast<uint32_t>(packed.vertexData.size() / vertexSize);
+            packedMesh.indexOffset = static_cast<uint32_t>(packed.indexData.size());
+
+            auto first = meshData.vertexData.begin() + size_t(mesh.vertexOffset) * vertexSize;
+            packed.vertexData.insert(packed.vertexData.end(), first, first + size_t(vertexCount) * vertexSize);
+
+            auto firstIndex = meshData.indexData.begin() + mesh.indexOffset;
+            packed.indexData.insert(packed.indexData.end(), firstIndex, firstIndex + mesh.indexCount);
+
+            meshRemap[m] = static_cast<uint32_t>(packed.meshes.size());
+            packed.meshes.push_back(packedMesh);
+        }
+
+        for (auto& [node, mesh] : scene.meshForNode)
+            mesh = meshRemap[mesh];
+
+        meshData = std::move(packed);
+    }
+
     void mergeNodesWithMaterial(
         lzvk::loader::Scene& scene,
         lzvk::loader::MeshData& meshData,
@@ -23,98 +196,171 @@ namespace lzvk::tools {
         uint32_t materialId = static_cast<uint32_t>(std::distance(scene.materialNames.begin(), it));
         std::cout << "[merge] Material ID: " << materialId << std::endl;
 
-        // 3 collect all draw data and meshes that contains this material
-        std::vector<uint32_t> nodesToMerge;
-        std::vector<uint32_t> meshesToMerge;
+        // 3 collect all draw data that render a mesh with this material
+        std::vector<uint32_t> drawsToMerge;
 
         for (size_t i = 0; i < scene.drawDataArray.size(); ++i)
         {
             const auto& dd = scene.drawDataArray[i];
-            if (dd.materialId == materialId)
-            {
-                nodesToMerge.push_back(dd.transformId);
-
-                auto itMesh = scene.meshForNode.find(dd.transformId);
-                if (itMesh != scene.meshForNode.end())
-                {
-                    meshesToMerge.push_back(itMesh->second);
-                }
-            }
+            if (dd.materialId == materialId && scene.meshForNode.count(dd.transformId) > 0)
+                drawsToMerge.push_back(static_cast<uint32_t>(i));
         }
 
-        if (meshesToMerge.size() <= 1)
+        if (drawsToMerge.size() <= 1)
         {
             std::cout << "[merge] Nothing to merge for material: " << materialName << std::endl;
             return;
         }
 
-        std::cout << "[merge] Found " << meshesToMerge.size() << " meshes to merge." << std::endl;
+        std::cout << "[merge] Found " << drawsToMerge.size() << " meshes to merge." << std::endl;
+
+        // 4 bake them into one mesh, node and draw
+        std::vector<bool> removeDraw(scene.drawDataArray.size(), false);
+        for (uint32_t drawIndex : drawsToMerge)
+            removeDraw[drawIndex] = true;
+
+        appendBakedBatch(scene, meshData, drawsToMerge, materialId, "Merged_" + materialName);
+
+        // 5 remove old draw data and their meshes
+        removeDrawsAndCompact(scene, meshData, removeDraw);
+
+        std::cout << "[merge] Merged mesh and node created for material: " << materialName << std::endl;
+    }
+
+    // Bump when batchStaticDraws changes the data it writes, cached scenes are then rebuilt
+    static constexpr uint32_t STATIC_BATCH_VERSION = 1;
+
+    uint64_t getStaticBatchCacheKey(const StaticBatchSettings& settings) {
+
+        uint32_t cellSizeBits = 0;
+        std::memcpy(&cellSizeBits, &settings.cellSize, sizeof(cellSizeBits));
+
+        // FNV-1a over the fields
+        uint64_t key = 0xcbf29ce484222325ull;
+        for (uint32_t word : { STATIC_BATCH_VERSION, cellSizeBits, settings.maxTrianglesPerBatch }) {
+            key = (key ^ word) * 0x100000001b3ull;
+        }
+
+        return key;
+    }
+
+    void batchStaticDraws(
+        lzvk::loader::Scene& scene,
+        lzvk::loader::MeshData& meshData,
+        const StaticBatchSettings& settings)
+    {
+        using namespace lzvk::loader;
 
-        // 4 create new mesh
-        Mesh mergedMesh;
-        mergedMesh.materialID = materialId;
-        mergedMesh.vertexOffset = static_cast<uint32_t>(meshData.vertexData.size() / (sizeof(float) * 11));
-        mergedMesh.indexOffset = static_cast<uint32_t>(meshData.indexData.size());
-        mergedMesh.indexCount = 0;
+        const size_t vertexStride = 11;
+        const float* vertices = reinterpret_cast<const float*>(meshData.vertexData.data());
+        const glm::mat4 rootInverse = glm::inverse(scene.globalTransform[0]);
+        const size_t drawCountBefore = scene.drawDataArray.size();
 
-        uint32_t vertexOffsetShift = 0;
+        // 1 root space center of every draw, from the bounds of its mesh
+        std::vector<glm::vec3> drawCenters(scene.drawDataArray.size(), glm::vec3(0.0f));
+        std::vector<bool> batchable(scene.drawDataArray.size(), false);
+        glm::vec3 sceneMin(FLT_MAX);
+        glm::vec3 sceneMax(-FLT_MAX);
 
-        for (auto meshIdx : meshesToMerge)
+        for (size_t i = 0; i < scene.drawDataArray.size(); ++i)
         {
-            const auto& mesh = meshData.meshes[meshIdx];
+            const DrawData& dd = scene.drawDataArray[i];
+            auto itMesh = scene.meshForNode.find(dd.transformId);
 
-            uint32_t startVertex = mesh.vertexOffset * 11;
-            uint32_t endVertex = startVertex + mesh.indexCount * 11;
+            if (itMesh == scene.meshForNode.end())
+                continue;
 
-            // copy vertices
-            meshData.vertexData.insert(
-                meshData.vertexData.end(),
-                meshData.vertexData.begin() + startVertex * sizeof(float),
-                meshData.vertexData.begin() + endVertex * sizeof(float)
-            );
+            const Mesh& mesh = meshData.meshes[itMesh->second];
+
+            if (mesh.indexCount < 3 || mesh.indexCount / 3 > settings.maxTrianglesPerBatch)
+                continue;
+
+            glm::vec3 minPos(FLT_MAX);
+            glm::vec3 maxPos(-FLT_MAX);
 
-            // copy indices and do offset shift
-            for (size_t i = 0; i < mesh.indexCount; ++i)
+            for (uint32_t j = 0; j < mesh.indexCount; ++j)
             {
-                uint32_t index = meshData.indexData[mesh.indexOffset + i];
-                index += vertexOffsetShift;
-                meshData.indexData.push_back(index);
+                const float* p = vertices + (size_t(mesh.vertexOffset) + meshData.indexData[mesh.indexOffset + j]) * vertexStride;
+                minPos = glm::min(minPos, glm::vec3(p[0], p[1], p[2]));
+                maxPos = glm::max(maxPos, glm::vec3(p[0], p[1], p[2]));
             }
 
-            vertexOffsetShift += mesh.indexCount;
-            mergedMesh.indexCount += mesh.indexCount;
+            glm::mat4 model = rootInverse * scene.globalTransform[dd.transformId];
+            drawCenters[i] = glm::vec3(model * glm::vec4((minPos + maxPos) * 0.5f, 1.0f));
+            batchable[i] = true;
+
+            sceneMin = glm::min(sceneMin, drawCenters[i]);
+            sceneMax = glm::max(sceneMax, drawCenters[i]);
         }
 
-        meshData.meshes.push_back(mergedMesh);
-        uint32_t mergedMeshIdx = static_cast<uint32_t>(meshData.meshes.size() - 1);
+        glm::vec3 sceneExtent = glm::max(sceneMax - sceneMin, glm::vec3(0.0f));
+        float cellSize = settings.cellSize > 0.0f
+            ? settings.cellSize
+            : glm::max(sceneExtent.x, glm::max(sceneExtent.y, sceneExtent.z)) / 8.0f;
 
-        // 5 add new node
-        int newNodeId = addNode(scene, -1, 1);
-        scene.nodeNames.push_back("Merged_" + materialName);
-        scene.nameForNode[newNodeId] = static_cast<uint32_t>(scene.nodeNames.size() - 1);
-        scene.meshForNode[newNodeId] = mergedMeshIdx;
+        if (cellSize <= 0.0f)
+            cellSize = 1.0f;
 
-        // 6 add new draw data
-        DrawData newDD;
-        newDD.transformId = newNodeId;
-        newDD.materialId = materialId;
-        scene.drawDataArray.push_back(newDD);
+        // 2 group by material and grid cell, ordered so the output is deterministic
+        std::map<std::tuple<uint32_t, int32_t, int32_t, int32_t>, std::vector<uint32_t>> groups;
 
-        std::cout << "[merge] Merged mesh and node created for material: " << materialName << std::endl;
+        for (size_t i = 0; i < scene.drawDataArray.size(); ++i)
+        {
+            if (!batchable[i])
+                continue;
+
+            glm::ivec3 cell = glm::ivec3(glm::floor((drawCenters[i] - sceneMin) / cellSize));
+            groups[{ scene.drawDataArray[i].materialId, cell.x, cell.y, cell.z }].push_back(static_cast<uint32_t>(i));
+        }
+
+        // 3 split every group at the triangle budget, single draws stay as they are
+        std::vector<bool> removeDraw(scene.drawDataArray.size(), false);
+        size_t batchCount = 0;
+        size_t batchedDrawCount = 0;
+
+        for (const auto& [key, drawIndices] : groups)
+        {
+            uint32_t materialId = std::get<0>(key);
+            std::vector<uint32_t> batch;
+            uint32_t batchTriangles = 0;
 
-        // 7 remove old drawData
-        scene.drawDataArray.erase(
-            std::remove_if(
-                scene.drawDataArray.begin(),
-                scene.drawDataArray.end(),
-                [materialId](const DrawData& dd)
+            auto flush = [&]() {
+                if (batch.size() > 1)
                 {
-                    return dd.materialId == materialId;
-                }),
-            scene.drawDataArray.end()
-        );
+                    std::string name = "Batch_" + std::to_string(materialId) + "_" + std::to_string(batchCount);
+                    appendBakedBatch(scene, meshData, batch, materialId, name);
+
+                    for (uint32_t drawIndex : batch)
+                        removeDraw[drawIndex] = true;
+
+                    ++batchCount;
+                    batchedDrawCount += batch.size();
+                }
+
+                batch.clear();
+                batchTriangles = 0;
+            };
+
+            for (uint32_t drawIndex : drawIndices)
+            {
+                const Mesh& mesh = meshData.meshes[scene.meshForNode.at(scene.drawDataArray[drawIndex].transformId)];
+                uint32_t triangles = mesh.indexCount / 3;
+
+                if (!batch.empty() && batchTriangles + triangles > settings.maxTrianglesPerBatch)
+                    flush();
+
+                batch.push_back(drawIndex);
+                batchTriangles += triangles;
+            }
+
+            flush();
+        }
+
+        // 4 drop the source draws and their meshes
+        removeDrawsAndCompact(scene, meshData, removeDraw);
 
-        std::cout << "[merge] Old nodes removed for material: " << materialName << std::endl;
+        printf("[batchStaticDraws] draws %zu -> %zu, %zu batches from %zu draws, cell size %.2f, budget %u triangles\n",
+            drawCountBefore, scene.drawDataArray.size(), batchCount, batchedDrawCount, cellSize, settings.maxTrianglesPerBatch);
     }
 
     void mergeScenes(
@@ -317,12 +563,13 @@ namespace lzvk::tools {
         merged.normalTextureFiles.clear();
         merged.emissiveTextureFiles.clear();
         merged.opacityTextureFiles.clear();
+        merged.specularTextureFiles.clear();
 
         //
         vector<Material> allMaterials;
         unordered_map<size_t, size_t> materialToSourceMap;
 
-        vector<const vector<string>*> diffuseLists, normalLists, emissiveLists, opacityLists;
+        vector<const vector<string>*> diffuseLists, normalLists, emissiveLists, opacityLists, specularLists;
 
         for (size_t i = 0; i < meshList.size(); ++i) {
             const auto* meshData = meshList[i];
@@ -331,6 +578,7 @@ namespace lzvk::tools {
             normalLists.push_back(&meshData->normalTextureFiles);
             emissiveLists.push_back(&meshData->emissiveTextureFiles);
             opacityLists.push_back(&meshData->opacityTextureFiles);
+            specularLists.push_back(&meshData->specularTextureFiles);
 
             for (const auto& mat : meshData->materials) {
                 allMaterials.push_back(mat);
@@ -356,6 +604,7 @@ namespace lzvk::tools {
         auto normalMap = buildUnifiedTextureList(normalLists, merged.normalTextureFiles);
         auto emissiveMap = buildUnifiedTextureList(emissiveLists, merged.emissiveTextureFiles);
         auto opacityMap = buildUnifiedTextureList(opacityLists, merged.opacityTextureFiles);
+        auto specularMap = buildUnifiedTextureList(specularLists, merged.specularTextureFiles);
 
         // 4
         auto remapIndex = [&](size_t matIndex, uint32_t& index, const vector<const vector<string>*>& texLists, const unordered_map<string, int>& map) {
@@ -384,6 +633,7 @@ namespace lzvk::tools {
             remapIndex(i, m.normalTexture, normalLists, normalMap);
             remapIndex(i, m.emissiveTexture, emissiveLists, emissiveMap);
             remapIndex(i, m.opacityTexture, opacityLists, opacityMap);
+            remapIndex(i, m.specularTexture, specularLists, specularMap);
 
         }
 
@@ -401,12 +651,13 @@ namespace lzvk::tools {
             materialOffset += localMatCount;
         }
 
-        printf("[mergeMaterialLists] After merge: materials = %zu, diffuse = %zu, normal = %zu, emissive = %zu, opacity = %zu\n",
+        printf("[mergeMaterialLists] After merge: materials = %zu, diffuse = %zu, normal = %zu, emissive = %zu, opacity = %zu, specular = %zu\n",
             merged.materials.size(),
             merged.diffuseTextureFiles.size(),
             merged.normalTextureFiles.size(),
             merged.emissiveTextureFiles.size(),
-            merged.opacityTextureFiles.size());
+            merged.opacityTextureFiles.size(),
+            merged.specularTextureFiles.size());
     }
 
 
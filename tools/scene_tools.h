@@ -5,6 +5,21 @@
 
 namespace lzvk::tools {
 
+    struct StaticBatchSettings {
+
+        // edge of the grid cells draws are grouped by, 0 uses an eighth of the largest scene extent
+        float cellSize = 0.0f;
+
+        // triangles per batch before a new one is started in the same cell
+        uint32_t maxTrianglesPerBatch = 65536;
+    };
+
+    // Key of the mesh and scene caches, changes with the settings and with STATIC_BATCH_VERSION
+    uint64_t getStaticBatchCacheKey(const StaticBatchSettings& settings);
+
+    // Merges static draws sharing a material and grid cell into batches with baked transforms
+    void batchStaticDraws(lzvk::loader::Scene& scene, lzvk::loader::MeshData& meshData, const StaticBatchSettings& settings = {});
+
     void mergeNodesWithMaterial(lzvk::loader::Scene& scene, lzvk::loader::MeshData& meshData, const std::string& materialName);
     
     void mergeScenes(lzvk::loader::Scene& mergedScene,
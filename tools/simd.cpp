@@ -0,0 +1,51 @@
+#include "simd.h"
+#include <cstdlib>
+
+#if LZVK_X86_SIMD && defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace lzvk::tools {
+
+    namespace {
+
+        bool detectAvx2() {
+
+#if LZVK_X86_SIMD
+            if (std::getenv("LZVK_DISABLE_AVX2") != nullptr) {
+                return false;
+            }
+
+#if defined(_MSC_VER) && !defined(__clang__)
+            // FMA, AVX and OSXSAVE in leaf 1, the OS has to save the YMM registers, then AVX2 in leaf 7
+            int info[4] = {};
+            __cpuid(info, 0);
+            if (info[0] < 7) {
+                return false;
+            }
+
+            __cpuid(info, 1);
+            const int leaf1Bits = (1 << 12) | (1 << 27) | (1 << 28);
+            if ((info[2] & leaf1Bits) != leaf1Bits || (_xgetbv(0) & 6) != 6) {
+                return false;
+            }
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            // the builtins include the OS support check
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+#else
+            return false;
+#endif
+        }
+    }
+
+    bool hasAvx2() {
+
+        static const bool supported = detectAvx2();
+        return supported;
+    }
+}
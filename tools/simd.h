@@ -0,0 +1,28 @@
+#pragma once
+
+// AVX2/FMA kernels are compiled into every x86-64 build and picked at runtime with hasAvx2(), so
+// the binaries still run on CPUs without them. GCC and Clang build each kernel for AVX2 through
+// LZVK_TARGET_AVX2, MSVC accepts the intrinsics in any function. Only functions marked with it
+// may use AVX2 or FMA intrinsics, and only after hasAvx2() returned true. SSE2 is part of x86-64
+// and needs neither.
+#if defined(__x86_64__) || defined(_M_X64)
+#define LZVK_X86_SIMD 1
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define LZVK_TARGET_AVX2
+#else
+#define LZVK_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+#else
+#define LZVK_X86_SIMD 0
+#define LZVK_TARGET_AVX2
+#endif
+
+namespace lzvk::tools {
+
+    // CPU and OS support AVX2 and FMA, checked once. LZVK_DISABLE_AVX2 set in the environment
+    // forces the other kernels, e.g. to compare both on one machine
+    bool hasAvx2();
+}
@@ -0,0 +1,146 @@
+#include "texture_baker.h"
+#include "bc_encoder.h"
+#include "mip_chain.h"
+
+#include <cmath>
+#include <filesystem>
+#include <ktx.h>
+
+namespace lzvk::tools {
+
+    namespace {
+
+        const char* getKindName(TextureKind kind)
+        {
+            switch (kind) {
+            case TextureKind::Color: return "color";
+            case TextureKind::Normal: return "normal";
+            case TextureKind::Mask: return "mask";
+            }
+
+            return "unknown";
+        }
+    }
+
+    std::string getBakedTexturePath(const std::string& sourcePath, TextureKind kind)
+    {
+        std::filesystem::path path = std::filesystem::path("assets/.cache/textures") / std::filesystem::path(sourcePath).relative_path();
+        path += std::string(".") + getKindName(kind) + ".ktx2";
+
+        return path.generic_string();
+    }
+
+    bool isBakedTextureCurrent(const std::string& sourcePath, TextureKind kind)
+    {
+        std::error_code error;
+
+        auto bakedTime = std::filesystem::last_write_time(getBakedTexturePath(sourcePath, kind), error);
+        if (error) {
+            return false;
+        }
+
+        auto sourceTime = std::filesystem::last_write_time(sourcePath, error);
+
+        // a baked file without its source is still usable
+        return error || bakedTime >= sourceTime;
+    }
+
+    BakedTexture bakeTexture(const uint8_t* rgba, uint32_t width, uint32_t height, TextureKind kind,
+                             const std::string& outputPath, uint32_t threadCount)
+    {
+        const size_t texelCount = size_t(width) * height;
+
+        // 1 Pick the block format and the filtering of the chain
+        MipSettings mipSettings{};
+        BlockFormat blockFormat = BlockFormat::BC7;
+        VkFormat format = VK_FORMAT_BC7_SRGB_BLOCK;
+
+        std::vector<uint8_t> source(rgba, rgba + texelCount * 4);
+
+        switch (kind) {
+        case TextureKind::Color: {
+
+            bool opaque = true;
+            for (size_t i = 0; i < texelCount && opaque; ++i) {
+                opaque = source[i * 4 + 3] == 255;
+            }
+
+            mipSettings.srgb = true;
+            mipSettings.coverageChannel = opaque ? -1 : 3;
+            blockFormat = opaque ? BlockFormat::BC1 : BlockFormat::BC7;
+            format = opaque ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC7_SRGB_BLOCK;
+        }
+            break;
+        case TextureKind::Normal:
+
+            mipSettings.srgb = false;
+            blockFormat = BlockFormat::BC5;
+            format = VK_FORMAT_BC5_UNORM_BLOCK;
+            break;
+        case TextureKind::Mask: {
+
+            // masks were sampled through an sRGB view, BC4 has none so the decode happens here
+            for (size_t i = 0; i < texelCount; ++i) {
+                float v = source[i * 4] / 255.0f;
+                v = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+                source[i * 4] = static_cast<uint8_t>(v * 255.0f + 0.5f);
+            }
+
+            mipSettings.srgb = false;
+            mipSettings.coverageChannel = 0;
+            blockFormat = BlockFormat::BC4;
+            format = VK_FORMAT_BC4_UNORM_BLOCK;
+        }
+            break;
+        }
+
+        mipSettings.threadCount = threadCount;
+        MipChain chain = generateMipChain(source.data(), width, height, mipSettings);
+
+        // 2 Encode every level
+        ktxTextureCreateInfo createInfo{};
+        createInfo.vkFormat = format;
+        createInfo.baseWidth = width;
+        createInfo.baseHeight = height;
+        createInfo.baseDepth = 1;
+        createInfo.numDimensions = 2;
+        createInfo.numLevels = static_cast<uint32_t>(chain.levels.size());
+        createInfo.numLayers = 1;
+        createInfo.numFaces = 1;
+        createInfo.isArray = KTX_FALSE;
+        createInfo.generateMipmaps = KTX_FALSE;
+
+        ktxTexture2* texture = nullptr;
+        if (ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &texture) != KTX_SUCCESS) {
+            throw std::runtime_error("Error: failed to create KTX2 texture for " + outputPath);
+        }
+
+        BakedTexture result{};
+        result.width = width;
+        result.height = height;
+        result.levelCount = createInfo.numLevels;
+        result.format = format;
+        result.uncompressedBytes = chain.data.size();
+
+        for (uint32_t level = 0; level < chain.levels.size(); ++level) {
+
+            const auto& mip = chain.levels[level];
+            auto blocks = encodeImage(blockFormat, chain.data.data() + mip.offset, mip.width, mip.height, threadCount);
+
+            ktxTexture_SetImageFromMemory(ktxTexture(texture), level, 0, 0, blocks.data(), blocks.size());
+            result.bakedBytes += blocks.size();
+        }
+
+        // 3 Write
+        std::filesystem::create_directories(std::filesystem::path(outputPath).parent_path());
+
+        KTX_error_code written = ktxTexture_WriteToNamedFile(ktxTexture(texture), outputPath.c_str());
+        ktxTexture_Destroy(ktxTexture(texture));
+
+        if (written != KTX_SUCCESS) {
+            throw std::runtime_error("Error: failed to write " + outputPath);
+        }
+
+        return result;
+    }
+}
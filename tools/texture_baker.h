@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../common.h"
+
+namespace lzvk::tools {
+
+    // How a texture is sampled, decides its block format
+    //   Color  - sRGB, BC1 when every texel is opaque, BC7 otherwise
+    //   Normal - tangent space xy in BC5, the shaders rebuild z
+    //   Mask   - single channel in BC4, stored linear
+    enum class TextureKind {
+        Color,
+        Normal,
+        Mask
+    };
+
+    struct BakedTexture {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levelCount = 0;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+
+        // the same chain as RGBA8, what the texture costs without baking
+        size_t uncompressedBytes = 0;
+        size_t bakedBytes = 0;
+    };
+
+    // assets/.cache/textures/<source path>.<kind>.ktx2
+    std::string getBakedTexturePath(const std::string& sourcePath, TextureKind kind);
+
+    // The baked file exists and is at least as new as its source
+    bool isBakedTextureCurrent(const std::string& sourcePath, TextureKind kind);
+
+    // Builds the mip chain of the decoded source, encodes every level and writes a KTX2 file
+    BakedTexture bakeTexture(const uint8_t* rgba, uint32_t width, uint32_t height, TextureKind kind,
+                             const std::string& outputPath, uint32_t threadCount = 0);
+}
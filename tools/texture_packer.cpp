@@ -0,0 +1,38 @@
+#include "texture_packer.h"
+
+namespace lzvk::tools {
+
+    std::vector<TextureArrayPlan> planTextureArrays(const std::vector<TextureShape>& shapes, uint32_t maxLayers, uint32_t minLayers) {
+
+        // 1 Bucket by shape, indices stay sorted so the layer order is stable between runs
+        std::map<TextureShape, std::vector<uint32_t>> buckets{};
+
+        for (uint32_t i = 0; i < shapes.size(); ++i) {
+            if (shapes[i].format != VK_FORMAT_UNDEFINED) {
+                buckets[shapes[i]].push_back(i);
+            }
+        }
+
+        // 2 Split each bucket into arrays, a remainder below minLayers keeps its own images
+        std::vector<TextureArrayPlan> plans{};
+        maxLayers = std::max(maxLayers, 1u);
+
+        for (const auto& [shape, indices] : buckets) {
+
+            for (size_t first = 0; first < indices.size(); first += maxLayers) {
+
+                size_t count = std::min<size_t>(maxLayers, indices.size() - first);
+                if (count < minLayers) {
+                    break;
+                }
+
+                TextureArrayPlan plan{};
+                plan.shape = shape;
+                plan.layers.assign(indices.begin() + first, indices.begin() + first + count);
+                plans.push_back(std::move(plan));
+            }
+        }
+
+        return plans;
+    }
+}
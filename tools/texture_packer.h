@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../common.h"
+#include <tuple>
+
+namespace lzvk::tools {
+
+    // Format and chain extents of a fully loaded texture, textures of the same shape can be
+    // layers of one array image
+    struct TextureShape {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t levelCount = 0;
+
+        bool operator<(const TextureShape& other) const {
+            return std::tie(format, width, height, levelCount) < std::tie(other.format, other.width, other.height, other.levelCount);
+        }
+    };
+
+    struct TextureArrayPlan {
+        TextureShape shape;
+
+        // indices into the planned shapes, in layer order
+        std::vector<uint32_t> layers;
+    };
+
+    // Groups textures of the same shape into arrays of at most maxLayers layers, in index order.
+    // Shapes with an undefined format are left out, as are groups smaller than minLayers
+    std::vector<TextureArrayPlan> planTextureArrays(const std::vector<TextureShape>& shapes, uint32_t maxLayers, uint32_t minLayers = 2);
+}
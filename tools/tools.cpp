@@ -1,7 +1,217 @@
 #include "tools.h"
+#include "bitmap_ops.h"
+#include "simd.h"
+#include <cfloat>
 
 namespace lzvk::tools {
 
+    namespace {
+
+        // Direction of a texel is base + u * uAxis, base holds the v and constant terms of the
+        // face and is the same for the whole row. Same directions as faceCoordsToXYZ
+        struct FaceAxes {
+            glm::vec3 uAxis;
+            glm::vec3 vAxis;
+            glm::vec3 origin;
+        };
+
+        const FaceAxes FACE_AXES[6] = {
+            { {  0,  0, -1 }, { 0, -1,  0 }, {  1,  0,  0 } }, // +X
+            { {  0,  0,  1 }, { 0, -1,  0 }, { -1,  0,  0 } }, // -X
+            { {  1,  0,  0 }, { 0,  0,  1 }, {  0,  1,  0 } }, // +Y
+            { {  1,  0,  0 }, { 0,  0, -1 }, {  0, -1,  0 } }, // -Y
+            { {  1,  0,  0 }, { 0, -1,  0 }, {  0,  0,  1 } }, // +Z
+            { { -1,  0,  0 }, { 0, -1,  0 }, {  0,  0, -1 } }, // -Z
+        };
+
+        // Corner texels of a bilinear tap and their weights
+        struct BilinearTap {
+            const float* A;
+            const float* B;
+            const float* C;
+            const float* D;
+            float wA, wB, wC, wD;
+        };
+
+        // Bilinear tap at (Uf, Vf), taps outside the image are clamped to the border
+        inline BilinearTap getBilinearTap(const Bitmap& equirect, float Uf, float Vf) {
+
+            const int clampW = equirect.mWidth - 1;
+            const int clampH = equirect.mHeight - 1;
+            const int channels = equirect.mChannels;
+
+            int U1 = std::clamp(int(std::floor(Uf)), 0, clampW);
+            int V1 = std::clamp(int(std::floor(Vf)), 0, clampH);
+            int U2 = std::clamp(U1 + 1, 0, clampW);
+            int V2 = std::clamp(V1 + 1, 0, clampH);
+
+            float s = Uf - U1;
+            float t = Vf - V1;
+
+            const float* data = reinterpret_cast<const float*>(equirect.mData.data());
+
+            BilinearTap tap{};
+            tap.A = data + size_t(channels) * (size_t(V1) * equirect.mWidth + U1);
+            tap.B = data + size_t(channels) * (size_t(V1) * equirect.mWidth + U2);
+            tap.C = data + size_t(channels) * (size_t(V2) * equirect.mWidth + U1);
+            tap.D = data + size_t(channels) * (size_t(V2) * equirect.mWidth + U2);
+            tap.wA = (1 - s) * (1 - t);
+            tap.wB = s * (1 - t);
+            tap.wC = (1 - s) * t;
+            tap.wD = s * t;
+
+            return tap;
+        }
+
+        inline void sampleBilinear(const Bitmap& equirect, float Uf, float Vf, float* dst) {
+
+            const BilinearTap tap = getBilinearTap(equirect, Uf, Vf);
+
+#if LZVK_X86_SIMD
+            // RGBA texels in one SSE register
+            if (equirect.mChannels == 4) {
+
+                __m128 color = _mm_mul_ps(_mm_loadu_ps(tap.A), _mm_set1_ps(tap.wA));
+                color = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(tap.B), _mm_set1_ps(tap.wB)), color);
+                color = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(tap.C), _mm_set1_ps(tap.wC)), color);
+                color = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(tap.D), _mm_set1_ps(tap.wD)), color);
+                _mm_storeu_ps(dst, color);
+                return;
+            }
+#endif
+
+            for (int c = 0; c < equirect.mChannels; ++c) {
+                dst[c] = tap.A[c] * tap.wA + tap.B[c] * tap.wB + tap.C[c] * tap.wC + tap.D[c] * tap.wD;
+            }
+        }
+
+#if LZVK_X86_SIMD
+
+        // Same with FMA
+        LZVK_TARGET_AVX2 inline void sampleBilinearAvx2(const Bitmap& equirect, float Uf, float Vf, float* dst) {
+
+            const BilinearTap tap = getBilinearTap(equirect, Uf, Vf);
+
+            __m128 color = _mm_mul_ps(_mm_loadu_ps(tap.A), _mm_set1_ps(tap.wA));
+            color = _mm_fmadd_ps(_mm_loadu_ps(tap.B), _mm_set1_ps(tap.wB), color);
+            color = _mm_fmadd_ps(_mm_loadu_ps(tap.C), _mm_set1_ps(tap.wC), color);
+            color = _mm_fmadd_ps(_mm_loadu_ps(tap.D), _mm_set1_ps(tap.wD), color);
+            _mm_storeu_ps(dst, color);
+        }
+
+        // atan2 with an odd minimax polynomial on [0, 1], at most 1.7e-6 rad off, which is
+        // 0.002 texels of an 8K input
+        LZVK_TARGET_AVX2 inline __m256 atan2Avx(__m256 y, __m256 x) {
+
+            const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+            __m256 ax = _mm256_andnot_ps(signMask, x);
+            __m256 ay = _mm256_andnot_ps(signMask, y);
+            __m256 maxValue = _mm256_max_ps(ax, ay);
+            __m256 minValue = _mm256_min_ps(ax, ay);
+
+            __m256 t = _mm256_div_ps(minValue, _mm256_max_ps(maxValue, _mm256_set1_ps(FLT_MIN)));
+            __m256 s = _mm256_mul_ps(t, t);
+
+            __m256 p = _mm256_set1_ps(-0.01172120f);
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(0.05265332f));
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(-0.11643287f));
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(0.19354346f));
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(-0.33262347f));
+            p = _mm256_fmadd_ps(p, s, _mm256_set1_ps(0.99997726f));
+            p = _mm256_mul_ps(p, t);
+
+            // 1 Back to the octant, then the quadrant, then the sign of y
+            p = _mm256_blendv_ps(p, _mm256_sub_ps(_mm256_set1_ps(glm::half_pi<float>()), p), _mm256_cmp_ps(ay, ax, _CMP_GT_OQ));
+            p = _mm256_blendv_ps(p, _mm256_sub_ps(_mm256_set1_ps(glm::pi<float>()), p), _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_LT_OQ));
+
+            return _mm256_or_ps(p, _mm256_and_ps(y, signMask));
+        }
+
+        // Eight texels per step of one face row, returns how many were written. The directions
+        // don't need normalizing since only their angles are used
+        LZVK_TARGET_AVX2 int convertRowAvx2(const Bitmap& equirect, float* dst, int faceSize, int channels, const glm::vec3& uAxis, const glm::vec3& base, float du, float u0, float scale) {
+
+            alignas(32) float Uf[8];
+            alignas(32) float Vf[8];
+
+            const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+            int i = 0;
+
+            for (; i + 8 <= faceSize; i += 8) {
+
+                __m256 u = _mm256_fmadd_ps(_mm256_add_ps(lane, _mm256_set1_ps(float(i))), _mm256_set1_ps(du), _mm256_set1_ps(u0));
+
+                __m256 x = _mm256_fmadd_ps(u, _mm256_set1_ps(uAxis.x), _mm256_set1_ps(base.x));
+                __m256 y = _mm256_fmadd_ps(u, _mm256_set1_ps(uAxis.y), _mm256_set1_ps(base.y));
+                __m256 z = _mm256_fmadd_ps(u, _mm256_set1_ps(uAxis.z), _mm256_set1_ps(base.z));
+
+                __m256 R = _mm256_sqrt_ps(_mm256_fmadd_ps(x, x, _mm256_mul_ps(y, y)));
+                __m256 theta = atan2Avx(y, x);
+                __m256 phi = atan2Avx(z, R);
+
+                _mm256_store_ps(Uf, _mm256_mul_ps(_mm256_add_ps(theta, _mm256_set1_ps(glm::pi<float>())), _mm256_set1_ps(scale)));
+                _mm256_store_ps(Vf, _mm256_mul_ps(_mm256_sub_ps(_mm256_set1_ps(glm::half_pi<float>()), phi), _mm256_set1_ps(scale)));
+
+                for (int k = 0; k < 8; ++k) {
+                    if (channels == 4) {
+                        sampleBilinearAvx2(equirect, Uf[k], Vf[k], dst + size_t(channels) * (i + k));
+                    }
+                    else {
+                        sampleBilinear(equirect, Uf[k], Vf[k], dst + size_t(channels) * (i + k));
+                    }
+                }
+            }
+
+            return i;
+        }
+
+#endif
+
+        // One output row of a face, written left to right
+        void convertRow(const Bitmap& equirect, Bitmap& cubemap, int face, int row) {
+
+            const int faceSize = cubemap.mWidth;
+            const int channels = cubemap.mChannels;
+            const FaceAxes& axes = FACE_AXES[face];
+
+            const float du = 2.0f / faceSize;
+            const float u0 = 0.5f * du - 1.0f;
+            const float v = (2.0f * (row + 0.5f) / faceSize) - 1.0f;
+            const glm::vec3 base = axes.origin + v * axes.vAxis;
+
+            // texels per radian, the equirect spans 2 pi across 4 faces and pi across 2
+            const float scale = 2.0f * faceSize / glm::pi<float>();
+
+            float* dst = reinterpret_cast<float*>(cubemap.mData.data()) + size_t(channels) * (size_t(face * cubemap.mHeight + row) * faceSize);
+
+            int i = 0;
+
+#if LZVK_X86_SIMD
+            // 1 Eight texels per step on AVX2 CPUs
+            if (hasAvx2()) {
+                i = convertRowAvx2(equirect, dst, faceSize, channels, axes.uAxis, base, du, u0, scale);
+            }
+#endif
+
+            // 2 Remainder, or every texel without AVX2
+            for (; i < faceSize; ++i) {
+
+                float u = u0 + i * du;
+                glm::vec3 P = base + u * axes.uAxis;
+
+                float R = std::hypot(P.x, P.y);
+                float theta = std::atan2(P.y, P.x);
+                float phi = std::atan2(P.z, R);
+
+                float Uf = scale * (theta + glm::pi<float>());
+                float Vf = scale * (glm::half_pi<float>() - phi);
+
+                sampleBilinear(equirect, Uf, Vf, dst + size_t(channels) * i);
+            }
+        }
+    }
+
     glm::vec3 Tools::faceCoordsToXYZ(int i, int j, int faceID, int faceSize) {
         float u = (2.0f * (i + 0.5f) / faceSize) - 1.0f;
         float v = (2.0f * (j + 0.5f) / faceSize) - 1.0f;
@@ -17,49 +227,30 @@ namespace lzvk::tools {
         }
     }
 
-    Bitmap Tools::convertEquirectangularToCubemapFaces(const Bitmap& equirect) {
-        
+    bool Tools::isSimdEnabled() {
+        return hasAvx2();
+    }
+
+    Bitmap Tools::convertEquirectangularToCubemapFaces(const Bitmap& equirect, uint32_t threadCount) {
+
         if (equirect.mFormat != BitmapFormat::Float) {
             throw std::runtime_error("input must be float format");
         }
 
         int faceSize = equirect.mWidth / 4;
-        Bitmap cubemap(faceSize, faceSize, 6, equirect.mChannels, equirect.mFormat);
-
-        int clampW = equirect.mWidth - 1;
-        int clampH = equirect.mHeight - 1;
-
-        for (int face = 0; face < 6; ++face) {
-            for (int i = 0; i < faceSize; ++i) {
-                for (int j = 0; j < faceSize; ++j) {
-                    glm::vec3 P = faceCoordsToXYZ(i, j, face, faceSize);
-                    float R = std::hypot(P.x, P.y);
-                    float theta = std::atan2(P.y, P.x);
-                    float phi = std::atan2(P.z, R);
-
-                    float Uf = 2.0f * faceSize * (theta + glm::pi<float>()) / glm::pi<float>();
-                    float Vf = 2.0f * faceSize * (glm::half_pi<float>() - phi) / glm::pi<float>();
-
-                    int U1 = std::clamp(int(std::floor(Uf)), 0, clampW);
-                    int V1 = std::clamp(int(std::floor(Vf)), 0, clampH);
-                    int U2 = std::clamp(U1 + 1, 0, clampW);
-                    int V2 = std::clamp(V1 + 1, 0, clampH);
-
-                    float s = Uf - U1;
-                    float t = Vf - V1;
+        if (faceSize == 0 || equirect.mHeight == 0) {
+            throw std::runtime_error("Error: equirectangular image is too small for a cube map");
+        }
 
-                    glm::vec4 A = equirect.getPixelFloat(U1, V1);
-                    glm::vec4 B = equirect.getPixelFloat(U2, V1);
-                    glm::vec4 C = equirect.getPixelFloat(U1, V2);
-                    glm::vec4 D = equirect.getPixelFloat(U2, V2);
+        Bitmap cubemap(faceSize, faceSize, 6, equirect.mChannels, equirect.mFormat);
 
-                    glm::vec4 color = A * (1 - s) * (1 - t) + B * s * (1 - t) + C * (1 - s) * t + D * s * t;
+        // 1 Rows of all faces are independent, threads take every step-th row so each sees all faces
+        const uint32_t rowCount = 6 * uint32_t(faceSize);
 
-                    cubemap.setPixelFloat(i, j, face, color); 
-                }
-            }
-        }
+        forEachRow(rowCount, getThreadCount(threadCount, rowCount), [&](uint32_t row, uint32_t) {
+            convertRow(equirect, cubemap, int(row) / faceSize, int(row) % faceSize);
+        });
 
         return cubemap;
     }
-}
\ No newline at end of file
+}
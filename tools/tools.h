@@ -6,7 +6,11 @@ namespace lzvk::tools {
 	public:
 
 		static glm::vec3 faceCoordsToXYZ(int i, int j, int faceID, int faceSize);
-		static Bitmap convertEquirectangularToCubemapFaces(const Bitmap& equirect);
+		static bool isSimdEnabled();
+
+		// Float equirectangular image to six faces of width / 4, bilinear filtered. The rows of every
+		// face are spread over threadCount threads, 0 uses every core
+		static Bitmap convertEquirectangularToCubemapFaces(const Bitmap& equirect, uint32_t threadCount = 0);
 
 	};
 
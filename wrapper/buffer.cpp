@@ -4,11 +4,25 @@
 
 namespace lzvk::wrapper {
 
+	static const char* getMemoryTag(VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
+
+		bool hostVisible = (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+
+		if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT) return "vertex";
+		if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT) return "index";
+		if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) return "uniform";
+		if (hostVisible && (usage & VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)) return "indirect";
+		if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT) return "storage";
+		if (hostVisible && (usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT)) return "staging";
+
+		return "buffer";
+	}
+
 	Buffer::Ptr Buffer::createVertexBuffer(const Device::Ptr& device, VkDeviceSize size, const void* pData) {
 		
 		auto buffer = Buffer::create(
 			device, size,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
 
@@ -21,7 +35,7 @@ namespace lzvk::wrapper {
 		
 		auto buffer = Buffer::create(
 			device, size,
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
 			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
 		);
 
@@ -74,6 +88,20 @@ namespace lzvk::wrapper {
 		return buffer;
 	}
 
+	Buffer::Ptr Buffer::createHostIndirectBuffer(const Device::Ptr& device, VkDeviceSize size) {
+
+		// Host visible so the CPU can write draw commands every frame without a staging copy
+		auto buffer = create(
+			device, size,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		);
+
+		buffer->mapPersistent();
+
+		return buffer;
+	}
+
 	Buffer::Buffer(const Device::Ptr& device, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, bool supportDeviceAddress){
 	
 		mDevice = device;
@@ -92,83 +120,50 @@ namespace lzvk::wrapper {
 			throw std::runtime_error("Error:failed to create buffer");
 		}
 
-		// 2 Allocate buffer in GPU memory
-		// 2.1 Memory create info
-		VkMemoryRequirements memReq{};
-		vkGetBufferMemoryRequirements(mDevice->getDevice(), mBuffer, &memReq);
-
-		VkMemoryAllocateFlagsInfo flagsInfo{};
-		flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
-		flagsInfo.flags = supportDeviceAddress ? VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT : 0;
-
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memReq.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, properties);
-		allocInfo.pNext = supportDeviceAddress ? &flagsInfo : nullptr;
-
-		// 2.2 Allocate memory
-		if (vkAllocateMemory(mDevice->getDevice(), &allocInfo, nullptr, &mBufferMemory) != VK_SUCCESS) {
-			throw std::runtime_error("Error: failed to allocate memory");
-		}
-
-		// 3 Bind buffer handle with buffer memory
-		vkBindBufferMemory(mDevice->getDevice(), mBuffer, mBufferMemory, 0);
+		// 2 Sub-allocate GPU memory and bind it to the buffer
+		mAllocation = mDevice->getAllocator()->allocateForBuffer(mBuffer, properties, getMemoryTag(usage, properties), supportDeviceAddress);
 
 		mBufferInfo.buffer = mBuffer;
 		mBufferInfo.offset = 0;
 		mBufferInfo.range = size;
 	}
 	
-	uint32_t Buffer::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-
-
-		VkPhysicalDeviceMemoryProperties memProps;
-		vkGetPhysicalDeviceMemoryProperties(mDevice->getPhysicalDevice(), &memProps);
-
-		for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
-
-			// Requirement 1: meet the type
-			// Requirement 2: meet the flag of type
-			if ((typeFilter & (1 << i)) && ((memProps.memoryTypes[i].propertyFlags & properties) == properties)) {
-				
-				return i;
-			}
+	void Buffer::updateBufferByMap(const void* data, size_t size) {
+		
+		// Host visible blocks are mapped once by the allocator
+		if (mAllocation.mappedData == nullptr) {
+			throw std::runtime_error("Error: buffer memory is not host visible");
 		}
 
-		throw std::runtime_error("Error: cannot find the property memory type!");
+		memcpy(mAllocation.mappedData, data, size);
 	}
 
-	void Buffer::updateBufferByMap(const void* data, size_t size) {
-		
-		void* memPtr = nullptr;
+	void* Buffer::mapPersistent() {
 
-		vkMapMemory(mDevice->getDevice(), mBufferMemory, 0, size, 0, &memPtr);
-		memcpy(memPtr, data, size);
-		vkUnmapMemory(mDevice->getDevice(), mBufferMemory);
+		// Memory stays mapped until the buffer is destroyed
+		if (mAllocation.mappedData == nullptr) {
+			throw std::runtime_error("Error: failed to map buffer memory");
+		}
 
+		return mAllocation.mappedData;
 	}
 
 	void Buffer::updateBufferByStage(const void* data, size_t size) {
 		
-		auto stageBuffer = Buffer::create(mDevice, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-		stageBuffer->updateBufferByMap(data, size);
-
-		copyBuffer(stageBuffer->getBuffer(), mBuffer, static_cast<VkDeviceSize>(size));
+		updateBufferByStage(data, size, 0);
 	}
 
 	void Buffer::updateBufferByStage(const void* data, size_t size, size_t offset) {
-		auto stageBuffer = Buffer::create(
-			mDevice,
-			size,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		);
 
-		stageBuffer->updateBufferByMap(data, size);
+		// Host visible memory needs no copy
+		if (mAllocation.mappedData != nullptr) {
 
-		copyBuffer(stageBuffer->getBuffer(), mBuffer, static_cast<VkDeviceSize>(size), static_cast<VkDeviceSize>(offset));
+			memcpy(static_cast<uint8_t*>(mAllocation.mappedData) + offset, data, size);
+			return;
+		}
+
+		// Recorded into the current upload batch, visible to the graphics queue once the batch is flushed
+		mDevice->getUploadManager()->uploadBuffer(mBuffer, data, static_cast<VkDeviceSize>(size), static_cast<VkDeviceSize>(offset));
 	}
 
 	void Buffer::copyBuffer(const VkBuffer& srcBuffer, const VkBuffer& dstBuffer, VkDeviceSize size) {
@@ -207,14 +202,12 @@ namespace lzvk::wrapper {
 	}
 
 	Buffer::~Buffer(){
-	
+
 		if (mBuffer != VK_NULL_HANDLE) {
 			vkDestroyBuffer(mDevice->getDevice(), mBuffer, nullptr);
 		}
 
-		if (mBufferMemory != VK_NULL_HANDLE) {
-			vkFreeMemory(mDevice->getDevice(), mBufferMemory, nullptr);
-		}
+		mDevice->getAllocator()->free(mAllocation);
 	}
 
 }
\ No newline at end of file
@@ -21,6 +21,7 @@ namespace lzvk::wrapper {
 		static Ptr createUniformBuffer(const Device::Ptr& device, VkDeviceSize size, const void* pData = nullptr);
 		static Ptr createStageBuffer(const Device::Ptr& device, VkDeviceSize size, const void* pData = nullptr);
 		static Ptr createStorageBuffer(const Device::Ptr& device, VkDeviceSize size, const void* pData, bool supportDeviceAddress);
+		static Ptr createHostIndirectBuffer(const Device::Ptr& device, VkDeviceSize size);
 
 	public:
 
@@ -28,6 +29,7 @@ namespace lzvk::wrapper {
 		~Buffer();
 		
 		void updateBufferByMap(const void* data, size_t size);
+		void* mapPersistent();
 		void updateBufferByStage(const void* data, size_t size);
 		void updateBufferByStage(const void* data, size_t size, size_t offset);
 		void copyBuffer(const VkBuffer& srcBuffer, const VkBuffer& dstBuffer, VkDeviceSize size);
@@ -63,16 +65,15 @@ namespace lzvk::wrapper {
 		[[nodiscard]] auto getBuffer() const { return mBuffer; }
 		[[nodiscard]] auto& getBufferInfo() { return mBufferInfo; }
 		[[nodiscard]] auto getVkDeviceMemory() const {
-			return mBufferMemory;
+			return mAllocation.memory;
 		}
-	private:
-
-		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+		[[nodiscard]] auto getMemoryOffset() const { return mAllocation.offset; }
+		[[nodiscard]] auto getMappedData() const { return mAllocation.mappedData; }
 
 	private:
 
 		VkBuffer mBuffer{ VK_NULL_HANDLE };
-		VkDeviceMemory mBufferMemory{ VK_NULL_HANDLE };
+		MemoryAllocation mAllocation{};
 		Device::Ptr mDevice{ nullptr };
 		VkDescriptorBufferInfo mBufferInfo{};
 	};
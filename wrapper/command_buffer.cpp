@@ -1,5 +1,6 @@
 #include "command_buffer.h"
 #include "render_pass.h"
+#include <chrono>
 
 namespace lzvk::wrapper {
 
@@ -96,6 +97,8 @@ namespace lzvk::wrapper {
 		renderingInfo.pDepthAttachment = pDepthAttachment;
 		renderingInfo.pStencilAttachment = nullptr;
 
+		flushBarriers();
+
 		vkCmdBeginRendering(mCommandBuffer, &renderingInfo);
 	}
 
@@ -157,6 +160,8 @@ namespace lzvk::wrapper {
 		renderingInfo.pDepthAttachment = pDepthAttachment;
 		renderingInfo.pStencilAttachment = nullptr;
 
+		flushBarriers();
+
 		vkCmdBeginRendering(mCommandBuffer, &renderingInfo);
 	}
 
@@ -174,30 +179,14 @@ namespace lzvk::wrapper {
 		colorAttachment.clearValue.color = { {0.0f, 0.0f, 0.0f, 1.0f} };
 		colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
 
-		// Optional depth attachment
-		VkImageView depthImageView = swapchain->getDepthImageView(imageIndex);
-		VkRenderingAttachmentInfo depthAttachment{};
-		VkRenderingAttachmentInfo* pDepthAttachment = nullptr;
-
-		if (depthImageView != VK_NULL_HANDLE) {
-			depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
-			depthAttachment.imageView = depthImageView;
-			depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
-			depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-			depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
-			depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
-
-			pDepthAttachment = &depthAttachment;
-		}
-
 		VkRenderingInfo renderingInfo{};
 		renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
 		renderingInfo.renderArea = { {0, 0}, extent };
 		renderingInfo.layerCount = 1;
 		renderingInfo.colorAttachmentCount = 1;
 		renderingInfo.pColorAttachments = &colorAttachment;
-		renderingInfo.pDepthAttachment = pDepthAttachment;
+
+		flushBarriers();
 
 		vkCmdBeginRendering(mCommandBuffer, &renderingInfo);
 	}
@@ -221,11 +210,15 @@ namespace lzvk::wrapper {
 		renderingInfo.pDepthAttachment = nullptr;
 		renderingInfo.pStencilAttachment = nullptr;
 
+		flushBarriers();
+
 		vkCmdBeginRendering(mCommandBuffer, &renderingInfo);
 	}
 
 	void CommandBuffer::beginRenderPass(const VkRenderPassBeginInfo& renderPassBeginInfo, const VkSubpassContents& subPassContents){
 	
+		flushBarriers();
+
 		vkCmdBeginRenderPass(mCommandBuffer, &renderPassBeginInfo, subPassContents);
 	
 	}
@@ -289,8 +282,20 @@ namespace lzvk::wrapper {
 		vkCmdPushConstants(mCommandBuffer, layout, stageFlags, 0, sizeof(lzvk::core::IrradiancePushConstant), &pc);
 	}
 
+	void CommandBuffer::resetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount) {
+
+		vkCmdResetQueryPool(mCommandBuffer, queryPool, firstQuery, queryCount);
+	}
+
+	void CommandBuffer::writeTimestamp(VkPipelineStageFlagBits stage, VkQueryPool queryPool, uint32_t query) {
+
+		vkCmdWriteTimestamp(mCommandBuffer, stage, queryPool, query);
+	}
+
 	void CommandBuffer::dispatch(uint32_t x, uint32_t y, uint32_t z) {
 		
+		flushBarriers();
+
 		vkCmdDispatch(mCommandBuffer, x, y, z);
 	}
 
@@ -308,7 +313,30 @@ namespace lzvk::wrapper {
 
 	void CommandBuffer::bindDescriptorSet(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, const VkDescriptorSet& descriptorSet, uint32_t setIndex) {
 
-		vkCmdBindDescriptorSets(mCommandBuffer, bindPoint, layout, setIndex, 1, &descriptorSet, 0, nullptr);
+		recordBind(bindPoint, layout, setIndex, 1, &descriptorSet, 0, nullptr);
+	}
+
+	void CommandBuffer::bindDescriptorSet(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, const VkDescriptorSet& descriptorSet, uint32_t setIndex, const std::vector<uint32_t>& dynamicOffsets) {
+
+		recordBind(bindPoint, layout, setIndex, 1, &descriptorSet, static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+	}
+
+	void CommandBuffer::bindDescriptorSets(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, uint32_t firstSet, const std::vector<VkDescriptorSet>& descriptorSets, const std::vector<uint32_t>& dynamicOffsets) {
+
+		recordBind(bindPoint, layout, firstSet, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+	}
+
+	void CommandBuffer::recordBind(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount, const VkDescriptorSet* descriptorSets, uint32_t dynamicOffsetCount, const uint32_t* dynamicOffsets) {
+
+		auto start = std::chrono::steady_clock::now();
+
+		vkCmdBindDescriptorSets(mCommandBuffer, bindPoint, layout, firstSet, setCount, descriptorSets, dynamicOffsetCount, dynamicOffsets);
+
+		auto end = std::chrono::steady_clock::now();
+
+		++sBindCallCount;
+		sBoundSetCount += setCount;
+		sBindCpuTimeNs += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
 	}
 
 	void CommandBuffer::draw(size_t vertexCount){
@@ -331,6 +359,17 @@ namespace lzvk::wrapper {
 		vkCmdDrawIndexedIndirect(mCommandBuffer, indirectBuffer, offset, drawCount, stride);
 	}
 
+	void CommandBuffer::drawMeshTasks(uint32_t x, uint32_t y, uint32_t z) {
+
+		auto drawMeshTasksFunc = mDevice->getDrawMeshTasksFunction();
+
+		if (!drawMeshTasksFunc) {
+			throw std::runtime_error("Error: vkCmdDrawMeshTasksEXT is not available");
+		}
+
+		drawMeshTasksFunc(mCommandBuffer, x, y, z);
+	}
+
 	void CommandBuffer::endRenderPass(){
 	
 		vkCmdEndRenderPass(mCommandBuffer);
@@ -343,6 +382,8 @@ namespace lzvk::wrapper {
 
 	void CommandBuffer::end(){
 	
+		flushBarriers();
+
 		if (vkEndCommandBuffer(mCommandBuffer) != VK_SUCCESS) {
 
 			throw std::runtime_error("Error: failed to end command buffer");
@@ -388,6 +429,8 @@ namespace lzvk::wrapper {
 		resolveRegion.dstOffset = { 0, 0, 0 };
 		resolveRegion.extent = { width, height, 1 };
 
+		flushBarriers();
+
 		vkCmdResolveImage(
 			mCommandBuffer,
 			srcImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
@@ -410,6 +453,8 @@ namespace lzvk::wrapper {
 
 	void CommandBuffer::copyBufferToBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t copyInfoCount, const std::vector<VkBufferCopy>& copyInfos) {
 		
+		flushBarriers();
+
 		vkCmdCopyBuffer(mCommandBuffer, srcBuffer, dstBuffer, copyInfoCount, copyInfos.data());
 	}
 
@@ -427,6 +472,8 @@ namespace lzvk::wrapper {
 		region.imageOffset = { 0, 0, 0 };
 		region.imageExtent = { width, height, 1 };
 
+		flushBarriers();
+
 		vkCmdCopyBufferToImage(mCommandBuffer, srcBuffer, dstImage, dstImageLayout, 1, &region);
 
 	}
@@ -445,7 +492,13 @@ namespace lzvk::wrapper {
 
 	void CommandBuffer::transferImageLayout(const VkImageMemoryBarrier &imageMemoryBarrier, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask) {
 
+		flushBarriers();
+
 		vkCmdPipelineBarrier(mCommandBuffer, srcStageMask, dstStageMask, 0, 0, nullptr, 0, nullptr, 1, &imageMemoryBarrier);
+
+		++sBarrierStats.requests;
+		++sBarrierStats.imageBarriers;
+		++sBarrierStats.barrierCalls;
 	}
 
 	VkImageAspectFlags CommandBuffer::getAspectMaskForFormat(VkFormat format) {
@@ -473,8 +526,10 @@ namespace lzvk::wrapper {
 		uint32_t baseArrayLayer,
 		uint32_t layerCount
 	) {
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		VkImageMemoryBarrier2 barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		barrier.srcStageMask = srcStage;
+		barrier.dstStageMask = dstStage;
 		barrier.oldLayout = oldLayout;
 		barrier.newLayout = newLayout;
 		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
@@ -493,31 +548,165 @@ namespace lzvk::wrapper {
 			barrier.srcAccessMask = 0;
 		}
 		else if (oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
 		}
 		else if (oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
 		}
 		else if (oldLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			barrier.srcAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+		}
+		else if (oldLayout == VK_IMAGE_LAYOUT_GENERAL) {
+			barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
 		}
 
 		// dst access mask
 		if (newLayout == VK_IMAGE_LAYOUT_GENERAL) {
-			barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
 		}
 		else if (newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
 		}
 		else if (newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
-			barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
 		}
 		else if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-			barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 		}
 
-		transferImageLayout(barrier, srcStage, dstStage);
+		++sBarrierStats.requests;
+		queueImageBarrier(barrier);
 	}
 
+	void CommandBuffer::requireImage(const Image::Ptr& image, ImageAccess access, bool discard) {
 
-}
\ No newline at end of file
+		const ImageSubresourceState target = Image::getAccessState(access);
+		const VkAccessFlags2 writeAccess =
+			VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |
+			VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+			VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+		++sBarrierStats.requests;
+
+		// 1 Every subresource either needs a barrier or only widens the set of readers to wait for later
+		bool needsBarrier = false;
+
+		for (uint32_t level = 0; level < image->getMipLevels(); ++level) {
+			for (uint32_t layer = 0; layer < image->getArrayLayers(); ++layer) {
+
+				const auto& state = image->getSubresourceState(level, layer);
+				bool hazard = (state.access & writeAccess) || ((target.access & writeAccess) && state.stages != VK_PIPELINE_STAGE_2_NONE);
+
+				if (state.layout != target.layout || hazard) {
+					needsBarrier = true;
+				}
+			}
+		}
+
+		if (!needsBarrier) {
+
+			++sBarrierStats.redundant;
+
+			if (sBarrierDebug && std::find(sReportedImages.begin(), sReportedImages.end(), image->getImage()) == sReportedImages.end()) {
+
+				sReportedImages.push_back(image->getImage());
+				printf("[Barrier] redundant request: image %p is already in layout %d for this access\n", (void*)image->getImage(), target.layout);
+			}
+
+			for (uint32_t level = 0; level < image->getMipLevels(); ++level) {
+				for (uint32_t layer = 0; layer < image->getArrayLayers(); ++layer) {
+
+					auto state = image->getSubresourceState(level, layer);
+					state.stages |= target.stages;
+					state.access |= target.access;
+					image->setSubresourceState(level, layer, state);
+				}
+			}
+
+			return;
+		}
+
+		// 2 One barrier per run of layers that share their previous state, a single one for plain 2D images
+		for (uint32_t level = 0; level < image->getMipLevels(); ++level) {
+
+			uint32_t runStart = 0;
+
+			for (uint32_t layer = 1; layer <= image->getArrayLayers(); ++layer) {
+
+				const auto& first = image->getSubresourceState(level, runStart);
+
+				if (layer < image->getArrayLayers()) {
+
+					const auto& state = image->getSubresourceState(level, layer);
+
+					if (state.layout == first.layout && state.stages == first.stages && state.access == first.access) {
+						continue;
+					}
+				}
+
+				VkImageMemoryBarrier2 barrier{};
+				barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+				barrier.srcStageMask = first.stages;
+				barrier.srcAccessMask = first.access & writeAccess;
+				barrier.dstStageMask = target.stages;
+				barrier.dstAccessMask = target.access;
+				barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : first.layout;
+				barrier.newLayout = target.layout;
+				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+				barrier.image = image->getImage();
+				barrier.subresourceRange.aspectMask = getAspectMaskForFormat(image->getFormat());
+				barrier.subresourceRange.baseMipLevel = level;
+				barrier.subresourceRange.levelCount = 1;
+				barrier.subresourceRange.baseArrayLayer = runStart;
+				barrier.subresourceRange.layerCount = layer - runStart;
+
+				queueImageBarrier(barrier);
+
+				runStart = layer;
+			}
+		}
+
+		// 3 The tracked state moves to the new use as soon as the barrier is queued
+		for (uint32_t level = 0; level < image->getMipLevels(); ++level) {
+			for (uint32_t layer = 0; layer < image->getArrayLayers(); ++layer) {
+
+				image->setSubresourceState(level, layer, target);
+			}
+		}
+	}
+
+	void CommandBuffer::queueImageBarrier(const VkImageMemoryBarrier2& barrier) {
+
+		// a second transition of the same image depends on the first, it can't share the batch
+		for (const auto& pending : mPendingImageBarriers) {
+
+			if (pending.image == barrier.image) {
+
+				flushBarriers();
+				break;
+			}
+		}
+
+		mPendingImageBarriers.push_back(barrier);
+	}
+
+	void CommandBuffer::flushBarriers() {
+
+		if (mPendingImageBarriers.empty()) {
+			return;
+		}
+
+		VkDependencyInfo dependencyInfo{};
+		dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+		dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(mPendingImageBarriers.size());
+		dependencyInfo.pImageMemoryBarriers = mPendingImageBarriers.data();
+
+		vkCmdPipelineBarrier2(mCommandBuffer, &dependencyInfo);
+
+		++sBarrierStats.barrierCalls;
+		sBarrierStats.imageBarriers += static_cast<uint32_t>(mPendingImageBarriers.size());
+
+		mPendingImageBarriers.clear();
+	}
+}
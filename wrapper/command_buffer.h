@@ -10,6 +10,14 @@
 
 namespace lzvk::wrapper {
 
+	// Barrier activity recorded by all command buffers since the last reset
+	struct BarrierStats {
+		uint32_t requests{ 0 };			// transitions asked for through requireImage or transitionImageLayout
+		uint32_t redundant{ 0 };		// requests that needed no barrier
+		uint32_t imageBarriers{ 0 };	// image barriers recorded
+		uint32_t barrierCalls{ 0 };		// vkCmdPipelineBarrier / vkCmdPipelineBarrier2 calls
+	};
+
 	class CommandBuffer {
 	public:
 		using Ptr = std::shared_ptr<CommandBuffer>;
@@ -38,6 +46,8 @@ namespace lzvk::wrapper {
 		void bindVertexBuffer(const std::vector<VkBuffer>& buffers);
 		void bindIndexBuffer(const VkBuffer& buffer);
 		void bindDescriptorSet(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, const VkDescriptorSet& descriptorSet, uint32_t setIndex);
+		void bindDescriptorSet(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, const VkDescriptorSet& descriptorSet, uint32_t setIndex, const std::vector<uint32_t>& dynamicOffsets);
+		void bindDescriptorSets(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, uint32_t firstSet, const std::vector<VkDescriptorSet>& descriptorSets, const std::vector<uint32_t>& dynamicOffsets = {});
 
 		void pushConstants(const VkPipelineLayout layout, VkShaderStageFlags stageFlags, const lzvk::core::PushConstants& pc);
 		void pushConstants(const VkPipelineLayout layout, VkShaderStageFlags stageFlags, const lzvk::core::SSAOPushConstants& pc);
@@ -46,12 +56,16 @@ namespace lzvk::wrapper {
 		void pushConstants(const VkPipelineLayout layout, VkShaderStageFlags stageFlags, const lzvk::core::LightPushConstant& pc);
 		void pushConstants(const VkPipelineLayout layout, VkShaderStageFlags stageFlags, const lzvk::core::IrradiancePushConstant& pc);
 
+		void resetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount);
+		void writeTimestamp(VkPipelineStageFlagBits stage, VkQueryPool queryPool, uint32_t query);
+
 		void dispatch(uint32_t x, uint32_t y, uint32_t z);
 
 		void draw(size_t vertexCount);
 		void drawIndex(size_t indexCount);
 		void drawIndexInstanced(uint32_t indexCount, uint32_t instancingCount);
 		void drawIndexedIndirect(VkBuffer indirectBuffer, VkDeviceSize offset, uint32_t drawCount, uint32_t stride);
+		void drawMeshTasks(uint32_t x, uint32_t y, uint32_t z);
 
 		void endRenderPass();
 		void endRendering();
@@ -77,13 +91,45 @@ namespace lzvk::wrapper {
 
 		VkImageAspectFlags getAspectMaskForFormat(VkFormat format);
 
+		// Tracked transitions, the previous layout and access come from the image. Barriers are
+		// batched and recorded as one vkCmdPipelineBarrier2 before the next command that needs them,
+		// discard drops the old contents when the pass overwrites the whole image
+		void requireImage(const Image::Ptr& image, ImageAccess access, bool discard = false);
+		void flushBarriers();
+
 		[[nodiscard]] auto getCommandBuffer()const { return mCommandBuffer; }
 
+		// Descriptor set binds recorded by all command buffers since the last reset
+		[[nodiscard]] static uint32_t getBindCallCount() { return sBindCallCount; }
+		[[nodiscard]] static uint32_t getBoundSetCount() { return sBoundSetCount; }
+		[[nodiscard]] static double getBindCpuTimeMs() { return sBindCpuTimeNs * 1e-6; }
+		static void resetBindStats() { sBindCallCount = 0; sBoundSetCount = 0; sBindCpuTimeNs = 0; }
+
+		// Barrier statistics, debug mode also reports every redundant request once per image
+		[[nodiscard]] static BarrierStats getBarrierStats() { return sBarrierStats; }
+		static void resetBarrierStats() { sBarrierStats = {}; }
+		static void setBarrierDebug(bool enabled) { sBarrierDebug = enabled; sReportedImages.clear(); }
+		[[nodiscard]] static bool isBarrierDebug() { return sBarrierDebug; }
+
+	private:
+
+		void queueImageBarrier(const VkImageMemoryBarrier2& barrier);
+		void recordBind(VkPipelineBindPoint bindPoint, const VkPipelineLayout layout, uint32_t firstSet, uint32_t setCount, const VkDescriptorSet* descriptorSets, uint32_t dynamicOffsetCount, const uint32_t* dynamicOffsets);
+
 	private:
 
 		VkCommandBuffer mCommandBuffer{ VK_NULL_HANDLE };
 		Device::Ptr mDevice{ nullptr };
 		CommandPool::Ptr mCommandPool{ nullptr };
 
+		std::vector<VkImageMemoryBarrier2> mPendingImageBarriers{};
+
+		inline static uint32_t sBindCallCount{ 0 };
+		inline static uint32_t sBoundSetCount{ 0 };
+		inline static uint64_t sBindCpuTimeNs{ 0 };
+
+		inline static BarrierStats sBarrierStats{};
+		inline static bool sBarrierDebug{ false };
+		inline static std::vector<VkImage> sReportedImages{};
 	};
 }
\ No newline at end of file
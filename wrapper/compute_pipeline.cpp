@@ -31,17 +31,20 @@ namespace lzvk::wrapper {
 			throw std::runtime_error("Compute shader is not set");
 		}
 
+		// push constants exactly as the shader declares them
+		const auto& reflected = mComputeShader->getReflection().pushConstant;
+
 		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(glm::mat4) + sizeof(uint64_t) * 2 + sizeof(float) + sizeof(uint32_t);
+		pushConstantRange.offset = reflected.offset;
+		pushConstantRange.size = reflected.size;
 		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
 
 		VkPipelineLayoutCreateInfo layoutInfo{};
 		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		layoutInfo.setLayoutCount = static_cast<uint32_t>(mSetLayouts.size());
 		layoutInfo.pSetLayouts = mSetLayouts.data();
-		layoutInfo.pushConstantRangeCount = 1;
-		layoutInfo.pPushConstantRanges = &pushConstantRange;
+		layoutInfo.pushConstantRangeCount = reflected.size > 0 ? 1 : 0;
+		layoutInfo.pPushConstantRanges = reflected.size > 0 ? &pushConstantRange : nullptr;
 
 		if (vkCreatePipelineLayout(mDevice->getDevice(), &layoutInfo, nullptr, &mLayout) != VK_SUCCESS) {
 			
@@ -70,7 +73,7 @@ namespace lzvk::wrapper {
 		pipelineInfo.stage = shaderStageInfo;
 		pipelineInfo.layout = mLayout;
 
-		if (vkCreateComputePipelines(mDevice->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mComputePipeline) != VK_SUCCESS) {
+		if (vkCreateComputePipelines(mDevice->getDevice(), mDevice->getPipelineCache()->getCache(), 1, &pipelineInfo, nullptr, &mComputePipeline) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create compute pipeline");
 		}
 	}
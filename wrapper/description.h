@@ -14,6 +14,9 @@ namespace lzvk::wrapper {
 		size_t					mSize{ 0 };
 		uint32_t				mBinding{ 0 };
 
+		// base offset into the buffer, dynamic buffers add the bind time offset on top
+		VkDeviceSize			mOffset{ 0 };
+
 		uint32_t				mCount{ 0 };
 		VkDescriptorType		mDescriptorType;
 		VkShaderStageFlags      mStage;
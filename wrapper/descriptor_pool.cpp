@@ -18,6 +18,7 @@ namespace lzvk::wrapper {
 
 		// 1 Get the number of uniform buffer
 		uint32_t uniformBufferCount = 0;
+		uint32_t dynamicUniformBufferCount = 0;
 		uint32_t textureCount = 0;
 		uint32_t storageBufferCount = 0;
 		uint32_t storageImageCount = 0;
@@ -30,6 +31,10 @@ namespace lzvk::wrapper {
 				uniformBufferCount += param->mCount;
 				break;
 
+			case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC:
+				dynamicUniformBufferCount += param->mCount;
+				break;
+
 			case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
 				textureCount += param->mCount;
 				break;
@@ -58,6 +63,12 @@ namespace lzvk::wrapper {
 				uniformBufferCount * frameCount
 				});
 		}
+		if (dynamicUniformBufferCount > 0) {
+			poolSizes.push_back({
+				VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				dynamicUniformBufferCount * frameCount
+				});
+		}
 		if (textureCount > 0) {
 			poolSizes.push_back({
 				VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
@@ -52,6 +52,21 @@ namespace lzvk::wrapper {
             throw std::runtime_error("Error: failed to allocate descriptor sets");
         }
 
+        // 2 Single descriptor bindings get cached state and an update template
+        for (auto& param : params) {
+
+            if (param && param->mCount == 1) {
+                mEntries.push_back({ param->mBinding, param->mDescriptorType });
+            }
+        }
+
+        mWritten.assign(frameCount, std::vector<DescriptorInfo>(mEntries.size()));
+        mStaged.assign(frameCount, std::vector<DescriptorInfo>(mEntries.size()));
+        mValid.assign(frameCount, std::vector<bool>(mEntries.size(), false));
+        mDirty.assign(frameCount, std::vector<bool>(mEntries.size(), false));
+
+        createUpdateTemplate(layout->getLayout());
+
         // ----------- Prepare persistent storage for bufferInfos ----------- 
         std::vector<std::vector<VkDescriptorBufferInfo>> allBufferInfos(params.size());
 
@@ -68,6 +83,7 @@ namespace lzvk::wrapper {
                 }
 
                 if (param->mDescriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+                    param->mDescriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC ||
                     param->mDescriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
 
                     if (param->mBuffers.empty()) {
@@ -83,7 +99,7 @@ namespace lzvk::wrapper {
 
                         VkDescriptorBufferInfo bufferInfo{};
                         bufferInfo.buffer = buffer->getBuffer();
-                        bufferInfo.offset = 0;
+                        bufferInfo.offset = param->mOffset;
                         bufferInfo.range = param->mSize;
                         bufferInfos.push_back(bufferInfo);
                     }
@@ -109,6 +125,12 @@ namespace lzvk::wrapper {
                     write.pBufferInfo = bufferInfos.data();
 
                     writes.push_back(write);
+
+                    int entry = findEntry(param->mBinding);
+                    if (entry >= 0) {
+                        mWritten[i][entry].buffer = bufferInfos[0];
+                        mValid[i][entry] = true;
+                    }
                 }
                 else if (param->mDescriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
 
@@ -132,12 +154,19 @@ namespace lzvk::wrapper {
                     write.pImageInfo = param->mImageInfos.data();
 
                     writes.push_back(write);
+
+                    int entry = findEntry(param->mBinding);
+                    if (entry >= 0) {
+                        mWritten[i][entry].image = param->mImageInfos[0];
+                        mValid[i][entry] = true;
+                    }
                 }
 
                 ++paramIdx;
             }
 
             if (!writes.empty()) {
+                sWriteCount += static_cast<uint32_t>(writes.size());
                 vkUpdateDescriptorSets(
                     mDevice->getDevice(),
                     static_cast<uint32_t>(writes.size()),
@@ -149,8 +178,204 @@ namespace lzvk::wrapper {
         }
     }
 
+    void DescriptorSet::createUpdateTemplate(VkDescriptorSetLayout layout) {
+
+        std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+
+        for (size_t i = 0; i < mEntries.size(); ++i) {
+
+            // dynamic offsets are applied at bind time, these sets are never rewritten
+            if (mEntries[i].type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) {
+                continue;
+            }
+
+            VkDescriptorUpdateTemplateEntry entry{};
+            entry.dstBinding = mEntries[i].binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = 1;
+            entry.descriptorType = mEntries[i].type;
+            entry.offset = i * sizeof(DescriptorInfo);
+            entry.stride = sizeof(DescriptorInfo);
+
+            templateEntries.push_back(entry);
+        }
+
+        if (templateEntries.size() != mEntries.size() || templateEntries.empty()) {
+            return;
+        }
+
+        VkDescriptorUpdateTemplateCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+        createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+        createInfo.pDescriptorUpdateEntries = templateEntries.data();
+        createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+        createInfo.descriptorSetLayout = layout;
+
+        if (vkCreateDescriptorUpdateTemplate(mDevice->getDevice(), &createInfo, nullptr, &mUpdateTemplate) != VK_SUCCESS) {
+            throw std::runtime_error("Error: failed to create descriptor update template");
+        }
+    }
+
+    int DescriptorSet::findFrame(VkDescriptorSet descriptorSet) const {
+
+        for (size_t i = 0; i < mDescriptorSets.size(); ++i) {
+            if (mDescriptorSets[i] == descriptorSet) {
+                return static_cast<int>(i);
+            }
+        }
+
+        return -1;
+    }
+
+    int DescriptorSet::findEntry(uint32_t binding) const {
+
+        for (size_t i = 0; i < mEntries.size(); ++i) {
+            if (mEntries[i].binding == binding) {
+                return static_cast<int>(i);
+            }
+        }
+
+        return -1;
+    }
+
+    bool DescriptorSet::isImage(uint32_t entry) const {
+
+        VkDescriptorType type = mEntries[entry].type;
+        return type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    }
+
+    void DescriptorSet::stage(int frameIndex, int entry, const DescriptorInfo& info) {
+
+        mStaged[frameIndex][entry] = info;
+
+        bool same = false;
+        if (mValid[frameIndex][entry]) {
+
+            const DescriptorInfo& written = mWritten[frameIndex][entry];
+
+            same = isImage(entry)
+                ? written.image.sampler == info.image.sampler && written.image.imageView == info.image.imageView && written.image.imageLayout == info.image.imageLayout
+                : written.buffer.buffer == info.buffer.buffer && written.buffer.offset == info.buffer.offset && written.buffer.range == info.buffer.range;
+        }
+
+        mDirty[frameIndex][entry] = !same;
+    }
+
+    void DescriptorSet::setImage(int frameIndex, uint32_t binding, const VkDescriptorImageInfo& imageInfo) {
+
+        int entry = findEntry(binding);
+        if (entry < 0) {
+            throw std::runtime_error("Error: binding is not a single descriptor of this set");
+        }
+
+        DescriptorInfo info{};
+        info.image = imageInfo;
+        stage(frameIndex, entry, info);
+    }
+
+    void DescriptorSet::setBuffer(int frameIndex, uint32_t binding, const VkDescriptorBufferInfo& bufferInfo) {
+
+        int entry = findEntry(binding);
+        if (entry < 0) {
+            throw std::runtime_error("Error: binding is not a single descriptor of this set");
+        }
+
+        DescriptorInfo info{};
+        info.buffer = bufferInfo;
+        stage(frameIndex, entry, info);
+    }
+
+    void DescriptorSet::invalidate() {
+
+        for (auto& valid : mValid) {
+            std::fill(valid.begin(), valid.end(), false);
+        }
+    }
+
+    void DescriptorSet::commit(int frameIndex) {
+
+        auto& dirty = mDirty[frameIndex];
+        auto& valid = mValid[frameIndex];
+        auto& staged = mStaged[frameIndex];
+        auto& written = mWritten[frameIndex];
+
+        bool anyDirty = false;
+        bool allKnown = true;
+
+        for (size_t i = 0; i < mEntries.size(); ++i) {
+            anyDirty = anyDirty || dirty[i];
+            allKnown = allKnown && (valid[i] || dirty[i]);
+        }
+
+        if (!anyDirty) {
+            return;
+        }
+
+        // 1 Every descriptor of the set is known, rewrite it with the template
+        if (mUpdateTemplate != VK_NULL_HANDLE && allKnown) {
+
+            for (size_t i = 0; i < mEntries.size(); ++i) {
+
+                if (dirty[i]) {
+                    written[i] = staged[i];
+                }
+            }
+
+            vkUpdateDescriptorSetWithTemplate(mDevice->getDevice(), mDescriptorSets[frameIndex], mUpdateTemplate, written.data());
+            sWriteCount += static_cast<uint32_t>(mEntries.size());
+        }
+        // 2 Otherwise write only the changed bindings
+        else {
+
+            std::vector<VkWriteDescriptorSet> writes;
+
+            for (size_t i = 0; i < mEntries.size(); ++i) {
+
+                if (!dirty[i]) {
+                    continue;
+                }
+
+                written[i] = staged[i];
+
+                VkWriteDescriptorSet write{};
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet = mDescriptorSets[frameIndex];
+                write.dstBinding = mEntries[i].binding;
+                write.dstArrayElement = 0;
+                write.descriptorType = mEntries[i].type;
+                write.descriptorCount = 1;
+
+                if (isImage(static_cast<uint32_t>(i))) {
+                    write.pImageInfo = &written[i].image;
+                }
+                else {
+                    write.pBufferInfo = &written[i].buffer;
+                }
+
+                writes.push_back(write);
+            }
+
+            vkUpdateDescriptorSets(mDevice->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+            sWriteCount += static_cast<uint32_t>(writes.size());
+        }
+
+        for (size_t i = 0; i < mEntries.size(); ++i) {
+
+            valid[i] = valid[i] || dirty[i];
+            dirty[i] = false;
+        }
+    }
+
     void DescriptorSet::updateImage(const VkDescriptorSet& descriptorSet, uint32_t binding, const VkDescriptorImageInfo& imageInfo) {
         
+        int frameIndex = findFrame(descriptorSet);
+        if (frameIndex >= 0 && findEntry(binding) >= 0) {
+
+            setImage(frameIndex, binding, imageInfo);
+            commit(frameIndex);
+            return;
+        }
+
         VkWriteDescriptorSet write{};
         write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         write.dstSet = descriptorSet;
@@ -161,9 +386,19 @@ namespace lzvk::wrapper {
         write.pImageInfo = &imageInfo;
 
         vkUpdateDescriptorSets(mDevice->getDevice(), 1, &write, 0, nullptr);
+        ++sWriteCount;
     }
 
     void DescriptorSet::updateStorageImage(const VkDescriptorSet& descriptorSet, uint32_t binding, const VkDescriptorImageInfo& imageInfo) {
+        
+        int frameIndex = findFrame(descriptorSet);
+        if (frameIndex >= 0 && findEntry(binding) >= 0) {
+
+            setImage(frameIndex, binding, imageInfo);
+            commit(frameIndex);
+            return;
+        }
+
         VkWriteDescriptorSet write{};
         write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         write.dstSet = descriptorSet;
@@ -174,9 +409,53 @@ namespace lzvk::wrapper {
         write.pImageInfo = &imageInfo;
 
         vkUpdateDescriptorSets(mDevice->getDevice(), 1, &write, 0, nullptr);
+        ++sWriteCount;
+    }
+
+    void DescriptorSet::updateStorageBuffer(const VkDescriptorSet& descriptorSet, uint32_t binding, const VkDescriptorBufferInfo& bufferInfo) {
+        
+        int frameIndex = findFrame(descriptorSet);
+        if (frameIndex >= 0 && findEntry(binding) >= 0) {
+
+            setBuffer(frameIndex, binding, bufferInfo);
+            commit(frameIndex);
+            return;
+        }
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet;
+        write.dstBinding = binding;
+        write.dstArrayElement = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.descriptorCount = 1;
+        write.pBufferInfo = &bufferInfo;
+
+        vkUpdateDescriptorSets(mDevice->getDevice(), 1, &write, 0, nullptr);
+        ++sWriteCount;
+    }
+
+    void DescriptorSet::updateImageArrayElement(int frameIndex, uint32_t binding, uint32_t arrayElement, const VkDescriptorImageInfo& imageInfo) {
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = mDescriptorSets[frameIndex];
+        write.dstBinding = binding;
+        write.dstArrayElement = arrayElement;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &imageInfo;
+
+        vkUpdateDescriptorSets(mDevice->getDevice(), 1, &write, 0, nullptr);
+        ++sWriteCount;
     }
 
 
-	DescriptorSet::~DescriptorSet() {}
+    DescriptorSet::~DescriptorSet() {
+
+        if (mUpdateTemplate != VK_NULL_HANDLE) {
+            vkDestroyDescriptorUpdateTemplate(mDevice->getDevice(), mUpdateTemplate, nullptr);
+        }
+    }
 
 }
\ No newline at end of file
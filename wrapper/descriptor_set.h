@@ -20,15 +20,63 @@ namespace lzvk::wrapper {
 		DescriptorSet(const Device::Ptr& device, const std::vector<UniformParameter::Ptr> params, const DescriptorSetLayout::Ptr& layout, const DescriptorPool::Ptr& pool,int frameCount);
 		~DescriptorSet();
 
+		// Immediate updates, skipped when the set already holds the same descriptor
 		void updateImage(const VkDescriptorSet& descriptorSet, uint32_t binding, const VkDescriptorImageInfo& imageInfo);
 		void updateStorageImage(const VkDescriptorSet& descriptorSet, uint32_t binding, const VkDescriptorImageInfo& imageInfo);
+		void updateStorageBuffer(const VkDescriptorSet& descriptorSet, uint32_t binding, const VkDescriptorBufferInfo& bufferInfo);
+
+		// One element of a texture array binding, the array has to be update after bind when the set is in use
+		void updateImageArrayElement(int frameIndex, uint32_t binding, uint32_t arrayElement, const VkDescriptorImageInfo& imageInfo);
+
+		// Staged updates, commit writes whatever changed with one template update
+		void setImage(int frameIndex, uint32_t binding, const VkDescriptorImageInfo& imageInfo);
+		void setBuffer(int frameIndex, uint32_t binding, const VkDescriptorBufferInfo& bufferInfo);
+		void commit(int frameIndex);
+
+		// Forget what the sets hold, the next commit writes everything again. Needed when the
+		// referenced images are recreated, a new view can reuse the handle of a destroyed one
+		void invalidate();
 
 		[[nodiscard]] auto getDescriptorSet(int frameCount) const { return mDescriptorSets[frameCount]; }
 
+		// Descriptors written by all sets since the last reset
+		[[nodiscard]] static uint32_t getWriteCount() { return sWriteCount; }
+		static void resetWriteCount() { sWriteCount = 0; }
+
+	private:
+
+		union DescriptorInfo {
+			VkDescriptorImageInfo image;
+			VkDescriptorBufferInfo buffer;
+		};
+
+		struct Entry {
+			uint32_t binding = 0;
+			VkDescriptorType type = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+		};
+
+		int findFrame(VkDescriptorSet descriptorSet) const;
+		int findEntry(uint32_t binding) const;
+		bool isImage(uint32_t entry) const;
+		void stage(int frameIndex, int entry, const DescriptorInfo& info);
+		void createUpdateTemplate(VkDescriptorSetLayout layout);
+
 	private:
 
 		Device::Ptr mDevice{ nullptr };
 		std::vector<VkDescriptorSet> mDescriptorSets{};
 		std::unordered_map<uint32_t, std::vector<VkDescriptorImageInfo>> mImageInfos;
+
+		// 1 Single descriptor bindings covered by the update template
+		std::vector<Entry> mEntries{};
+		VkDescriptorUpdateTemplate mUpdateTemplate{ VK_NULL_HANDLE };
+
+		// 2 Per frame: what the set holds, what is staged, which entries are known and dirty
+		std::vector<std::vector<DescriptorInfo>> mWritten{};
+		std::vector<std::vector<DescriptorInfo>> mStaged{};
+		std::vector<std::vector<bool>> mValid{};
+		std::vector<std::vector<bool>> mDirty{};
+
+		inline static uint32_t sWriteCount{ 0 };
 	};
 }
\ No newline at end of file
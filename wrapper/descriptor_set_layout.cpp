@@ -15,9 +15,39 @@ namespace lzvk::wrapper {
 	}
 
 	void DescriptorSetLayout::build(const std::vector<UniformParameter::Ptr>& params) {
+
+		build(params, ShaderReflection{}, 0);
+	}
+
+	bool DescriptorSetLayout::isCompatible(VkDescriptorType layoutType, VkDescriptorType shaderType) {
+
+		// dynamic offsets are a property of the layout, the shader sees a plain buffer
+		if (layoutType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC) return shaderType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		if (layoutType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC) return shaderType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+		return layoutType == shaderType;
+	}
+
+	void DescriptorSetLayout::build(const std::vector<UniformParameter::Ptr>& params, const ShaderReflection& reflection, uint32_t set) {
 		
 		mParams = params;
 
+		// 1 Every binding the shaders read needs a parameter
+		if (!reflection.isEmpty()) {
+
+			for (const auto& shaderBinding : reflection.getSet(set)) {
+
+				bool declared = std::any_of(mParams.begin(), mParams.end(), [&](const UniformParameter::Ptr& param) {
+					return param->mBinding == shaderBinding.binding && param->mCount > 0;
+				});
+
+				if (!declared) {
+					throw std::runtime_error("Error: shaders use set " + std::to_string(set) + " binding " + std::to_string(shaderBinding.binding) +
+											 " but the layout doesn't declare it, recompile the shaders or add the parameter");
+				}
+			}
+		}
+
 		if (mLayout != VK_NULL_HANDLE) {
 			
 			vkDestroyDescriptorSetLayout(mDevice->getDevice(), mLayout, nullptr);
@@ -25,6 +55,7 @@ namespace lzvk::wrapper {
 
 		std::vector<VkDescriptorSetLayoutBinding> layoutBindings{};
 		std::vector<VkDescriptorBindingFlags> bindingFlags;
+		bool updateAfterBind = false;
 
 		for (const auto& param : mParams) {
 
@@ -35,6 +66,31 @@ namespace lzvk::wrapper {
 			layoutBinding.descriptorType = param->mDescriptorType;
 			layoutBinding.binding = param->mBinding;
 			layoutBinding.stageFlags = param->mStage;
+
+			// 2 Stages from the shaders, the parameter has to agree on type and count
+			if (!reflection.isEmpty()) {
+
+				const ShaderBinding* shaderBinding = reflection.find(set, param->mBinding);
+
+				if (shaderBinding == nullptr) {
+					printf("[DescriptorSetLayout] set %u binding %u is not used by any reflected shader\n", set, param->mBinding);
+				}
+				else {
+
+					if (!isCompatible(param->mDescriptorType, shaderBinding->type)) {
+						throw std::runtime_error("Error: set " + std::to_string(set) + " binding " + std::to_string(param->mBinding) +
+												 " is descriptor type " + std::to_string(param->mDescriptorType) + " in the layout but " +
+												 std::to_string(shaderBinding->type) + " in the shaders");
+					}
+
+					if (shaderBinding->count > param->mCount) {
+						throw std::runtime_error("Error: set " + std::to_string(set) + " binding " + std::to_string(param->mBinding) +
+												 " holds fewer descriptors than the shaders index");
+					}
+
+					layoutBinding.stageFlags = shaderBinding->stages;
+				}
+			}
 			layoutBinding.descriptorCount = (param->mDescriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
 				? std::max(param->mCount, 1u)
 				: param->mCount;
@@ -53,6 +109,7 @@ namespace lzvk::wrapper {
 				flags |= VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
 				flags |= VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
 				flags |= VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+				updateAfterBind = true;
 			}
 
 			bindingFlags.push_back(flags);
@@ -68,7 +125,9 @@ namespace lzvk::wrapper {
 		createInfo.pNext = &bindingFlagsInfo;
 		createInfo.bindingCount = static_cast<uint32_t>(layoutBindings.size());
 		createInfo.pBindings = layoutBindings.data();
-		createInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+
+		// Dynamic buffers are not allowed in update after bind layouts
+		createInfo.flags = updateAfterBind ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT : 0;
 
 
 		if (vkCreateDescriptorSetLayout(mDevice->getDevice(), &createInfo, nullptr, &mLayout) != VK_SUCCESS) {
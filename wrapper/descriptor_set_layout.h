@@ -3,6 +3,7 @@
 #include "../common.h"
 #include "device.h"
 #include "description.h"
+#include "shader_reflection.h"
 
 namespace lzvk::wrapper {
 
@@ -17,8 +18,16 @@ namespace lzvk::wrapper {
 
 		void build(const std::vector<UniformParameter::Ptr>& params);
 
+		// Types and stages come from the shaders using the set, a parameter that disagrees with
+		// them or a binding the shaders use without a parameter throws instead of failing on the GPU
+		void build(const std::vector<UniformParameter::Ptr>& params, const ShaderReflection& reflection, uint32_t set);
+
 		[[nodiscard]] const VkDescriptorSetLayout& getLayout() const { return mLayout; }
 
+	private:
+
+		static bool isCompatible(VkDescriptorType layoutType, VkDescriptorType shaderType);
+
 	private:
 
 		Device::Ptr mDevice{ nullptr };
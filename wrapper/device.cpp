@@ -1,4 +1,5 @@
 #include "device.h"
+#include <cstring>
 
 namespace lzvk::wrapper {
 
@@ -13,6 +14,9 @@ namespace lzvk::wrapper {
 
 	Device::~Device() {
 
+		mUploadManager.reset();
+		mPipelineCache.reset();
+		mAllocator.reset();
 		vkDestroyDevice(mDevice, nullptr);
 		mSurface.reset();
 		mInstance.reset();
@@ -150,10 +154,12 @@ namespace lzvk::wrapper {
 			std::cout << "Selected depth resolve mode: " << resolveModeToString(mDepthResolveMode) << std::endl;
 		}
 
+		// Integrated and software devices (e.g. lavapipe) are accepted, rateDevice still prefers discrete GPUs
 		bool supported =
-			deviceProp.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
 			features2.features.geometryShader &&
 			features2.features.samplerAnisotropy &&
+			features2.features.fragmentStoresAndAtomics &&
+			features13.synchronization2 &&
 			bufferAddressFeatureCheck.bufferDeviceAddress &&
 			indexingFeaturesCheck.runtimeDescriptorArray &&
 			indexingFeaturesCheck.shaderSampledImageArrayNonUniformIndexing &&
@@ -162,12 +168,88 @@ namespace lzvk::wrapper {
 			indexingFeaturesCheck.descriptorBindingSampledImageUpdateAfterBind;
 			
 		if (!supported) {
-			std::cerr << "Device is missing required features for descriptor indexing or buffer device address.\n";
+			std::cerr << "Device is missing required features for descriptor indexing, buffer device address, synchronization2 or fragment stores.\n";
 		}
 
 		return supported;
 	}
 
+	bool Device::checkMeshShaderSupport(VkPhysicalDevice device) {
+
+		// 1 Extension
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		bool hasExtension = false;
+		for (const auto& ext : availableExtensions) {
+			if (strcmp(ext.extensionName, VK_EXT_MESH_SHADER_EXTENSION_NAME) == 0) {
+				hasExtension = true;
+				break;
+			}
+		}
+
+		if (!hasExtension) {
+			return false;
+		}
+
+		// 2 Task and mesh stage features
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshFeatures{};
+		meshFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+		VkPhysicalDeviceFeatures2 features2{};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &meshFeatures;
+		vkGetPhysicalDeviceFeatures2(device, &features2);
+
+		return meshFeatures.taskShader && meshFeatures.meshShader;
+	}
+
+	bool Device::checkMemoryBudgetSupport(VkPhysicalDevice device) {
+
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+		for (const auto& ext : availableExtensions) {
+			if (strcmp(ext.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0) {
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool Device::getDeviceLocalMemoryBudget(VkDeviceSize& budget, VkDeviceSize& usage) const {
+
+		budget = 0;
+		usage = 0;
+
+		if (!mMemoryBudgetSupported) {
+			return false;
+		}
+
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProps{};
+		budgetProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+		VkPhysicalDeviceMemoryProperties2 memoryProps2{};
+		memoryProps2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		memoryProps2.pNext = &budgetProps;
+		vkGetPhysicalDeviceMemoryProperties2(mPhysicalDevice, &memoryProps2);
+
+		for (uint32_t i = 0; i < memoryProps2.memoryProperties.memoryHeapCount; ++i) {
+
+			if (memoryProps2.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+				budget += budgetProps.heapBudget[i];
+				usage += budgetProps.heapUsage[i];
+			}
+		}
+
+		return true;
+	}
+
 	void Device::initQueueFamilies(VkPhysicalDevice device) {
 
 		uint32_t queueFamilyCount = 0;
@@ -208,12 +290,29 @@ namespace lzvk::wrapper {
 
 			++i;
 		}
+
+		// 4 Find a transfer only queue for uploads, fall back to the graphic queue. The uploads copy
+		// images in row bands, so the family must allow copies at any texel granularity
+		mTransferQueueFamily = mGraphicQueueFamily;
+
+		for (uint32_t family = 0; family < queueFamilyCount; ++family) {
+
+			VkQueueFlags flags = queueFamilies[family].queueFlags;
+			VkExtent3D granularity = queueFamilies[family].minImageTransferGranularity;
+			bool anyGranularity = granularity.width == 1 && granularity.height == 1 && granularity.depth == 1;
+
+			if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && anyGranularity) {
+
+				mTransferQueueFamily = family;
+				break;
+			}
+		}
 	}
 
 	void Device::createLogicalDevice() {
 
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-		std::set<uint32_t> queueFamilies = { mGraphicQueueFamily.value(), mPresentQueueFamily.value(), mComputeQueueFamily.value() };
+		std::set<uint32_t> queueFamilies = { mGraphicQueueFamily.value(), mPresentQueueFamily.value(), mComputeQueueFamily.value(), mTransferQueueFamily.value() };
 		float queuePriority = 1.0;
 
 		// 1 Fill in queue family create info
@@ -232,6 +331,7 @@ namespace lzvk::wrapper {
 		VkPhysicalDeviceVulkan13Features features13{};
 		features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
 		features13.dynamicRendering = VK_TRUE; 
+		features13.synchronization2 = VK_TRUE;
 		features13.pNext = nullptr;
 
 		// 2.2 Descriptor indexing features
@@ -250,27 +350,63 @@ namespace lzvk::wrapper {
 		bufferDeviceAddressFeatures.bufferDeviceAddress = VK_TRUE;
 		bufferDeviceAddressFeatures.pNext = &indexingFeatures;
 
-		// 2.4 Vulkan 1.1 features
+		// 2.4 Timeline semaphores for upload completion
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineSemaphoreFeatures{};
+		timelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		timelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+		timelineSemaphoreFeatures.pNext = &bufferDeviceAddressFeatures;
+
+		// 2.5 Vulkan 1.1 features
 		VkPhysicalDeviceVulkan11Features features11{};
 		features11.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES;
 		features11.shaderDrawParameters = VK_TRUE;
-		features11.pNext = &bufferDeviceAddressFeatures;
+		features11.pNext = &timelineSemaphoreFeatures;
 
-		// 2.5 Base features2
+		// 2.6 Optional mesh shader features
+		mMeshShaderSupported = checkMeshShaderSupport(mPhysicalDevice);
+
+		std::vector<const char*> enabledExtensions = deviceRequiredExtensions;
+
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+		meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+		meshShaderFeatures.taskShader = VK_TRUE;
+		meshShaderFeatures.meshShader = VK_TRUE;
+		meshShaderFeatures.pNext = &features11;
+
+		if (mMeshShaderSupported) {
+			enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+		}
+
+		// 2.7 Optional block compressed textures, baked textures fall back to their sources without them
+		VkPhysicalDeviceFeatures supportedFeatures{};
+		vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supportedFeatures);
+		mTextureCompressionBCSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
+
+		// 2.8 Optional memory budget queries, texture streaming sizes its budget from them
+		mMemoryBudgetSupported = checkMemoryBudgetSupport(mPhysicalDevice);
+
+		if (mMemoryBudgetSupported) {
+			enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		}
+
+		// 2.9 Base features2
 		VkPhysicalDeviceFeatures2 deviceFeatures{};
 		deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
 		deviceFeatures.features.shaderInt64 = VK_TRUE;
 		deviceFeatures.features.samplerAnisotropy = VK_TRUE;
 		deviceFeatures.features.multiDrawIndirect = VK_TRUE;
-		deviceFeatures.pNext = &features11;
+		deviceFeatures.features.geometryShader = VK_TRUE;
+		deviceFeatures.features.fragmentStoresAndAtomics = VK_TRUE; // mip streaming feedback written from the fragment shader
+		deviceFeatures.features.textureCompressionBC = mTextureCompressionBCSupported ? VK_TRUE : VK_FALSE;
+		deviceFeatures.pNext = mMeshShaderSupported ? static_cast<void*>(&meshShaderFeatures) : static_cast<void*>(&features11);
 
 		// deviceCreateInfo
 		VkDeviceCreateInfo deviceCreateInfo{};
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 		deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceRequiredExtensions.size());
-		deviceCreateInfo.ppEnabledExtensionNames = deviceRequiredExtensions.data();
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = enabledExtensions.data();
 		deviceCreateInfo.pEnabledFeatures = nullptr;
 		deviceCreateInfo.pNext = &deviceFeatures;
 
@@ -296,11 +432,32 @@ namespace lzvk::wrapper {
 			throw std::runtime_error("Error: failed to load vkGetBufferDeviceAddress");
 		}
 
+		if (mMeshShaderSupported) {
+
+			fpCmdDrawMeshTasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(mDevice, "vkCmdDrawMeshTasksEXT"));
+			mMeshShaderSupported = fpCmdDrawMeshTasks != nullptr;
+		}
+
+		std::cout << "Mesh shader support: " << (mMeshShaderSupported ? "yes" : "no") << std::endl;
+		std::cout << "BC texture support: " << (mTextureCompressionBCSupported ? "yes" : "no") << std::endl;
+
 
 		// 5 Create queue
 		vkGetDeviceQueue(mDevice, mGraphicQueueFamily.value(), 0, &mGraphicQueue);
 		vkGetDeviceQueue(mDevice, mPresentQueueFamily.value(), 0, &mPresentQueue);
 		vkGetDeviceQueue(mDevice, mComputeQueueFamily.value(), 0, &mComputeQueue);
+		vkGetDeviceQueue(mDevice, mTransferQueueFamily.value(), 0, &mTransferQueue);
+
+		// 6 Buffers and images sub-allocate from shared memory blocks
+		mAllocator = MemoryAllocator::create(mDevice, mPhysicalDevice);
+
+		// 7 Uploads are batched and submitted on the transfer queue
+		mUploadManager = UploadManager::create(mDevice, mAllocator, mTransferQueueFamily.value(), mTransferQueue, mGraphicQueueFamily.value(), mGraphicQueue);
+
+		std::cout << "Transfer queue family: " << mTransferQueueFamily.value() << (mUploadManager->isOwnershipTransferEnabled() ? " (dedicated)" : " (shared with graphics)") << std::endl;
+
+		// 8 Pipelines compiled by earlier runs on this GPU and driver are reused
+		mPipelineCache = PipelineCache::create(mDevice, mPhysicalDevice, "pipeline_cache.bin");
 	}
 
 	PFN_vkGetBufferDeviceAddress Device::getBufferDeviceAddressFunction() const {
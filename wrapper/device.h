@@ -4,6 +4,9 @@
 #include "instance.h"
 #include "Surface.h"
 #include "vulkan_config.h"
+#include "memory_allocator.h"
+#include "upload_manager.h"
+#include "pipeline_cache.h"
 
 
 namespace lzvk::wrapper {
@@ -32,6 +35,8 @@ namespace lzvk::wrapper {
 		void createLogicalDevice();
 		VkSampleCountFlagBits getMaxUsableSampleCount();
 		PFN_vkGetBufferDeviceAddress getBufferDeviceAddressFunction() const;
+		bool checkMeshShaderSupport(VkPhysicalDevice device);
+		bool checkMemoryBudgetSupport(VkPhysicalDevice device);
 
 		const char* resolveModeToString(VkResolveModeFlagBits mode) {
 			switch (mode) {
@@ -50,9 +55,27 @@ namespace lzvk::wrapper {
 		[[nodiscard]] auto getGraphicQueueFamily() const { return mGraphicQueueFamily; }
 		[[nodiscard]] auto getPresentQueueFamily() const { return mPresentQueueFamily; }
 		[[nodiscard]] auto getComputeQueueFamily() const { return mComputeQueueFamily; }
+		[[nodiscard]] auto getTransferQueueFamily() const { return mTransferQueueFamily; }
 		[[nodiscard]] auto getGraphicQueue() const { return mGraphicQueue;}
 		[[nodiscard]] auto getPresentQueue() const { return mPresentQueue; }
 		[[nodiscard]] auto getComputeQueue() const { return mComputeQueue; }
+		[[nodiscard]] auto getTransferQueue() const { return mTransferQueue; }
+		[[nodiscard]] auto getAllocator() const { return mAllocator; }
+		[[nodiscard]] auto getUploadManager() const { return mUploadManager; }
+		[[nodiscard]] auto getPipelineCache() const { return mPipelineCache; }
+
+		// Mesh shading is optional, callers fall back to the vertex path when unsupported
+		[[nodiscard]] auto isMeshShaderSupported() const { return mMeshShaderSupported; }
+		[[nodiscard]] auto getDrawMeshTasksFunction() const { return fpCmdDrawMeshTasks; }
+		[[nodiscard]] VkShaderStageFlags getGeometryShaderStages() const {
+			return mMeshShaderSupported ? (VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT) : VK_SHADER_STAGE_VERTEX_BIT;
+		}
+
+		[[nodiscard]] auto isTextureCompressionBCSupported() const { return mTextureCompressionBCSupported; }
+
+		// Budget and usage summed over the device local heaps, false without VK_EXT_memory_budget
+		[[nodiscard]] auto isMemoryBudgetSupported() const { return mMemoryBudgetSupported; }
+		bool getDeviceLocalMemoryBudget(VkDeviceSize& budget, VkDeviceSize& usage) const;
 
 
 	private:
@@ -65,16 +88,27 @@ namespace lzvk::wrapper {
 		std::optional<uint32_t> mGraphicQueueFamily;
 		std::optional<uint32_t> mPresentQueueFamily;
 		std::optional<uint32_t> mComputeQueueFamily;
+		std::optional<uint32_t> mTransferQueueFamily;
 
 		VkQueue mGraphicQueue{ VK_NULL_HANDLE };
 		VkQueue mPresentQueue{ VK_NULL_HANDLE };
 		VkQueue mComputeQueue{ VK_NULL_HANDLE };
+		VkQueue mTransferQueue{ VK_NULL_HANDLE };
+
+		MemoryAllocator::Ptr mAllocator{ nullptr };
+		UploadManager::Ptr mUploadManager{ nullptr };
+		PipelineCache::Ptr mPipelineCache{ nullptr };
 
 		VkSampleCountFlagBits mSampleCounts{ VK_SAMPLE_COUNT_1_BIT };
 		VkResolveModeFlagBits mDepthResolveMode{ VK_RESOLVE_MODE_NONE };
 
 		PFN_vkGetBufferDeviceAddress fpGetBufferDeviceAddress = nullptr;
 
+		bool mMeshShaderSupported{ false };
+		bool mTextureCompressionBCSupported{ false };
+		bool mMemoryBudgetSupported{ false };
+		PFN_vkCmdDrawMeshTasksEXT fpCmdDrawMeshTasks = nullptr;
+
 	};
 
 }
\ No newline at end of file
@@ -4,6 +4,15 @@
 
 namespace lzvk::wrapper {
 
+	static const char* getMemoryTag(VkImageUsageFlags usage) {
+
+		if (usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) return "depth target";
+		if (usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) return "render target";
+		if (usage & VK_IMAGE_USAGE_STORAGE_BIT) return "storage image";
+
+		return "texture";
+	}
+
 	Image::Ptr Image::createDepthImage(const Device::Ptr& device, const int& width, const int& height, VkSampleCountFlagBits sample) {
 
 		std::vector<VkFormat> formats = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT,VK_FORMAT_D24_UNORM_S8_UINT, };
@@ -30,13 +39,17 @@ namespace lzvk::wrapper {
 	Image::Image(const Device::Ptr& device, const int& width, const int& height, const VkFormat& format,
 		const VkImageType& imageType, const VkImageTiling& tiling, const VkImageUsageFlags& usage,
 		const VkSampleCountFlagBits& sample, const VkMemoryPropertyFlags& properties, const VkImageAspectFlags& aspectFlags,
-		const VkImageCreateFlags& imageCreateFlags, const uint32_t& arrayLayers, const VkImageViewType& viewType) {
+		const VkImageCreateFlags& imageCreateFlags, const uint32_t& arrayLayers, const VkImageViewType& viewType, const uint32_t& mipLevels) {
 
 		mDevice = device;
 		mLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		mWidth = width;
 		mHeight = height;
 		mFormat = format;
+		mAspectFlags = aspectFlags;
+		mArrayLayers = arrayLayers;
+		mMipLevels = mipLevels;
+		mSubresourceStates.assign(mArrayLayers * mMipLevels, ImageSubresourceState{});
 
 		// 1 Image create info
 		VkImageCreateInfo imageCreateInfo{};
@@ -49,7 +62,7 @@ namespace lzvk::wrapper {
 		imageCreateInfo.tiling = tiling;
 		imageCreateInfo.usage = usage;
 		imageCreateInfo.samples = sample;
-		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.mipLevels = mipLevels;
 		imageCreateInfo.arrayLayers = arrayLayers;
 		imageCreateInfo.flags = imageCreateFlags;
 		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -61,33 +74,75 @@ namespace lzvk::wrapper {
 
 		}
 
-		// 2 Allocate memory
-		VkMemoryRequirements memReq{};
-		vkGetImageMemoryRequirements(mDevice->getDevice(), mImage, &memReq);
+		// 2 Sub-allocate memory, render targets get a dedicated allocation
+		bool renderTarget = (usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT)) != 0;
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memReq.size;
+		mAllocation = mDevice->getAllocator()->allocateForImage(mImage, properties, getMemoryTag(usage), renderTarget, tiling == VK_IMAGE_TILING_LINEAR);
+		mOwnsMemory = true;
+
+		// 3 Image view
+		createImageView(aspectFlags, arrayLayers, viewType);
+	}
+
+	Image::Image(const Device::Ptr& device, const int& width, const int& height, const VkFormat& format,
+				 const VkImageUsageFlags& usage, const VkImageAspectFlags& aspectFlags) {
 
-		allocInfo.memoryTypeIndex = findMemoryType(memReq.memoryTypeBits, properties);
+		mDevice = device;
+		mWidth = width;
+		mHeight = height;
+		mFormat = format;
+		mAspectFlags = aspectFlags;
+		mSubresourceStates.assign(1, ImageSubresourceState{});
+
+		VkImageCreateInfo imageCreateInfo{};
+		imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageCreateInfo.extent.width = width;
+		imageCreateInfo.extent.height = height;
+		imageCreateInfo.extent.depth = 1;
+		imageCreateInfo.format = format;
+		imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageCreateInfo.usage = usage;
+		imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageCreateInfo.mipLevels = 1;
+		imageCreateInfo.arrayLayers = 1;
+		imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(mDevice->getDevice(), &imageCreateInfo, nullptr, &mImage) != VK_SUCCESS) {
+
+			throw std::runtime_error("Error: failed to create transient image");
+		}
+	}
+
+	VkMemoryRequirements Image::getMemoryRequirements() const {
+
+		VkMemoryRequirements requirements{};
+		vkGetImageMemoryRequirements(mDevice->getDevice(), mImage, &requirements);
+
+		return requirements;
+	}
 
-		if (vkAllocateMemory(mDevice->getDevice(), &allocInfo, nullptr, &mImageMemory) != VK_SUCCESS) {
+	void Image::bindMemory(VkDeviceMemory memory, VkDeviceSize offset) {
 
-			throw std::runtime_error("Error: failed to allocate memory");
+		if (vkBindImageMemory(mDevice->getDevice(), mImage, memory, offset) != VK_SUCCESS) {
 
+			throw std::runtime_error("Error: failed to bind transient image memory");
 		}
 
-		vkBindImageMemory(mDevice->getDevice(), mImage, mImageMemory, 0);
+		createImageView(mAspectFlags, 1, VK_IMAGE_VIEW_TYPE_2D);
+	}
+
+	void Image::createImageView(VkImageAspectFlags aspectFlags, uint32_t arrayLayers, VkImageViewType viewType) {
 
-		// 3 Image view create info
 		VkImageViewCreateInfo imageViewCreateInfo{};
 		imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
 		imageViewCreateInfo.viewType = viewType;
-		imageViewCreateInfo.format = format;
+		imageViewCreateInfo.format = mFormat;
 		imageViewCreateInfo.image = mImage;
 		imageViewCreateInfo.subresourceRange.aspectMask = aspectFlags;
 		imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
-		imageViewCreateInfo.subresourceRange.levelCount = 1;
+		imageViewCreateInfo.subresourceRange.levelCount = mMipLevels;
 		imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
 		imageViewCreateInfo.subresourceRange.layerCount = arrayLayers;
 
@@ -104,12 +159,18 @@ namespace lzvk::wrapper {
 	}
 
 
-	Image::Image(const Device::Ptr& device, VkImage image, VkImageView imageView, VkFormat format) {
+	Image::Image(const Device::Ptr& device, VkImage image, VkImageView imageView, VkFormat format,
+				 uint32_t arrayLayers, uint32_t mipLevels, VkImageLayout layout) {
 
 		mDevice = device;
 		mImage = image;
 		mImageView = imageView;
 		mFormat = format;
+		mArrayLayers = arrayLayers;
+		mMipLevels = mipLevels;
+		mSubresourceStates.assign(mArrayLayers * mMipLevels, ImageSubresourceState{});
+
+		setImageLayout(layout);
 	}
 
 
@@ -120,30 +181,15 @@ namespace lzvk::wrapper {
 			vkDestroyImageView(mDevice->getDevice(), mImageView, nullptr);
 		}
 
-		if (mImageMemory != VK_NULL_HANDLE) {
-
-			vkFreeMemory(mDevice->getDevice(), mImageMemory, nullptr);
-		}
-
 		if (mImage != VK_NULL_HANDLE) {
 
 			vkDestroyImage(mDevice->getDevice(), mImage, nullptr);
 		}
-	}
-
-	uint32_t Image::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-
-		VkPhysicalDeviceMemoryProperties memProps;
-		vkGetPhysicalDeviceMemoryProperties(mDevice->getPhysicalDevice(), &memProps);
 
-		for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i) {
+		if (mOwnsMemory) {
 
-			if ((typeFilter & (1 << i)) && ((memProps.memoryTypes[i].propertyFlags & properties) == properties)) {
-				return i;
-			}
+			mDevice->getAllocator()->free(mAllocation);
 		}
-
-		throw std::runtime_error("Error: cannot find the property memory type!");
 	}
 
 	VkFormat Image::findDepthFormat(const Device::Ptr& device) {
@@ -177,6 +223,59 @@ namespace lzvk::wrapper {
 
 	}
 
+	void Image::setImageLayout(VkImageLayout newLayout) {
+
+		mLayout = newLayout;
+
+		for (auto& state : mSubresourceStates) {
+
+			state = { newLayout, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE };
+		}
+	}
+
+	const ImageSubresourceState& Image::getSubresourceState(uint32_t mipLevel, uint32_t arrayLayer) const {
+
+		return mSubresourceStates[mipLevel * mArrayLayers + arrayLayer];
+	}
+
+	void Image::setSubresourceState(uint32_t mipLevel, uint32_t arrayLayer, const ImageSubresourceState& state) {
+
+		mSubresourceStates[mipLevel * mArrayLayers + arrayLayer] = state;
+
+		// getLayout keeps describing the first subresource, which is what the single level views sample
+		if (mipLevel == 0 && arrayLayer == 0) {
+			mLayout = state.layout;
+		}
+	}
+
+	ImageSubresourceState Image::getAccessState(ImageAccess access) {
+
+		switch (access) {
+		case ImageAccess::ColorAttachment:
+			return { VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+					 VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+					 VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT };
+		case ImageAccess::DepthAttachment:
+			return { VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+					 VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+					 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+		case ImageAccess::SampledFragment:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+		case ImageAccess::SampledCompute:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+		case ImageAccess::SampledFragmentCompute:
+			return { VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					 VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					 VK_ACCESS_2_SHADER_SAMPLED_READ_BIT };
+		case ImageAccess::StorageCompute:
+			return { VK_IMAGE_LAYOUT_GENERAL,
+					 VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+					 VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT };
+		}
+
+		throw std::runtime_error("Error: unknown image access");
+	}
+
 	bool Image::hasStencilComponent(VkFormat format) {
 
 		return mFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || mFormat == VK_FORMAT_D24_UNORM_S8_UINT;
@@ -245,12 +344,15 @@ namespace lzvk::wrapper {
 			break;
 		}
 
-		// 3 Set new layout as current layout
-		if (subresrouceRange.baseArrayLayer == 0 && subresrouceRange.layerCount == 6) {
-			mLayout = newLayout; // Full cubemap transition
-		}
-		else if (subresrouceRange.baseArrayLayer == 0 && subresrouceRange.layerCount == 1) {
-			mLayout = newLayout; // Ordinary 2D texture
+		// 3 Set new layout as current layout, the submit below waits for the queue so no access is left pending
+		uint32_t layerEnd = subresrouceRange.layerCount == VK_REMAINING_ARRAY_LAYERS ? mArrayLayers : subresrouceRange.baseArrayLayer + subresrouceRange.layerCount;
+		uint32_t levelEnd = subresrouceRange.levelCount == VK_REMAINING_MIP_LEVELS ? mMipLevels : subresrouceRange.baseMipLevel + subresrouceRange.levelCount;
+
+		for (uint32_t level = subresrouceRange.baseMipLevel; level < std::min(levelEnd, mMipLevels); ++level) {
+			for (uint32_t layer = subresrouceRange.baseArrayLayer; layer < std::min(layerEnd, mArrayLayers); ++layer) {
+
+				setSubresourceState(level, layer, { newLayout, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE });
+			}
 		}
 
 		// 4 Command
@@ -6,6 +6,23 @@
 
 namespace lzvk::wrapper {
 
+	// How a pass is going to use an image, CommandBuffer::requireImage derives the barrier from it
+	enum class ImageAccess {
+		ColorAttachment,
+		DepthAttachment,
+		SampledFragment,
+		SampledCompute,
+		SampledFragmentCompute,
+		StorageCompute
+	};
+
+	// Layout and last synchronized use of one mip level of one array layer
+	struct ImageSubresourceState {
+		VkImageLayout			layout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkPipelineStageFlags2	stages{ VK_PIPELINE_STAGE_2_NONE };
+		VkAccessFlags2			access{ VK_ACCESS_2_NONE };
+	};
+
 	class Image {
 	public:
 
@@ -20,15 +37,24 @@ namespace lzvk::wrapper {
 		static Ptr create(const Device::Ptr& device, const int& width, const int& height, const VkFormat& format,
 						  const VkImageType& imageType, const VkImageTiling& tiling, const VkImageUsageFlags& usage,
 			              const VkSampleCountFlagBits& sample, const VkMemoryPropertyFlags& properties, const VkImageAspectFlags& aspectFlags,
-						  const VkImageCreateFlags& imageCreateFlags = 0, const uint32_t& arrayLayers = 1, const VkImageViewType& viewType = VK_IMAGE_VIEW_TYPE_2D) {
+						  const VkImageCreateFlags& imageCreateFlags = 0, const uint32_t& arrayLayers = 1, const VkImageViewType& viewType = VK_IMAGE_VIEW_TYPE_2D,
+						  const uint32_t& mipLevels = 1) {
 			
 			return std::make_shared<Image>(device, width, height, format, imageType, tiling, usage, sample, properties, aspectFlags,
-										   imageCreateFlags, arrayLayers, viewType);
+										   imageCreateFlags, arrayLayers, viewType, mipLevels);
 		}
 
-		static Ptr create(const Device::Ptr& device, VkImage image, VkImageView imageView, VkFormat format) {
+		static Ptr create(const Device::Ptr& device, VkImage image, VkImageView imageView, VkFormat format,
+						  uint32_t arrayLayers = 1, uint32_t mipLevels = 1, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED) {
 
-			return std::make_shared<Image>(device, image, imageView, format);
+			return std::make_shared<Image>(device, image, imageView, format, arrayLayers, mipLevels, layout);
+		}
+
+		// Image without memory, the owner of a shared heap binds it with bindMemory
+		static Ptr createTransient(const Device::Ptr& device, const int& width, const int& height, const VkFormat& format,
+								   const VkImageUsageFlags& usage, const VkImageAspectFlags& aspectFlags) {
+
+			return std::make_shared<Image>(device, width, height, format, usage, aspectFlags);
 		}
 
 
@@ -36,18 +62,30 @@ namespace lzvk::wrapper {
 		Image(const Device::Ptr& device, const int& width, const int& height, const VkFormat& format,
 			  const VkImageType& imageType, const VkImageTiling& tiling, const VkImageUsageFlags& usage,
 			  const VkSampleCountFlagBits& sample, const VkMemoryPropertyFlags& properties, const VkImageAspectFlags& aspectFlags,
-			  const VkImageCreateFlags& imageCreateFlags = 0, const uint32_t& arrayLayers = 1, const VkImageViewType& viewType = VK_IMAGE_VIEW_TYPE_2D);
+			  const VkImageCreateFlags& imageCreateFlags = 0, const uint32_t& arrayLayers = 1, const VkImageViewType& viewType = VK_IMAGE_VIEW_TYPE_2D,
+			  const uint32_t& mipLevels = 1);
 		
-		Image(const Device::Ptr& device, VkImage image, VkImageView imageView, VkFormat format);
+		Image(const Device::Ptr& device, VkImage image, VkImageView imageView, VkFormat format,
+			  uint32_t arrayLayers = 1, uint32_t mipLevels = 1, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+		Image(const Device::Ptr& device, const int& width, const int& height, const VkFormat& format,
+			  const VkImageUsageFlags& usage, const VkImageAspectFlags& aspectFlags);
 
 		~Image();
 
 
 		void setImageLayout(VkImageLayout newLayout, VkPipelineStageFlags srcStageMask, VkPipelineStageFlags dstStageMask, VkImageSubresourceRange subresrouceRange,const CommandPool::Ptr& commandPool);
 		void fillImageData(size_t size, void* pData, const CommandPool::Ptr& commandPool, uint32_t arrayLayer);
+
+		[[nodiscard]] VkMemoryRequirements getMemoryRequirements() const;
+		void bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
 		
 		
-		void setImageLayout(VkImageLayout newLayout) { mLayout = newLayout; }
+		// The image was moved to newLayout outside of any tracked command buffer
+		void setImageLayout(VkImageLayout newLayout);
+
+		[[nodiscard]] const ImageSubresourceState& getSubresourceState(uint32_t mipLevel, uint32_t arrayLayer) const;
+		void setSubresourceState(uint32_t mipLevel, uint32_t arrayLayer, const ImageSubresourceState& state);
 
 		[[nodiscard]] auto getImage() const { return mImage; }
 		[[nodiscard]] auto getLayout() const { return mLayout; }
@@ -55,9 +93,13 @@ namespace lzvk::wrapper {
 		[[nodiscard]] auto getWidth() const { return mWidth; }
 		[[nodiscard]] auto getHeight() const { return mHeight; }
 		[[nodiscard]] auto getImageView() const { return mImageView; }
+		[[nodiscard]] auto getArrayLayers() const { return mArrayLayers; }
+		[[nodiscard]] auto getMipLevels() const { return mMipLevels; }
 
 	public:
 
+		static ImageSubresourceState getAccessState(ImageAccess access);
+
 		static VkFormat findDepthFormat(const Device::Ptr& device);
 		static VkFormat findSupportedFormat(const Device::Ptr& device, const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
 
@@ -65,20 +107,25 @@ namespace lzvk::wrapper {
 
 	private:
 
-		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-
-
+		void createImageView(VkImageAspectFlags aspectFlags, uint32_t arrayLayers, VkImageViewType viewType);
 
 	private:
 
 		Device::Ptr			mDevice{ nullptr };
 		VkImage				mImage{ VK_NULL_HANDLE };
-		VkDeviceMemory		mImageMemory{ VK_NULL_HANDLE };
+		MemoryAllocation	mAllocation{};
+		bool				mOwnsMemory{ false };
 		VkImageView			mImageView{ VK_NULL_HANDLE };
 		VkFormat			mFormat;
 		VkImageLayout		mLayout{ VK_IMAGE_LAYOUT_UNDEFINED };
+		VkImageAspectFlags	mAspectFlags{ VK_IMAGE_ASPECT_COLOR_BIT };
 
 		size_t				mWidth{ 0 };
 		size_t				mHeight{ 0 };
+
+		// 1 Tracked state, indexed by mipLevel * mArrayLayers + arrayLayer
+		uint32_t			mArrayLayers{ 1 };
+		uint32_t			mMipLevels{ 1 };
+		std::vector<ImageSubresourceState> mSubresourceStates{};
 	};
 }
\ No newline at end of file
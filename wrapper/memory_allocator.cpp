@@ -0,0 +1,672 @@
+#include "memory_allocator.h"
+
+namespace lzvk::wrapper {
+
+	static uint32_t lowestBit(uint64_t value) {
+
+		uint32_t bit = 0;
+		while ((value & 1) == 0) {
+			value >>= 1;
+			++bit;
+		}
+		return bit;
+	}
+
+	static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	//
+	// ========== TlsfBlock ==========
+	//
+
+	TlsfBlock::TlsfBlock(VkDeviceSize size) {
+
+		mSize = size;
+
+		for (uint32_t fl = 0; fl < FL_COUNT; ++fl) {
+			for (uint32_t sl = 0; sl < SL_COUNT; ++sl) {
+				mFreeHeads[fl][sl] = NONE;
+			}
+		}
+
+		uint32_t index = newRegion();
+		mRegions[index].offset = 0;
+		mRegions[index].size = size;
+		insertFree(index);
+	}
+
+	void TlsfBlock::mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl) {
+
+		fl = 0;
+		while ((size >> (fl + 1)) != 0) {
+			++fl;
+		}
+
+		// small sizes map linearly into the first row
+		if (fl < SL_BITS) {
+			fl = 0;
+			sl = static_cast<uint32_t>(size);
+		}
+		else {
+			sl = static_cast<uint32_t>(size >> (fl - SL_BITS)) - SL_COUNT;
+		}
+	}
+
+	uint32_t TlsfBlock::newRegion() {
+
+		if (!mUnusedRegions.empty()) {
+
+			uint32_t index = mUnusedRegions.back();
+			mUnusedRegions.pop_back();
+			mRegions[index] = Region{};
+			return index;
+		}
+
+		mRegions.push_back(Region{});
+		return static_cast<uint32_t>(mRegions.size() - 1);
+	}
+
+	void TlsfBlock::insertFree(uint32_t index) {
+
+		uint32_t fl, sl;
+		mapping(mRegions[index].size, fl, sl);
+
+		Region& region = mRegions[index];
+		region.free = true;
+		region.prevFree = NONE;
+		region.nextFree = mFreeHeads[fl][sl];
+
+		if (region.nextFree != NONE) {
+			mRegions[region.nextFree].prevFree = index;
+		}
+
+		mFreeHeads[fl][sl] = index;
+		mSlBitmap[fl] |= 1u << sl;
+		mFlBitmap |= uint64_t(1) << fl;
+	}
+
+	void TlsfBlock::removeFree(uint32_t index) {
+
+		uint32_t fl, sl;
+		mapping(mRegions[index].size, fl, sl);
+
+		Region& region = mRegions[index];
+
+		if (region.prevFree != NONE) {
+			mRegions[region.prevFree].nextFree = region.nextFree;
+		}
+		if (region.nextFree != NONE) {
+			mRegions[region.nextFree].prevFree = region.prevFree;
+		}
+
+		if (mFreeHeads[fl][sl] == index) {
+
+			mFreeHeads[fl][sl] = region.nextFree;
+
+			if (mFreeHeads[fl][sl] == NONE) {
+
+				mSlBitmap[fl] &= ~(1u << sl);
+				if (mSlBitmap[fl] == 0) {
+					mFlBitmap &= ~(uint64_t(1) << fl);
+				}
+			}
+		}
+
+		region.free = false;
+		region.prevFree = NONE;
+		region.nextFree = NONE;
+	}
+
+	uint32_t TlsfBlock::split(uint32_t index, VkDeviceSize size) {
+
+		// newRegion may grow the vector, take references afterwards
+		uint32_t rest = newRegion();
+
+		Region& region = mRegions[index];
+		Region& remainder = mRegions[rest];
+
+		remainder.offset = region.offset + size;
+		remainder.size = region.size - size;
+		remainder.prevPhysical = index;
+		remainder.nextPhysical = region.nextPhysical;
+
+		if (region.nextPhysical != NONE) {
+			mRegions[region.nextPhysical].prevPhysical = rest;
+		}
+
+		region.nextPhysical = rest;
+		region.size = size;
+
+		return rest;
+	}
+
+	void TlsfBlock::merge(uint32_t index, uint32_t next) {
+
+		Region& region = mRegions[index];
+		Region& absorbed = mRegions[next];
+
+		region.size += absorbed.size;
+		region.nextPhysical = absorbed.nextPhysical;
+
+		if (absorbed.nextPhysical != NONE) {
+			mRegions[absorbed.nextPhysical].prevPhysical = index;
+		}
+
+		absorbed = Region{};
+		mUnusedRegions.push_back(next);
+	}
+
+	bool TlsfBlock::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& regionIndex) {
+
+		alignment = std::max<VkDeviceSize>(alignment, 1);
+
+		// 1 round the request up to the next size class so any region found there fits
+		VkDeviceSize searchSize = size + alignment - 1;
+
+		uint32_t fl, sl;
+		mapping(searchSize, fl, sl);
+
+		if (fl >= SL_BITS) {
+			searchSize += (VkDeviceSize(1) << (fl - SL_BITS)) - 1;
+			mapping(searchSize, fl, sl);
+		}
+
+		if (fl >= FL_COUNT || searchSize > mSize) {
+			return false;
+		}
+
+		// 2 first non empty class at or above the request
+		uint32_t slMap = mSlBitmap[fl] & (~0u << sl);
+
+		if (slMap == 0) {
+
+			uint64_t flMap = fl + 1 < FL_COUNT ? mFlBitmap & (~uint64_t(0) << (fl + 1)) : 0;
+			if (flMap == 0) {
+				return false;
+			}
+
+			fl = lowestBit(flMap);
+			slMap = mSlBitmap[fl];
+		}
+
+		sl = lowestBit(slMap);
+		uint32_t index = mFreeHeads[fl][sl];
+		removeFree(index);
+
+		// 3 alignment padding in front stays free
+		VkDeviceSize padding = alignUp(mRegions[index].offset, alignment) - mRegions[index].offset;
+
+		if (padding > 0) {
+
+			uint32_t aligned = split(index, padding);
+			insertFree(index);
+			index = aligned;
+		}
+
+		// 4 return the tail
+		if (mRegions[index].size - size >= MIN_REGION_SIZE) {
+
+			uint32_t tail = split(index, size);
+			insertFree(tail);
+		}
+
+		mUsedBytes += mRegions[index].size;
+		++mAllocationCount;
+
+		offset = mRegions[index].offset;
+		regionIndex = index;
+
+		return true;
+	}
+
+	VkDeviceSize TlsfBlock::free(uint32_t regionIndex) {
+
+		uint32_t index = regionIndex;
+		VkDeviceSize size = mRegions[index].size;
+
+		mUsedBytes -= size;
+		--mAllocationCount;
+
+		// coalesce with free neighbours
+		uint32_t next = mRegions[index].nextPhysical;
+		if (next != NONE && mRegions[next].free) {
+
+			removeFree(next);
+			merge(index, next);
+		}
+
+		uint32_t prev = mRegions[index].prevPhysical;
+		if (prev != NONE && mRegions[prev].free) {
+
+			removeFree(prev);
+			merge(prev, index);
+			index = prev;
+		}
+
+		insertFree(index);
+
+		return size;
+	}
+
+	VkDeviceSize TlsfBlock::getLargestFreeRegion() const {
+
+		if (mFlBitmap == 0) {
+			return 0;
+		}
+
+		// the largest region sits in the highest non empty class
+		uint32_t fl = 63;
+		while ((mFlBitmap & (uint64_t(1) << fl)) == 0) {
+			--fl;
+		}
+
+		uint32_t sl = SL_COUNT - 1;
+		while ((mSlBitmap[fl] & (1u << sl)) == 0) {
+			--sl;
+		}
+
+		VkDeviceSize largest = 0;
+		for (uint32_t index = mFreeHeads[fl][sl]; index != NONE; index = mRegions[index].nextFree) {
+			largest = std::max(largest, mRegions[index].size);
+		}
+
+		return largest;
+	}
+
+	uint32_t TlsfBlock::getFreeRegionCount() const {
+
+		uint32_t count = 0;
+
+		for (uint32_t fl = 0; fl < FL_COUNT; ++fl) {
+			for (uint32_t sl = 0; sl < SL_COUNT; ++sl) {
+				for (uint32_t index = mFreeHeads[fl][sl]; index != NONE; index = mRegions[index].nextFree) {
+					++count;
+				}
+			}
+		}
+
+		return count;
+	}
+
+	//
+	// ========== MemoryAllocator ==========
+	//
+
+	MemoryAllocator::MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice) {
+
+		mDevice = device;
+
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &mMemoryProperties);
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		mBufferImageGranularity = properties.limits.bufferImageGranularity;
+	}
+
+	MemoryAllocator::~MemoryAllocator() {
+
+		uint32_t leaked = 0;
+
+		for (auto& pool : mPools) {
+			for (auto& block : pool.blocks) {
+
+				if (block.memory == VK_NULL_HANDLE) {
+					continue;
+				}
+
+				leaked += block.allocator->getAllocationCount();
+
+				if (block.mappedData != nullptr) {
+					vkUnmapMemory(mDevice, block.memory);
+				}
+				vkFreeMemory(mDevice, block.memory, nullptr);
+			}
+		}
+
+		leaked += mDedicatedCount;
+
+		if (leaked > 0) {
+			printf("[MemoryAllocator] %u allocations still alive at shutdown\n", leaked);
+		}
+	}
+
+	uint32_t MemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+
+		for (uint32_t i = 0; i < mMemoryProperties.memoryTypeCount; ++i) {
+
+			// Requirement 1: meet the type
+			// Requirement 2: meet the flag of type
+			if ((typeFilter & (1 << i)) && ((mMemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)) {
+
+				return i;
+			}
+		}
+
+		throw std::runtime_error("Error: cannot find the property memory type!");
+	}
+
+	uint32_t MemoryAllocator::getPoolIndex(uint32_t memoryTypeIndex, bool linear, bool deviceAddress) {
+
+		// without a granularity limit buffers and optimal images can share blocks
+		if (mBufferImageGranularity <= 1) {
+			linear = true;
+		}
+
+		for (uint32_t i = 0; i < mPools.size(); ++i) {
+
+			const auto& pool = mPools[i];
+			if (pool.memoryTypeIndex == memoryTypeIndex && pool.linear == linear && pool.deviceAddress == deviceAddress) {
+				return i;
+			}
+		}
+
+		// small heaps such as host visible device local memory get smaller blocks
+		const VkDeviceSize defaultBlockSize = 64ull * 1024 * 1024;
+		VkDeviceSize heapSize = mMemoryProperties.memoryHeaps[mMemoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+
+		Pool pool{};
+		pool.memoryTypeIndex = memoryTypeIndex;
+		pool.linear = linear;
+		pool.deviceAddress = deviceAddress;
+		pool.blockSize = heapSize <= 1024ull * 1024 * 1024 ? heapSize / 8 : defaultBlockSize;
+
+		mPools.push_back(std::move(pool));
+		return static_cast<uint32_t>(mPools.size() - 1);
+	}
+
+	uint32_t MemoryAllocator::getTagIndex(const char* tag) {
+
+		for (uint32_t i = 0; i < mTags.size(); ++i) {
+			if (mTags[i] == tag) {
+				return i;
+			}
+		}
+
+		mTags.push_back(tag);
+		mTagBytes.push_back(0);
+		return static_cast<uint32_t>(mTags.size() - 1);
+	}
+
+	VkDeviceMemory MemoryAllocator::allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, bool deviceAddress, void** mappedData,
+												   VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = size;
+		allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+		// pNext chain: allocate flags, then the resource a dedicated allocation belongs to
+		const void** next = &allocInfo.pNext;
+
+		VkMemoryAllocateFlagsInfo flagsInfo{};
+		flagsInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+		flagsInfo.flags = deviceAddress ? VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT : 0;
+
+		if (deviceAddress) {
+			*next = &flagsInfo;
+			next = &flagsInfo.pNext;
+		}
+
+		VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+		dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicatedInfo.buffer = dedicatedBuffer;
+		dedicatedInfo.image = dedicatedImage;
+
+		if (dedicatedBuffer != VK_NULL_HANDLE || dedicatedImage != VK_NULL_HANDLE) {
+			*next = &dedicatedInfo;
+		}
+
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to allocate memory");
+		}
+
+		// host visible memory stays mapped, sub-allocations share the mapping
+		*mappedData = nullptr;
+		if (mMemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+
+			if (vkMapMemory(mDevice, memory, 0, VK_WHOLE_SIZE, 0, mappedData) != VK_SUCCESS) {
+				throw std::runtime_error("Error: failed to map memory");
+			}
+		}
+
+		return memory;
+	}
+
+	MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, const char* tag,
+											   bool linear, bool deviceAddress, bool dedicated, VkBuffer buffer, VkImage image) {
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+
+		MemoryAllocation allocation{};
+		allocation.size = requirements.size;
+		allocation.tagIndex = getTagIndex(tag);
+		allocation.poolIndex = getPoolIndex(memoryTypeIndex, linear, deviceAddress);
+
+		Pool& pool = mPools[allocation.poolIndex];
+
+		// 1 dedicated memory for render targets and anything that would hog a block
+		if (dedicated || requirements.size > pool.blockSize / 2) {
+
+			allocation.memory = allocateMemory(requirements.size, memoryTypeIndex, deviceAddress, &allocation.mappedData, buffer, image);
+			allocation.dedicated = true;
+
+			++mDedicatedCount;
+			mDedicatedBytes += requirements.size;
+			mTagBytes[allocation.tagIndex] += requirements.size;
+
+			return allocation;
+		}
+
+		// 2 first block with a fitting free region
+		auto tryBlock = [&](uint32_t blockIndex) {
+
+			Block& block = pool.blocks[blockIndex];
+			if (block.memory == VK_NULL_HANDLE) {
+				return false;
+			}
+
+			if (!block.allocator->allocate(requirements.size, requirements.alignment, allocation.offset, allocation.regionIndex)) {
+				return false;
+			}
+
+			allocation.memory = block.memory;
+			allocation.blockIndex = blockIndex;
+			allocation.mappedData = block.mappedData ? static_cast<uint8_t*>(block.mappedData) + allocation.offset : nullptr;
+			return true;
+		};
+
+		for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+
+			if (tryBlock(i)) {
+				mTagBytes[allocation.tagIndex] += requirements.size;
+				return allocation;
+			}
+		}
+
+		// 3 new block, reusing a released slot so block indices stay stable
+		uint32_t blockIndex = static_cast<uint32_t>(pool.blocks.size());
+		for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+			if (pool.blocks[i].memory == VK_NULL_HANDLE) {
+				blockIndex = i;
+				break;
+			}
+		}
+
+		if (blockIndex == pool.blocks.size()) {
+			pool.blocks.emplace_back();
+		}
+
+		Block& block = pool.blocks[blockIndex];
+		block.memory = allocateMemory(pool.blockSize, memoryTypeIndex, deviceAddress, &block.mappedData);
+		block.allocator = std::make_unique<TlsfBlock>(pool.blockSize);
+
+		if (!tryBlock(blockIndex)) {
+			throw std::runtime_error("Error: allocation does not fit an empty memory block");
+		}
+
+		mTagBytes[allocation.tagIndex] += requirements.size;
+		return allocation;
+	}
+
+	MemoryAllocation MemoryAllocator::allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, const char* tag, bool supportDeviceAddress) {
+
+		VkMemoryDedicatedRequirements dedicatedReq{};
+		dedicatedReq.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 memReq{};
+		memReq.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		memReq.pNext = &dedicatedReq;
+
+		VkBufferMemoryRequirementsInfo2 reqInfo{};
+		reqInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+		reqInfo.buffer = buffer;
+
+		vkGetBufferMemoryRequirements2(mDevice, &reqInfo, &memReq);
+
+		bool dedicated = dedicatedReq.requiresDedicatedAllocation == VK_TRUE;
+		auto allocation = allocate(memReq.memoryRequirements, properties, tag, true, supportDeviceAddress, dedicated, buffer, VK_NULL_HANDLE);
+
+		if (vkBindBufferMemory(mDevice, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to bind buffer memory");
+		}
+
+		return allocation;
+	}
+
+	MemoryAllocation MemoryAllocator::allocateForRequirements(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, const char* tag) {
+
+		return allocate(requirements, properties, tag, false, false, true);
+	}
+
+	MemoryAllocation MemoryAllocator::allocateForImage(VkImage image, VkMemoryPropertyFlags properties, const char* tag, bool preferDedicated, bool linearTiling) {
+
+		VkMemoryDedicatedRequirements dedicatedReq{};
+		dedicatedReq.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+		VkMemoryRequirements2 memReq{};
+		memReq.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+		memReq.pNext = &dedicatedReq;
+
+		VkImageMemoryRequirementsInfo2 reqInfo{};
+		reqInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+		reqInfo.image = image;
+
+		vkGetImageMemoryRequirements2(mDevice, &reqInfo, &memReq);
+
+		bool dedicated = preferDedicated || dedicatedReq.prefersDedicatedAllocation == VK_TRUE || dedicatedReq.requiresDedicatedAllocation == VK_TRUE;
+		auto allocation = allocate(memReq.memoryRequirements, properties, tag, linearTiling, false, dedicated, VK_NULL_HANDLE, image);
+
+		if (vkBindImageMemory(mDevice, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to bind image memory");
+		}
+
+		return allocation;
+	}
+
+	void MemoryAllocator::free(MemoryAllocation& allocation) {
+
+		if (allocation.memory == VK_NULL_HANDLE) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		mTagBytes[allocation.tagIndex] -= allocation.size;
+
+		if (allocation.dedicated) {
+
+			if (allocation.mappedData != nullptr) {
+				vkUnmapMemory(mDevice, allocation.memory);
+			}
+			vkFreeMemory(mDevice, allocation.memory, nullptr);
+
+			--mDedicatedCount;
+			mDedicatedBytes -= allocation.size;
+			allocation = MemoryAllocation{};
+			return;
+		}
+
+		Pool& pool = mPools[allocation.poolIndex];
+		Block& block = pool.blocks[allocation.blockIndex];
+		block.allocator->free(allocation.regionIndex);
+
+		// keep one empty block per pool around to avoid allocation churn
+		if (block.allocator->isEmpty()) {
+
+			bool hasOtherEmpty = false;
+			for (uint32_t i = 0; i < pool.blocks.size() && !hasOtherEmpty; ++i) {
+
+				hasOtherEmpty = i != allocation.blockIndex && pool.blocks[i].memory != VK_NULL_HANDLE && pool.blocks[i].allocator->isEmpty();
+			}
+
+			if (hasOtherEmpty) {
+
+				if (block.mappedData != nullptr) {
+					vkUnmapMemory(mDevice, block.memory);
+				}
+				vkFreeMemory(mDevice, block.memory, nullptr);
+				block = Block{};
+			}
+		}
+
+		allocation = MemoryAllocation{};
+	}
+
+	MemoryStats MemoryAllocator::getStats() const {
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		MemoryStats stats{};
+		stats.dedicatedCount = mDedicatedCount;
+		stats.dedicatedBytes = mDedicatedBytes;
+		stats.allocationCount = mDedicatedCount;
+
+		VkDeviceSize freeBytes = 0;
+
+		for (const auto& pool : mPools) {
+			for (const auto& block : pool.blocks) {
+
+				if (block.memory == VK_NULL_HANDLE) {
+					continue;
+				}
+
+				++stats.blockCount;
+				stats.blockBytes += block.allocator->getSize();
+				stats.usedBytes += block.allocator->getUsedBytes();
+				stats.allocationCount += block.allocator->getAllocationCount();
+				stats.freeRegionCount += block.allocator->getFreeRegionCount();
+				stats.largestFreeRegion = std::max(stats.largestFreeRegion, block.allocator->getLargestFreeRegion());
+
+				freeBytes += block.allocator->getSize() - block.allocator->getUsedBytes();
+			}
+		}
+
+		stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(stats.largestFreeRegion) / static_cast<float>(freeBytes) : 0.0f;
+
+		for (size_t i = 0; i < mTags.size(); ++i) {
+			stats.bytesPerTag.emplace_back(mTags[i], mTagBytes[i]);
+		}
+
+		return stats;
+	}
+
+	void MemoryAllocator::printStats() const {
+
+		auto stats = getStats();
+		const double mb = 1.0 / (1024.0 * 1024.0);
+
+		printf("[MemoryAllocator] %u blocks (%.1f MB, %.1f MB used), %u dedicated (%.1f MB), %u allocations, fragmentation %.2f\n",
+			stats.blockCount, stats.blockBytes * mb, stats.usedBytes * mb,
+			stats.dedicatedCount, stats.dedicatedBytes * mb,
+			stats.allocationCount, stats.fragmentation);
+
+		for (const auto& [tag, bytes] : stats.bytesPerTag) {
+			printf("[MemoryAllocator]   %-16s %.2f MB\n", tag.c_str(), bytes * mb);
+		}
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "../common.h"
+#include <mutex>
+
+namespace lzvk::wrapper {
+
+	// Two level segregated fit allocator over one VkDeviceMemory block,
+	// allocation and free run in constant time and neighbours coalesce on free
+	class TlsfBlock {
+	public:
+
+		explicit TlsfBlock(VkDeviceSize size);
+
+		bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint32_t& regionIndex);
+		VkDeviceSize free(uint32_t regionIndex);
+
+		[[nodiscard]] auto getSize() const { return mSize; }
+		[[nodiscard]] auto getUsedBytes() const { return mUsedBytes; }
+		[[nodiscard]] auto getAllocationCount() const { return mAllocationCount; }
+		[[nodiscard]] bool isEmpty() const { return mAllocationCount == 0; }
+		[[nodiscard]] VkDeviceSize getLargestFreeRegion() const;
+		[[nodiscard]] uint32_t getFreeRegionCount() const;
+
+	private:
+
+		static constexpr uint32_t SL_BITS = 3;
+		static constexpr uint32_t SL_COUNT = 1u << SL_BITS;
+		static constexpr uint32_t FL_COUNT = 64;
+		static constexpr uint32_t NONE = ~0u;
+
+		// tails smaller than this stay with the allocation
+		static constexpr VkDeviceSize MIN_REGION_SIZE = 256;
+
+		struct Region {
+			VkDeviceSize offset = 0;
+			VkDeviceSize size = 0;
+			uint32_t prevPhysical = NONE;
+			uint32_t nextPhysical = NONE;
+			uint32_t prevFree = NONE;
+			uint32_t nextFree = NONE;
+			bool free = false;
+		};
+
+		static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+
+		uint32_t newRegion();
+		void insertFree(uint32_t index);
+		void removeFree(uint32_t index);
+		uint32_t split(uint32_t index, VkDeviceSize size);
+		void merge(uint32_t index, uint32_t next);
+
+	private:
+
+		VkDeviceSize mSize{ 0 };
+		VkDeviceSize mUsedBytes{ 0 };
+		uint32_t mAllocationCount{ 0 };
+
+		std::vector<Region> mRegions{};
+		std::vector<uint32_t> mUnusedRegions{};
+
+		uint64_t mFlBitmap{ 0 };
+		uint32_t mSlBitmap[FL_COUNT]{};
+		uint32_t mFreeHeads[FL_COUNT][SL_COUNT];
+	};
+
+	struct MemoryAllocation {
+		VkDeviceMemory memory{ VK_NULL_HANDLE };
+		VkDeviceSize offset{ 0 };
+		VkDeviceSize size{ 0 };
+		void* mappedData{ nullptr };
+
+		uint32_t poolIndex{ 0 };
+		uint32_t blockIndex{ 0 };
+		uint32_t regionIndex{ 0 };
+		uint32_t tagIndex{ 0 };
+		bool dedicated{ false };
+	};
+
+	struct MemoryStats {
+		uint32_t blockCount = 0;
+		uint32_t dedicatedCount = 0;
+		uint32_t allocationCount = 0;
+
+		VkDeviceSize blockBytes = 0;
+		VkDeviceSize dedicatedBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize largestFreeRegion = 0;
+		uint32_t freeRegionCount = 0;
+
+		// 0 when the free space of the blocks is one region, towards 1 the more it is scattered
+		float fragmentation = 0.0f;
+
+		std::vector<std::pair<std::string, VkDeviceSize>> bytesPerTag{};
+	};
+
+	// Sub-allocates buffers and images from large blocks per memory type, render
+	// targets and resources larger than half a block get their own allocation.
+	// Linear and optimal resources live in separate pools so bufferImageGranularity
+	// never has to be checked between neighbours.
+	class MemoryAllocator {
+	public:
+
+		using Ptr = std::shared_ptr<MemoryAllocator>;
+		static Ptr create(VkDevice device, VkPhysicalDevice physicalDevice) {
+
+			return std::make_shared<MemoryAllocator>(device, physicalDevice);
+		}
+
+		MemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice);
+		~MemoryAllocator();
+
+		// allocate and bind
+		MemoryAllocation allocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, const char* tag, bool supportDeviceAddress);
+		MemoryAllocation allocateForImage(VkImage image, VkMemoryPropertyFlags properties, const char* tag, bool preferDedicated, bool linearTiling);
+
+		// dedicated memory the caller binds itself, e.g. a heap shared by aliased images
+		MemoryAllocation allocateForRequirements(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, const char* tag);
+
+		void free(MemoryAllocation& allocation);
+
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+		[[nodiscard]] MemoryStats getStats() const;
+		void printStats() const;
+
+	private:
+
+		struct Block {
+			VkDeviceMemory memory{ VK_NULL_HANDLE };
+			void* mappedData{ nullptr };
+			std::unique_ptr<TlsfBlock> allocator{ nullptr };
+		};
+
+		struct Pool {
+			uint32_t memoryTypeIndex = 0;
+			bool linear = true;
+			bool deviceAddress = false;
+			VkDeviceSize blockSize = 0;
+			std::vector<Block> blocks{};
+		};
+
+		MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, const char* tag,
+								  bool linear, bool deviceAddress, bool dedicated,
+								  VkBuffer buffer = VK_NULL_HANDLE, VkImage image = VK_NULL_HANDLE);
+
+		// buffer or image, when set, is the only resource bound to the memory and goes into VkMemoryDedicatedAllocateInfo
+		VkDeviceMemory allocateMemory(VkDeviceSize size, uint32_t memoryTypeIndex, bool deviceAddress, void** mappedData,
+									  VkBuffer dedicatedBuffer = VK_NULL_HANDLE, VkImage dedicatedImage = VK_NULL_HANDLE);
+		uint32_t getPoolIndex(uint32_t memoryTypeIndex, bool linear, bool deviceAddress);
+		uint32_t getTagIndex(const char* tag);
+
+	private:
+
+		VkDevice mDevice{ VK_NULL_HANDLE };
+		VkPhysicalDeviceMemoryProperties mMemoryProperties{};
+		VkDeviceSize mBufferImageGranularity{ 1 };
+
+		std::vector<Pool> mPools{};
+		std::vector<std::string> mTags{};
+		std::vector<VkDeviceSize> mTagBytes{};
+
+		uint32_t mDedicatedCount{ 0 };
+		VkDeviceSize mDedicatedBytes{ 0 };
+
+		mutable std::mutex mMutex;
+	};
+}
@@ -95,13 +95,32 @@ namespace lzvk::wrapper {
 		mBlendState.attachmentCount = static_cast<uint32_t>(mBlendAttachmentStates.size());
 		mBlendState.pAttachments = mBlendAttachmentStates.data();
 
-		// 4 Create layout
+		// 4 Create layout, the push constant ranges have to cover what the shaders declare
+		for (const auto& shader : mShaders) {
+
+			const auto& pushConstant = shader->getReflection().pushConstant;
+			if (pushConstant.size == 0) {
+				continue;
+			}
+
+			bool covered = false;
+			for (uint32_t i = 0; i < mLayoutState.pushConstantRangeCount; ++i) {
+
+				const auto& range = mLayoutState.pPushConstantRanges[i];
+				covered |= (range.stageFlags & shader->getShaderStage()) && range.offset <= pushConstant.offset &&
+						   pushConstant.offset + pushConstant.size <= range.offset + range.size;
+			}
+
+			if (!covered) {
+				throw std::runtime_error("Error: pipeline layout doesn't cover the " + std::to_string(pushConstant.size) +
+										 " push constant bytes of a shader stage " + std::to_string(shader->getShaderStage()));
+			}
+		}
+
 		if (mLayout != VK_NULL_HANDLE) {
 			vkDestroyPipelineLayout(mDevice->getDevice(), mLayout, nullptr);
 		}
 
-
-
 		if (vkCreatePipelineLayout(mDevice->getDevice(), &mLayoutState, nullptr, &mLayout) != VK_SUCCESS) {
 			throw std::runtime_error("Error: failed to create pipeline layout");
 		}
@@ -148,7 +167,7 @@ namespace lzvk::wrapper {
 			vkDestroyPipeline(mDevice->getDevice(), mPipeline, nullptr);
 		}
 
-		if (vkCreateGraphicsPipelines(mDevice->getDevice(), VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &mPipeline) != VK_SUCCESS) {
+		if (vkCreateGraphicsPipelines(mDevice->getDevice(), mDevice->getPipelineCache()->getCache(), 1, &pipelineCreateInfo, nullptr, &mPipeline) != VK_SUCCESS) {
 			
 			throw std::runtime_error("Error:failed to create pipeline");
 
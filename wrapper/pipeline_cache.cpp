@@ -0,0 +1,142 @@
+#include "pipeline_cache.h"
+#include <cstdio>
+#include <cstring>
+
+namespace lzvk::wrapper {
+
+	PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path) {
+
+		mDevice = device;
+		mPath = path;
+
+		// 1 What a valid file has to match
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		mHeader.vendorID = properties.vendorID;
+		mHeader.deviceID = properties.deviceID;
+		mHeader.driverVersion = properties.driverVersion;
+		std::memcpy(mHeader.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+		// 2 Seed the cache with the file, a rejected file leaves it empty
+		std::vector<char> data = load();
+
+		VkPipelineCacheCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		createInfo.initialDataSize = data.size();
+		createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+		if (vkCreatePipelineCache(mDevice, &createInfo, nullptr, &mCache) != VK_SUCCESS) {
+
+			// the driver may still refuse data that passed our checks, start over without it
+			createInfo.initialDataSize = 0;
+			createInfo.pInitialData = nullptr;
+
+			if (vkCreatePipelineCache(mDevice, &createInfo, nullptr, &mCache) != VK_SUCCESS) {
+				throw std::runtime_error("Error: failed to create pipeline cache");
+			}
+
+			data.clear();
+		}
+
+		mLoadedBytes = data.size();
+		printf("[PipelineCache] %s %s (%zu bytes)\n", mPath.c_str(), isWarm() ? "loaded" : "empty, pipelines compile from scratch", mLoadedBytes);
+	}
+
+	PipelineCache::~PipelineCache() {
+
+		save();
+
+		if (mCache != VK_NULL_HANDLE) {
+			vkDestroyPipelineCache(mDevice, mCache, nullptr);
+		}
+	}
+
+	std::vector<char> PipelineCache::load() {
+
+		std::ifstream file(mPath, std::ios::binary | std::ios::ate);
+
+		if (!file) {
+			return {};
+		}
+
+		const size_t fileSize = static_cast<size_t>(file.tellg());
+
+		if (fileSize < sizeof(FileHeader)) {
+			printf("[PipelineCache] %s is truncated, ignored\n", mPath.c_str());
+			return {};
+		}
+
+		FileHeader header{};
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
+
+		// 1 Written by this code for this GPU and driver
+		bool sameDevice = header.magic == MAGIC && header.fileVersion == FILE_VERSION &&
+						  header.vendorID == mHeader.vendorID && header.deviceID == mHeader.deviceID &&
+						  header.driverVersion == mHeader.driverVersion &&
+						  std::memcmp(header.pipelineCacheUUID, mHeader.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+		if (!sameDevice) {
+			printf("[PipelineCache] %s was written for another device or driver, ignored\n", mPath.c_str());
+			return {};
+		}
+
+		// 2 Complete
+		if (header.dataSize != fileSize - sizeof(FileHeader)) {
+			printf("[PipelineCache] %s is truncated, ignored\n", mPath.c_str());
+			return {};
+		}
+
+		std::vector<char> data(static_cast<size_t>(header.dataSize));
+		file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+		if (!file) {
+			return {};
+		}
+
+		return data;
+	}
+
+	void PipelineCache::save() {
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		if (mCache == VK_NULL_HANDLE) {
+			return;
+		}
+
+		size_t dataSize = 0;
+		if (vkGetPipelineCacheData(mDevice, mCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+			return;
+		}
+
+		std::vector<char> data(dataSize);
+		if (vkGetPipelineCacheData(mDevice, mCache, &dataSize, data.data()) != VK_SUCCESS) {
+			return;
+		}
+
+		FileHeader header = mHeader;
+		header.dataSize = dataSize;
+
+		// write a temporary file and swap it in, a crash while saving never leaves a half written cache
+		std::string tempPath = mPath + ".tmp";
+		{
+			std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+
+			if (!file) {
+				printf("[PipelineCache] failed to write %s\n", tempPath.c_str());
+				return;
+			}
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+			file.write(data.data(), static_cast<std::streamsize>(dataSize));
+		}
+
+		std::remove(mPath.c_str());
+
+		if (std::rename(tempPath.c_str(), mPath.c_str()) != 0) {
+			printf("[PipelineCache] failed to replace %s\n", mPath.c_str());
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "../common.h"
+#include <mutex>
+
+namespace lzvk::wrapper {
+
+	// VkPipelineCache backed by a file. The file is only used when it was written for the same
+	// vendor, device, driver version and pipeline cache UUID, otherwise the cache starts empty.
+	// vkCreate*Pipelines may use the cache from several threads at once.
+	class PipelineCache {
+	public:
+
+		using Ptr = std::shared_ptr<PipelineCache>;
+		static Ptr create(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path) {
+			return std::make_shared<PipelineCache>(device, physicalDevice, path);
+		}
+
+		PipelineCache(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+		~PipelineCache();
+
+		// Writes the current cache contents, creation keeps going if the file can't be written
+		void save();
+
+		[[nodiscard]] auto getCache() const { return mCache; }
+
+		// true when the file matched this device and was handed to the driver
+		[[nodiscard]] auto isWarm() const { return mLoadedBytes > 0; }
+		[[nodiscard]] auto getLoadedBytes() const { return mLoadedBytes; }
+
+	private:
+
+		static constexpr uint32_t MAGIC = 0x43504c5a; // "ZLPC"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+		struct FileHeader {
+			uint32_t magic{ MAGIC };
+			uint32_t fileVersion{ FILE_VERSION };
+			uint32_t vendorID{ 0 };
+			uint32_t deviceID{ 0 };
+			uint32_t driverVersion{ 0 };
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE]{};
+			uint64_t dataSize{ 0 };
+		};
+
+		std::vector<char> load();
+
+	private:
+
+		VkDevice mDevice{ VK_NULL_HANDLE };
+		VkPipelineCache mCache{ VK_NULL_HANDLE };
+		std::string mPath{};
+		FileHeader mHeader{};
+		size_t mLoadedBytes{ 0 };
+		std::mutex mMutex;
+	};
+}
@@ -0,0 +1,55 @@
+#include "query_pool.h"
+
+namespace lzvk::wrapper {
+
+	QueryPool::QueryPool(const Device::Ptr& device, uint32_t queryCount) {
+
+		mDevice = device;
+		mQueryCount = queryCount;
+
+		VkPhysicalDeviceProperties properties{};
+		vkGetPhysicalDeviceProperties(mDevice->getPhysicalDevice(), &properties);
+		mTimestampPeriodMs = static_cast<double>(properties.limits.timestampPeriod) * 1e-6;
+		mTimestampSupported = properties.limits.timestampComputeAndGraphics == VK_TRUE;
+
+		VkQueryPoolCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		createInfo.queryCount = queryCount;
+
+		if (vkCreateQueryPool(mDevice->getDevice(), &createInfo, nullptr, &mQueryPool) != VK_SUCCESS) {
+
+			throw std::runtime_error("Error: failed to create query pool");
+		}
+	}
+
+	QueryPool::~QueryPool() {
+
+		if (mQueryPool != VK_NULL_HANDLE) {
+
+			vkDestroyQueryPool(mDevice->getDevice(), mQueryPool, nullptr);
+		}
+	}
+
+	bool QueryPool::getTimestampsMs(std::vector<double>& timestampsMs) const {
+
+		std::vector<uint64_t> ticks(mQueryCount, 0);
+
+		// Does not wait, returns false until every query of the last submission is available
+		VkResult result = vkGetQueryPoolResults(
+			mDevice->getDevice(), mQueryPool, 0, mQueryCount,
+			ticks.size() * sizeof(uint64_t), ticks.data(), sizeof(uint64_t),
+			VK_QUERY_RESULT_64_BIT);
+
+		if (result != VK_SUCCESS) {
+			return false;
+		}
+
+		timestampsMs.resize(mQueryCount);
+		for (uint32_t i = 0; i < mQueryCount; ++i) {
+			timestampsMs[i] = static_cast<double>(ticks[i] - ticks[0]) * mTimestampPeriodMs;
+		}
+
+		return true;
+	}
+}
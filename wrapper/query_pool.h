@@ -0,0 +1,31 @@
+#pragma once
+
+#include "../common.h"
+#include "device.h"
+
+namespace lzvk::wrapper {
+
+	// Timestamp queries, read back on the CPU once the frame that wrote them has finished
+	class QueryPool {
+	public:
+		using Ptr = std::shared_ptr<QueryPool>;
+		static Ptr create(const Device::Ptr& device, uint32_t queryCount) { return std::make_shared<QueryPool>(device, queryCount); }
+
+		QueryPool(const Device::Ptr& device, uint32_t queryCount);
+		~QueryPool();
+
+		bool getTimestampsMs(std::vector<double>& timestampsMs) const;
+
+		[[nodiscard]] auto getQueryPool() const { return mQueryPool; }
+		[[nodiscard]] auto getQueryCount() const { return mQueryCount; }
+		[[nodiscard]] auto isTimestampSupported() const { return mTimestampSupported; }
+
+	private:
+
+		VkQueryPool mQueryPool{ VK_NULL_HANDLE };
+		Device::Ptr mDevice{ nullptr };
+		uint32_t mQueryCount{ 0 };
+		double mTimestampPeriodMs{ 0.0 };
+		bool mTimestampSupported{ false };
+	};
+}
@@ -1,10 +1,9 @@
 #include "sampler.h"
+#include <cstring>
 
 namespace lzvk::wrapper {
 
-	Sampler::Sampler(const Device::Ptr& device) {
-		
-		mDevice = device;
+	VkSamplerCreateInfo Sampler::getDefaultCreateInfo() {
 
 		VkSamplerCreateInfo createInfo{};
 		createInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -32,13 +31,75 @@ namespace lzvk::wrapper {
 		createInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
 		createInfo.mipLodBias = 0.0f;
 		createInfo.minLod = 0.0f;
-		createInfo.maxLod = 0.0f;
+		createInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+		return createInfo;
+	}
+
+	Sampler::Key Sampler::makeKey(VkDevice device, const VkSamplerCreateInfo& createInfo) {
+
+		// floats are compared bit for bit, equal samplers are built from equal literals
+		auto bits = [](float value) {
+			uint32_t result = 0;
+			std::memcpy(&result, &value, sizeof(result));
+			return result;
+		};
+
+		uint64_t deviceBits = reinterpret_cast<uint64_t>(device);
+
+		return {
+			static_cast<uint32_t>(deviceBits), static_cast<uint32_t>(deviceBits >> 32),
+			createInfo.flags,
+			static_cast<uint32_t>(createInfo.magFilter), static_cast<uint32_t>(createInfo.minFilter),
+			static_cast<uint32_t>(createInfo.mipmapMode),
+			static_cast<uint32_t>(createInfo.addressModeU), static_cast<uint32_t>(createInfo.addressModeV), static_cast<uint32_t>(createInfo.addressModeW),
+			bits(createInfo.mipLodBias),
+			createInfo.anisotropyEnable, bits(createInfo.maxAnisotropy),
+			createInfo.compareEnable, static_cast<uint32_t>(createInfo.compareOp),
+			bits(createInfo.minLod), bits(createInfo.maxLod),
+			static_cast<uint32_t>(createInfo.borderColor),
+			createInfo.unnormalizedCoordinates
+		};
+	}
+
+	Sampler::Ptr Sampler::create(const Device::Ptr& device, const VkSamplerCreateInfo& createInfo) {
+
+		// extension structs are not part of the key, such samplers are never shared
+		if (createInfo.pNext != nullptr) {
+			++sRequestCount;
+			return std::make_shared<Sampler>(device, createInfo);
+		}
+
+		Key key = makeKey(device->getDevice(), createInfo);
+
+		std::lock_guard<std::mutex> lock(sMutex);
+		++sRequestCount;
+
+		auto it = sCache.find(key);
+		if (it != sCache.end()) {
+
+			if (auto sampler = it->second.lock()) {
+				return sampler;
+			}
+		}
+
+		auto sampler = std::make_shared<Sampler>(device, createInfo);
+		sCache[key] = sampler;
+
+		return sampler;
+	}
+
+	Sampler::Sampler(const Device::Ptr& device, const VkSamplerCreateInfo& createInfo) {
+		
+		mDevice = device;
 
 		if (vkCreateSampler(mDevice->getDevice(), &createInfo, nullptr, &mSampler) != VK_SUCCESS) {
 			
 			throw std::runtime_error("Error: failed to create sampler");
 
 		}
+
+		++sLiveCount;
 	}
 
 	Sampler::~Sampler() {
@@ -46,7 +107,7 @@ namespace lzvk::wrapper {
 		if (mSampler != VK_NULL_HANDLE) {
 
 			vkDestroySampler(mDevice->getDevice(), mSampler, nullptr);
-
+			--sLiveCount;
 		}
 	}
 }
\ No newline at end of file
@@ -2,21 +2,43 @@
 
 #include "../common.h"
 #include "device.h"
+#include <mutex>
+#include <atomic>
 
 namespace lzvk::wrapper {
 
+	// Samplers are immutable, so identical create infos on one device share a single VkSampler.
+	// The cache only holds weak references, a sampler is destroyed with its last user.
 	class Sampler {
 	public:
 		using Ptr = std::shared_ptr<Sampler>;
-		static Ptr create(const Device::Ptr& device) { return std::make_shared<Sampler>(device); }
+		static Ptr create(const Device::Ptr& device) { return create(device, getDefaultCreateInfo()); }
+		static Ptr create(const Device::Ptr& device, const VkSamplerCreateInfo& createInfo);
 
-		Sampler(const Device::Ptr& device);
+		// Linear filtering, repeat addressing and 16x anisotropy
+		static VkSamplerCreateInfo getDefaultCreateInfo();
+
+		Sampler(const Device::Ptr& device, const VkSamplerCreateInfo& createInfo);
 		~Sampler();
 
 		[[nodiscard]] auto getSampler() const { return mSampler; }
 
+		// Live VkSampler objects and the requests they served
+		[[nodiscard]] static uint32_t getLiveCount() { return sLiveCount; }
+		[[nodiscard]] static uint32_t getRequestCount() { return sRequestCount; }
+
+	private:
+
+		using Key = std::vector<uint32_t>;
+		static Key makeKey(VkDevice device, const VkSamplerCreateInfo& createInfo);
+
 	private:
 		Device::Ptr mDevice{ nullptr };
 		VkSampler mSampler{ VK_NULL_HANDLE };
+
+		inline static std::mutex sMutex;
+		inline static std::map<Key, std::weak_ptr<Sampler>> sCache{};
+		inline static std::atomic<uint32_t> sLiveCount{ 0 };
+		inline static std::atomic<uint32_t> sRequestCount{ 0 };
 	};
 }
\ No newline at end of file
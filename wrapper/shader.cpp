@@ -8,7 +8,7 @@ namespace lzvk::wrapper {
 
 		if (!file) {
 
-			throw std::runtime_error("Error: failed to open shader file");
+			throw std::runtime_error("Error: failed to open shader file " + fileName);
 
 		}
 
@@ -29,11 +29,28 @@ namespace lzvk::wrapper {
 		mShaderStage = shaderStage;
 		mEntryPoint = entryPoint;
 
-		std::vector<char> codeBuffer = readBinary(fileName);
+		// 1 Code and reflection from the mapped archive, or the loose file as a fallback
+		std::vector<char> codeBuffer{};
 		VkShaderModuleCreateInfo shaderCreateInfo{};
 		shaderCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		shaderCreateInfo.codeSize = codeBuffer.size();
-		shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(codeBuffer.data());
+
+		const ShaderArchive::Module* module = sArchive ? sArchive->find(fileName) : nullptr;
+
+		if (module) {
+
+			shaderCreateInfo.codeSize = module->codeSize;
+			shaderCreateInfo.pCode = module->code;
+			mReflection = module->reflection;
+		}
+		else {
+
+			codeBuffer = readBinary(fileName);
+			shaderCreateInfo.codeSize = codeBuffer.size();
+			shaderCreateInfo.pCode = reinterpret_cast<const uint32_t*>(codeBuffer.data());
+			mReflection = ShaderReflection::reflect(shaderCreateInfo.pCode, codeBuffer.size() / sizeof(uint32_t));
+		}
+
+		// 2 Module
 
 		if (vkCreateShaderModule(mDevice->getDevice(), &shaderCreateInfo, nullptr, &mShaderModule) != VK_SUCCESS) {
 
@@ -42,6 +59,34 @@ namespace lzvk::wrapper {
 	}
 
 
+	ShaderReflection Shader::reflect(const std::vector<std::string>& fileNames) {
+
+		ShaderReflection reflection{};
+
+		for (const auto& fileName : fileNames) {
+
+			const ShaderArchive::Module* module = sArchive ? sArchive->find(fileName) : nullptr;
+
+			ShaderReflection moduleReflection = module ? module->reflection : ShaderReflection{};
+
+			if (!module) {
+
+				std::vector<char> code = readBinary(fileName);
+				moduleReflection = ShaderReflection::reflect(reinterpret_cast<const uint32_t*>(code.data()), code.size() / sizeof(uint32_t));
+			}
+
+			// a module compiled from older GLSL shows up here, name it so the stale .spv is easy to find
+			try {
+				reflection.merge(moduleReflection);
+			}
+			catch (const std::runtime_error& e) {
+				throw std::runtime_error(std::string(e.what()) + " (in " + fileName + ")");
+			}
+		}
+
+		return reflection;
+	}
+
 	Shader::~Shader() {
 
 		if (mShaderModule != VK_NULL_HANDLE) {
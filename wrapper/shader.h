@@ -2,6 +2,7 @@
 
 #include "../common.h"
 #include "device.h"
+#include "shader_archive.h"
 
 namespace lzvk::wrapper {
 
@@ -20,6 +21,13 @@ namespace lzvk::wrapper {
 		[[nodiscard]] auto getShaderStage() const { return mShaderStage; }
 		[[nodiscard]] auto& getShaderEntryPoint()const { return mEntryPoint; }
 		[[nodiscard]] auto getShaderModule() const { return mShaderModule; }
+		[[nodiscard]] const auto& getReflection() const { return mReflection; }
+
+		// Modules are looked up in the archive first, by the same path as the loose file
+		static void setArchive(const ShaderArchive::Ptr& archive) { sArchive = archive; }
+
+		// Interface of several shaders without creating modules, used to build shared layouts
+		static ShaderReflection reflect(const std::vector<std::string>& fileNames);
 
 	private:
 
@@ -27,5 +35,8 @@ namespace lzvk::wrapper {
 		Device::Ptr mDevice{ nullptr };
 		std::string mEntryPoint;
 		VkShaderStageFlagBits mShaderStage;
+		ShaderReflection mReflection{};
+
+		inline static ShaderArchive::Ptr sArchive{ nullptr };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "shader_archive.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lzvk::wrapper {
+
+	ShaderArchive::Ptr ShaderArchive::open(const std::string& path) {
+
+		std::ifstream probe(path, std::ios::binary);
+
+		if (!probe) {
+			printf("[ShaderArchive] %s not found, shaders are loaded from their .spv files\n", path.c_str());
+			return nullptr;
+		}
+
+		probe.close();
+		return std::make_shared<ShaderArchive>(path);
+	}
+
+	ShaderArchive::ShaderArchive(const std::string& path) {
+
+		map(path);
+
+		// 1 Header and entry table
+		if (mSize < sizeof(FileHeader)) {
+			throw std::runtime_error("Error: shader archive " + path + " is truncated");
+		}
+
+		const auto* header = reinterpret_cast<const FileHeader*>(mData);
+
+		if (header->magic != MAGIC || header->fileVersion != FILE_VERSION) {
+			throw std::runtime_error("Error: " + path + " is not a shader archive of this version");
+		}
+
+		if (sizeof(FileHeader) + size_t(header->entryCount) * sizeof(FileEntry) > mSize) {
+			throw std::runtime_error("Error: shader archive " + path + " is truncated");
+		}
+
+		const auto* entries = reinterpret_cast<const FileEntry*>(mData + sizeof(FileHeader));
+
+		// 2 Modules point into the mapping, only the reflection is unpacked
+		auto inside = [this](uint32_t offset, uint32_t size) { return size_t(offset) + size <= mSize; };
+
+		for (uint32_t i = 0; i < header->entryCount; ++i) {
+
+			const auto& entry = entries[i];
+
+			if (!inside(entry.nameOffset, entry.nameSize) || !inside(entry.codeOffset, entry.codeSize) || !inside(entry.reflectionOffset, entry.reflectionSize)) {
+				throw std::runtime_error("Error: shader archive " + path + " has an entry outside the file");
+			}
+
+			std::string name(reinterpret_cast<const char*>(mData + entry.nameOffset), entry.nameSize);
+
+			Module module{};
+			module.code = reinterpret_cast<const uint32_t*>(mData + entry.codeOffset);
+			module.codeSize = entry.codeSize;
+			module.reflection = ShaderReflection::deserialize(reinterpret_cast<const uint32_t*>(mData + entry.reflectionOffset), entry.reflectionSize / sizeof(uint32_t));
+
+			mModules.emplace(std::move(name), std::move(module));
+		}
+
+		printf("[ShaderArchive] mapped %s, %u modules in %.1f KB\n", path.c_str(), getModuleCount(), mSize / 1024.0);
+	}
+
+	ShaderArchive::~ShaderArchive() {
+
+		unmap();
+	}
+
+	const ShaderArchive::Module* ShaderArchive::find(const std::string& name) const {
+
+		auto it = mModules.find(name);
+		return it == mModules.end() ? nullptr : &it->second;
+	}
+
+	void ShaderArchive::write(const std::string& path, const std::vector<std::pair<std::string, std::vector<uint32_t>>>& modules) {
+
+		auto align4 = [](size_t value) { return (value + 3) & ~size_t(3); };
+
+		// 1 Lay out names, code and reflection behind the entry table
+		std::vector<FileEntry> entries(modules.size());
+		std::vector<std::vector<uint32_t>> reflections(modules.size());
+
+		size_t offset = sizeof(FileHeader) + entries.size() * sizeof(FileEntry);
+
+		for (size_t i = 0; i < modules.size(); ++i) {
+
+			const auto& [name, code] = modules[i];
+			reflections[i] = ShaderReflection::reflect(code.data(), code.size()).serialize();
+
+			entries[i].nameOffset = static_cast<uint32_t>(offset);
+			entries[i].nameSize = static_cast<uint32_t>(name.size());
+			offset = align4(offset + name.size());
+
+			entries[i].codeOffset = static_cast<uint32_t>(offset);
+			entries[i].codeSize = static_cast<uint32_t>(code.size() * sizeof(uint32_t));
+			offset += entries[i].codeSize;
+
+			entries[i].reflectionOffset = static_cast<uint32_t>(offset);
+			entries[i].reflectionSize = static_cast<uint32_t>(reflections[i].size() * sizeof(uint32_t));
+			offset += entries[i].reflectionSize;
+		}
+
+		// 2 Write in the same order
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+		if (!file) {
+			throw std::runtime_error("Error: failed to write shader archive " + path);
+		}
+
+		FileHeader header{};
+		header.entryCount = static_cast<uint32_t>(entries.size());
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(FileEntry));
+
+		const char padding[4] = {};
+
+		for (size_t i = 0; i < modules.size(); ++i) {
+
+			const auto& [name, code] = modules[i];
+
+			file.write(name.data(), name.size());
+			file.write(padding, align4(name.size()) - name.size());
+			file.write(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+			file.write(reinterpret_cast<const char*>(reflections[i].data()), reflections[i].size() * sizeof(uint32_t));
+		}
+
+		if (!file) {
+			throw std::runtime_error("Error: failed to write shader archive " + path);
+		}
+	}
+
+#if defined(_WIN32)
+
+	void ShaderArchive::map(const std::string& path) {
+
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("Error: failed to open shader archive " + path);
+		}
+		mFileHandle = file;
+
+		LARGE_INTEGER size{};
+		GetFileSizeEx(file, &size);
+		mSize = static_cast<size_t>(size.QuadPart);
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			unmap();
+			throw std::runtime_error("Error: failed to map shader archive " + path);
+		}
+		mMappingHandle = mapping;
+
+		mData = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+		if (mData == nullptr) {
+			unmap();
+			throw std::runtime_error("Error: failed to map shader archive " + path);
+		}
+	}
+
+	void ShaderArchive::unmap() {
+
+		if (mData != nullptr) UnmapViewOfFile(mData);
+		if (mMappingHandle != nullptr) CloseHandle(static_cast<HANDLE>(mMappingHandle));
+		if (mFileHandle != nullptr) CloseHandle(static_cast<HANDLE>(mFileHandle));
+
+		mData = nullptr;
+		mMappingHandle = nullptr;
+		mFileHandle = nullptr;
+	}
+
+#else
+
+	void ShaderArchive::map(const std::string& path) {
+
+		int file = ::open(path.c_str(), O_RDONLY);
+		if (file < 0) {
+			throw std::runtime_error("Error: failed to open shader archive " + path);
+		}
+
+		struct stat info {};
+		fstat(file, &info);
+		mSize = static_cast<size_t>(info.st_size);
+
+		// the mapping keeps the file alive, the descriptor isn't needed after this
+		void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, file, 0);
+		::close(file);
+
+		if (data == MAP_FAILED) {
+			throw std::runtime_error("Error: failed to map shader archive " + path);
+		}
+
+		mData = static_cast<const uint8_t*>(data);
+	}
+
+	void ShaderArchive::unmap() {
+
+		if (mData != nullptr) {
+			munmap(const_cast<uint8_t*>(mData), mSize);
+		}
+
+		mData = nullptr;
+	}
+
+#endif
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../common.h"
+#include "shader_reflection.h"
+
+namespace lzvk::wrapper {
+
+	// All SPIR-V modules of the renderer in one file, written by the ShaderPacker build step.
+	// The file is memory mapped, shader modules are created straight from the mapping and
+	// every module comes with its reflection, so nothing is parsed or read at runtime.
+	//
+	// Layout: FileHeader, FileEntry[entryCount], names, code and reflection words, all offsets
+	// in bytes from the start of the file and 4 byte aligned.
+	class ShaderArchive {
+	public:
+
+		using Ptr = std::shared_ptr<ShaderArchive>;
+
+		// nullptr when there is no archive, shaders are then read from their .spv files
+		static Ptr open(const std::string& path);
+
+		static void write(const std::string& path, const std::vector<std::pair<std::string, std::vector<uint32_t>>>& modules);
+
+		explicit ShaderArchive(const std::string& path);
+		~ShaderArchive();
+
+		struct Module {
+			const uint32_t* code{ nullptr };
+			size_t codeSize{ 0 };
+			ShaderReflection reflection{};
+		};
+
+		// name is the path the module was packed under, e.g. "shaders/ssao/ssao_comp.spv"
+		[[nodiscard]] const Module* find(const std::string& name) const;
+
+		[[nodiscard]] auto getModuleCount() const { return static_cast<uint32_t>(mModules.size()); }
+		[[nodiscard]] auto getSize() const { return mSize; }
+
+	private:
+
+		static constexpr uint32_t MAGIC = 0x41535a4c; // "LZSA"
+		static constexpr uint32_t FILE_VERSION = 1;
+
+		struct FileHeader {
+			uint32_t magic{ MAGIC };
+			uint32_t fileVersion{ FILE_VERSION };
+			uint32_t entryCount{ 0 };
+			uint32_t reserved{ 0 };
+		};
+
+		struct FileEntry {
+			uint32_t nameOffset{ 0 };
+			uint32_t nameSize{ 0 };
+			uint32_t codeOffset{ 0 };
+			uint32_t codeSize{ 0 };
+			uint32_t reflectionOffset{ 0 };
+			uint32_t reflectionSize{ 0 };
+		};
+
+		void map(const std::string& path);
+		void unmap();
+
+	private:
+
+		const uint8_t* mData{ nullptr };
+		size_t mSize{ 0 };
+
+		// platform handles of the mapping
+		void* mFileHandle{ nullptr };
+		void* mMappingHandle{ nullptr };
+
+		std::unordered_map<std::string, Module> mModules{};
+	};
+}
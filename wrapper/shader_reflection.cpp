@@ -0,0 +1,469 @@
+#include "shader_reflection.h"
+
+namespace lzvk::wrapper {
+
+	namespace {
+
+		// SPIR-V opcodes, decorations, storage classes and execution models used below
+		constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+
+		constexpr uint32_t OP_ENTRY_POINT = 15;
+		constexpr uint32_t OP_TYPE_INT = 21;
+		constexpr uint32_t OP_TYPE_FLOAT = 22;
+		constexpr uint32_t OP_TYPE_VECTOR = 23;
+		constexpr uint32_t OP_TYPE_MATRIX = 24;
+		constexpr uint32_t OP_TYPE_IMAGE = 25;
+		constexpr uint32_t OP_TYPE_SAMPLER = 26;
+		constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+		constexpr uint32_t OP_TYPE_ARRAY = 28;
+		constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+		constexpr uint32_t OP_TYPE_STRUCT = 30;
+		constexpr uint32_t OP_TYPE_POINTER = 32;
+		constexpr uint32_t OP_CONSTANT = 43;
+		constexpr uint32_t OP_VARIABLE = 59;
+		constexpr uint32_t OP_DECORATE = 71;
+		constexpr uint32_t OP_MEMBER_DECORATE = 72;
+		constexpr uint32_t OP_TYPE_ACCELERATION_STRUCTURE = 5341;
+
+		constexpr uint32_t DECORATION_SPEC_ID = 1;
+		constexpr uint32_t DECORATION_BUFFER_BLOCK = 3;
+		constexpr uint32_t DECORATION_ARRAY_STRIDE = 6;
+		constexpr uint32_t DECORATION_MATRIX_STRIDE = 7;
+		constexpr uint32_t DECORATION_BINDING = 33;
+		constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+		constexpr uint32_t DECORATION_OFFSET = 35;
+
+		constexpr uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+		constexpr uint32_t STORAGE_UNIFORM = 2;
+		constexpr uint32_t STORAGE_PUSH_CONSTANT = 9;
+		constexpr uint32_t STORAGE_STORAGE_BUFFER = 12;
+
+		constexpr uint32_t DIM_BUFFER = 5;
+		constexpr uint32_t DIM_SUBPASS_DATA = 6;
+
+		VkShaderStageFlags toStage(uint32_t executionModel) {
+
+			switch (executionModel) {
+			case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+			case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+			case 5267:
+			case 5364: return VK_SHADER_STAGE_TASK_BIT_EXT;
+			case 5268:
+			case 5365: return VK_SHADER_STAGE_MESH_BIT_EXT;
+			default: return 0;
+			}
+		}
+
+		struct Id {
+			uint32_t opcode{ 0 };
+			std::vector<uint32_t> operands{};
+
+			// decorations
+			bool hasSet{ false };
+			bool hasBinding{ false };
+			bool bufferBlock{ false };
+			uint32_t set{ 0 };
+			uint32_t binding{ 0 };
+			uint32_t arrayStride{ 0 };
+			std::vector<uint32_t> memberOffsets{};
+			std::vector<uint32_t> memberMatrixStrides{};
+		};
+
+		class Parser {
+		public:
+
+			Parser(const uint32_t* code, size_t wordCount) : mCode(code), mWordCount(wordCount) {}
+
+			ShaderReflection run() {
+
+				if (mWordCount < 5 || mCode[0] != SPIRV_MAGIC) {
+					throw std::runtime_error("Error: shader code is not SPIR-V");
+				}
+
+				mIds.resize(mCode[3]);
+
+				// 1 Collect types, constants, variables and their decorations
+				std::vector<uint32_t> variables{};
+
+				for (size_t i = 5; i < mWordCount;) {
+
+					uint32_t opcode = mCode[i] & 0xffff;
+					uint32_t count = mCode[i] >> 16;
+
+					if (count == 0 || i + count > mWordCount) {
+						throw std::runtime_error("Error: malformed SPIR-V instruction stream");
+					}
+
+					const uint32_t* words = mCode + i;
+
+					switch (opcode) {
+
+					case OP_ENTRY_POINT:
+						mReflection.stages |= toStage(words[1]);
+						break;
+
+					case OP_DECORATE:
+						decorate(words[1], words[2], count > 3 ? words[3] : 0);
+						break;
+
+					case OP_MEMBER_DECORATE:
+						decorateMember(words[1], words[2], words[3], count > 4 ? words[4] : 0);
+						break;
+
+					case OP_TYPE_INT:
+					case OP_TYPE_FLOAT:
+					case OP_TYPE_VECTOR:
+					case OP_TYPE_MATRIX:
+					case OP_TYPE_IMAGE:
+					case OP_TYPE_SAMPLER:
+					case OP_TYPE_SAMPLED_IMAGE:
+					case OP_TYPE_ARRAY:
+					case OP_TYPE_RUNTIME_ARRAY:
+					case OP_TYPE_STRUCT:
+					case OP_TYPE_POINTER:
+					case OP_TYPE_ACCELERATION_STRUCTURE:
+						define(words[1], opcode, words + 2, count - 2);
+						break;
+
+					case OP_CONSTANT:
+						// value only, 64 bit constants keep their low word
+						define(words[2], opcode, words + 3, 1);
+						break;
+
+					case OP_VARIABLE: {
+						// pointer type and storage class
+						const uint32_t operands[] = { words[1], words[3] };
+						define(words[2], opcode, operands, 2);
+						variables.push_back(words[2]);
+						break;
+					}
+
+					default:
+						break;
+					}
+
+					i += count;
+				}
+
+				// 2 Resources are variables in the descriptor and push constant storage classes
+				for (auto variable : variables) {
+					addVariable(variable);
+				}
+
+				std::sort(mReflection.bindings.begin(), mReflection.bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+					return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+				});
+
+				return mReflection;
+			}
+
+		private:
+
+			Id& at(uint32_t id) {
+
+				if (id >= mIds.size()) {
+					throw std::runtime_error("Error: SPIR-V id out of bounds");
+				}
+				return mIds[id];
+			}
+
+			void define(uint32_t id, uint32_t opcode, const uint32_t* operands, uint32_t count) {
+
+				auto& entry = at(id);
+				entry.opcode = opcode;
+				entry.operands.assign(operands, operands + count);
+			}
+
+			void decorate(uint32_t id, uint32_t decoration, uint32_t value) {
+
+				auto& entry = at(id);
+
+				switch (decoration) {
+				case DECORATION_DESCRIPTOR_SET: entry.hasSet = true; entry.set = value; break;
+				case DECORATION_BINDING: entry.hasBinding = true; entry.binding = value; break;
+				case DECORATION_BUFFER_BLOCK: entry.bufferBlock = true; break;
+				case DECORATION_ARRAY_STRIDE: entry.arrayStride = value; break;
+				case DECORATION_SPEC_ID: mReflection.specializationIds.push_back(value); break;
+				default: break;
+				}
+			}
+
+			void decorateMember(uint32_t id, uint32_t member, uint32_t decoration, uint32_t value) {
+
+				auto& entry = at(id);
+
+				if (decoration == DECORATION_OFFSET) {
+
+					if (entry.memberOffsets.size() <= member) entry.memberOffsets.resize(member + 1, 0);
+					entry.memberOffsets[member] = value;
+				}
+				else if (decoration == DECORATION_MATRIX_STRIDE) {
+
+					if (entry.memberMatrixStrides.size() <= member) entry.memberMatrixStrides.resize(member + 1, 0);
+					entry.memberMatrixStrides[member] = value;
+				}
+			}
+
+			uint32_t constantValue(uint32_t id) {
+
+				const auto& entry = at(id);
+				return entry.opcode == OP_CONSTANT && !entry.operands.empty() ? entry.operands[0] : 1;
+			}
+
+			// Byte size of a type laid out with explicit offsets and strides
+			uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0) {
+
+				const auto& type = at(typeId);
+
+				switch (type.opcode) {
+
+				case OP_TYPE_INT:
+				case OP_TYPE_FLOAT:
+					return type.operands[0] / 8;
+
+				case OP_TYPE_VECTOR:
+					return sizeOf(type.operands[0]) * type.operands[1];
+
+				case OP_TYPE_MATRIX:
+					return (matrixStride != 0 ? matrixStride : sizeOf(type.operands[0])) * type.operands[1];
+
+				case OP_TYPE_ARRAY: {
+					uint32_t stride = type.arrayStride != 0 ? type.arrayStride : sizeOf(type.operands[0], matrixStride);
+					return stride * constantValue(type.operands[1]);
+				}
+
+				case OP_TYPE_STRUCT: {
+					uint32_t size = 0;
+					for (uint32_t m = 0; m < type.operands.size(); ++m) {
+
+						uint32_t offset = m < type.memberOffsets.size() ? type.memberOffsets[m] : 0;
+						uint32_t stride = m < type.memberMatrixStrides.size() ? type.memberMatrixStrides[m] : 0;
+						size = std::max(size, offset + sizeOf(type.operands[m], stride));
+					}
+					return size;
+				}
+
+				default:
+					return 0;
+				}
+			}
+
+			VkDescriptorType descriptorType(const Id& type, uint32_t storageClass) {
+
+				switch (type.opcode) {
+
+				case OP_TYPE_SAMPLER:
+					return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+				case OP_TYPE_SAMPLED_IMAGE:
+					return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+				case OP_TYPE_IMAGE: {
+					// operands: sampled type, dim, depth, arrayed, multisampled, sampled
+					uint32_t dim = type.operands[1];
+					bool storage = type.operands[5] == 2;
+
+					if (dim == DIM_BUFFER) return storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+					if (dim == DIM_SUBPASS_DATA) return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+					return storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+				}
+
+				case OP_TYPE_STRUCT:
+					// GLSL before 1.3 targets emits storage buffers as Uniform + BufferBlock
+					if (storageClass == STORAGE_STORAGE_BUFFER || type.bufferBlock) return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+					return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+				case OP_TYPE_ACCELERATION_STRUCTURE:
+					return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+
+				default:
+					return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+				}
+			}
+
+			void addVariable(uint32_t id) {
+
+				const auto& variable = at(id);
+				uint32_t storageClass = variable.operands[1];
+
+				const auto& pointer = at(variable.operands[0]);
+				if (pointer.opcode != OP_TYPE_POINTER) {
+					return;
+				}
+
+				uint32_t typeId = pointer.operands[1];
+
+				// 1 Push constant block
+				if (storageClass == STORAGE_PUSH_CONSTANT) {
+
+					const auto& block = at(typeId);
+					uint32_t offset = block.memberOffsets.empty() ? 0 : *std::min_element(block.memberOffsets.begin(), block.memberOffsets.end());
+
+					mReflection.pushConstant.offset = offset;
+					mReflection.pushConstant.size = sizeOf(typeId) - offset;
+					mReflection.pushConstant.stages = mReflection.stages;
+					return;
+				}
+
+				if (storageClass != STORAGE_UNIFORM_CONSTANT && storageClass != STORAGE_UNIFORM && storageClass != STORAGE_STORAGE_BUFFER) {
+					return;
+				}
+
+				if (!variable.hasBinding) {
+					return;
+				}
+
+				// 2 Descriptor, arrays multiply the count and runtime arrays leave it open
+				ShaderBinding binding{};
+				binding.set = variable.hasSet ? variable.set : 0;
+				binding.binding = variable.binding;
+				binding.stages = mReflection.stages;
+
+				while (at(typeId).opcode == OP_TYPE_ARRAY || at(typeId).opcode == OP_TYPE_RUNTIME_ARRAY) {
+
+					const auto& array = at(typeId);
+					binding.count = array.opcode == OP_TYPE_RUNTIME_ARRAY ? 0 : binding.count * constantValue(array.operands[1]);
+					typeId = array.operands[0];
+				}
+
+				binding.type = descriptorType(at(typeId), storageClass);
+
+				if (binding.type != VK_DESCRIPTOR_TYPE_MAX_ENUM) {
+					mReflection.bindings.push_back(binding);
+				}
+			}
+
+		private:
+
+			const uint32_t* mCode{ nullptr };
+			size_t mWordCount{ 0 };
+			std::vector<Id> mIds{};
+			ShaderReflection mReflection{};
+		};
+	}
+
+	ShaderReflection ShaderReflection::reflect(const uint32_t* code, size_t wordCount) {
+
+		Parser parser(code, wordCount);
+		return parser.run();
+	}
+
+	void ShaderReflection::merge(const ShaderReflection& other) {
+
+		stages |= other.stages;
+
+		for (const auto& binding : other.bindings) {
+
+			auto it = std::find_if(bindings.begin(), bindings.end(), [&](const ShaderBinding& b) {
+				return b.set == binding.set && b.binding == binding.binding;
+			});
+
+			if (it == bindings.end()) {
+				bindings.push_back(binding);
+				continue;
+			}
+
+			if (it->type != binding.type) {
+				throw std::runtime_error("Error: shaders disagree on the type of set " + std::to_string(binding.set) +
+										 " binding " + std::to_string(binding.binding));
+			}
+
+			it->stages |= binding.stages;
+			it->count = (it->count == 0 || binding.count == 0) ? 0 : std::max(it->count, binding.count);
+		}
+
+		std::sort(bindings.begin(), bindings.end(), [](const ShaderBinding& a, const ShaderBinding& b) {
+			return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+		});
+
+		if (other.pushConstant.size > 0) {
+
+			if (pushConstant.size == 0) {
+				pushConstant = other.pushConstant;
+			}
+			else {
+				uint32_t end = std::max(pushConstant.offset + pushConstant.size, other.pushConstant.offset + other.pushConstant.size);
+				pushConstant.offset = std::min(pushConstant.offset, other.pushConstant.offset);
+				pushConstant.size = end - pushConstant.offset;
+				pushConstant.stages |= other.pushConstant.stages;
+			}
+		}
+
+		for (auto id : other.specializationIds) {
+			if (std::find(specializationIds.begin(), specializationIds.end(), id) == specializationIds.end()) {
+				specializationIds.push_back(id);
+			}
+		}
+	}
+
+	const ShaderBinding* ShaderReflection::find(uint32_t set, uint32_t binding) const {
+
+		for (const auto& b : bindings) {
+			if (b.set == set && b.binding == binding) {
+				return &b;
+			}
+		}
+		return nullptr;
+	}
+
+	std::vector<ShaderBinding> ShaderReflection::getSet(uint32_t set) const {
+
+		std::vector<ShaderBinding> result{};
+		for (const auto& b : bindings) {
+			if (b.set == set) {
+				result.push_back(b);
+			}
+		}
+		return result;
+	}
+
+	std::vector<uint32_t> ShaderReflection::serialize() const {
+
+		// stages, counts and push constants, then 5 words per binding, then the specialization ids
+		std::vector<uint32_t> words = {
+			stages,
+			static_cast<uint32_t>(bindings.size()),
+			static_cast<uint32_t>(specializationIds.size()),
+			pushConstant.offset, pushConstant.size, pushConstant.stages
+		};
+
+		for (const auto& b : bindings) {
+			words.insert(words.end(), { b.set, b.binding, static_cast<uint32_t>(b.type), b.count, b.stages });
+		}
+
+		words.insert(words.end(), specializationIds.begin(), specializationIds.end());
+		return words;
+	}
+
+	ShaderReflection ShaderReflection::deserialize(const uint32_t* words, size_t wordCount) {
+
+		if (wordCount < 6) {
+			throw std::runtime_error("Error: shader reflection data is truncated");
+		}
+
+		ShaderReflection reflection{};
+		reflection.stages = words[0];
+		uint32_t bindingCount = words[1];
+		uint32_t specCount = words[2];
+		reflection.pushConstant = { words[3], words[4], words[5] };
+
+		if (wordCount != 6 + size_t(bindingCount) * 5 + specCount) {
+			throw std::runtime_error("Error: shader reflection data is truncated");
+		}
+
+		const uint32_t* cursor = words + 6;
+		reflection.bindings.resize(bindingCount);
+
+		for (auto& b : reflection.bindings) {
+			b = { cursor[0], cursor[1], static_cast<VkDescriptorType>(cursor[2]), cursor[3], cursor[4] };
+			cursor += 5;
+		}
+
+		reflection.specializationIds.assign(cursor, cursor + specCount);
+		return reflection;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "../common.h"
+
+namespace lzvk::wrapper {
+
+	struct ShaderBinding {
+		uint32_t set{ 0 };
+		uint32_t binding{ 0 };
+		VkDescriptorType type{ VK_DESCRIPTOR_TYPE_MAX_ENUM };
+
+		// 0 for runtime sized arrays, the layout decides the count
+		uint32_t count{ 1 };
+		VkShaderStageFlags stages{ 0 };
+	};
+
+	struct ShaderPushConstant {
+		uint32_t offset{ 0 };
+		uint32_t size{ 0 };
+		VkShaderStageFlags stages{ 0 };
+	};
+
+	// Resource interface of one or more SPIR-V modules, read from the decorations the GLSL
+	// layout qualifiers produce. Layouts are built from it instead of matching them by hand.
+	struct ShaderReflection {
+
+		VkShaderStageFlags stages{ 0 };
+		std::vector<ShaderBinding> bindings{};
+		ShaderPushConstant pushConstant{};
+		std::vector<uint32_t> specializationIds{};
+
+		// Parses a module, throws when the code is not SPIR-V
+		static ShaderReflection reflect(const uint32_t* code, size_t wordCount);
+
+		// Union of both interfaces, used for layouts shared by several shaders
+		void merge(const ShaderReflection& other);
+
+		[[nodiscard]] bool isEmpty() const { return stages == 0; }
+		[[nodiscard]] const ShaderBinding* find(uint32_t set, uint32_t binding) const;
+		[[nodiscard]] std::vector<ShaderBinding> getSet(uint32_t set) const;
+
+		// Flat word stream stored next to the code in the shader archive
+		[[nodiscard]] std::vector<uint32_t> serialize() const;
+		static ShaderReflection deserialize(const uint32_t* words, size_t wordCount);
+	};
+}
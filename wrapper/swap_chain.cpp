@@ -86,41 +86,7 @@ namespace lzvk::wrapper {
 
 		}
 
-		// 7 Create depth image
-		mDepthImages.resize(mImageCount);
-
-		VkImageSubresourceRange region{};
-		region.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-		region.baseMipLevel = 0;
-		region.levelCount = 1;
-		region.baseArrayLayer = 0;
-		region.layerCount = 1;
-		
-		for (int i = 0; i < mImageCount; ++i) {
-
-			mDepthImages[i] = Image::createDepthImage(mDevice, mSwapChainExtent.width, mSwapChainExtent.height, VK_SAMPLE_COUNT_1_BIT);
-
-			mDepthImages[i]->setImageLayout(VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, region, commandPool);
-		}
-
-		// 8 Create multi-sample image
-		mMultiSampleImages.resize(mImageCount);
-
-		VkImageSubresourceRange regionMutiSample{};
-		regionMutiSample.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		regionMutiSample.baseMipLevel = 0;
-		regionMutiSample.levelCount = 1;
-		regionMutiSample.baseArrayLayer = 0;
-		regionMutiSample.layerCount = 1;
-
-		for (int i = 0; i < mImageCount; ++i) {
-
-			mMultiSampleImages[i] = Image::createRenderTargetImage(mDevice, mSwapChainExtent.width, mSwapChainExtent.height,mSwapChainFormat);
-
-			mMultiSampleImages[i]->setImageLayout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 
-												  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, regionMutiSample, commandPool);
-		}
-
+		// depth and intermediate targets belong to the frame graph, the swapchain only holds what is presented
 	}
 
 	SwapChain::~SwapChain() {
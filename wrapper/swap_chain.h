@@ -43,10 +43,6 @@ namespace lzvk::wrapper {
 		[[nodiscard]] auto getImageCount() const { return mImageCount; }
 		[[nodiscard]] auto getImage(uint32_t index) const { return mSwapChainImages[index]; }
 		[[nodiscard]] auto getImageView(uint32_t index) const { return mSwapChainImageViews[index]; }
-
-		[[nodiscard]] auto getDepthImage(uint32_t index) const { return mDepthImages[index]->getImage(); }
-		[[nodiscard]] auto getDepthImageFormat() const { return mDepthImages[0]->getFormat(); }
-		[[nodiscard]] auto getDepthImageView(uint32_t index) const { return mDepthImages[index]->getImageView(); }
 	
 
 	private:
@@ -63,8 +59,6 @@ namespace lzvk::wrapper {
 		uint32_t mImageCount{ 0 };
 		std::vector<VkImage> mSwapChainImages{};
 		std::vector<VkImageView> mSwapChainImageViews{};
-		std::vector<Image::Ptr> mDepthImages{};
-		std::vector<Image::Ptr> mMultiSampleImages{}; 
 		std::vector<Framebuffer::Ptr> mFramebuffers{};
 
 		Device::Ptr mDevice{ nullptr };
@@ -0,0 +1,512 @@
+#include "upload_manager.h"
+
+namespace lzvk::wrapper {
+
+	UploadManager::UploadManager(VkDevice device, const MemoryAllocator::Ptr& allocator,
+								 uint32_t transferQueueFamily, VkQueue transferQueue,
+								 uint32_t graphicQueueFamily, VkQueue graphicQueue) {
+
+		mDevice = device;
+		mAllocator = allocator;
+		mTransferQueueFamily = transferQueueFamily;
+		mTransferQueue = transferQueue;
+		mGraphicQueueFamily = graphicQueueFamily;
+		mGraphicQueue = graphicQueue;
+		mOwnershipTransfer = transferQueueFamily != graphicQueueFamily;
+
+		// 1 Command pools, command buffers live for one batch
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = mTransferQueueFamily;
+
+		if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mTransferCommandPool) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to create upload command pool");
+		}
+
+		if (mOwnershipTransfer) {
+
+			poolInfo.queueFamilyIndex = mGraphicQueueFamily;
+			if (vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mGraphicCommandPool) != VK_SUCCESS) {
+				throw std::runtime_error("Error: failed to create upload command pool");
+			}
+		}
+
+		// 2 Staging ring
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = RING_SIZE;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateBuffer(mDevice, &bufferInfo, nullptr, &mRingBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to create staging ring buffer");
+		}
+
+		mRingAllocation = mAllocator->allocateForBuffer(mRingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "staging", false);
+		mRingData = static_cast<uint8_t*>(mRingAllocation.mappedData);
+
+		// 3 Timeline semaphore
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mTimeline) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to create upload timeline semaphore");
+		}
+
+		// the transfer queue gets its own timeline when the graphics queue acquires, each semaphore is signaled from one queue
+		if (mOwnershipTransfer) {
+
+			if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mTransferTimeline) != VK_SUCCESS) {
+				throw std::runtime_error("Error: failed to create upload timeline semaphore");
+			}
+		}
+	}
+
+	UploadManager::~UploadManager() {
+
+		waitIdle();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			retire();
+		}
+
+		if (mTimeline != VK_NULL_HANDLE) {
+			vkDestroySemaphore(mDevice, mTimeline, nullptr);
+		}
+
+		if (mTransferTimeline != VK_NULL_HANDLE) {
+			vkDestroySemaphore(mDevice, mTransferTimeline, nullptr);
+		}
+
+		if (mRingBuffer != VK_NULL_HANDLE) {
+			vkDestroyBuffer(mDevice, mRingBuffer, nullptr);
+		}
+		mAllocator->free(mRingAllocation);
+
+		if (mGraphicCommandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(mDevice, mGraphicCommandPool, nullptr);
+		}
+		if (mTransferCommandPool != VK_NULL_HANDLE) {
+			vkDestroyCommandPool(mDevice, mTransferCommandPool, nullptr);
+		}
+	}
+
+	void UploadManager::beginBatch() {
+
+		if (mRecording) {
+			return;
+		}
+
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = mTransferCommandPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		mCurrent = Batch{};
+		if (vkAllocateCommandBuffers(mDevice, &allocInfo, &mCurrent.transferCommandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to allocate upload command buffer");
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		vkBeginCommandBuffer(mCurrent.transferCommandBuffer, &beginInfo);
+
+		mRecording = true;
+	}
+
+	VkDeviceSize UploadManager::reserve(VkDeviceSize size, VkDeviceSize alignment) {
+
+		retire();
+
+		while (true) {
+
+			VkDeviceSize position = mRingHead % RING_SIZE;
+			VkDeviceSize padding = (alignment - position % alignment) % alignment;
+
+			// wrap to the start instead of splitting a copy across the end
+			if (position + padding + size > RING_SIZE) {
+				padding = RING_SIZE - position;
+			}
+
+			if (mRingHead + padding + size - mRingTail <= RING_SIZE) {
+
+				mRingHead += padding;
+				VkDeviceSize offset = mRingHead % RING_SIZE;
+				mRingHead += size;
+				return offset;
+			}
+
+			// ring is full, hand the recorded copies to the GPU and wait for the oldest batch
+			if (mRecording) {
+				submit();
+			}
+
+			if (mPending.empty()) {
+				throw std::runtime_error("Error: upload does not fit the staging ring");
+			}
+
+			uint64_t value = mPending.front().timelineValue;
+
+			VkSemaphoreWaitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &mTimeline;
+			waitInfo.pValues = &value;
+			vkWaitSemaphores(mDevice, &waitInfo, UINT64_MAX);
+
+			retire();
+		}
+	}
+
+	void UploadManager::uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+
+		if (data == nullptr || size == 0) {
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// large buffers go through the ring in chunks
+		const VkDeviceSize chunkSize = RING_SIZE / 2;
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+
+		for (VkDeviceSize copied = 0; copied < size; ) {
+
+			VkDeviceSize bytes = std::min(chunkSize, size - copied);
+			VkDeviceSize offset = reserve(bytes, COPY_ALIGNMENT);
+			memcpy(mRingData + offset, src + copied, bytes);
+
+			beginBatch();
+
+			VkBufferCopy region{};
+			region.srcOffset = offset;
+			region.dstOffset = dstOffset + copied;
+			region.size = bytes;
+			vkCmdCopyBuffer(mCurrent.transferCommandBuffer, mRingBuffer, dstBuffer, 1, &region);
+
+			copied += bytes;
+		}
+
+		// release to the graphics family, the acquire half is recorded at submit
+		if (mOwnershipTransfer) {
+
+			VkBufferMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0;
+			barrier.srcQueueFamilyIndex = mTransferQueueFamily;
+			barrier.dstQueueFamilyIndex = mGraphicQueueFamily;
+			barrier.buffer = dstBuffer;
+			barrier.offset = dstOffset;
+			barrier.size = size;
+
+			vkCmdPipelineBarrier(mCurrent.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+								 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			mAcquireBufferBarriers.push_back(barrier);
+		}
+
+		mUploadedBytes += size;
+	}
+
+	void UploadManager::uploadImage(VkImage dstImage, uint32_t width, uint32_t height, uint32_t arrayLayer, const void* data, VkDeviceSize size,
+									VkImageLayout finalLayout, uint32_t mipLevels) {
+
+		if (data == nullptr || size == 0 || height == 0) {
+			return;
+		}
+
+		// 1 Split the packed chain into its levels
+		VkDeviceSize texelCount = 0;
+		for (uint32_t level = 0; level < mipLevels; ++level) {
+			texelCount += VkDeviceSize(std::max(1u, width >> level)) * std::max(1u, height >> level);
+		}
+
+		const VkDeviceSize texelBytes = size / texelCount;
+		const uint8_t* src = static_cast<const uint8_t*>(data);
+
+		std::vector<ImageUploadLevel> levels(mipLevels);
+
+		for (uint32_t level = 0; level < mipLevels; ++level) {
+
+			levels[level].data = src;
+			levels[level].size = VkDeviceSize(std::max(1u, width >> level)) * std::max(1u, height >> level) * texelBytes;
+			src += levels[level].size;
+		}
+
+		uploadImage(dstImage, width, height, arrayLayer, levels, { 1, 1 }, finalLayout);
+	}
+
+	void UploadManager::uploadImage(VkImage dstImage, uint32_t width, uint32_t height, uint32_t arrayLayer, const std::vector<ImageUploadLevel>& levels,
+									VkExtent2D blockExtent, VkImageLayout finalLayout) {
+
+		if (levels.empty() || height == 0) {
+			return;
+		}
+
+		const uint32_t mipLevels = static_cast<uint32_t>(levels.size());
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		beginBatch();
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.image = dstImage;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.levelCount = mipLevels;
+		barrier.subresourceRange.baseArrayLayer = arrayLayer;
+		barrier.subresourceRange.layerCount = 1;
+
+		// 1 Undefined to transfer destination
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(mCurrent.transferCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+							 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		// 2 Copy every level in bands of block rows so large images still fit the ring
+		VkDeviceSize size = 0;
+
+		for (uint32_t level = 0; level < mipLevels; ++level) {
+
+			const uint32_t levelWidth = std::max(1u, width >> level);
+			const uint32_t levelHeight = std::max(1u, height >> level);
+			const uint32_t blockRows = (levelHeight + blockExtent.height - 1) / blockExtent.height;
+			const VkDeviceSize rowBytes = levels[level].size / blockRows;
+			const uint32_t rowsPerChunk = static_cast<uint32_t>(std::max<VkDeviceSize>(1, (RING_SIZE / 2) / rowBytes));
+			const uint8_t* src = static_cast<const uint8_t*>(levels[level].data);
+
+			for (uint32_t row = 0; row < blockRows; row += rowsPerChunk) {
+
+				uint32_t rows = std::min(rowsPerChunk, blockRows - row);
+				VkDeviceSize bytes = rows * rowBytes;
+
+				VkDeviceSize offset = reserve(bytes, COPY_ALIGNMENT);
+				memcpy(mRingData + offset, src + row * rowBytes, bytes);
+
+				// reserve may have submitted the batch, keep recording into a fresh one
+				beginBatch();
+
+				// the last band of a compressed level ends at the level edge, not on a block boundary
+				const uint32_t y = row * blockExtent.height;
+
+				VkBufferImageCopy region{};
+				region.bufferOffset = offset;
+				region.bufferRowLength = 0;
+				region.bufferImageHeight = 0;
+				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.imageSubresource.mipLevel = level;
+				region.imageSubresource.baseArrayLayer = arrayLayer;
+				region.imageSubresource.layerCount = 1;
+				region.imageOffset = { 0, static_cast<int32_t>(y), 0 };
+				region.imageExtent = { levelWidth, std::min(rows * blockExtent.height, levelHeight - y), 1 };
+
+				vkCmdCopyBufferToImage(mCurrent.transferCommandBuffer, mRingBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			}
+
+			size += levels[level].size;
+		}
+
+		// 3 Transfer destination to the final layout, split into release and acquire across families
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = finalLayout;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		if (mOwnershipTransfer) {
+
+			barrier.srcQueueFamilyIndex = mTransferQueueFamily;
+			barrier.dstQueueFamilyIndex = mGraphicQueueFamily;
+			barrier.dstAccessMask = 0;
+
+			vkCmdPipelineBarrier(mCurrent.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+								 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			mAcquireImageBarriers.push_back(barrier);
+		}
+		else {
+
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+			vkCmdPipelineBarrier(mCurrent.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+								 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+								 0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		mUploadedBytes += size;
+	}
+
+	uint64_t UploadManager::submit() {
+
+		// 1 Same family, later submissions on the queue see the copies through this barrier
+		if (!mOwnershipTransfer) {
+
+			VkMemoryBarrier barrier{};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+			vkCmdPipelineBarrier(mCurrent.transferCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+								 0, 1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		vkEndCommandBuffer(mCurrent.transferCommandBuffer);
+
+		// 2 Transfer queue signals the batch value, on the transfer timeline when an acquire follows
+		mCurrent.timelineValue = ++mTimelineValue;
+		VkSemaphore transferSemaphore = mOwnershipTransfer ? mTransferTimeline : mTimeline;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &mCurrent.timelineValue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &mCurrent.transferCommandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &transferSemaphore;
+
+		if (vkQueueSubmit(mTransferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("Error: failed to submit upload batch");
+		}
+
+		// 3 Graphics queue acquires ownership once the copies are done
+		if (mOwnershipTransfer) {
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = mGraphicCommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+
+			if (vkAllocateCommandBuffers(mDevice, &allocInfo, &mCurrent.acquireCommandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("Error: failed to allocate upload command buffer");
+			}
+
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(mCurrent.acquireCommandBuffer, &beginInfo);
+
+			vkCmdPipelineBarrier(mCurrent.acquireCommandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+								 0, nullptr,
+								 static_cast<uint32_t>(mAcquireBufferBarriers.size()), mAcquireBufferBarriers.data(),
+								 static_cast<uint32_t>(mAcquireImageBarriers.size()), mAcquireImageBarriers.data());
+
+			vkEndCommandBuffer(mCurrent.acquireCommandBuffer);
+
+			VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+			VkTimelineSemaphoreSubmitInfo acquireTimelineInfo{};
+			acquireTimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			acquireTimelineInfo.waitSemaphoreValueCount = 1;
+			acquireTimelineInfo.pWaitSemaphoreValues = &mCurrent.timelineValue;
+			acquireTimelineInfo.signalSemaphoreValueCount = 1;
+			acquireTimelineInfo.pSignalSemaphoreValues = &mCurrent.timelineValue;
+
+			VkSubmitInfo acquireInfo{};
+			acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireInfo.pNext = &acquireTimelineInfo;
+			acquireInfo.waitSemaphoreCount = 1;
+			acquireInfo.pWaitSemaphores = &mTransferTimeline;
+			acquireInfo.pWaitDstStageMask = &waitStage;
+			acquireInfo.commandBufferCount = 1;
+			acquireInfo.pCommandBuffers = &mCurrent.acquireCommandBuffer;
+			acquireInfo.signalSemaphoreCount = 1;
+			acquireInfo.pSignalSemaphores = &mTimeline;
+
+			if (vkQueueSubmit(mGraphicQueue, 1, &acquireInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+				throw std::runtime_error("Error: failed to submit upload acquire batch");
+			}
+
+			mAcquireBufferBarriers.clear();
+			mAcquireImageBarriers.clear();
+		}
+
+		mCurrent.ringEnd = mRingHead;
+		mPending.push_back(mCurrent);
+		mCurrent = Batch{};
+		mRecording = false;
+		++mSubmitCount;
+
+		return mTimelineValue;
+	}
+
+	void UploadManager::retire() {
+
+		if (mPending.empty()) {
+			return;
+		}
+
+		uint64_t completed = 0;
+		vkGetSemaphoreCounterValue(mDevice, mTimeline, &completed);
+
+		while (!mPending.empty() && mPending.front().timelineValue <= completed) {
+
+			Batch& batch = mPending.front();
+
+			vkFreeCommandBuffers(mDevice, mTransferCommandPool, 1, &batch.transferCommandBuffer);
+			if (batch.acquireCommandBuffer != VK_NULL_HANDLE) {
+				vkFreeCommandBuffers(mDevice, mGraphicCommandPool, 1, &batch.acquireCommandBuffer);
+			}
+
+			mRingTail = batch.ringEnd;
+			mPending.pop_front();
+		}
+	}
+
+	uint64_t UploadManager::flush() {
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		retire();
+
+		return mRecording ? submit() : mTimelineValue;
+	}
+
+	bool UploadManager::isComplete(uint64_t value) {
+
+		uint64_t completed = 0;
+		vkGetSemaphoreCounterValue(mDevice, mTimeline, &completed);
+
+		return completed >= value;
+	}
+
+	void UploadManager::wait(uint64_t value) {
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &mTimeline;
+		waitInfo.pValues = &value;
+
+		vkWaitSemaphores(mDevice, &waitInfo, UINT64_MAX);
+	}
+
+	void UploadManager::waitIdle() {
+
+		wait(flush());
+	}
+}
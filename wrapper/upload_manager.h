@@ -0,0 +1,115 @@
+#pragma once
+
+#include "../common.h"
+#include "memory_allocator.h"
+#include <deque>
+#include <mutex>
+
+namespace lzvk::wrapper {
+
+	struct ImageUploadLevel {
+		const void* data{ nullptr };
+		VkDeviceSize size{ 0 };
+	};
+
+	// Batches buffer and image uploads through a persistently mapped staging ring.
+	// Copies are recorded into one command buffer and submitted on the transfer queue,
+	// resources are released to the graphics queue family when the transfer queue is
+	// a separate family. Batches complete on a timeline semaphore, the CPU only waits
+	// when the ring runs out of space.
+	class UploadManager {
+	public:
+
+		using Ptr = std::shared_ptr<UploadManager>;
+		static Ptr create(VkDevice device, const MemoryAllocator::Ptr& allocator,
+						  uint32_t transferQueueFamily, VkQueue transferQueue,
+						  uint32_t graphicQueueFamily, VkQueue graphicQueue) {
+
+			return std::make_shared<UploadManager>(device, allocator, transferQueueFamily, transferQueue, graphicQueueFamily, graphicQueue);
+		}
+
+		UploadManager(VkDevice device, const MemoryAllocator::Ptr& allocator,
+					  uint32_t transferQueueFamily, VkQueue transferQueue,
+					  uint32_t graphicQueueFamily, VkQueue graphicQueue);
+
+		~UploadManager();
+
+		// Record a copy into the current batch, data is consumed before returning
+		void uploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+		// data holds mipLevels levels back to back, largest first, each level half the size of the one before
+		void uploadImage(VkImage dstImage, uint32_t width, uint32_t height, uint32_t arrayLayer, const void* data, VkDeviceSize size,
+						 VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, uint32_t mipLevels = 1);
+
+		// Levels largest first, block compressed formats pass their block extent so rows are copied in whole blocks
+		void uploadImage(VkImage dstImage, uint32_t width, uint32_t height, uint32_t arrayLayer, const std::vector<ImageUploadLevel>& levels,
+						 VkExtent2D blockExtent = { 1, 1 }, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		// Submit the current batch, returns the timeline value that signals its completion
+		uint64_t flush();
+
+		bool isComplete(uint64_t value);
+		void wait(uint64_t value);
+		void waitIdle();
+
+		[[nodiscard]] auto getTimelineSemaphore() const { return mTimeline; }
+		[[nodiscard]] auto getUploadedBytes() const { return mUploadedBytes; }
+		[[nodiscard]] auto getSubmitCount() const { return mSubmitCount; }
+		[[nodiscard]] auto isOwnershipTransferEnabled() const { return mOwnershipTransfer; }
+
+	private:
+
+		struct Batch {
+			VkCommandBuffer transferCommandBuffer{ VK_NULL_HANDLE };
+			VkCommandBuffer acquireCommandBuffer{ VK_NULL_HANDLE };
+			uint64_t timelineValue{ 0 };
+			uint64_t ringEnd{ 0 };
+		};
+
+		void beginBatch();
+		VkDeviceSize reserve(VkDeviceSize size, VkDeviceSize alignment);
+		uint64_t submit();
+		void retire();
+
+	private:
+
+		VkDevice mDevice{ VK_NULL_HANDLE };
+		MemoryAllocator::Ptr mAllocator{ nullptr };
+
+		uint32_t mTransferQueueFamily{ 0 };
+		uint32_t mGraphicQueueFamily{ 0 };
+		VkQueue mTransferQueue{ VK_NULL_HANDLE };
+		VkQueue mGraphicQueue{ VK_NULL_HANDLE };
+		bool mOwnershipTransfer{ false };
+
+		VkCommandPool mTransferCommandPool{ VK_NULL_HANDLE };
+		VkCommandPool mGraphicCommandPool{ VK_NULL_HANDLE };
+
+		// 1 Staging ring, head and tail grow monotonically and wrap by modulo
+		static constexpr VkDeviceSize RING_SIZE = 64ull * 1024 * 1024;
+		static constexpr VkDeviceSize COPY_ALIGNMENT = 16;
+
+		VkBuffer mRingBuffer{ VK_NULL_HANDLE };
+		MemoryAllocation mRingAllocation{};
+		uint8_t* mRingData{ nullptr };
+		uint64_t mRingHead{ 0 };
+		uint64_t mRingTail{ 0 };
+
+		// 2 Batch being recorded and batches in flight
+		Batch mCurrent{};
+		bool mRecording{ false };
+		std::vector<VkBufferMemoryBarrier> mAcquireBufferBarriers{};
+		std::vector<VkImageMemoryBarrier> mAcquireImageBarriers{};
+		std::deque<Batch> mPending{};
+
+		// 3 Completion, mTimeline reaches a batch value once the batch is usable on the graphics queue
+		VkSemaphore mTimeline{ VK_NULL_HANDLE };
+		VkSemaphore mTransferTimeline{ VK_NULL_HANDLE };
+		uint64_t mTimelineValue{ 0 };
+
+		VkDeviceSize mUploadedBytes{ 0 };
+		uint32_t mSubmitCount{ 0 };
+
+		std::mutex mMutex;
+	};
+}